@@ -0,0 +1,117 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <cmath>
+
+namespace cga {
+
+/**
+ * Affine transformation stored as a 3x4 matrix.
+ *
+ * The model matrices of the shapes are always affine, so the last row (0, 0, 0, 1) of glm::mat4 is not stored,
+ * which saves 16 bytes per matrix, and the product of two transformations needs 36 multiplications instead of 64.
+ * It is converted to and from glm::mat4 implicitly, and glm::translate(), glm::rotate(), and glm::inverse() are
+ * overloaded for it, so it can be used in the same way as glm::mat4.
+ */
+class AffineTransform {
+public:
+	/** the columns of the matrix; the last one is the translation */
+	glm::vec3 col[4];
+
+public:
+	AffineTransform() {
+		col[0] = glm::vec3(1, 0, 0);
+		col[1] = glm::vec3(0, 1, 0);
+		col[2] = glm::vec3(0, 0, 1);
+		col[3] = glm::vec3(0, 0, 0);
+	}
+
+	AffineTransform(const glm::mat4& m) {
+		for (int i = 0; i < 4; ++i) {
+			col[i] = glm::vec3(m[i]);
+		}
+	}
+
+	operator glm::mat4() const {
+		return glm::mat4(glm::vec4(col[0], 0), glm::vec4(col[1], 0), glm::vec4(col[2], 0), glm::vec4(col[3], 1));
+	}
+
+	glm::vec3& operator[](int i) { return col[i]; }
+	const glm::vec3& operator[](int i) const { return col[i]; }
+
+	AffineTransform operator*(const AffineTransform& m) const {
+		AffineTransform result;
+		result.col[0] = transformVector(m.col[0]);
+		result.col[1] = transformVector(m.col[1]);
+		result.col[2] = transformVector(m.col[2]);
+		result.col[3] = transformPoint(m.col[3]);
+		return result;
+	}
+
+	glm::vec4 operator*(const glm::vec4& v) const {
+		return glm::vec4(col[0] * v.x + col[1] * v.y + col[2] * v.z + col[3] * v.w, v.w);
+	}
+
+	glm::vec3 transformPoint(const glm::vec3& p) const {
+		return col[0] * p.x + col[1] * p.y + col[2] * p.z + col[3];
+	}
+
+	glm::vec3 transformVector(const glm::vec3& v) const {
+		return col[0] * v.x + col[1] * v.y + col[2] * v.z;
+	}
+};
+
+inline glm::mat4 operator*(const glm::mat4& m1, const AffineTransform& m2) {
+	return m1 * (glm::mat4)m2;
+}
+
+inline glm::mat4 operator*(const AffineTransform& m1, const glm::mat4& m2) {
+	return (glm::mat4)m1 * m2;
+}
+
+}
+
+namespace glm {
+
+/**
+ * Same as glm::translate() for glm::mat4, which moves the origin of the transformation.
+ */
+inline cga::AffineTransform translate(const cga::AffineTransform& m, const glm::vec3& v) {
+	cga::AffineTransform result = m;
+	result.col[3] = m.transformPoint(v);
+	return result;
+}
+
+/**
+ * Same as glm::rotate() for glm::mat4, which rotates the axes of the transformation by the angle in radians.
+ */
+inline cga::AffineTransform rotate(const cga::AffineTransform& m, float angle, const glm::vec3& v) {
+	float c = cos(angle);
+	float s = sin(angle);
+	glm::vec3 axis = glm::normalize(v);
+	glm::vec3 temp = (1.0f - c) * axis;
+
+	cga::AffineTransform result;
+	result.col[0] = m.transformVector(glm::vec3(c + temp.x * axis.x, temp.x * axis.y + s * axis.z, temp.x * axis.z - s * axis.y));
+	result.col[1] = m.transformVector(glm::vec3(temp.y * axis.x - s * axis.z, c + temp.y * axis.y, temp.y * axis.z + s * axis.x));
+	result.col[2] = m.transformVector(glm::vec3(temp.z * axis.x + s * axis.y, temp.z * axis.y - s * axis.x, c + temp.z * axis.z));
+	result.col[3] = m.col[3];
+	return result;
+}
+
+/**
+ * Inverse of the affine transformation.
+ */
+inline cga::AffineTransform inverse(const cga::AffineTransform& m) {
+	glm::mat3 inv = glm::inverse(glm::mat3(m.col[0], m.col[1], m.col[2]));
+
+	cga::AffineTransform result;
+	result.col[0] = inv[0];
+	result.col[1] = inv[1];
+	result.col[2] = inv[2];
+	result.col[3] = -(inv * m.col[3]);
+	return result;
+}
+
+}
@@ -1,14 +1,230 @@
 #include "Asset.h"
+#include "BoundingBox.h"
+#include "OBJLoader.h"
+#include <QFileInfo>
+#include <QDateTime>
+#include <QTemporaryFile>
+#include <cstddef>
 
 namespace cga {
 
+const char* Asset::MAGIC = "CGAASSET";
+
 Asset::Asset() {
+	offsets = NULL;
+	points = NULL;
+	normals = NULL;
+	texCoords = NULL;
+	num_faces = 0;
+	num_points = 0;
+	_file = NULL;
+}
+
+/**
+ * Take the flat arrays by swapping them, so the arrays of the caller become empty.
+ */
+Asset::Asset(std::vector<glm::vec3>& points, std::vector<glm::vec3>& normals, std::vector<glm::vec2>& texCoords, std::vector<int>& offsets) {
+	_points.swap(points);
+	_normals.swap(normals);
+	_texCoords.swap(texCoords);
+	_offsets.swap(offsets);
+	if (_offsets.size() == 0) {
+		_offsets.push_back(0);
+	}
+	_file = NULL;
+
+	this->offsets = &_offsets[0];
+	this->points = _points.size() > 0 ? &_points[0] : NULL;
+	this->normals = _normals.size() > 0 ? &_normals[0] : NULL;
+	this->texCoords = _texCoords.size() > 0 ? &_texCoords[0] : NULL;
+	num_faces = _offsets.size() - 1;
+	num_points = _points.size();
+
+	BoundingBox bbox(_points);
+	minPt = bbox.minPt;
+	maxPt = bbox.maxPt;
+}
+
+Asset::~Asset() {
+	if (_file != NULL) {
+		_file->close();
+		delete _file;
+	}
+}
+
+/**
+ * Load the asset of the OBJ file.
+ * The precompiled asset file is used if it is up to date. Otherwise, the OBJ file is parsed and the asset file is written for the next time.
+ *
+ * @param filename	the OBJ file
+ * @return			the asset, or NULL if the OBJ file cannot be read
+ */
+Asset* Asset::load(const std::string& filename) {
+	QString source_filename = QString::fromUtf8(filename.c_str());
+	QString cache_filename = cacheFileName(source_filename);
+
+	Asset* asset = loadCache(cache_filename, source_filename);
+	if (asset != NULL) return asset;
+
+	std::vector<glm::vec3> points;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> texCoords;
+	std::vector<int> offsets;
+	if (!OBJLoader::loadMapped(filename.c_str(), points, normals, texCoords, offsets)) {
+		return NULL;
+	}
+
+	asset = new Asset(points, normals, texCoords, offsets);
+
+	// the asset can be used even if the file cannot be written
+	asset->save(cache_filename, source_filename);
+
+	return asset;
+}
+
+QString Asset::cacheFileName(const QString& filename) {
+	return filename + ".asset";
+}
+
+/**
+ * Write the asset file.
+ * It is written to a temporary file first and then renamed, so that other processes never read a partially written file.
+ */
+bool Asset::save(const QString& filename, const QString& source_filename) const {
+	QFileInfo source_info(source_filename);
+
+	AssetFileHeader header;
+	memset(&header, 0, sizeof(AssetFileHeader));
+	memcpy(header.magic, MAGIC, 8);
+	header.version = VERSION;
+	header.num_faces = num_faces;
+	header.num_points = num_points;
+	header.has_texCoords = texCoords != NULL ? 1 : 0;
+	header.source_size = source_info.size();
+	header.source_mtime = source_info.lastModified().toMSecsSinceEpoch();
+	if (!hashFile(source_filename, header.source_hash)) return false;
+	for (int i = 0; i < 3; ++i) {
+		header.minPt[i] = minPt[i];
+		header.maxPt[i] = maxPt[i];
+	}
+
+	QTemporaryFile file(filename + ".XXXXXX");
+	file.setAutoRemove(false);
+	if (!file.open()) return false;
+
+	file.write((const char*)&header, sizeof(AssetFileHeader));
+	file.write((const char*)offsets, sizeof(int) * (num_faces + 1));
+	file.write((const char*)points, sizeof(glm::vec3) * num_points);
+	file.write((const char*)normals, sizeof(glm::vec3) * num_points);
+	if (texCoords != NULL) {
+		file.write((const char*)texCoords, sizeof(glm::vec2) * num_points);
+	}
+	file.close();
+
+	QFile::remove(filename);
+	if (!QFile::rename(file.fileName(), filename)) {
+		QFile::remove(file.fileName());
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Map the asset file, and use the arrays in the file without copying them.
+ *
+ * @return	the asset, or NULL if the file does not exist or it is out of date
+ */
+Asset* Asset::loadCache(const QString& filename, const QString& source_filename) {
+	QFileInfo source_info(source_filename);
+	if (!source_info.exists()) return NULL;
+
+	QFile* file = new QFile(filename);
+	if (!file->open(QIODevice::ReadOnly) || file->size() < sizeof(AssetFileHeader)) {
+		delete file;
+		return NULL;
+	}
+
+	const uchar* data = file->map(0, file->size());
+	if (data == NULL) {
+		delete file;
+		return NULL;
+	}
+
+	const AssetFileHeader* header = (const AssetFileHeader*)data;
+	bool valid = memcmp(header->magic, MAGIC, 8) == 0 && header->version == VERSION && header->source_size == source_info.size();
+	if (valid) {
+		qint64 expected_size = sizeof(AssetFileHeader) + sizeof(int) * (header->num_faces + 1) + (sizeof(glm::vec3) * 2 + (header->has_texCoords ? sizeof(glm::vec2) : 0)) * header->num_points;
+		valid = file->size() == expected_size;
+	}
+	qint64 source_mtime = source_info.lastModified().toMSecsSinceEpoch();
+	if (valid && header->source_mtime != source_mtime) {
+		// the file may have been copied or touched without being changed
+		quint64 hash;
+		valid = hashFile(source_filename, hash) && hash == header->source_hash;
+
+		// record the new modification time so that the OBJ file is not hashed again next time
+		if (valid) {
+			updateSourceTime(filename, source_mtime);
+		}
+	}
+	if (!valid) {
+		delete file;
+		return NULL;
+	}
+
+	Asset* asset = new Asset();
+	asset->_file = file;
+	asset->num_faces = header->num_faces;
+	asset->num_points = header->num_points;
+	asset->minPt = glm::vec3(header->minPt[0], header->minPt[1], header->minPt[2]);
+	asset->maxPt = glm::vec3(header->maxPt[0], header->maxPt[1], header->maxPt[2]);
+
+	const uchar* p = data + sizeof(AssetFileHeader);
+	asset->offsets = (const int*)p;
+	p += sizeof(int) * (asset->num_faces + 1);
+	asset->points = (const glm::vec3*)p;
+	p += sizeof(glm::vec3) * asset->num_points;
+	asset->normals = (const glm::vec3*)p;
+	p += sizeof(glm::vec3) * asset->num_points;
+	if (header->has_texCoords) {
+		asset->texCoords = (const glm::vec2*)p;
+	}
+
+	return asset;
+}
+
+/**
+ * Overwrite the modification time of the OBJ file in the header of the asset file.
+ * The rest of the file is not changed, so the mapped arrays stay valid.
+ */
+bool Asset::updateSourceTime(const QString& filename, qint64 source_mtime) {
+	QFile file(filename);
+	if (!file.open(QIODevice::ReadWrite)) return false;
+	if (!file.seek(offsetof(AssetFileHeader, source_mtime))) return false;
+
+	return file.write((const char*)&source_mtime, sizeof(qint64)) == sizeof(qint64);
 }
 
-Asset::Asset(const std::vector<std::vector<glm::vec3> >& points, const std::vector<std::vector<glm::vec3> >& normals, const std::vector<std::vector<glm::vec2> >& texCoords) {
-	this->points = points;
-	this->normals = normals;
-	this->texCoords = texCoords;
+/**
+ * Compute the 64-bit FNV-1a hash of the file.
+ */
+bool Asset::hashFile(const QString& filename, quint64& hash) {
+	hash = 14695981039346656037ULL;
+
+	QFile file(filename);
+	if (!file.open(QIODevice::ReadOnly)) return false;
+	if (file.size() == 0) return true;
+
+	const uchar* data = file.map(0, file.size());
+	if (data == NULL) return false;
+
+	for (qint64 i = 0; i < file.size(); ++i) {
+		hash ^= data[i];
+		hash *= 1099511628211ULL;
+	}
+
+	return true;
 }
 
-}
\ No newline at end of file
+}
@@ -3,18 +3,84 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/string_cast.hpp>
 #include <vector>
+#include <string>
+#include <boost/noncopyable.hpp>
+#include <QFile>
+#include <QString>
 
 namespace cga {
 
-class Asset {
+/**
+ * Layout of a precompiled asset file (little endian), which is written next to the OBJ file as "<OBJ file>.asset":
+ *
+ *   AssetFileHeader
+ *   int offsets[num_faces + 1]
+ *   vec3 points[num_points]
+ *   vec3 normals[num_points]
+ *   vec2 texCoords[num_points]    (only if has_texCoords is 1)
+ *
+ * The file is valid as long as the size and the modification time of the OBJ file are the same as the ones in the header.
+ * If only the modification time is different, the hash of the OBJ file is compared, and the new modification time is written to the header if they match.
+ */
+struct AssetFileHeader {
+	char magic[8];
+	quint32 version;
+	quint32 num_faces;
+	quint32 num_points;
+	quint32 has_texCoords;
+	quint64 source_size;
+	qint64 source_mtime;
+	quint64 source_hash;
+	float minPt[3];
+	float maxPt[3];
+};
+
+/**
+ * Geometry of an OBJ file for the insert operator.
+ *
+ * The faces are stored in flat arrays, and the vertices of the face i are in [offsets[i], offsets[i + 1]).
+ * texCoords is NULL if the OBJ file does not define them.
+ * The arrays are either owned by the asset or point into the memory-mapped asset file.
+ * Once loaded, an asset is shared by all the inserted shapes as a const object, and it is never modified.
+ */
+class Asset : boost::noncopyable {
 public:
-	std::vector<std::vector<glm::vec3> > points;
-	std::vector<std::vector<glm::vec3> > normals;
-	std::vector<std::vector<glm::vec2> > texCoords;
+	static const char* MAGIC;
+	static const int VERSION = 1;
+
+	const int* offsets;
+	const glm::vec3* points;
+	const glm::vec3* normals;
+	const glm::vec2* texCoords;
+	int num_faces;
+	int num_points;
+	glm::vec3 minPt;
+	glm::vec3 maxPt;
+
+private:
+	std::vector<int> _offsets;
+	std::vector<glm::vec3> _points;
+	std::vector<glm::vec3> _normals;
+	std::vector<glm::vec2> _texCoords;
+	QFile* _file;
 
 public:
+	Asset(std::vector<glm::vec3>& points, std::vector<glm::vec3>& normals, std::vector<glm::vec2>& texCoords, std::vector<int>& offsets);
+	~Asset();
+
+	int numFaces() const { return num_faces; }
+	int faceSize(int face) const { return offsets[face + 1] - offsets[face]; }
+	glm::vec3 size() const { return maxPt - minPt; }
+
+	static Asset* load(const std::string& filename);
+	static QString cacheFileName(const QString& filename);
+
+private:
 	Asset();
-	Asset(const std::vector<std::vector<glm::vec3> >& points, const std::vector<std::vector<glm::vec3> >& normals, const std::vector<std::vector<glm::vec2> >& texCoords);
+	bool save(const QString& filename, const QString& source_filename) const;
+	static Asset* loadCache(const QString& filename, const QString& source_filename);
+	static bool updateSourceTime(const QString& filename, qint64 source_mtime);
+	static bool hashFile(const QString& filename, quint64& hash);
 };
 
 }
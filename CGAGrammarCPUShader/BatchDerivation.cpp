@@ -0,0 +1,598 @@
+#include "BatchDerivation.h"
+#include <iostream>
+#include <set>
+#include <cstdio>
+#include <algorithm>
+#include <boost/spirit/include/qi.hpp>
+
+namespace cga {
+
+namespace {
+
+/**
+ * Recursive descent compiler of the expressions, which accepts the same syntax as myeval::calculator.
+ */
+class ExpressionCompiler {
+private:
+	std::string::const_iterator it;
+	std::string::const_iterator end;
+	const std::vector<std::string>& variable_names;
+	std::vector<BatchExpression::Instruction>& instructions;
+
+public:
+	ExpressionCompiler(const std::string& expression, const std::vector<std::string>& variable_names, std::vector<BatchExpression::Instruction>& instructions) : it(expression.begin()), end(expression.end()), variable_names(variable_names), instructions(instructions) {}
+
+	bool compile() {
+		if (!expression()) return false;
+		skipSpaces();
+		return it == end;
+	}
+
+private:
+	void skipSpaces() {
+		while (it != end && (*it == ' ' || (*it >= '\t' && *it <= '\r'))) ++it;
+	}
+
+	bool match(char c) {
+		skipSpaces();
+		if (it == end || *it != c) return false;
+		++it;
+		return true;
+	}
+
+	bool expression() {
+		if (!term()) return false;
+		while (true) {
+			if (match('+')) {
+				if (!term()) return false;
+				instructions.push_back(BatchExpression::Instruction(BatchExpression::OP_ADD));
+			} else if (match('-')) {
+				if (!term()) return false;
+				instructions.push_back(BatchExpression::Instruction(BatchExpression::OP_SUBTRACT));
+			} else {
+				return true;
+			}
+		}
+	}
+
+	bool term() {
+		if (!factor()) return false;
+		while (true) {
+			if (match('*')) {
+				if (!factor()) return false;
+				instructions.push_back(BatchExpression::Instruction(BatchExpression::OP_MULTIPLY));
+			} else if (match('/')) {
+				if (!factor()) return false;
+				instructions.push_back(BatchExpression::Instruction(BatchExpression::OP_DIVIDE));
+			} else {
+				return true;
+			}
+		}
+	}
+
+	bool factor() {
+		skipSpaces();
+		if (it == end) return false;
+
+		// the number is tried first as myeval::calculator does
+		std::string::const_iterator number_end = it;
+		float value;
+		if (boost::spirit::qi::parse(number_end, end, boost::spirit::qi::float_, value)) {
+			it = number_end;
+			instructions.push_back(BatchExpression::Instruction(BatchExpression::OP_CONSTANT, value));
+			return true;
+		}
+
+		// the longest name matches as qi::symbols does
+		int variable = -1;
+		for (int i = 0; i < variable_names.size(); ++i) {
+			const std::string& name = variable_names[i];
+			if (name.size() <= end - it && std::equal(name.begin(), name.end(), it)) {
+				if (variable < 0 || name.size() > variable_names[variable].size()) variable = i;
+			}
+		}
+		if (variable >= 0) {
+			it += variable_names[variable].size();
+			instructions.push_back(BatchExpression::Instruction(BatchExpression::OP_VARIABLE, 0.0f, variable));
+			return true;
+		}
+
+		if (match('(')) {
+			return expression() && match(')');
+		} else if (match('-')) {
+			if (!factor()) return false;
+			instructions.push_back(BatchExpression::Instruction(BatchExpression::OP_NEGATE));
+			return true;
+		} else if (match('+')) {
+			return factor();
+		}
+		return false;
+	}
+};
+
+}
+
+BatchExpression::BatchExpression() {
+	this->max_depth = 0;
+}
+
+/**
+ * Compile the expression.
+ *
+ * @param variable_names	the names of the variables that the expression can use
+ * @return					the compiled expression, or NULL if the expression is not valid
+ */
+boost::shared_ptr<BatchExpression> BatchExpression::compile(const std::string& expression, const std::vector<std::string>& variable_names) {
+	boost::shared_ptr<BatchExpression> result(new BatchExpression());
+	ExpressionCompiler compiler(expression, variable_names, result->instructions);
+	if (!compiler.compile()) return boost::shared_ptr<BatchExpression>();
+
+	int depth = 0;
+	for (int i = 0; i < result->instructions.size(); ++i) {
+		const Instruction& instruction = result->instructions[i];
+		if (instruction.op == OP_CONSTANT || instruction.op == OP_VARIABLE) {
+			depth++;
+		} else if (instruction.op != OP_NEGATE) {
+			depth--;
+		}
+		result->max_depth = std::max(result->max_depth, depth);
+
+		if (instruction.op == OP_VARIABLE && std::find(result->used_variables.begin(), result->used_variables.end(), instruction.variable) == result->used_variables.end()) {
+			result->used_variables.push_back(instruction.variable);
+		}
+	}
+
+	return result;
+}
+
+const std::vector<int>& BatchExpression::usedVariables() const {
+	return used_variables;
+}
+
+/**
+ * Evaluate the expression for all the samples.
+ *
+ * @param variables		the values of each variable for the samples, of which only the used variables have to be set
+ * @param results		[OUT] the value of the expression for each sample
+ */
+void BatchExpression::evaluate(const std::vector<std::vector<float> >& variables, int num_samples, std::vector<float>& results) const {
+	results.resize(num_samples);
+	if (num_samples == 0) return;
+
+	std::vector<float> stack(max_depth * num_samples);
+	int top = 0;
+	for (int i = 0; i < instructions.size(); ++i) {
+		const Instruction& instruction = instructions[i];
+		float* a = top >= 2 ? &stack[(top - 2) * num_samples] : NULL;
+		float* b = top >= 1 ? &stack[(top - 1) * num_samples] : NULL;
+
+		switch (instruction.op) {
+		case OP_CONSTANT:
+			std::fill(stack.begin() + top * num_samples, stack.begin() + (top + 1) * num_samples, instruction.value);
+			top++;
+			break;
+		case OP_VARIABLE:
+			std::copy(variables[instruction.variable].begin(), variables[instruction.variable].begin() + num_samples, stack.begin() + top * num_samples);
+			top++;
+			break;
+		case OP_ADD:
+			for (int k = 0; k < num_samples; ++k) a[k] += b[k];
+			top--;
+			break;
+		case OP_SUBTRACT:
+			for (int k = 0; k < num_samples; ++k) a[k] -= b[k];
+			top--;
+			break;
+		case OP_MULTIPLY:
+			for (int k = 0; k < num_samples; ++k) a[k] *= b[k];
+			top--;
+			break;
+		case OP_DIVIDE:
+			for (int k = 0; k < num_samples; ++k) a[k] /= b[k];
+			top--;
+			break;
+		case OP_NEGATE:
+			for (int k = 0; k < num_samples; ++k) b[k] = -b[k];
+			break;
+		}
+	}
+
+	std::copy(stack.begin(), stack.begin() + num_samples, results.begin());
+}
+
+BatchEvaluator::BatchEvaluator(const std::vector<const Grammar*>& grammars) {
+	this->grammars = grammars;
+
+	// the scope is added to the variables of Grammar::evalFloat() first, so an attribute of the same name is ignored
+	variable_names.push_back("scope.sx");
+	variable_names.push_back("scope.sy");
+	variable_names.push_back("scope.sz");
+	std::set<std::string> attr_names;
+	for (int i = 0; i < grammars.size(); ++i) {
+		for (auto it = grammars[i]->attrs.begin(); it != grammars[i]->attrs.end(); ++it) {
+			if (std::find(variable_names.begin(), variable_names.begin() + NUM_SCOPE_VARIABLES, it->first) == variable_names.begin() + NUM_SCOPE_VARIABLES) {
+				attr_names.insert(it->first);
+			}
+		}
+	}
+	variable_names.insert(variable_names.end(), attr_names.begin(), attr_names.end());
+
+	values.resize(variable_names.size(), std::vector<float>(grammars.size(), 0.0f));
+	valid.resize(variable_names.size(), std::vector<char>(grammars.size(), 1));
+	for (int v = NUM_SCOPE_VARIABLES; v < variable_names.size(); ++v) {
+		for (int i = 0; i < grammars.size(); ++i) {
+			auto it = grammars[i]->attrs.find(variable_names[v]);
+			valid[v][i] = it != grammars[i]->attrs.end() && sscanf(it->second.value.c_str(), "%f", &values[v][i]) == 1;
+		}
+	}
+	variables.resize(variable_names.size());
+}
+
+const Grammar& BatchEvaluator::grammar(int sample) const {
+	return *grammars[sample];
+}
+
+/**
+ * Evaluate the expression for the shapes of the samples.
+ *
+ * @param samples	the index of the sample of each shape
+ * @param results	[OUT] the value of the expression for each shape
+ */
+void BatchEvaluator::evalFloat(const std::string& expression, const std::vector<int>& samples, const std::vector<boost::shared_ptr<Shape> >& shapes, std::vector<float>& results) {
+	auto it = expressions.find(expression);
+	if (it == expressions.end()) {
+		it = expressions.insert(std::make_pair(expression, BatchExpression::compile(expression, variable_names))).first;
+	}
+	const boost::shared_ptr<BatchExpression>& compiled = it->second;
+
+	bool batch = compiled != NULL;
+	for (int i = 0; batch && i < compiled->usedVariables().size(); ++i) {
+		int v = compiled->usedVariables()[i];
+		for (int k = 0; k < samples.size(); ++k) {
+			if (!valid[v][samples[k]]) {
+				batch = false;
+				break;
+			}
+		}
+	}
+
+	if (!batch) {
+		results.resize(shapes.size());
+		for (int k = 0; k < shapes.size(); ++k) {
+			results[k] = grammars[samples[k]]->evalFloat(expression, shapes[k]);
+		}
+		return;
+	}
+
+	for (int i = 0; i < compiled->usedVariables().size(); ++i) {
+		int v = compiled->usedVariables()[i];
+		variables[v].resize(shapes.size());
+		for (int k = 0; k < shapes.size(); ++k) {
+			variables[v][k] = v < NUM_SCOPE_VARIABLES ? shapes[k]->_scope[v] : values[v][samples[k]];
+		}
+	}
+	compiled->evaluate(variables, shapes.size(), results);
+}
+
+BatchDerivation::BatchDerivation(const std::vector<const Grammar*>& grammars, const DerivationBudget& budget, bool suppressWarning) : grammars(grammars), budget(budget), evaluator(grammars), lods(grammars.size()), pivots(grammars.size()) {
+	this->suppressWarning = suppressWarning;
+	this->num_divergences = 0;
+
+	std::vector<int> representatives;
+	for (int i = 0; i < grammars.size(); ++i) {
+		int id = 0;
+		while (id < representatives.size() && !haveSameRules(*grammars[representatives[id]], *grammars[i])) id++;
+		if (id == representatives.size()) {
+			representatives.push_back(i);
+		}
+		rule_set_ids.push_back(id);
+	}
+}
+
+/**
+ * Set the level of detail of the sample, which is not used by default.
+ *
+ * @param pivot	the pivot of the derivation of the sample, as CGA::pivot
+ */
+void BatchDerivation::setLevelOfDetail(int sample, const ScreenSpaceLOD& lod, const AffineTransform& pivot) {
+	lods[sample] = lod;
+	pivots[sample] = pivot;
+}
+
+/**
+ * Derive the shapes in the stack of each sample, and put the terminal shapes of each sample to shapes.
+ * The shapes of a sample that exceeds the budget are discarded, and its error is returned by error().
+ * A sample that fails with another error, such as an expression that cannot be parsed, is left with its start shapes
+ * in its stack, so that it can be derived by CGA::derive(), which reports the error as usual.
+ */
+void BatchDerivation::derive(std::vector<std::list<boost::shared_ptr<Shape> > >& stacks, std::vector<std::vector<boost::shared_ptr<Shape> > >& shapes) {
+	DerivationBudgetScope budget_scope(budget);
+	int num_samples = grammars.size();
+	shapes.resize(num_samples);
+	for (int i = 0; i < num_samples; ++i) {
+		shapes[i].clear();
+	}
+	num_shapes.assign(num_samples, 0);
+	elapsed_nsec.assign(num_samples, 0);
+	errors.assign(num_samples, boost::shared_ptr<BudgetExceededError>());
+	unfinished.assign(num_samples, 0);
+	num_divergences = 0;
+	timer.start();
+
+	// the operators change the start shapes, so they are copied for the samples that fail
+	std::vector<std::list<boost::shared_ptr<Shape> > > start_stacks(num_samples);
+	for (int i = 0; i < num_samples; ++i) {
+		for (auto it = stacks[i].begin(); it != stacks[i].end(); ++it) {
+			start_stacks[i].push_back((*it)->clone((*it)->_name));
+		}
+	}
+
+	std::list<Group> queue;
+	std::vector<int> samples(num_samples);
+	for (int i = 0; i < num_samples; ++i) {
+		samples[i] = i;
+	}
+	enqueue(samples, stacks, queue);
+	// the start shapes are not the divergence of the rules
+	num_divergences = 0;
+
+	while (!queue.empty()) {
+		Group group;
+		group.samples.swap(queue.front().samples);
+		group.shapes.swap(queue.front().shapes);
+		queue.pop_front();
+
+		std::string rule_name = group.shapes[0]->_name;
+		qint64 start_nsec = timer.nsecsElapsed();
+
+		// the samples that have stopped are removed
+		int num_alive = 0;
+		for (int k = 0; k < group.samples.size(); ++k) {
+			int sample = group.samples[k];
+			if (isStopped(sample)) continue;
+
+			num_shapes[sample]++;
+			if (budget.max_shapes > 0 && num_shapes[sample] > budget.max_shapes) {
+				abortSample(sample, BudgetExceededError::BUDGET_SHAPES, budget.max_shapes, rule_name);
+				continue;
+			}
+			group.samples[num_alive] = sample;
+			group.shapes[num_alive] = group.shapes[k];
+			num_alive++;
+		}
+		group.samples.resize(num_alive);
+		group.shapes.resize(num_alive);
+		if (num_alive == 0) continue;
+
+		const Grammar& grammar = *grammars[group.samples[0]];
+		if (!grammar.contain(rule_name)) {
+			for (int k = 0; k < group.samples.size(); ++k) {
+				if (!suppressWarning && rule_name.back() != '!' && rule_name.back() != '.') {
+					std::cout << "Warning: " << "no rule is found for " << rule_name << "." << std::endl;
+				}
+				shapes[group.samples[k]].push_back(group.shapes[k]);
+			}
+			continue;
+		}
+
+		// the shapes that are too small in the views of their sample are not derived any more
+		num_alive = 0;
+		for (int k = 0; k < group.samples.size(); ++k) {
+			int sample = group.samples[k];
+			if (lods[sample].isTooSmall(*group.shapes[k], pivots[sample])) {
+				boost::shared_ptr<Shape> proxy = ScreenSpaceLOD::proxy(group.shapes[k], grammar);
+				if (proxy != NULL) shapes[sample].push_back(proxy);
+				continue;
+			}
+			group.samples[num_alive] = sample;
+			group.shapes[num_alive] = group.shapes[k];
+			num_alive++;
+		}
+		group.samples.resize(num_alive);
+		group.shapes.resize(num_alive);
+		if (num_alive == 0) continue;
+
+		int depth = group.shapes[0]->_depth + 1;
+		std::vector<std::list<boost::shared_ptr<Shape> > > children(group.samples.size());
+		applyRule(rule_name, grammar.rules.at(rule_name), group, children);
+
+		for (int k = 0; k < group.samples.size(); ++k) {
+			if (children[k].empty()) continue;
+
+			if (budget.max_depth > 0 && depth > budget.max_depth) {
+				abortSample(group.samples[k], BudgetExceededError::BUDGET_DEPTH, budget.max_depth, rule_name);
+				children[k].clear();
+				continue;
+			}
+			for (auto it = children[k].begin(); it != children[k].end(); ++it) {
+				(*it)->_depth = depth;
+			}
+		}
+
+		enqueue(group.samples, children, queue);
+
+		// the time of the group is shared by its samples, so that a slow sample does not stop the others
+		qint64 group_nsec = (timer.nsecsElapsed() - start_nsec) / group.samples.size();
+		for (int k = 0; k < group.samples.size(); ++k) {
+			int sample = group.samples[k];
+			elapsed_nsec[sample] += group_nsec;
+			if (budget.max_msec > 0 && !isStopped(sample) && elapsed_nsec[sample] > budget.max_msec * 1000000LL) {
+				abortSample(sample, BudgetExceededError::BUDGET_TIME, budget.max_msec, rule_name);
+			}
+		}
+	}
+
+	for (int i = 0; i < num_samples; ++i) {
+		stacks[i].clear();
+		if (errors[i]) {
+			shapes[i].clear();
+		} else if (unfinished[i]) {
+			shapes[i].clear();
+			stacks[i].swap(start_stacks[i]);
+		}
+	}
+}
+
+/**
+ * Return the error of the sample, or NULL if its derivation has completed.
+ */
+const boost::shared_ptr<BudgetExceededError>& BatchDerivation::error(int sample) const {
+	return errors[sample];
+}
+
+/**
+ * Return the number of the times that the samples of a group generated different shapes in the last derivation.
+ */
+int BatchDerivation::numDivergences() const {
+	return num_divergences;
+}
+
+/**
+ * Apply the rule to the shapes of the group in the same way as Rule::apply().
+ * Each operator is applied to the shapes of all the samples before the next operator.
+ * A sample whose operator fails is stopped without generating shapes.
+ *
+ * @param stacks	[OUT] the shapes generated for each sample of the group
+ */
+void BatchDerivation::applyRule(const std::string& rule_name, const Rule& rule, const Group& group, std::vector<std::list<boost::shared_ptr<Shape> > >& stacks) {
+	std::vector<boost::shared_ptr<Shape> > current = group.shapes;
+
+	std::vector<boost::shared_ptr<Shape> > shapes;
+	std::vector<int> samples;
+	std::vector<int> indices;
+	std::vector<std::list<boost::shared_ptr<Shape> > > generated;
+	std::vector<std::exception_ptr> operator_errors;
+	for (int i = 0; i < rule.operators.size(); ++i) {
+		// the operator is applied only to the shapes that have not been removed by the previous operators
+		shapes.clear();
+		samples.clear();
+		indices.clear();
+		for (int k = 0; k < current.size(); ++k) {
+			if (current[k] == NULL) continue;
+			shapes.push_back(current[k]);
+			samples.push_back(group.samples[k]);
+			indices.push_back(k);
+		}
+		if (shapes.empty()) break;
+
+		generated.clear();
+		generated.resize(shapes.size());
+		operator_errors.assign(shapes.size(), std::exception_ptr());
+		rule.operators[i]->applyBatch(shapes, samples, evaluator, generated, operator_errors);
+
+		for (int j = 0; j < indices.size(); ++j) {
+			if (operator_errors[j]) {
+				try {
+					std::rethrow_exception(operator_errors[j]);
+				} catch (const BudgetExceededError& ex) {
+					abortSample(samples[j], ex.type, ex.limit, rule_name);
+				} catch (...) {
+					// only this sample is derived again by CGA::derive()
+					unfinished[samples[j]] = 1;
+				}
+				current[indices[j]] = boost::shared_ptr<Shape>();
+				stacks[indices[j]].clear();
+				continue;
+			}
+
+			current[indices[j]] = shapes[j];
+			stacks[indices[j]].splice(stacks[indices[j]].end(), generated[j]);
+		}
+	}
+
+	for (int k = 0; k < current.size(); ++k) {
+		if (current[k] == NULL) continue;
+
+		if (rule.operators.size() == 0 || rule.operators.back()->name == "copy") {
+			current[k] = boost::shared_ptr<Shape>();
+		} else {
+			// the shape is kept as a terminal shape with "!" as Rule::apply() does
+			current[k]->_name += "!";
+			stacks[k].push_back(current[k]);
+		}
+	}
+}
+
+/**
+ * Add the shapes in the stacks of the samples to the queue.
+ * The samples are divided by the names of their shapes, and the i-th shapes of the samples in the same division become one group.
+ *
+ * @param stacks	the shapes of each sample, which are moved to the queue
+ */
+void BatchDerivation::enqueue(const std::vector<int>& samples, std::vector<std::list<boost::shared_ptr<Shape> > >& stacks, std::list<Group>& queue) {
+	std::map<std::string, int> division_ids;
+	std::vector<std::vector<int> > divisions;
+	for (int k = 0; k < samples.size(); ++k) {
+		if (isStopped(samples[k]) || stacks[k].empty()) continue;
+
+		std::string key((const char*)&rule_set_ids[samples[k]], sizeof(int));
+		for (auto it = stacks[k].begin(); it != stacks[k].end(); ++it) {
+			key += (*it)->_name;
+			key += '\0';
+		}
+
+		auto it = division_ids.find(key);
+		if (it == division_ids.end()) {
+			it = division_ids.insert(std::make_pair(key, (int)divisions.size())).first;
+			divisions.push_back(std::vector<int>());
+		}
+		divisions[it->second].push_back(k);
+	}
+	if (divisions.size() > 1) {
+		num_divergences += divisions.size() - 1;
+	}
+
+	for (int d = 0; d < divisions.size(); ++d) {
+		const std::vector<int>& division = divisions[d];
+		int num_shapes = stacks[division[0]].size();
+
+		queue.resize(queue.size() + num_shapes);
+		auto group = queue.end();
+		std::advance(group, -num_shapes);
+		for (auto it = group; it != queue.end(); ++it) {
+			it->samples.reserve(division.size());
+			it->shapes.reserve(division.size());
+		}
+
+		for (int j = 0; j < division.size(); ++j) {
+			int k = division[j];
+			auto it = group;
+			for (auto shape = stacks[k].begin(); shape != stacks[k].end(); ++shape, ++it) {
+				it->samples.push_back(samples[k]);
+				it->shapes.push_back(*shape);
+			}
+			stacks[k].clear();
+		}
+	}
+}
+
+/**
+ * Stop the derivation of the sample.
+ */
+void BatchDerivation::abortSample(int sample, int type, int limit, const std::string& rule_name) {
+	errors[sample] = boost::shared_ptr<BudgetExceededError>(new BudgetExceededError(type, limit, rule_name, num_shapes[sample], (int)(elapsed_nsec[sample] / 1000000)));
+}
+
+/**
+ * Return true if the derivation of the sample has been stopped by the budget or an error.
+ */
+bool BatchDerivation::isStopped(int sample) const {
+	return errors[sample] || unfinished[sample];
+}
+
+/**
+ * Return true if the grammars have the same rules, which apply the same operators.
+ * The copies of a grammar share the operators, so only the pointers of the operators are compared.
+ */
+bool BatchDerivation::haveSameRules(const Grammar& grammar1, const Grammar& grammar2) {
+	if (&grammar1 == &grammar2) return true;
+	if (grammar1.rules.size() != grammar2.rules.size()) return false;
+
+	for (auto it1 = grammar1.rules.begin(), it2 = grammar2.rules.begin(); it1 != grammar1.rules.end(); ++it1, ++it2) {
+		if (it1->first != it2->first) return false;
+		if (it1->second.operators != it2->second.operators) return false;
+	}
+	return true;
+}
+
+}
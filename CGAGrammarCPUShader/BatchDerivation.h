@@ -0,0 +1,132 @@
+#pragma once
+
+#include <vector>
+#include <list>
+#include <map>
+#include <string>
+#include <boost/shared_ptr.hpp>
+#include <QElapsedTimer>
+#include "CGA.h"
+
+namespace cga {
+
+/**
+ * Expression of the grammar compiled into the instructions of a stack machine.
+ *
+ * It is evaluated for many samples at once. Each value on the stack is an array of the values of all the samples
+ * (structure of arrays), so each instruction is a simple loop over the samples, which the compiler can vectorize.
+ * The syntax and the arithmetic are the same as Grammar::evalFloat(), and the numbers are parsed by the same parser.
+ */
+class BatchExpression {
+public:
+	enum { OP_CONSTANT = 0, OP_VARIABLE, OP_ADD, OP_SUBTRACT, OP_MULTIPLY, OP_DIVIDE, OP_NEGATE };
+
+	struct Instruction {
+		int op;
+		float value;
+		int variable;
+
+		Instruction(int op, float value = 0.0f, int variable = -1) : op(op), value(value), variable(variable) {}
+	};
+
+private:
+	std::vector<Instruction> instructions;
+	std::vector<int> used_variables;
+	int max_depth;
+
+public:
+	BatchExpression();
+
+	static boost::shared_ptr<BatchExpression> compile(const std::string& expression, const std::vector<std::string>& variable_names);
+	const std::vector<int>& usedVariables() const;
+	void evaluate(const std::vector<std::vector<float> >& variables, int num_samples, std::vector<float>& results) const;
+};
+
+/**
+ * Evaluator of the expressions for the samples of BatchDerivation.
+ *
+ * The attribute values of all the samples are converted to numbers only once, and each expression is compiled only once.
+ * An expression that cannot be compiled or that uses an attribute which is not a number in some sample is evaluated
+ * for each sample by Grammar::evalFloat(), so the result is always the same as Grammar::evalFloat().
+ */
+class BatchEvaluator {
+private:
+	enum { SCOPE_SX = 0, SCOPE_SY, SCOPE_SZ, NUM_SCOPE_VARIABLES };
+
+	std::vector<const Grammar*> grammars;
+	/** scope.sx, scope.sy, scope.sz, and the names of the attributes of all the samples */
+	std::vector<std::string> variable_names;
+	/** the value of each variable for each sample */
+	std::vector<std::vector<float> > values;
+	/** whether the value of each variable is a number for each sample */
+	std::vector<std::vector<char> > valid;
+	/** the compiled expressions, or NULL if the expression cannot be compiled */
+	std::map<std::string, boost::shared_ptr<BatchExpression> > expressions;
+	/** the values of the variables of the shapes being evaluated */
+	std::vector<std::vector<float> > variables;
+
+public:
+	BatchEvaluator(const std::vector<const Grammar*>& grammars);
+
+	const Grammar& grammar(int sample) const;
+	void evalFloat(const std::string& expression, const std::vector<int>& samples, const std::vector<boost::shared_ptr<Shape> >& shapes, std::vector<float>& results);
+};
+
+/**
+ * Derivation of the same grammar with many different attribute values, such as the samples of a dataset.
+ *
+ * The samples are derived in lockstep. Each group has the shapes of the samples at the same position of their
+ * derivation tree, which have the same name. The rule is looked up once for the group, and each operator is applied
+ * to the shapes of all the samples by Operator::applyBatch() before the next operator, so the expressions of
+ * the operator are evaluated for all the samples at once by BatchEvaluator.
+ * When the rule generates different shapes for some samples, such as a different number of repeated tiles,
+ * the group is divided into the groups of the samples that generated the same names, and a sample that differs
+ * from all the others is derived alone, in the same way as CGA::derive().
+ *
+ * The shapes of each sample are processed in the same order as CGA::derive(), so the terminal shapes of each sample
+ * are the same as CGA::derive(), including their order. A sample that exceeds the budget is stopped without stopping
+ * the others. The time of each group is shared by its samples, so each sample has its own time budget.
+ * A sample that fails with another error is left to CGA::derive().
+ * Each sample can have its own level of detail, by which its shapes that are too small are replaced with their proxies
+ * as CGA::derive() does, while the shapes of the other samples in the same group are derived.
+ */
+class BatchDerivation {
+private:
+	struct Group {
+		std::vector<int> samples;
+		std::vector<boost::shared_ptr<Shape> > shapes;
+	};
+
+	std::vector<const Grammar*> grammars;
+	DerivationBudget budget;
+	bool suppressWarning;
+	BatchEvaluator evaluator;
+	/** the samples whose grammars have the same rules have the same id */
+	std::vector<int> rule_set_ids;
+	std::vector<ScreenSpaceLOD> lods;
+	std::vector<AffineTransform> pivots;
+	std::vector<int> num_shapes;
+	std::vector<qint64> elapsed_nsec;
+	std::vector<boost::shared_ptr<BudgetExceededError> > errors;
+	/** whether the sample has failed with an error other than the budget */
+	std::vector<char> unfinished;
+	int num_divergences;
+	QElapsedTimer timer;
+
+public:
+	BatchDerivation(const std::vector<const Grammar*>& grammars, const DerivationBudget& budget, bool suppressWarning);
+
+	void setLevelOfDetail(int sample, const ScreenSpaceLOD& lod, const AffineTransform& pivot);
+	void derive(std::vector<std::list<boost::shared_ptr<Shape> > >& stacks, std::vector<std::vector<boost::shared_ptr<Shape> > >& shapes);
+	const boost::shared_ptr<BudgetExceededError>& error(int sample) const;
+	int numDivergences() const;
+
+private:
+	void applyRule(const std::string& rule_name, const Rule& rule, const Group& group, std::vector<std::list<boost::shared_ptr<Shape> > >& stacks);
+	void enqueue(const std::vector<int>& samples, std::vector<std::list<boost::shared_ptr<Shape> > >& stacks, std::list<Group>& queue);
+	void abortSample(int sample, int type, int limit, const std::string& rule_name);
+	bool isStopped(int sample) const;
+	static bool haveSameRules(const Grammar& grammar1, const Grammar& grammar2);
+};
+
+}
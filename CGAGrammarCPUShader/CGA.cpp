@@ -1,12 +1,18 @@
 ﻿#include "CGA.h"
 #include "GLUtils.h"
 #include "OBJLoader.h"
+#include "DerivationProfiler.h"
+#include "ParallelDerivation.h"
+#include "MemoizedDerivation.h"
+#include "BatchDerivation.h"
 #include <map>
 #include <iostream>
 #include <random>
 #include <sstream>
 #include <iostream>
 #include <boost/lexical_cast.hpp>
+#include <boost/thread/tss.hpp>
+#include <QElapsedTimer>
 
 namespace cga {
 
@@ -23,45 +29,250 @@ std::vector<float> CGA::randomParamValues(Grammar& grammar) {
 
 	for (auto it = grammar.attrs.begin(); it != grammar.attrs.end(); ++it) {
 		if (it->second.hasRange) {
-			float r = (float)rand() / RAND_MAX;
-			float v = r * (it->second.range_end - it->second.range_start) + it->second.range_start;
 			//float v = (it->second.range_end - it->second.range_start) * distribution(generator) + it->second.range_start;
-			it->second.value = boost::lexical_cast<std::string>(v);
-			param_values.push_back(v);
+			param_values.push_back(randomParamValue(it->second));
 		}
 	}
 
 	return param_values;
 }
 
+/**
+ * Randomly select the value of the attribute within its range.
+ */
+float CGA::randomParamValue(Attribute& attr) {
+	float r = (float)rand() / RAND_MAX;
+	float v = r * (attr.range_end - attr.range_start) + attr.range_start;
+	attr.value = boost::lexical_cast<std::string>(v);
+	return v;
+}
+
+DerivationBudget::DerivationBudget(int max_shapes, int max_depth, int max_terminal_polygons, int max_msec) {
+	this->max_shapes = max_shapes;
+	this->max_depth = max_depth;
+	this->max_terminal_polygons = max_terminal_polygons;
+	this->max_msec = max_msec;
+}
+
+namespace {
+
+// each thread has the pointer to the budget of its derivation, which is NULL when no derivation is running
+boost::thread_specific_ptr<const DerivationBudget*> current_budget;
+
+}
+
+/**
+ * Return the budget of the derivation running on the calling thread, or NULL if there is none.
+ */
+const DerivationBudget* DerivationBudget::current() {
+	return current_budget.get() != NULL ? *current_budget : NULL;
+}
+
+DerivationBudgetScope::DerivationBudgetScope(const DerivationBudget& budget) {
+	if (current_budget.get() == NULL) {
+		current_budget.reset(new const DerivationBudget*(NULL));
+	}
+	this->prev_budget = *current_budget;
+	*current_budget = &budget;
+}
+
+DerivationBudgetScope::~DerivationBudgetScope() {
+	*current_budget = prev_budget;
+}
+
+BudgetExceededError::BudgetExceededError(int type, int limit, const std::string& rule_name, int num_shapes, int elapsed_msec) {
+	this->type = type;
+	this->limit = limit;
+	this->rule_name = rule_name;
+	this->num_shapes = num_shapes;
+	this->elapsed_msec = elapsed_msec;
+}
+
+std::string BudgetExceededError::message() const {
+	static const char* budget_names[] = { "shapes", "depth", "terminal polygons", "time (msec)" };
+
+	std::stringstream ss;
+	ss << "The derivation exceeded the budget of " << budget_names[type] << " (" << limit << ")";
+	if (!rule_name.empty()) {
+		ss << " at rule " << rule_name;
+	}
+	ss << " after " << num_shapes << " shapes and " << elapsed_msec << " msec.";
+	return ss.str();
+}
+
 /**
  * Execute a derivation of the grammar
+ * BudgetExceededError is thrown if the derivation exceeds the budget, and the shapes derived so far are discarded.
  */
 void CGA::derive(const Grammar& grammar, bool suppressWarning) {
 	shapes.clear();
+	ShapeCollector collector(shapes);
+	derive(grammar, collector, suppressWarning);
+}
+
+/**
+ * Execute a derivation of the grammar, and pass each terminal shape to the consumer as soon as it is derived.
+ * The terminal shapes are not kept in shapes, so the memory for them is not needed if the consumer releases them.
+ * If lod has views, the shapes that are too small in all the views are not derived any more, and they are passed as terminal shapes.
+ * BudgetExceededError is thrown if the derivation exceeds the budget, and the shapes in the stack are discarded.
+ */
+void CGA::derive(const Grammar& grammar, TerminalShapeConsumer& consumer, bool suppressWarning) {
+	CGA_PROFILE_DERIVATION(stack);
+
+	DerivationBudgetScope budget_scope(budget);
+	QElapsedTimer timer;
+	timer.start();
+	int num_shapes = 0;
 
 	while (!stack.empty()) {
 		boost::shared_ptr<Shape> shape = stack.front();
 		stack.pop_front();
 
+		num_shapes++;
+		if (budget.max_shapes > 0 && num_shapes > budget.max_shapes) {
+			abortDerivation(BudgetExceededError::BUDGET_SHAPES, budget.max_shapes, shape->_name, num_shapes, (int)timer.elapsed());
+		}
+		// checking the clock for every shape is not necessary
+		if (budget.max_msec > 0 && num_shapes % 256 == 0 && timer.elapsed() > budget.max_msec) {
+			abortDerivation(BudgetExceededError::BUDGET_TIME, budget.max_msec, shape->_name, num_shapes, (int)timer.elapsed());
+		}
+
 		if (grammar.contain(shape->_name)) {
-			grammar.getRule(shape->_name).apply(shape, grammar, stack);
+			if (lod.isTooSmall(*shape, pivot)) {
+				boost::shared_ptr<Shape> proxy = ScreenSpaceLOD::proxy(shape, grammar);
+				if (proxy != NULL) consumer.consume(proxy);
+				continue;
+			}
+
+			std::string rule_name = shape->_name;
+			int depth = shape->_depth + 1;
+			int stack_size = stack.size();
+			try {
+				CGA_PROFILE_RULE(rule_name, stack);
+				grammar.getRule(rule_name).apply(shape, grammar, stack);
+			} catch (const BudgetExceededError& ex) {
+				// the operator does not know the rule and the number of the shapes
+				abortDerivation(ex.type, ex.limit, rule_name, num_shapes, (int)timer.elapsed());
+			}
+
+			// the shapes generated by the rule are appended to the stack
+			int num_new_shapes = (int)stack.size() - stack_size;
+			if (num_new_shapes > 0 && budget.max_depth > 0 && depth > budget.max_depth) {
+				abortDerivation(BudgetExceededError::BUDGET_DEPTH, budget.max_depth, rule_name, num_shapes, (int)timer.elapsed());
+			}
+			auto it = stack.end();
+			for (int i = 0; i < num_new_shapes; ++i) {
+				--it;
+				(*it)->_depth = depth;
+			}
 		} else {
 			if (!suppressWarning && shape->_name.back() != '!' && shape->_name.back() != '.') {
 				std::cout << "Warning: " << "no rule is found for " << shape->_name << "." << std::endl;
 			}
-			shapes.push_back(shape);
+			try {
+				consumer.consume(shape);
+			} catch (const BudgetExceededError&) {
+				// the consumer may have its own budget, such as the number of the polygons
+				stack.clear();
+				throw;
+			}
 		}
 	}
 }
 
+/**
+ * Execute a derivation of the grammar on multiple threads.
+ * The result is the same as derive(), including the order of the terminal shapes.
+ * The level of detail is not applied, so all the shapes are derived.
+ *
+ * @param num_threads	the number of the threads including the calling thread
+ */
+void CGA::deriveParallel(const Grammar& grammar, int num_threads, bool suppressWarning) {
+	if (num_threads <= 1) {
+		derive(grammar, suppressWarning);
+		return;
+	}
+
+	CGA_PROFILE_DERIVATION(stack);
+	ParallelDerivation derivation(grammar, budget, num_threads, suppressWarning);
+	derivation.derive(stack, shapes);
+}
+
+/**
+ * Execute a derivation of the grammar, in which the identical subtrees, such as the window tiles of a facade, are derived only once.
+ * The result is the same as derive(), including the order of the terminal shapes, except that the shapes whose scopes differ
+ * by less than MemoizedDerivation::SCOPE_QUANTUM (0.0001) get the subtree of the first one.
+ */
+void CGA::deriveMemoized(const Grammar& grammar, bool suppressWarning) {
+	CGA_PROFILE_DERIVATION(stack);
+	MemoizedDerivation derivation(grammar, budget, suppressWarning);
+	derivation.derive(stack, shapes);
+}
+
+/**
+ * Execute the derivations of the grammars at once, which are usually the same grammar with different attribute values.
+ * The samples whose derivations apply the same rules are derived in lockstep, and the expressions are evaluated for all of them at once.
+ * The result of each system is the same as derive(), but a system that exceeds the budget does not throw BudgetExceededError.
+ * Instead, its shapes are discarded and the error is stored in errors, which is NULL for the other systems.
+ * A system that fails with another error keeps its start shapes in its stack, so it can be derived by derive().
+ * The budget of the first system is used for all the systems, and the lod and the pivot of each system are used for it.
+ *
+ * @param systems	the systems, each of which has the start shapes in its stack
+ * @param grammars	the grammar of each system
+ * @param errors	[OUT] the error of each system
+ */
+void CGA::deriveBatch(const std::vector<CGA*>& systems, const std::vector<const Grammar*>& grammars, std::vector<boost::shared_ptr<BudgetExceededError> >& errors, bool suppressWarning) {
+	errors.assign(systems.size(), boost::shared_ptr<BudgetExceededError>());
+	if (systems.empty()) return;
+
+	std::vector<std::list<boost::shared_ptr<Shape> > > stacks(systems.size());
+	for (int i = 0; i < systems.size(); ++i) {
+		stacks[i].swap(systems[i]->stack);
+	}
+
+	BatchDerivation derivation(grammars, systems[0]->budget, suppressWarning);
+	for (int i = 0; i < systems.size(); ++i) {
+		derivation.setLevelOfDetail(i, systems[i]->lod, systems[i]->pivot);
+	}
+	std::vector<std::vector<boost::shared_ptr<Shape> > > shapes;
+	derivation.derive(stacks, shapes);
+
+	for (int i = 0; i < systems.size(); ++i) {
+		systems[i]->stack.swap(stacks[i]);
+		systems[i]->shapes.swap(shapes[i]);
+		errors[i] = derivation.error(i);
+	}
+}
+
 /**
  * Generate a geometry and add it to the render manager.
+ * BudgetExceededError is thrown if the number of the polygons exceeds the budget.
  */
 void CGA::generateGeometry(std::vector<std::vector<Vertex> >& vertices) {
+	GeometryGenerator generator(vertices, pivot, budget.max_terminal_polygons);
 	for (int i = 0; i < shapes.size(); ++i) {
-		shapes[i]->generateGeometry(1.0f, vertices);
+		generator.consume(shapes[i]);
 	}
 }
 
+/**
+ * Generate the geometry in which the identical meshes are stored only once.
+ * The geometry of each shape is generated in its local coordinates and placed by its model matrix.
+ * BudgetExceededError is thrown if the number of the polygons exceeds the budget.
+ */
+void CGA::generateInstancedGeometry(InstancedGeometry& geometry) {
+	InstancedGeometryGenerator generator(geometry, pivot, budget.max_terminal_polygons);
+	for (int i = 0; i < shapes.size(); ++i) {
+		generator.consume(shapes[i]);
+	}
+}
+
+/**
+ * Discard the unfinished derivation and throw BudgetExceededError.
+ */
+void CGA::abortDerivation(int type, int limit, const std::string& rule_name, int num_shapes, int elapsed_msec) {
+	stack.clear();
+	shapes.clear();
+	throw BudgetExceededError(type, limit, rule_name, num_shapes, elapsed_msec);
+}
 }
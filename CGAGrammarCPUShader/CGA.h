@@ -4,8 +4,11 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/string_cast.hpp>
 #include "Vertex.h"
+#include "InstancedGeometry.h"
 #include "Grammar.h"
 #include "Shape.h"
+#include "TerminalShapeConsumer.h"
+#include "ScreenSpaceLOD.h"
 
 namespace cga {
 
@@ -20,18 +23,81 @@ enum { CORNER_CUT_STRAIGHT = 0, CORNER_CUT_CURVE, CORNER_CUT_NEGATIVE_CURVE };
 
 const float M_PI = 3.1415926f;
 
+/**
+ * Limits of a derivation, which stop a grammar that recurses forever or generates too many shapes.
+ * 0 means no limit.
+ */
+class DerivationBudget {
+public:
+	int max_shapes;
+	int max_depth;
+	int max_terminal_polygons;
+	int max_msec;
+
+public:
+	DerivationBudget(int max_shapes = 0, int max_depth = 0, int max_terminal_polygons = 0, int max_msec = 0);
+
+	static const DerivationBudget* current();
+};
+
+/**
+ * Makes the budget the current budget of the calling thread while the derivation runs.
+ * The operators do not know the derivation, so they use the current budget to reject a split into too many pieces
+ * before the pieces are allocated. The previous budget is restored when the scope ends.
+ */
+class DerivationBudgetScope {
+private:
+	const DerivationBudget* prev_budget;
+
+public:
+	DerivationBudgetScope(const DerivationBudget& budget);
+	~DerivationBudgetScope();
+};
+
+/**
+ * Error thrown when a derivation exceeds its budget.
+ */
+class BudgetExceededError {
+public:
+	enum { BUDGET_SHAPES = 0, BUDGET_DEPTH, BUDGET_TERMINAL_POLYGONS, BUDGET_TIME };
+
+	int type;
+	int limit;
+	std::string rule_name;
+	int num_shapes;
+	int elapsed_msec;
+
+public:
+	BudgetExceededError(int type, int limit, const std::string& rule_name, int num_shapes, int elapsed_msec);
+
+	std::string message() const;
+};
+
 class CGA {
 public:
 	glm::mat4 modelMat;
+	/** the transformation applied after the model matrix of every shape, which is shared by all the shapes of the derivation */
+	AffineTransform pivot;
 	std::list<boost::shared_ptr<Shape> > stack;
 	std::vector<boost::shared_ptr<Shape> > shapes;
+	DerivationBudget budget;
+	ScreenSpaceLOD lod;
 
 public:
 	CGA();
 
 	std::vector<float> randomParamValues(Grammar& grammar);
+	static float randomParamValue(Attribute& attr);
 	void derive(const Grammar& grammar, bool suppressWarning = false);
+	void derive(const Grammar& grammar, TerminalShapeConsumer& consumer, bool suppressWarning = false);
+	void deriveParallel(const Grammar& grammar, int num_threads, bool suppressWarning = false);
+	void deriveMemoized(const Grammar& grammar, bool suppressWarning = false);
+	static void deriveBatch(const std::vector<CGA*>& systems, const std::vector<const Grammar*>& grammars, std::vector<boost::shared_ptr<BudgetExceededError> >& errors, bool suppressWarning = false);
 	void generateGeometry(std::vector<std::vector<Vertex> >& vertices);
+	void generateInstancedGeometry(InstancedGeometry& geometry);
+
+private:
+	void abortDerivation(int type, int limit, const std::string& rule_name, int num_shapes, int elapsed_msec);
 };
 
 }
@@ -15,4 +15,23 @@ boost::shared_ptr<Shape> CenterOperator::apply(boost::shared_ptr<Shape>& shape,
 	return shape;
 }
 
+void CenterOperator::toNode(GrammarNode& node) const {
+	node.tagName = "center";
+	if (axesSelector == AXES_SELECTOR_XYZ) {
+		node.setAttribute("axesSelector", "xyz");
+	} else if (axesSelector == AXES_SELECTOR_X) {
+		node.setAttribute("axesSelector", "x");
+	} else if (axesSelector == AXES_SELECTOR_Y) {
+		node.setAttribute("axesSelector", "y");
+	} else if (axesSelector == AXES_SELECTOR_Z) {
+		node.setAttribute("axesSelector", "z");
+	} else if (axesSelector == AXES_SELECTOR_XY) {
+		node.setAttribute("axesSelector", "xy");
+	} else if (axesSelector == AXES_SELECTOR_XZ) {
+		node.setAttribute("axesSelector", "xz");
+	} else {
+		node.setAttribute("axesSelector", "yz");
+	}
+}
+
 }
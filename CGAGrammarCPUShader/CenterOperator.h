@@ -12,6 +12,7 @@ public:
 	CenterOperator(int axesSelector);
 
 	boost::shared_ptr<Shape> apply(boost::shared_ptr<Shape>& shape, const Grammar& grammar, std::list<boost::shared_ptr<Shape> >& stack);
+	void toNode(GrammarNode& node) const;
 };
 
 }
\ No newline at end of file
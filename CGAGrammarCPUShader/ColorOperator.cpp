@@ -44,4 +44,15 @@ void ColorOperator::decodeRGB(const std::string& str, float& r, float& g, float&
 	b = (float)ib / 255;
 }
 
+void ColorOperator::toNode(GrammarNode& node) const {
+	node.tagName = "color";
+	if (s.empty()) {
+		node.setAttribute("r", r);
+		node.setAttribute("g", g);
+		node.setAttribute("b", b);
+	} else {
+		node.setAttribute("s", s);
+	}
+}
+
 }
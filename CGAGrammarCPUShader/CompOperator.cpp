@@ -19,4 +19,11 @@ boost::shared_ptr<Shape> CompOperator::apply(boost::shared_ptr<Shape>& shape, co
 	return boost::shared_ptr<Shape>();
 }
 
+void CompOperator::toNode(GrammarNode& node) const {
+	node.tagName = "comp";
+	for (auto it = name_map.begin(); it != name_map.end(); ++it) {
+		node.addParam(it->first, it->second);
+	}
+}
+
 }
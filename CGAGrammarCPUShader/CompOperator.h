@@ -12,6 +12,7 @@ private:
 public:
 	CompOperator(const std::map<std::string, std::string>& name_map);
 	boost::shared_ptr<Shape> apply(boost::shared_ptr<Shape>& shape, const Grammar& grammar, std::list<boost::shared_ptr<Shape> >& stack);
+	void toNode(GrammarNode& node) const;
 };
 
 }
@@ -16,4 +16,9 @@ boost::shared_ptr<Shape> CopyOperator::apply(boost::shared_ptr<Shape>& shape, co
 	return shape;
 }
 
+void CopyOperator::toNode(GrammarNode& node) const {
+	node.tagName = "copy";
+	node.setAttribute("name", copy_name);
+}
+
 }
@@ -17,5 +17,16 @@ boost::shared_ptr<Shape> CornerCutOperator::apply(boost::shared_ptr<Shape>& shap
 	return shape->cornerCut(shape->_name, type, actual_length);
 }
 
+void CornerCutOperator::toNode(GrammarNode& node) const {
+	node.tagName = "cornerCut";
+	if (type == CORNER_CUT_STRAIGHT) {
+		node.setAttribute("type", "straight");
+	} else if (type == CORNER_CUT_CURVE) {
+		node.setAttribute("type", "curve");
+	} else {
+		node.setAttribute("type", "negative_curve");
+	}
+	node.setAttribute("length", length);
+}
 
 }
@@ -14,6 +14,7 @@ public:
 	CornerCutOperator(int type, const std::string& length);
 
 	boost::shared_ptr<Shape> apply(boost::shared_ptr<Shape>& shape, const Grammar& grammar, std::list<boost::shared_ptr<Shape> >& stack);
+	void toNode(GrammarNode& node) const;
 };
 
 }
\ No newline at end of file
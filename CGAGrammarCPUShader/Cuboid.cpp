@@ -6,10 +6,9 @@
 
 namespace cga {
 
-Cuboid::Cuboid(const std::string& name, const glm::mat4& pivot, const glm::mat4& modelMat, float width, float depth, float height, const glm::vec3& color) {
+Cuboid::Cuboid(const std::string& name, const AffineTransform& modelMat, float width, float depth, float height, const glm::vec3& color) {
 	this->_name = name;
 	this->_removed = false;
-	this->_pivot = pivot;
 	this->_modelMat = modelMat;
 	this->_scope.x = width;
 	this->_scope.y = depth;
@@ -26,13 +25,13 @@ boost::shared_ptr<Shape> Cuboid::clone(const std::string& name) const {
 void Cuboid::comp(const std::map<std::string, std::string>& name_map, std::vector<boost::shared_ptr<Shape> >& shapes) {
 	// top face
 	if (name_map.find("top") != name_map.end() && name_map.at("top") != "NIL") {
-		glm::mat4 mat = glm::translate(_modelMat, glm::vec3(0, 0, _scope.z));
-		shapes.push_back(boost::shared_ptr<Shape>(new Rectangle(name_map.at("top"), _pivot, mat, _scope.x, _scope.y, _color)));
+		AffineTransform mat = glm::translate(_modelMat, glm::vec3(0, 0, _scope.z));
+		shapes.push_back(boost::shared_ptr<Shape>(new Rectangle(name_map.at("top"), mat, _scope.x, _scope.y, _color)));
 	}
 
 	// bottom face
 	if (name_map.find("bottom") != name_map.end() && name_map.at("bottom") != "NIL" && _scope.z >= 0) {
-		shapes.push_back(boost::shared_ptr<Shape>(new Rectangle(name_map.at("bottom"), _pivot, _modelMat, _scope.x, _scope.y, _color)));
+		shapes.push_back(boost::shared_ptr<Shape>(new Rectangle(name_map.at("bottom"), _modelMat, _scope.x, _scope.y, _color)));
 	}
 
 	// front face
@@ -41,7 +40,7 @@ void Cuboid::comp(const std::map<std::string, std::string>& name_map, std::vecto
 		if (_scope.z < 0) {
 			rot_angle = -rot_angle;
 		}
-		shapes.push_back(boost::shared_ptr<Shape>(new Rectangle(name_map.at("front"), _pivot, glm::rotate(_modelMat, rot_angle, glm::vec3(1, 0, 0)), _scope.x, fabs(_scope.z), _color)));
+		shapes.push_back(boost::shared_ptr<Shape>(new Rectangle(name_map.at("front"), glm::rotate(_modelMat, rot_angle, glm::vec3(1, 0, 0)), _scope.x, fabs(_scope.z), _color)));
 	}
 
 	// right face
@@ -50,8 +49,8 @@ void Cuboid::comp(const std::map<std::string, std::string>& name_map, std::vecto
 		if (_scope.z < 0) {
 			rot_angle = -rot_angle;
 		}
-		glm::mat4 mat = glm::rotate(glm::translate(_modelMat, glm::vec3(_scope.x, 0, 0)), M_PI * 0.5f, glm::vec3(0, 0, 1));
-		shapes.push_back(boost::shared_ptr<Shape>(new Rectangle(name_map.at("right"), _pivot, glm::rotate(mat, rot_angle, glm::vec3(1, 0, 0)), _scope.y, fabs(_scope.z), _color)));
+		AffineTransform mat = glm::rotate(glm::translate(_modelMat, glm::vec3(_scope.x, 0, 0)), M_PI * 0.5f, glm::vec3(0, 0, 1));
+		shapes.push_back(boost::shared_ptr<Shape>(new Rectangle(name_map.at("right"), glm::rotate(mat, rot_angle, glm::vec3(1, 0, 0)), _scope.y, fabs(_scope.z), _color)));
 	}
 
 	// left face
@@ -60,8 +59,8 @@ void Cuboid::comp(const std::map<std::string, std::string>& name_map, std::vecto
 		if (_scope.z < 0) {
 			rot_angle = -rot_angle;
 		}
-		glm::mat4 mat = glm::translate(glm::rotate(_modelMat, -M_PI * 0.5f, glm::vec3(0, 0, 1)), glm::vec3(-_scope.y, 0, 0));
-		shapes.push_back(boost::shared_ptr<Shape>(new Rectangle(name_map.at("left"), _pivot, glm::rotate(mat, rot_angle, glm::vec3(1, 0, 0)), _scope.y, fabs(_scope.z), _color)));
+		AffineTransform mat = glm::translate(glm::rotate(_modelMat, -M_PI * 0.5f, glm::vec3(0, 0, 1)), glm::vec3(-_scope.y, 0, 0));
+		shapes.push_back(boost::shared_ptr<Shape>(new Rectangle(name_map.at("left"), glm::rotate(mat, rot_angle, glm::vec3(1, 0, 0)), _scope.y, fabs(_scope.z), _color)));
 	}
 
 	// back face
@@ -70,8 +69,8 @@ void Cuboid::comp(const std::map<std::string, std::string>& name_map, std::vecto
 		if (_scope.z < 0) {
 			rot_angle = -rot_angle;
 		}
-		glm::mat4 mat = glm::translate(glm::rotate(glm::translate(_modelMat, glm::vec3(_scope.x, 0, 0)), M_PI, glm::vec3(0, 0, 1)), glm::vec3(0, -_scope.y, 0));
-		shapes.push_back(boost::shared_ptr<Shape>(new Rectangle(name_map.at("back"), _pivot, glm::rotate(mat, rot_angle, glm::vec3(1, 0, 0)), _scope.x, fabs(_scope.z), _color)));
+		AffineTransform mat = glm::translate(glm::rotate(glm::translate(_modelMat, glm::vec3(_scope.x, 0, 0)), M_PI, glm::vec3(0, 0, 1)), glm::vec3(0, -_scope.y, 0));
+		shapes.push_back(boost::shared_ptr<Shape>(new Rectangle(name_map.at("back"), glm::rotate(mat, rot_angle, glm::vec3(1, 0, 0)), _scope.x, fabs(_scope.z), _color)));
 	}
 
 	// side faces
@@ -83,25 +82,25 @@ void Cuboid::comp(const std::map<std::string, std::string>& name_map, std::vecto
 
 		// front face
 		if (name_map.find("front") == name_map.end()) {
-			shapes.push_back(boost::shared_ptr<Shape>(new Rectangle(name_map.at("side"), _pivot, glm::rotate(_modelMat, rot_angle, glm::vec3(1, 0, 0)), _scope.x, fabs(_scope.z), _color)));
+			shapes.push_back(boost::shared_ptr<Shape>(new Rectangle(name_map.at("side"), glm::rotate(_modelMat, rot_angle, glm::vec3(1, 0, 0)), _scope.x, fabs(_scope.z), _color)));
 		}
 
 		// right face
 		if (name_map.find("right") == name_map.end()) {
-			glm::mat4 mat = glm::rotate(glm::translate(_modelMat, glm::vec3(_scope.x, 0, 0)), M_PI * 0.5f, glm::vec3(0, 0, 1));
-			shapes.push_back(boost::shared_ptr<Shape>(new Rectangle(name_map.at("side"), _pivot, glm::rotate(mat, rot_angle, glm::vec3(1, 0, 0)), _scope.y, fabs(_scope.z), _color)));
+			AffineTransform mat = glm::rotate(glm::translate(_modelMat, glm::vec3(_scope.x, 0, 0)), M_PI * 0.5f, glm::vec3(0, 0, 1));
+			shapes.push_back(boost::shared_ptr<Shape>(new Rectangle(name_map.at("side"), glm::rotate(mat, rot_angle, glm::vec3(1, 0, 0)), _scope.y, fabs(_scope.z), _color)));
 		}
 
 		// left face
 		if (name_map.find("left") == name_map.end()) {
-			glm::mat4 mat = glm::translate(glm::rotate(_modelMat, -M_PI * 0.5f, glm::vec3(0, 0, 1)), glm::vec3(-_scope.y, 0, 0));
-			shapes.push_back(boost::shared_ptr<Shape>(new Rectangle(name_map.at("side"), _pivot, glm::rotate(mat, rot_angle, glm::vec3(1, 0, 0)), _scope.y, fabs(_scope.z), _color)));
+			AffineTransform mat = glm::translate(glm::rotate(_modelMat, -M_PI * 0.5f, glm::vec3(0, 0, 1)), glm::vec3(-_scope.y, 0, 0));
+			shapes.push_back(boost::shared_ptr<Shape>(new Rectangle(name_map.at("side"), glm::rotate(mat, rot_angle, glm::vec3(1, 0, 0)), _scope.y, fabs(_scope.z), _color)));
 		}
 
 		// back face
 		if (name_map.find("back") == name_map.end()) {
-			glm::mat4 mat = glm::translate(glm::rotate(glm::translate(_modelMat, glm::vec3(_scope.x, 0, 0)), M_PI, glm::vec3(0, 0, 1)), glm::vec3(0, -_scope.y, 0));
-			shapes.push_back(boost::shared_ptr<Shape>(new Rectangle(name_map.at("side"), _pivot, glm::rotate(mat, rot_angle, glm::vec3(1, 0, 0)), _scope.x, fabs(_scope.z), _color)));
+			AffineTransform mat = glm::translate(glm::rotate(glm::translate(_modelMat, glm::vec3(_scope.x, 0, 0)), M_PI, glm::vec3(0, 0, 1)), glm::vec3(0, -_scope.y, 0));
+			shapes.push_back(boost::shared_ptr<Shape>(new Rectangle(name_map.at("side"), glm::rotate(mat, rot_angle, glm::vec3(1, 0, 0)), _scope.x, fabs(_scope.z), _color)));
 		}
 	}
 }
@@ -118,38 +117,41 @@ void Cuboid::size(float xSize, float ySize, float zSize) {
 }
 
 /**
+ * Split the cuboid into the pieces along the axis.
+ * All the pieces are allocated in one block, which is shared by the pieces and released when all of them are released.
  */
 void Cuboid::split(int splitAxis, const std::vector<float>& sizes, const std::vector<std::string>& names, std::vector<boost::shared_ptr<Shape> >& objects) {
-	if (splitAxis == DIRECTION_X) {
-		glm::mat4 mat = this->_modelMat;
-		for (int i = 0; i < sizes.size(); ++i) {
-			if (names[i] != "NIL") {
-				objects.push_back(boost::shared_ptr<Shape>(new Cuboid(names[i], _pivot, mat, sizes[i], _scope.y, _scope.z, _color)));
-			}
-			mat = glm::translate(mat, glm::vec3(sizes[i], 0, 0));
-		}
-	} else if (splitAxis == DIRECTION_Y) {
-		glm::mat4 mat = this->_modelMat;
-		for (int i = 0; i < sizes.size(); ++i) {
-			if (names[i] != "NIL") {
-				objects.push_back(boost::shared_ptr<Shape>(new Cuboid(names[i], _pivot, mat, _scope.x, sizes[i], _scope.z, _color)));
-			}
-			mat = glm::translate(mat, glm::vec3(0, sizes[i], 0));
-		}
-	} else {
-		glm::mat4 mat = this->_modelMat;
-		for (int i = 0; i < sizes.size(); ++i) {
-			if (names[i] != "NIL") {
-				objects.push_back(boost::shared_ptr<Shape>(new Cuboid(names[i], _pivot, mat, _scope.x, _scope.y, sizes[i], _color)));
-			}
-			mat = glm::translate(mat, glm::vec3(0, 0, sizes[i]));
-		}
+	int num_pieces = 0;
+	for (int i = 0; i < sizes.size(); ++i) {
+		if (names[i] != "NIL") num_pieces++;
+	}
+	if (num_pieces == 0) return;
+
+	Cuboid prototype("", _modelMat, _scope.x, _scope.y, _scope.z, _color);
+	boost::shared_ptr<std::vector<Cuboid> > pieces(new std::vector<Cuboid>(num_pieces, prototype));
+	objects.reserve(objects.size() + num_pieces);
+
+	float offset = 0.0f;
+	int index = 0;
+	for (int i = 0; i < sizes.size(); ++i) {
+		if (names[i] != "NIL") {
+			Cuboid& piece = (*pieces)[index++];
+			piece._name = names[i];
+			glm::vec3 translation(0, 0, 0);
+			translation[splitAxis] = offset;
+			piece._modelMat = glm::translate(_modelMat, translation);
+			piece._scope[splitAxis] = sizes[i];
+			objects.push_back(boost::shared_ptr<Shape>(pieces, &piece));
+		}
+		offset += sizes[i];
 	}
 }
 
-void Cuboid::generateGeometry(float opacity, std::vector<std::vector<Vertex> >& vertices) const {
+void Cuboid::generateGeometry(const AffineTransform& pivot, float opacity, std::vector<std::vector<Vertex> >& vertices) const {
 	if (_removed) return;
 
+	AffineTransform worldMat = pivot * _modelMat;
+
 	int num = 0;
 
 	int offset = vertices.size();
@@ -157,7 +159,7 @@ void Cuboid::generateGeometry(float opacity, std::vector<std::vector<Vertex> >&
 
 	// top
 	{
-		glm::mat4 mat = _pivot * glm::translate(_modelMat, glm::vec3(_scope.x * 0.5, _scope.y * 0.5, _scope.z));
+		glm::mat4 mat = glm::translate(worldMat, glm::vec3(_scope.x * 0.5, _scope.y * 0.5, _scope.z));
 		glutils::drawQuad(_scope.x, _scope.y, glm::vec4(_color, opacity), mat, vertices[offset]);
 	}
 
@@ -165,7 +167,7 @@ void Cuboid::generateGeometry(float opacity, std::vector<std::vector<Vertex> >&
 	if (_scope.z >= 0) {
 		offset++;
 		vertices.resize(offset + 1);
-		glm::mat4 mat = _pivot * glm::translate(_modelMat, glm::vec3(_scope.x * 0.5, _scope.y * 0.5, 0));
+		glm::mat4 mat = glm::translate(worldMat, glm::vec3(_scope.x * 0.5, _scope.y * 0.5, 0));
 		glutils::drawQuad(_scope.x, _scope.y, glm::vec4(_color, opacity), mat, vertices[offset]);
 	}
 
@@ -177,7 +179,7 @@ void Cuboid::generateGeometry(float opacity, std::vector<std::vector<Vertex> >&
 		if (_scope.z < 0) {
 			rot_angle = -rot_angle;
 		}
-		glm::mat4 mat = _pivot * glm::rotate(glm::translate(_modelMat, glm::vec3(_scope.x * 0.5, 0, _scope.z * 0.5)), rot_angle, glm::vec3(1, 0, 0));
+		glm::mat4 mat = glm::rotate(glm::translate(worldMat, glm::vec3(_scope.x * 0.5, 0, _scope.z * 0.5)), rot_angle, glm::vec3(1, 0, 0));
 		glutils::drawQuad(_scope.x, _scope.z, glm::vec4(_color, opacity), mat, vertices[offset]);
 	}
 
@@ -189,7 +191,7 @@ void Cuboid::generateGeometry(float opacity, std::vector<std::vector<Vertex> >&
 		if (_scope.z < 0) {
 			rot_angle = -rot_angle;
 		}
-		glm::mat4 mat = _pivot * glm::rotate(glm::translate(glm::rotate(glm::translate(_modelMat, glm::vec3(_scope.x * 0.5, 0, _scope.z * 0.5)), M_PI, glm::vec3(0, 0, 1)), glm::vec3(0, -_scope.y, 0)), rot_angle, glm::vec3(1, 0, 0));
+		glm::mat4 mat = glm::rotate(glm::translate(glm::rotate(glm::translate(worldMat, glm::vec3(_scope.x * 0.5, 0, _scope.z * 0.5)), M_PI, glm::vec3(0, 0, 1)), glm::vec3(0, -_scope.y, 0)), rot_angle, glm::vec3(1, 0, 0));
 		glutils::drawQuad(_scope.x, _scope.z, glm::vec4(_color, opacity), mat, vertices[offset]);
 	}
 
@@ -201,7 +203,7 @@ void Cuboid::generateGeometry(float opacity, std::vector<std::vector<Vertex> >&
 		if (_scope.z < 0) {
 			rot_angle = -rot_angle;
 		}
-		glm::mat4 mat = _pivot * glm::rotate(glm::rotate(glm::translate(_modelMat, glm::vec3(_scope.x, _scope.y * 0.5, _scope.z * 0.5)), M_PI * 0.5f, glm::vec3(0, 0, 1)), rot_angle, glm::vec3(1, 0, 0));
+		glm::mat4 mat = glm::rotate(glm::rotate(glm::translate(worldMat, glm::vec3(_scope.x, _scope.y * 0.5, _scope.z * 0.5)), M_PI * 0.5f, glm::vec3(0, 0, 1)), rot_angle, glm::vec3(1, 0, 0));
 		glutils::drawQuad(_scope.y, _scope.z, glm::vec4(_color, opacity), mat, vertices[offset]);
 	}
 
@@ -213,7 +215,7 @@ void Cuboid::generateGeometry(float opacity, std::vector<std::vector<Vertex> >&
 		if (_scope.z < 0) {
 			rot_angle = -rot_angle;
 		}
-		glm::mat4 mat = _pivot * glm::rotate(glm::translate(glm::rotate(_modelMat, -M_PI * 0.5f, glm::vec3(0, 0, 1)), glm::vec3(-_scope.y * 0.5, 0, _scope.z * 0.5)), rot_angle, glm::vec3(1, 0, 0));
+		glm::mat4 mat = glm::rotate(glm::translate(glm::rotate(worldMat, -M_PI * 0.5f, glm::vec3(0, 0, 1)), glm::vec3(-_scope.y * 0.5, 0, _scope.z * 0.5)), rot_angle, glm::vec3(1, 0, 0));
 		glutils::drawQuad(_scope.y, _scope.z, glm::vec4(_color, opacity), mat, vertices[offset]);
 	}
 }
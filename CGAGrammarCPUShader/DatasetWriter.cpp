@@ -0,0 +1,127 @@
+#include "DatasetWriter.h"
+#include "ImagePipeline.h"
+#include "ShardedDataset.h"
+#include "NpyDatasetWriter.h"
+#include <iostream>
+#include <QBuffer>
+
+DatasetWriter* DatasetWriter::create(int format) {
+	if (format == FORMAT_SHARDED) {
+		return new ShardedDatasetWriter(ShardedDatasetWriter::IMAGE_RAW);
+	} else if (format == FORMAT_SHARDED_PNG) {
+		return new ShardedDatasetWriter(ShardedDatasetWriter::IMAGE_PNG);
+	} else if (format == FORMAT_NPY) {
+		return new NpyDatasetWriter();
+	} else {
+		return new PngDatasetWriter();
+	}
+}
+
+/**
+ * Compress the image into PNG.
+ *
+ * @param quality	0 for the smallest file, 100 for the fastest compression, and -1 for the default
+ */
+QByteArray DatasetWriter::encodePNG(const QImage& image, int quality) {
+	QByteArray data;
+	QBuffer buffer(&data);
+	buffer.open(QIODevice::WriteOnly);
+	image.save(&buffer, "PNG", quality);
+	return data;
+}
+
+/**
+ * Convert the image into 8-bit grayscale pixels, row by row from the top.
+ */
+QByteArray DatasetWriter::encodeGrayscale(const QImage& image) {
+	QByteArray data;
+	data.resize(image.width() * image.height());
+
+	uchar* dst = (uchar*)data.data();
+	for (int y = 0; y < image.height(); ++y) {
+		const QRgb* line = (const QRgb*)image.scanLine(y);
+		for (int x = 0; x < image.width(); ++x) {
+			*dst++ = qGray(line[x]);
+		}
+	}
+
+	return data;
+}
+
+/**
+ * Store the camera in NUM_CAMERA_VALUES floats.
+ */
+void DatasetWriter::cameraValues(const Camera& camera, float* values) {
+	values[0] = camera.xrot;
+	values[1] = camera.yrot;
+	values[2] = camera.zrot;
+	values[3] = camera.pos.x;
+	values[4] = camera.pos.y;
+	values[5] = camera.pos.z;
+}
+
+bool PngDatasetWriter::open(const QString& output_dir, int image_width, int image_height) {
+	this->output_dir = output_dir;
+
+	param_file.setFileName(output_dir + "/parameters.txt");
+	if (!param_file.open(QIODevice::WriteOnly)) {
+		std::cerr << "Cannot open file for writing: " << qPrintable(param_file.errorString()) << std::endl;
+		return false;
+	}
+	out.setDevice(&param_file);
+
+	camera_file.setFileName(output_dir + "/cameras.txt");
+	if (!camera_file.open(QIODevice::WriteOnly)) {
+		std::cerr << "Cannot open file for writing: " << qPrintable(camera_file.errorString()) << std::endl;
+		param_file.close();
+		return false;
+	}
+	camera_out.setDevice(&camera_file);
+
+	return true;
+}
+
+void PngDatasetWriter::encode(ImageSample* sample) const {
+	sample->encoded_images.resize(sample->images.size());
+	for (int i = 0; i < sample->images.size(); ++i) {
+		sample->encoded_images[i] = encodePNG(sample->images[i]);
+	}
+}
+
+void PngDatasetWriter::write(ImageSample* sample) {
+	for (int i = 0; i < sample->encoded_images.size(); ++i) {
+		// write all the param values to the file
+		for (int pi = 0; pi < sample->param_values.size(); ++pi) {
+			if (pi > 0) {
+				out << ",";
+			}
+			out << sample->param_values[pi];
+		}
+		out << "\n";
+
+		// write the camera of the view
+		float camera_values[NUM_CAMERA_VALUES];
+		cameraValues(sample->cameras[i], camera_values);
+		for (int ci = 0; ci < NUM_CAMERA_VALUES; ++ci) {
+			if (ci > 0) {
+				camera_out << ",";
+			}
+			camera_out << camera_values[ci];
+		}
+		camera_out << "\n";
+
+		QFile file(output_dir + "/" + QString("image_%1.png").arg(sample->image_index + i, 4, 10, QChar('0')));
+		if (file.open(QIODevice::WriteOnly)) {
+			file.write(sample->encoded_images[i]);
+		} else {
+			std::cerr << "Cannot open file for writing: " << qPrintable(file.errorString()) << std::endl;
+		}
+	}
+}
+
+void PngDatasetWriter::close() {
+	out.flush();
+	param_file.close();
+	camera_out.flush();
+	camera_file.close();
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <QString>
+#include <QImage>
+#include <QByteArray>
+#include <QFile>
+#include <QTextStream>
+#include "Camera.h"
+
+class ImageSample;
+
+/**
+ * Output of the image dataset.
+ *
+ * encode() is called by the encode workers of ImagePipeline in parallel, so it must not change the state of the writer.
+ * write() is called by the single writer thread in the order of the sample index.
+ * Each view of a sample is written as one image with the parameter values of the sample and the camera of the view.
+ */
+class DatasetWriter {
+public:
+	enum { FORMAT_PNG = 0, FORMAT_SHARDED, FORMAT_NPY, FORMAT_SHARDED_PNG };
+
+	/** xrot, yrot, zrot, and the position of the camera */
+	static const int NUM_CAMERA_VALUES = 6;
+
+public:
+	virtual ~DatasetWriter() {}
+
+	virtual bool open(const QString& output_dir, int image_width, int image_height) = 0;
+	virtual void encode(ImageSample* sample) const = 0;
+	virtual void write(ImageSample* sample) = 0;
+	virtual void close() = 0;
+
+	static DatasetWriter* create(int format);
+
+protected:
+	static QByteArray encodePNG(const QImage& image, int quality = -1);
+	static QByteArray encodeGrayscale(const QImage& image);
+	static void cameraValues(const Camera& camera, float* values);
+};
+
+/**
+ * One PNG file per image, the parameter values of all the images in parameters.txt, and their cameras in cameras.txt.
+ */
+class PngDatasetWriter : public DatasetWriter {
+private:
+	QString output_dir;
+	QFile param_file;
+	QTextStream out;
+	QFile camera_file;
+	QTextStream camera_out;
+
+public:
+	PngDatasetWriter() {}
+
+	bool open(const QString& output_dir, int image_width, int image_height);
+	void encode(ImageSample* sample) const;
+	void write(ImageSample* sample);
+	void close();
+};
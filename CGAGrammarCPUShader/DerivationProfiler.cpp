@@ -0,0 +1,201 @@
+#include "DerivationProfiler.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <QFile>
+
+namespace cga {
+
+namespace {
+
+bool compareTotalTime(const std::pair<std::string, ProfileStats>& s1, const std::pair<std::string, ProfileStats>& s2) {
+	return s1.second.nsec > s2.second.nsec;
+}
+
+std::string escapeJSON(const std::string& str) {
+	std::string escaped;
+	for (int i = 0; i < str.size(); ++i) {
+		if (str[i] == '"' || str[i] == '\\') {
+			escaped += '\\';
+		}
+		escaped += str[i];
+	}
+	return escaped;
+}
+
+void printStats(std::ostream& out, const char* title, const std::map<std::string, ProfileStats>& stats) {
+	std::vector<std::pair<std::string, ProfileStats> > sorted(stats.begin(), stats.end());
+	std::sort(sorted.begin(), sorted.end(), compareTotalTime);
+
+	out << std::left << std::setw(32) << title << std::right << std::setw(10) << "count" << std::setw(12) << "shapes"
+		<< std::setw(12) << "evals" << std::setw(12) << "total ms" << std::setw(12) << "avg us" << std::endl;
+	for (int i = 0; i < sorted.size(); ++i) {
+		const ProfileStats& s = sorted[i].second;
+		out << std::left << std::setw(32) << sorted[i].first << std::right << std::setw(10) << s.count << std::setw(12) << s.num_shapes
+			<< std::setw(12) << s.num_evals << std::setw(12) << std::fixed << std::setprecision(3) << s.nsec * 1e-6
+			<< std::setw(12) << (s.count > 0 ? s.nsec * 1e-3 / s.count : 0.0) << std::endl;
+	}
+	out.unsetf(std::ios::fixed);
+}
+
+}
+
+boost::mutex DerivationProfiler::mutex;
+std::vector<DerivationProfiler::ThreadProfile*> DerivationProfiler::profiles;
+boost::thread_specific_ptr<DerivationProfiler::ThreadProfile> DerivationProfiler::current(&DerivationProfiler::releaseProfile);
+QElapsedTimer DerivationProfiler::timer;
+
+bool DerivationProfiler::isEnabled() {
+#ifdef CGA_PROFILE
+	return true;
+#else
+	return false;
+#endif
+}
+
+/**
+ * Clear the recorded data and restart the clock.
+ * This must not be called while a derivation is running.
+ */
+void DerivationProfiler::reset() {
+	boost::mutex::scoped_lock lock(mutex);
+	for (int i = 0; i < profiles.size(); ++i) {
+		profiles[i]->num_evals = 0;
+		profiles[i]->events.clear();
+		profiles[i]->rule_stats.clear();
+		profiles[i]->operator_stats.clear();
+	}
+	timer.start();
+}
+
+/**
+ * Return the buffer of the calling thread.
+ * The buffers are owned by the profiler, not by the threads, so that the data of the finished threads are kept until they are written.
+ */
+DerivationProfiler::ThreadProfile* DerivationProfiler::threadProfile() {
+	ThreadProfile* profile = current.get();
+	if (profile == NULL) {
+		boost::mutex::scoped_lock lock(mutex);
+		if (!timer.isValid()) timer.start();
+
+		profile = new ThreadProfile();
+		profile->thread_id = profiles.size();
+		profile->num_evals = 0;
+		profiles.push_back(profile);
+		current.reset(profile);
+	}
+	return profile;
+}
+
+void DerivationProfiler::releaseProfile(ThreadProfile* profile) {
+	// the buffer is kept in profiles
+}
+
+qint64 DerivationProfiler::now() {
+	return timer.nsecsElapsed();
+}
+
+void DerivationProfiler::countEval() {
+	threadProfile()->num_evals++;
+}
+
+/**
+ * Print the statistics of all the threads, sorted by the total time.
+ */
+void DerivationProfiler::printSummary(std::ostream& out) {
+	std::map<std::string, ProfileStats> rule_stats;
+	std::map<std::string, ProfileStats> operator_stats;
+	mergeStats(KIND_RULE, rule_stats);
+	mergeStats(KIND_OPERATOR, operator_stats);
+
+	printStats(out, "rule", rule_stats);
+	out << std::endl;
+	printStats(out, "operator", operator_stats);
+}
+
+void DerivationProfiler::mergeStats(int kind, std::map<std::string, ProfileStats>& stats) {
+	boost::mutex::scoped_lock lock(mutex);
+	for (int i = 0; i < profiles.size(); ++i) {
+		const std::map<std::string, ProfileStats>& thread_stats = kind == KIND_RULE ? profiles[i]->rule_stats : profiles[i]->operator_stats;
+		for (auto it = thread_stats.begin(); it != thread_stats.end(); ++it) {
+			ProfileStats& s = stats[it->first];
+			s.count += it->second.count;
+			s.num_shapes += it->second.num_shapes;
+			s.num_evals += it->second.num_evals;
+			s.nsec += it->second.nsec;
+		}
+	}
+}
+
+/**
+ * Write the spans in the trace event format of Chrome, which can be opened by chrome://tracing.
+ * Each thread is shown as one track, and the operators are nested in the rules.
+ */
+bool DerivationProfiler::writeChromeTrace(const QString& filename) {
+	static const char* categories[] = { "derive", "rule", "operator" };
+
+	std::stringstream ss;
+	ss << "{\"traceEvents\":[";
+	bool first = true;
+	{
+		boost::mutex::scoped_lock lock(mutex);
+		for (int i = 0; i < profiles.size(); ++i) {
+			const std::vector<ProfileEvent>& events = profiles[i]->events;
+			for (int k = 0; k < events.size(); ++k) {
+				if (!first) ss << ",";
+				first = false;
+
+				ss << "\n{\"name\":\"" << escapeJSON(events[k].name) << "\",\"cat\":\"" << categories[events[k].kind] << "\",\"ph\":\"X\""
+					<< ",\"ts\":" << std::fixed << std::setprecision(3) << events[k].begin_nsec * 1e-3
+					<< ",\"dur\":" << (events[k].end_nsec - events[k].begin_nsec) * 1e-3
+					<< ",\"pid\":0,\"tid\":" << profiles[i]->thread_id
+					<< ",\"args\":{\"shapes\":" << events[k].num_shapes << ",\"evals\":" << events[k].num_evals << "}}";
+			}
+		}
+	}
+	ss << "\n]}\n";
+
+	QFile file(filename);
+	if (!file.open(QIODevice::WriteOnly)) {
+		std::cerr << "Cannot open file for writing: " << qPrintable(file.errorString()) << std::endl;
+		return false;
+	}
+	std::string json = ss.str();
+	file.write(json.c_str(), json.size());
+	return true;
+}
+
+ProfileScope::ProfileScope(int kind, const std::string& name, const std::list<boost::shared_ptr<Shape> >& stack) : name(name), stack(stack) {
+	this->profile = DerivationProfiler::threadProfile();
+	this->kind = kind;
+	this->stack_size = stack.size();
+	this->num_evals = profile->num_evals;
+	this->begin_nsec = DerivationProfiler::now();
+}
+
+ProfileScope::~ProfileScope() {
+	qint64 end_nsec = DerivationProfiler::now();
+	int num_shapes = (int)stack.size() - stack_size;
+	int evals = profile->num_evals - num_evals;
+
+	if (kind != DerivationProfiler::KIND_DERIVATION) {
+		ProfileStats& s = kind == DerivationProfiler::KIND_RULE ? profile->rule_stats[name] : profile->operator_stats[name];
+		s.count++;
+		s.num_shapes += num_shapes;
+		s.num_evals += evals;
+		s.nsec += end_nsec - begin_nsec;
+	}
+
+	if (profile->events.size() < DerivationProfiler::MAX_EVENTS_PER_THREAD) {
+		ProfileEvent event;
+		event.kind = kind;
+		event.name = name;
+		event.begin_nsec = begin_nsec;
+		event.end_nsec = end_nsec;
+		event.num_shapes = num_shapes;
+		event.num_evals = evals;
+		profile->events.push_back(event);
+	}
+}
+
+}
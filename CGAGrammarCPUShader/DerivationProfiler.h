@@ -0,0 +1,121 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <list>
+#include <iostream>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+#include <QString>
+#include <QElapsedTimer>
+
+/**
+ * Instrumentation of the derivation.
+ *
+ * Define CGA_PROFILE to record, for each rule and each operator type, the number of invocations, the shapes pushed to the stack,
+ * the expression evaluations, and the wall time. Without CGA_PROFILE, the macros below expand to nothing,
+ * so the derivation runs exactly the same code as before.
+ */
+#ifdef CGA_PROFILE
+#define CGA_PROFILE_DERIVATION(stack)		cga::ProfileScope cga_profile_derivation(cga::DerivationProfiler::KIND_DERIVATION, "derive", stack)
+#define CGA_PROFILE_RULE(name, stack)		cga::ProfileScope cga_profile_rule(cga::DerivationProfiler::KIND_RULE, name, stack)
+#define CGA_PROFILE_OPERATOR(name, stack)	cga::ProfileScope cga_profile_operator(cga::DerivationProfiler::KIND_OPERATOR, name, stack)
+#define CGA_PROFILE_EVAL()					cga::DerivationProfiler::countEval()
+#else
+#define CGA_PROFILE_DERIVATION(stack)
+#define CGA_PROFILE_RULE(name, stack)
+#define CGA_PROFILE_OPERATOR(name, stack)
+#define CGA_PROFILE_EVAL()
+#endif
+
+namespace cga {
+
+class Shape;
+
+/**
+ * Statistics of one rule or one operator type.
+ * The time of a rule includes the time of its operators.
+ */
+struct ProfileStats {
+	int count;
+	int num_shapes;
+	int num_evals;
+	qint64 nsec;
+
+	ProfileStats() : count(0), num_shapes(0), num_evals(0), nsec(0) {}
+};
+
+/**
+ * One span of the trace.
+ */
+struct ProfileEvent {
+	int kind;
+	std::string name;
+	qint64 begin_nsec;
+	qint64 end_nsec;
+	int num_shapes;
+	int num_evals;
+};
+
+/**
+ * Profiler of the derivation.
+ * Each thread records to its own buffer without locking, and the buffers are merged when the results are written,
+ * so the derive workers of ImagePipeline can be profiled as they are.
+ */
+class DerivationProfiler {
+public:
+	enum { KIND_DERIVATION = 0, KIND_RULE, KIND_OPERATOR };
+
+	/** the trace keeps up to this number of events per thread, while the statistics count all of them */
+	static const int MAX_EVENTS_PER_THREAD = 1000000;
+
+	struct ThreadProfile {
+		int thread_id;
+		int num_evals;
+		std::vector<ProfileEvent> events;
+		std::map<std::string, ProfileStats> rule_stats;
+		std::map<std::string, ProfileStats> operator_stats;
+	};
+
+private:
+	static boost::mutex mutex;
+	static std::vector<ThreadProfile*> profiles;
+	static boost::thread_specific_ptr<ThreadProfile> current;
+	static QElapsedTimer timer;
+
+public:
+	static bool isEnabled();
+	static void reset();
+	static ThreadProfile* threadProfile();
+	static qint64 now();
+	static void countEval();
+	static void printSummary(std::ostream& out);
+	static bool writeChromeTrace(const QString& filename);
+
+private:
+	static void releaseProfile(ThreadProfile* profile);
+	static void mergeStats(int kind, std::map<std::string, ProfileStats>& stats);
+};
+
+/**
+ * Span of a derivation, a rule, or an operator.
+ * The number of the shapes is the growth of the stack during the span.
+ */
+class ProfileScope {
+private:
+	DerivationProfiler::ThreadProfile* profile;
+	int kind;
+	std::string name;
+	const std::list<boost::shared_ptr<Shape> >& stack;
+	int stack_size;
+	int num_evals;
+	qint64 begin_nsec;
+
+public:
+	ProfileScope(int kind, const std::string& name, const std::list<boost::shared_ptr<Shape> >& stack);
+	~ProfileScope();
+};
+
+}
@@ -1,6 +1,7 @@
 #include "ExtrudeOperator.h"
 #include "CGA.h"
 #include "Shape.h"
+#include "BatchDerivation.h"
 
 namespace cga {
 
@@ -15,4 +16,34 @@ boost::shared_ptr<Shape> ExtrudeOperator::apply(boost::shared_ptr<Shape>& shape,
 	return shape->extrude(shape->_name, actual_height);
 }
 
+/**
+ * Extrude the shapes of multiple samples.
+ * The height is evaluated for all the samples at once, and then each shape is extruded in the same way as apply().
+ */
+void ExtrudeOperator::applyBatch(std::vector<boost::shared_ptr<Shape> >& shapes, const std::vector<int>& samples, BatchEvaluator& evaluator, std::vector<std::list<boost::shared_ptr<Shape> > >& stacks, std::vector<std::exception_ptr>& errors) {
+	std::vector<float> heights;
+	try {
+		evaluator.evalFloat(height, samples, shapes, heights);
+	} catch (...) {
+		// the shapes are extruded one by one so that only the samples with the error fail
+		Operator::applyBatch(shapes, samples, evaluator, stacks, errors);
+		return;
+	}
+
+	for (int k = 0; k < shapes.size(); ++k) {
+		try {
+			shapes[k] = shapes[k]->extrude(shapes[k]->_name, heights[k]);
+		} catch (...) {
+			shapes[k] = boost::shared_ptr<Shape>();
+			stacks[k].clear();
+			errors[k] = std::current_exception();
+		}
+	}
+}
+
+void ExtrudeOperator::toNode(GrammarNode& node) const {
+	node.tagName = "extrude";
+	node.setAttribute("height", height);
+}
+
 }
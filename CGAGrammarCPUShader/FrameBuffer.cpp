@@ -4,6 +4,7 @@
 //#include "scene.h"
 #include <math.h>
 #include <algorithm>
+#include <map>
 #include <QGLWidget>
 #include <QDir>
 #include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
@@ -14,6 +15,11 @@
 #include <CGAL/Polygon_2.h>
 #include <CGAL/create_offset_polygons_2.h>
 
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define FRAMEBUFFER_USE_SSE2
+#endif
+
 using namespace std;
 
 typedef CGAL::Exact_predicates_inexact_constructions_kernel K;
@@ -26,6 +32,129 @@ typedef CGAL::Creator_uniform_2<int, Point_2>               Creator;
 typedef CGAL::Random_points_in_square_2< Point_2, Creator > Point_generator;
 typedef boost::shared_ptr<Polygon_2>						PolygonPtr;
 
+namespace {
+
+// 7x7 Gaussian kernel that cv::GaussianBlur uses for ksize = 7 and sigma = 0, scaled by 64
+const int BLUR_RADIUS = 3;
+const int BLUR_SIZE = BLUR_RADIUS * 2 + 1;
+const unsigned short BLUR_KERNEL[BLUR_SIZE] = { 2, 7, 14, 18, 14, 7, 2 };
+
+// the color bits of a pixel (the alpha channel is not inverted, same as QImage::invertPixels)
+const unsigned int INVERT_MASK = 0x00FFFFFF;
+
+/**
+ * Return the same value as the first rand() after srand(seed) of the Visual C++ runtime.
+ * Unlike srand()/rand(), it does not change the global random state, so the strokes do not depend on
+ * the other random numbers, and multiple frame buffers can be rasterized on different threads.
+ */
+inline int strokeRandom(unsigned int seed) {
+	return ((seed * 214013 + 2531011) >> 16) & 0x7FFF;
+}
+
+/**
+ * Project the point by the matrix in the same way as Camera::Project().
+ */
+inline glm::vec3 projectPoint(const glm::mat4& mvpMatrix, const glm::vec3& p) {
+	glm::vec4 a = mvpMatrix * glm::vec4(p, 1);
+	return glm::vec3(a.x / a.w, a.y / a.w, a.z / a.w);
+}
+
+/**
+ * Reflect the index into [0, n-1] without duplicating the border pixel (cv::BORDER_REFLECT_101).
+ */
+inline int reflect101(int i, int n) {
+	if (n == 1) return 0;
+
+	while (i < 0 || i >= n) {
+		if (i < 0) i = -i;
+		if (i >= n) i = 2 * n - 2 - i;
+	}
+	return i;
+}
+
+/**
+ * Apply the horizontal pass of the blur to one row.
+ * Each channel of the result is normalized back to [0, 255], but stored as 16 bit so that the vertical pass can accumulate it without overflow.
+ *
+ * @param src	pixels of the row
+ * @param w		width of the row
+ * @param dst	[OUT] w * 4 channels of the blurred row
+ */
+void blurRow(const unsigned int* src, int w, unsigned short* dst) {
+	const unsigned char* bytes = (const unsigned char*)src;
+
+	int u = 0;
+	while (u < w) {
+#ifdef FRAMEBUFFER_USE_SSE2
+		// process two pixels at once while all the taps are inside the row
+		if (u >= BLUR_RADIUS && u + 1 + BLUR_RADIUS < w) {
+			__m128i zero = _mm_setzero_si128();
+			__m128i acc = _mm_setzero_si128();
+			for (int k = 0; k < BLUR_SIZE; ++k) {
+				__m128i p = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(bytes + (u + k - BLUR_RADIUS) * 4)), zero);
+				acc = _mm_add_epi16(acc, _mm_mullo_epi16(p, _mm_set1_epi16(BLUR_KERNEL[k])));
+			}
+			acc = _mm_srli_epi16(_mm_add_epi16(acc, _mm_set1_epi16(32)), 6);
+			_mm_storeu_si128((__m128i*)(dst + u * 4), acc);
+			u += 2;
+			continue;
+		}
+#endif
+
+		for (int c = 0; c < 4; ++c) {
+			unsigned int acc = 0;
+			for (int k = 0; k < BLUR_SIZE; ++k) {
+				acc += BLUR_KERNEL[k] * bytes[reflect101(u + k - BLUR_RADIUS, w) * 4 + c];
+			}
+			dst[u * 4 + c] = (acc + 32) >> 6;
+		}
+		u++;
+	}
+}
+
+/**
+ * Apply the vertical pass of the blur to one row, and write the result as pixels.
+ *
+ * @param rows		horizontally blurred rows for the 7 taps
+ * @param n			number of channels in the row (width * 4)
+ * @param mask		XOR mask that is applied to each output pixel
+ * @param dst		[OUT] pixels of the row
+ */
+void blurColumn(const unsigned short* const* rows, int n, unsigned int mask, unsigned int* dst) {
+	unsigned char* bytes = (unsigned char*)dst;
+
+	int i = 0;
+#ifdef FRAMEBUFFER_USE_SSE2
+	__m128i mask4 = _mm_set1_epi32(mask);
+	for (; i + 16 <= n; i += 16) {
+		__m128i acc0 = _mm_setzero_si128();
+		__m128i acc1 = _mm_setzero_si128();
+		for (int k = 0; k < BLUR_SIZE; ++k) {
+			__m128i weight = _mm_set1_epi16(BLUR_KERNEL[k]);
+			acc0 = _mm_add_epi16(acc0, _mm_mullo_epi16(_mm_loadu_si128((const __m128i*)(rows[k] + i)), weight));
+			acc1 = _mm_add_epi16(acc1, _mm_mullo_epi16(_mm_loadu_si128((const __m128i*)(rows[k] + i + 8)), weight));
+		}
+		acc0 = _mm_srli_epi16(_mm_add_epi16(acc0, _mm_set1_epi16(32)), 6);
+		acc1 = _mm_srli_epi16(_mm_add_epi16(acc1, _mm_set1_epi16(32)), 6);
+		_mm_storeu_si128((__m128i*)(bytes + i), _mm_xor_si128(_mm_packus_epi16(acc0, acc1), mask4));
+	}
+#endif
+
+	for (; i < n; i += 4) {
+		unsigned int pixel = 0;
+		for (int c = 0; c < 4; ++c) {
+			unsigned int acc = 0;
+			for (int k = 0; k < BLUR_SIZE; ++k) {
+				acc += BLUR_KERNEL[k] * rows[k][i + c];
+			}
+			pixel |= ((acc + 32) >> 6) << (c * 8);
+		}
+		dst[i / 4] = pixel ^ mask;
+	}
+}
+
+}
+
 AABB::AABB() {
 	corners[0][0] = (numeric_limits<float>::max)();
 	corners[0][1] = (numeric_limits<float>::max)();
@@ -190,12 +319,9 @@ void FrameBuffer::setClearColor(const glm::vec3& clear_color) {
 
 /**
  * Set all pixels to given color.
- *
- * @param bgr	the given color
+ * It does not touch OpenGL so that the frame buffer can be used by a thread other than the GUI thread.
  */
 void FrameBuffer::clear() {
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
 	unsigned int clr = GetColor(clear_color);
 	for (int uv = 0; uv < w*h; uv++) {
 		pix[uv] = clr;
@@ -203,6 +329,75 @@ void FrameBuffer::clear() {
 	}
 }
 
+/**
+ * Invert and/or blur the color buffer in place.
+ * This is equivalent to QImage::invertPixels() followed by cv::GaussianBlur() with a 7x7 kernel,
+ * but both are done in a single pass over the rows: the rows are blurred horizontally into a ring buffer
+ * that holds only the 7 rows needed by the vertical pass, and each output row is inverted when it is written back.
+ *
+ * @param invert	true if the colors are inverted
+ * @param blur		true if the image is blurred
+ */
+void FrameBuffer::postProcess(bool invert, bool blur) {
+	unsigned int mask = invert ? INVERT_MASK : 0;
+
+	if (!blur) {
+		if (!invert) return;
+
+		for (int uv = 0; uv < w*h; uv++) {
+			pix[uv] ^= mask;
+		}
+		return;
+	}
+
+	std::vector<unsigned short> ring(BLUR_SIZE * w * 4);
+	const unsigned short* rows[BLUR_SIZE];
+
+	int next_row = 0;
+	for (int v = 0; v < h; ++v) {
+		// blur horizontally all the rows that the vertical pass of this row needs.
+		// The output rows are written back in place, so only the rows below the current one can be read.
+		for (; next_row < h && next_row <= v + BLUR_RADIUS; ++next_row) {
+			blurRow(pix + next_row * w, w, &ring[(next_row % BLUR_SIZE) * w * 4]);
+		}
+
+		for (int k = 0; k < BLUR_SIZE; ++k) {
+			rows[k] = &ring[(reflect101(v + k - BLUR_RADIUS, h) % BLUR_SIZE) * w * 4];
+		}
+		blurColumn(rows, w * 4, mask, pix + v * w);
+	}
+}
+
+/**
+ * Convert the color buffer to an image.
+ */
+QImage FrameBuffer::toImage() const {
+	QImage image(w, h, QImage::Format_ARGB32);
+
+	// the first pixel of the color buffer is the bottom left corner, while that of the image is the top left corner.
+	for (int v = 0; v < h; ++v) {
+		const unsigned int* src = pix + (h - 1 - v) * w;
+		QRgb* dst = (QRgb*)image.scanLine(v);
+		for (int u = 0; u < w; ++u) {
+			// ABGR -> ARGB
+			dst[u] = (src[u] & 0xFF00FF00) | ((src[u] & 0xFF) << 16) | ((src[u] >> 16) & 0xFF);
+		}
+	}
+
+	return image;
+}
+
+/**
+ * Save the color buffer to an image file.
+ * The format is determined by the extension of the file name.
+ *
+ * @param filename	the file name
+ * @return			true if the image is successfully saved
+ */
+bool FrameBuffer::save(const std::string& filename) const {
+	return toImage().save(QString::fromUtf8(filename.c_str()));
+}
+
 /**
  * Set one pixel to given color.
  * If the specified pixel is out of the screen, it does nothing.
@@ -274,45 +469,6 @@ void FrameBuffer::Draw3DSegment(Camera* camera, const glm::vec3& p0, const glm::
 	Draw2DSegment(pp0, c0, pp1, c1);
 }
 
-/**
- * Draw 3D segment with color interpolation.
- *
- * @param ppc	the camera
- * @param p0	the first point of the segment
- * @param c0	the color of the first point
- * @param p1	the second point of the segment
- * @param c1	the color of the second point
- */
-void FrameBuffer::Draw3DStroke(Camera* camera, const glm::vec3& p0, const glm::vec3& p1, int seed) {
-	glm::vec3 q0 = p0;
-	glm::vec3 q1 = p1;
-
-	if (q0.x > q1.x) {
-		swap(q0, q1);
-	} else if (q0.x == q1.x) {
-		if (q0.y > q1.y) {
-			swap(q0, q1);
-		} else if (q0.y == q1.y) {
-			if (q0.z > q1.z) {
-				swap(q0, q1);
-			}
-		}
-	}
-
-	glm::vec3 pp0, pp1;
-	if (!camera->Project(q0, pp0)) return;
-	if (!camera->Project(q1, pp1)) return;
-
-	pp0 = convertScreenCoordinate(pp0);
-	pp1 = convertScreenCoordinate(pp1);
-
-	srand(seed + q0.x * 100 + q0.y * 50 + q0.z * 10 + q1.x * 20 + q1.y * 30 + q1.z * 40);
-
-	int polyline_index = rand() % style_polylines.size();
-	
-	Draw2DPolyline(pp0, pp1, polyline_index);
-}
-
 /**
  * Draw 2D polyline.
  *
@@ -349,61 +505,96 @@ void FrameBuffer::Draw2DPolyline(const glm::vec3& p0, const glm::vec3& p1, int p
 }
 
 /**
- * objectを描画する。
+ * Prepare the geometry for the rasterizer.
+ * The polygons are triangulated here, so that the result can be rendered from many cameras without repeating this work.
+ * They become one mesh with one instance that does not move it.
+ *
+ * @param vertices	the polygons
+ * @param seed		the seed to choose the stylized polylines
+ * @param mesh		[OUT] the prepared geometry
  */
-void FrameBuffer::rasterize(Camera* camera, const std::vector<std::vector<Vertex> >& vertices, int seed) {
-	std::multimap<float, std::vector<Vertex> > sortedVertices;
-
+void FrameBuffer::prepare(const std::vector<std::vector<Vertex> >& vertices, int seed, RenderMesh& mesh) const {
+	mesh.seed = seed;
+	mesh.meshes.assign(1, std::vector<RenderFace>(vertices.size()));
 	for (int i = 0; i < vertices.size(); ++i) {
-		float depth = maxDepth(camera, vertices[i]);
-
-		sortedVertices.insert(std::make_pair(depth, vertices[i]));
+		triangulateFace(vertices[i], mesh.meshes[0][i]);
 	}
+	mesh.instances.assign(1, GeometryInstance(0, glm::mat4()));
+}
 
-	for (auto it = sortedVertices.rbegin(); it != sortedVertices.rend(); ++it) {
-		if (it->second.size() == 3) {
-			rasterizePolygon(camera, it->second, seed);
-		} else {
-			rasterizeConcavePolygon(camera, it->second, seed);
+/**
+ * Prepare the instanced geometry for the rasterizer.
+ * Each mesh is triangulated only once in its local coordinates, and the instances are kept as they are,
+ * so the memory does not grow with the number of the instances.
+ *
+ * @param geometry	the instanced geometry
+ * @param seed		the seed to choose the stylized polylines
+ * @param mesh		[OUT] the prepared geometry
+ */
+void FrameBuffer::prepare(const InstancedGeometry& geometry, int seed, RenderMesh& mesh) const {
+	mesh.seed = seed;
+	mesh.meshes.resize(geometry.meshes.size());
+	for (int i = 0; i < geometry.meshes.size(); ++i) {
+		mesh.meshes[i].resize(geometry.meshes[i].size());
+		for (int j = 0; j < geometry.meshes[i].size(); ++j) {
+			triangulateFace(geometry.meshes[i][j], mesh.meshes[i][j]);
 		}
 	}
+	mesh.instances = geometry.instances;
 }
 
 /**
- * １つのfaceを描画する。
+ * Compute the points and the triangles of the polygon.
+ * A concave polygon is partitioned into convex ones on its own plane instead of on the screen,
+ * which covers the same region for any camera.
+ *
+ * @param vertices	the polygon
+ * @param face		[OUT] the polygon whose edges are not prepared yet
  */
-void FrameBuffer::rasterizePolygon(Camera* camera, const std::vector<Vertex>& vertices, int seed) {
-	for (int i = 1; i < vertices.size() - 1; ++i) {
-		rasterizeTriangle(camera, vertices[0].position, vertices[i].position, vertices[i + 1].position);
-	}
-
+void FrameBuffer::triangulateFace(const std::vector<Vertex>& vertices, RenderFace& face) const {
+	face.points.resize(vertices.size());
 	for (int i = 0; i < vertices.size(); ++i) {
-		int next = (i + 1) % vertices.size();
-
-		Draw3DStroke(camera, vertices[i].position, vertices[next].position, seed);
+		face.points[i] = vertices[i].position;
 	}
-}
 
-void FrameBuffer::rasterizeConcavePolygon(Camera* camera, const std::vector<Vertex>& vertices, int seed) {
+	face.triangles.clear();
 	Polygon_2 polygon;
-	glm::vec3 prev_pp;
-	glm::vec3 first_pp;
-	for (int i = 0; i < vertices.size(); ++i) {
-		glm::vec3 pp;
-		camera->Project(vertices[i].position, pp);
-		pp = convertScreenCoordinate(pp);
-		
-		if (i == 0) {
-			first_pp = pp;
+	std::map<std::pair<double, double>, glm::vec3> points3d;
+	if (vertices.size() > 4) {
+		// use the two axes other than the dominant axis of the normal as the 2D coordinates on the plane
+		glm::vec3 normal;
+		for (int i = 0; i < vertices.size(); ++i) {
+			const glm::vec3& p0 = vertices[i].position;
+			const glm::vec3& p1 = vertices[(i + 1) % vertices.size()].position;
+			normal.x += (p0.y - p1.y) * (p0.z + p1.z);
+			normal.y += (p0.z - p1.z) * (p0.x + p1.x);
+			normal.z += (p0.x - p1.x) * (p0.y + p1.y);
 		}
+		int axis = 2;
+		if (fabs(normal.x) >= fabs(normal.y) && fabs(normal.x) >= fabs(normal.z)) {
+			axis = 0;
+		} else if (fabs(normal.y) >= fabs(normal.z)) {
+			axis = 1;
+		}
+
+		glm::vec2 prev_pp;
+		glm::vec2 first_pp;
+		for (int i = 0; i < vertices.size(); ++i) {
+			glm::vec2 pp(vertices[i].position[(axis + 1) % 3], vertices[i].position[(axis + 2) % 3]);
 
-		if (i > 0 && pp.x == prev_pp.x && pp.y == prev_pp.y) continue;
-		if (i > 0 && pp.x == first_pp.x && pp.y == first_pp.y) continue;
+			if (i == 0) {
+				first_pp = pp;
+			}
 
-		prev_pp = pp;
-		polygon.push_back(Point_2(pp.x, pp.y));
+			if (i > 0 && pp.x == prev_pp.x && pp.y == prev_pp.y) continue;
+			if (i > 0 && pp.x == first_pp.x && pp.y == first_pp.y) continue;
+
+			prev_pp = pp;
+			polygon.push_back(Point_2(pp.x, pp.y));
+			points3d[std::make_pair((double)pp.x, (double)pp.y)] = vertices[i].position;
+		}
 	}
-	
+
 	if (polygon.size() > 4) {
 		// tesselate the concave polygon
 		Polygon_list partition_polys;
@@ -414,25 +605,126 @@ void FrameBuffer::rasterizeConcavePolygon(Camera* camera, const std::vector<Vert
 		CGAL::greene_approx_convex_partition_2(polygon.vertices_begin(), polygon.vertices_end(), std::back_inserter(partition_polys), partition_traits);
 
 		for (auto fit = partition_polys.begin(); fit != partition_polys.end(); ++fit) {
-			std::vector<glm::vec2> pts;
+			std::vector<glm::vec3> pts;
 			for (auto vit = fit->vertices_begin(); vit != fit->vertices_end(); ++vit) {
-				pts.push_back(glm::vec2(vit->x(), vit->y()));
+				pts.push_back(points3d[std::make_pair(vit->x(), vit->y())]);
 			}
 
-			for (int i = 1; i < pts.size() - 1; ++i) {
-				rasterizeTriangle(glm::vec3(pts[0], 0), glm::vec3(pts[i], 0), glm::vec3(pts[i+1], 0));
+			for (int i = 1; i < (int)pts.size() - 1; ++i) {
+				face.triangles.push_back(pts[0]);
+				face.triangles.push_back(pts[i]);
+				face.triangles.push_back(pts[i + 1]);
 			}
 		}
 	} else {
-		for (int i = 1; i < vertices.size() - 1; ++i) {
-			rasterizeTriangle(camera, vertices[0].position, vertices[i].position, vertices[i + 1].position);
+		for (int i = 1; i < (int)vertices.size() - 1; ++i) {
+			// if the area is too small, skip this triangle.
+			if (glm::length(glm::cross(vertices[i].position - vertices[0].position, vertices[i + 1].position - vertices[0].position)) < 1e-7) continue;
+
+			face.triangles.push_back(vertices[0].position);
+			face.triangles.push_back(vertices[i].position);
+			face.triangles.push_back(vertices[i + 1].position);
 		}
 	}
 
-	for (int i = 0; i < vertices.size(); ++i) {
-		int next = (i + 1) % vertices.size();
+}
+
+/**
+ * Choose the stylized polyline of the edge.
+ * The polyline depends on the positions of the end points, so the points must be in the world coordinates.
+ *
+ * @param seed		the seed to choose the stylized polylines
+ * @param q0		[IN/OUT] the first end point, which is swapped with the second one if needed
+ * @param q1		[IN/OUT] the second end point
+ * @return			the index of the stylized polyline
+ */
+int FrameBuffer::chooseStroke(int seed, glm::vec3& q0, glm::vec3& q1) const {
+	// sort the end points so that the edge shared by two polygons gets the same stroke
+	if (q0.x > q1.x) {
+		swap(q0, q1);
+	} else if (q0.x == q1.x) {
+		if (q0.y > q1.y) {
+			swap(q0, q1);
+		} else if (q0.y == q1.y) {
+			if (q0.z > q1.z) {
+				swap(q0, q1);
+			}
+		}
+	}
+
+	return strokeRandom(seed + q0.x * 100 + q0.y * 50 + q0.z * 10 + q1.x * 20 + q1.y * 30 + q1.z * 40) % style_polylines.size();
+}
 
-		Draw3DStroke(camera, vertices[i].position, vertices[next].position, seed);
+/**
+ * objectを描画する。
+ */
+void FrameBuffer::rasterize(Camera* camera, const std::vector<std::vector<Vertex> >& vertices, int seed) {
+	RenderMesh mesh;
+	prepare(vertices, seed, mesh);
+	rasterize(camera, mesh);
+}
+
+/**
+ * Render the instanced geometry from the camera.
+ */
+void FrameBuffer::rasterize(Camera* camera, const InstancedGeometry& geometry, int seed) {
+	RenderMesh mesh;
+	prepare(geometry, seed, mesh);
+	rasterize(camera, mesh);
+}
+
+/**
+ * Render the prepared geometry from the camera.
+ * The faces of all the instances are drawn from the farthest one so that the nearer faces overwrite them.
+ * The model matrix of each instance is combined with the camera, so the vertices of the mesh are projected directly.
+ * The stroke of each edge is chosen by its end points in the world coordinates, so the image is the same as the expanded geometry.
+ */
+void FrameBuffer::rasterize(Camera* camera, const RenderMesh& mesh) {
+	std::vector<glm::mat4> mvpMatrices(mesh.instances.size());
+	for (int i = 0; i < mesh.instances.size(); ++i) {
+		mvpMatrices[i] = camera->mvpMatrix * mesh.instances[i].modelMat;
+	}
+
+	// the faces are sorted by the depth, and then by the instance and the face, which is the order of the expanded geometry
+	std::vector<std::pair<float, std::pair<int, int> > > order;
+	for (int i = 0; i < mesh.instances.size(); ++i) {
+		const std::vector<RenderFace>& faces = mesh.meshes[mesh.instances[i].mesh_index];
+		for (int j = 0; j < faces.size(); ++j) {
+			order.push_back(std::make_pair(maxDepth(mvpMatrices[i], faces[j].points), std::make_pair(i, j)));
+		}
+	}
+	std::sort(order.begin(), order.end());
+
+	std::vector<glm::vec3> points;
+	for (int k = (int)order.size() - 1; k >= 0; --k) {
+		int instance = order[k].second.first;
+		const glm::mat4& modelMat = mesh.instances[instance].modelMat;
+		const glm::mat4& mvpMatrix = mvpMatrices[instance];
+		const RenderFace& face = mesh.meshes[mesh.instances[instance].mesh_index][order[k].second.second];
+
+		for (int i = 0; i + 2 < face.triangles.size(); i += 3) {
+			glm::vec3 pp0 = projectPoint(mvpMatrix, face.triangles[i]);
+			glm::vec3 pp1 = projectPoint(mvpMatrix, face.triangles[i + 1]);
+			glm::vec3 pp2 = projectPoint(mvpMatrix, face.triangles[i + 2]);
+
+			rasterizeTriangle(convertScreenCoordinate(pp0), convertScreenCoordinate(pp1), convertScreenCoordinate(pp2));
+		}
+
+		points.resize(face.points.size());
+		for (int i = 0; i < face.points.size(); ++i) {
+			points[i] = glm::vec3(modelMat * glm::vec4(face.points[i], 1));
+		}
+		for (int i = 0; i < points.size(); ++i) {
+			glm::vec3 q0 = points[i];
+			glm::vec3 q1 = points[(i + 1) % points.size()];
+			int polyline_index = chooseStroke(mesh.seed, q0, q1);
+
+			glm::vec3 pp0, pp1;
+			if (!camera->Project(q0, pp0)) continue;
+			if (!camera->Project(q1, pp1)) continue;
+
+			Draw2DPolyline(convertScreenCoordinate(pp0), convertScreenCoordinate(pp1), polyline_index);
+		}
 	}
 }
 
@@ -501,12 +793,28 @@ void FrameBuffer::rasterizeTriangle(const glm::vec3& p0, const glm::vec3& p1, co
 	}
 }
 
-float FrameBuffer::maxDepth(Camera* camera, const std::vector<Vertex>& vertices) {
+float FrameBuffer::maxDepth(Camera* camera, const std::vector<glm::vec3>& points) {
 	float max_z = 0.0f;
 
-	for (int i = 0; i < vertices.size(); ++i) {
+	for (int i = 0; i < points.size(); ++i) {
 		glm::vec3 pp;
-		camera->Project(vertices[i].position, pp);
+		camera->Project(points[i], pp);
+		if (pp.z > max_z) {
+			max_z = pp.z;
+		}
+	}
+
+	return max_z;
+}
+
+/**
+ * Return the maximum depth of the points projected by the matrix.
+ */
+float FrameBuffer::maxDepth(const glm::mat4& mvpMatrix, const std::vector<glm::vec3>& points) const {
+	float max_z = 0.0f;
+
+	for (int i = 0; i < points.size(); ++i) {
+		glm::vec3 pp = projectPoint(mvpMatrix, points[i]);
 		if (pp.z > max_z) {
 			max_z = pp.z;
 		}
@@ -5,7 +5,9 @@
 #include <glm/gtx/string_cast.hpp>
 #include "Camera.h"
 #include "Vertex.h"
+#include "InstancedGeometry.h"
 #include <vector>
+#include <QImage>
 #include <opencv/cv.h>
 #include <opencv/highgui.h>
 
@@ -34,6 +36,36 @@ public:
 	glm::vec3 getColor(float x, float y) const;
 };
 
+/**
+ * Polygon prepared for the rasterizer.
+ * It does not depend on the camera, so it can be rendered from any number of views.
+ */
+class RenderFace {
+public:
+	/** vertices of the polygon, which are used to sort the faces by depth and drawn as strokes along its edges */
+	std::vector<glm::vec3> points;
+
+	/** triangles that fill the polygon (3 points per triangle) */
+	std::vector<glm::vec3> triangles;
+};
+
+/**
+ * Geometry prepared for the rasterizer by FrameBuffer::prepare().
+ * The faces of each mesh are prepared only once in its local coordinates, and each instance places one of the meshes
+ * by its model matrix, which is applied to the vertices when they are projected.
+ */
+class RenderMesh {
+public:
+	std::vector<std::vector<RenderFace> > meshes;
+	std::vector<GeometryInstance> instances;
+
+	/** the seed to choose the stylized polylines */
+	int seed;
+
+public:
+	RenderMesh() : seed(0) {}
+};
+
 class FrameBuffer {
 public:
 	/** software color buffer (The first pixel is the bottom left corner.) */
@@ -61,20 +93,27 @@ public:
 
 	void setClearColor(const glm::vec3& clear_color);
 	void clear();
+	void postProcess(bool invert, bool blur);
+	QImage toImage() const;
+	bool save(const std::string& filename) const;
 	void Set(int u, int v, const glm::vec3& clr, float z);
 	void Add(int u, int v, const glm::vec3& color);
 	void Draw2DSegment(const glm::vec3& p0, const glm::vec3& c0, const glm::vec3& p1, const glm::vec3& c1);
 	void Draw3DSegment(Camera* camera, const glm::vec3& p0, const glm::vec3& c0, const glm::vec3& p1, const glm::vec3& c1);
-	void Draw3DStroke(Camera* camera, const glm::vec3& p0, const glm::vec3& p1, int seed);
 	void Draw2DPolyline(const glm::vec3& p0, const glm::vec3& p1, int polyline_index);
 
+	void prepare(const std::vector<std::vector<Vertex> >& vertices, int seed, RenderMesh& mesh) const;
+	void prepare(const InstancedGeometry& geometry, int seed, RenderMesh& mesh) const;
+	void triangulateFace(const std::vector<Vertex>& vertices, RenderFace& face) const;
+	int chooseStroke(int seed, glm::vec3& q0, glm::vec3& q1) const;
 	void rasterize(Camera* camera, const std::vector<std::vector<Vertex> >& vertices, int seed);
-	void rasterizePolygon(Camera* camera, const std::vector<Vertex>& vertices, int seed);
-	void rasterizeConcavePolygon(Camera* camera, const std::vector<Vertex>& vertices, int seed);
+	void rasterize(Camera* camera, const InstancedGeometry& geometry, int seed);
+	void rasterize(Camera* camera, const RenderMesh& mesh);
 	void rasterizeTriangle(Camera* camera, const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2);
 	void rasterizeTriangle(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2);
 
-	float maxDepth(Camera* camera, const std::vector<Vertex>& vertices);
+	float maxDepth(Camera* camera, const std::vector<glm::vec3>& points);
+	float maxDepth(const glm::mat4& mvpMatrix, const std::vector<glm::vec3>& points) const;
 
 	unsigned int GetColor(const glm::vec3& clr) const;
 	glm::vec3 convertScreenCoordinate(const glm::vec3& p) const;
@@ -4,14 +4,43 @@
 #include <GL/GLU.h>
 #include "GLUtils.h"
 #include "GrammarParser.h"
+#include "GrammarBinary.h"
 #include "Rectangle.h"
 #include <QDir>
 #include <QTextStream>
 #include "Utils.h"
+#include "ImagePipeline.h"
+#include "PolygonMerger.h"
+#include "DerivationProfiler.h"
+#include "MemoizedDerivation.h"
+#include <boost/thread.hpp>
 
 #define SQR(x)	((x) * (x))
 
+namespace {
+
+/**
+ * Return the index of the first terminal shape that is different, or -1 if the shapes are the same, including their order.
+ */
+int findMismatch(const std::vector<boost::shared_ptr<cga::Shape> >& shapes1, const std::vector<boost::shared_ptr<cga::Shape> >& shapes2) {
+	int num_shapes = (std::min)(shapes1.size(), shapes2.size());
+	for (int i = 0; i < num_shapes; ++i) {
+		const cga::Shape& shape1 = *shapes1[i];
+		const cga::Shape& shape2 = *shapes2[i];
+		if (shape1._name != shape2._name || shape1._scope != shape2._scope || shape1._color != shape2._color) return i;
+		for (int k = 0; k < 4; ++k) {
+			if (shape1._modelMat[k] != shape2._modelMat[k]) return i;
+		}
+	}
+
+	return shapes1.size() == shapes2.size() ? -1 : num_shapes;
+}
+
+}
+
 GLWidget3D::GLWidget3D() {
+	// the viewer derives the whole building on all the cores
+	derivation.setNumThreads((std::max)(1, (int)boost::thread::hardware_concurrency()));
 }
 
 /**
@@ -62,6 +91,8 @@ void GLWidget3D::resizeGL(int width, int height) {
  * This function is called whenever the widget needs to be painted.
  */
 void GLWidget3D::paintGL() {
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
 	fb->setClearColor(glm::vec3(1, 1, 1));
 	fb->clear();
 
@@ -69,23 +100,38 @@ void GLWidget3D::paintGL() {
 	fb->draw();
 }
 
-void GLWidget3D::loadCGA(const std::string& filename) {
+/**
+ * Load the grammar and derive it.
+ * When the same file is loaded again, only the subtrees that read the changed attributes are derived again.
+ * The random values of the attributes are kept unless randomize is true, so only the attributes edited in the file change.
+ *
+ * @param randomize	true to select new random values for all the attributes that have a range
+ */
+void GLWidget3D::loadCGA(const std::string& filename, bool randomize) {
 	vertices.clear();
 
 	float object_width = 10.0f;
 	float object_height = 8.0f;
 
-	{
-		cga::Rectangle* start = new cga::Rectangle("Start", glm::translate(glm::rotate(glm::mat4(), -3.141592f * 0.5f, glm::vec3(1, 0, 0)), glm::vec3(-object_width*0.5f, -object_height*0.5f, 0)), glm::mat4(), object_width, object_height, glm::vec3(1, 1, 1));
-		system.stack.push_back(boost::shared_ptr<cga::Shape>(start));
-	}
-
 	try {
 		cga::Grammar grammar;
-		cga::parseGrammar(filename.c_str(), grammar);
-		system.randomParamValues(grammar);
-		system.derive(grammar);
-		system.generateGeometry(vertices);
+		cga::loadGrammar(filename.c_str(), grammar);
+		randomizeParams(filename, grammar, randomize);
+
+		// the derivation is reused only if the previous one has completed
+		bool incremental = filename == derived_filename && !derivation.isEmpty();
+		derived_filename.clear();
+		if (incremental) {
+			derivation.update(grammar);
+		} else {
+			std::list<boost::shared_ptr<cga::Shape> > stack;
+			glm::mat4 pivot = glm::translate(glm::rotate(glm::mat4(), -3.141592f * 0.5f, glm::vec3(1, 0, 0)), glm::vec3(-object_width*0.5f, -object_height*0.5f, 0));
+			cga::Rectangle* start = new cga::Rectangle("Start", glm::mat4(), object_width, object_height, glm::vec3(1, 1, 1));
+			stack.push_back(boost::shared_ptr<cga::Shape>(start));
+			derivation.derive(grammar, stack, pivot);
+		}
+		derived_filename = filename;
+		derivation.generateGeometry(vertices);
 	} catch (const std::string& ex) {
 		std::cout << "ERROR:" << std::endl << ex << std::endl;
 	} catch (const char* ex) {
@@ -98,6 +144,39 @@ void GLWidget3D::loadCGA(const std::string& filename) {
 	updateGL();
 }
 
+/**
+ * Select the random values of the attributes that have a range.
+ * Unless randomize is true, the previous value of the same file is reused for each attribute whose definition in the file is not changed,
+ * and only the added or edited attributes get new random values.
+ */
+void GLWidget3D::randomizeParams(const std::string& filename, cga::Grammar& grammar, bool randomize) {
+	if (randomize || filename != param_filename) {
+		param_values.clear();
+	}
+
+	std::map<std::string, cga::Attribute> definitions;
+	for (auto it = grammar.attrs.begin(); it != grammar.attrs.end(); ++it) {
+		if (!it->second.hasRange) continue;
+		definitions[it->first] = it->second;
+
+		auto prev = param_definitions.find(it->first);
+		bool edited = prev == param_definitions.end() || prev->second.value != it->second.value
+			|| prev->second.range_start != it->second.range_start || prev->second.range_end != it->second.range_end;
+		if (edited || param_values.find(it->first) == param_values.end()) {
+			cga::CGA::randomParamValue(it->second);
+			param_values[it->first] = it->second.value;
+		} else {
+			it->second.value = param_values[it->first];
+		}
+	}
+
+	param_filename = filename;
+	param_definitions.swap(definitions);
+}
+
+/**
+ * Snap the coordinates to the 0.1 grid, and merge the coplanar polygons that overlap or touch each other.
+ */
 void GLWidget3D::simplifyGeometry(std::vector<std::vector<Vertex> >& vertices) {
 	// simplify the coordinates
 	for (int i = 0; i < vertices.size(); ++i) {
@@ -106,59 +185,7 @@ void GLWidget3D::simplifyGeometry(std::vector<std::vector<Vertex> >& vertices) {
 		}
 	}
 
-	while (true) {
-		bool merged = false;
-
-		for (int i = 0; i < vertices.size() && !merged; ++i) {
-			glm::vec3 n1 = glm::normalize(glm::cross(vertices[i][1].position - vertices[i][0].position, vertices[i][2].position - vertices[i][0].position));
-			float d1 = glm::dot(n1, vertices[i][0].position);
-			AABB box1;
-			for (int k = 0; k < vertices[i].size(); ++k) {
-				box1.AddPoint(vertices[i][k].position);
-			}
-
-			for (int j = i + 1; j < vertices.size() && !merged; ++j) {
-				glm::vec3 n2 = glm::normalize(glm::cross(vertices[j][1].position - vertices[j][0].position, vertices[j][2].position - vertices[j][0].position));
-				if (glm::dot(n1, n2) < 0.99) continue;
-
-				float d2 = glm::dot(n2, vertices[j][0].position);
-				if (fabs(d1 - d2) > 0.01) continue;
-
-				AABB box2;
-				for (int k = 0; k < vertices[j].size(); ++k) {
-					box2.AddPoint(vertices[j][k].position);
-				}
-
-				if (!box1.intersect(box2)) continue;
-
-				// merge two polygons
-				std::vector<glm::vec3> polygon1;
-				for (int k = 0; k < vertices[i].size(); ++k) {
-					polygon1.push_back(vertices[i][k].position);
-				}
-				std::vector<glm::vec3> polygon2;
-				for (int k = 0; k < vertices[j].size(); ++k) {
-					polygon2.push_back(vertices[j][k].position);
-				}
-
-				std::vector<glm::vec3> union_polygon;
-				if (utils::union_polygons(polygon1, polygon2, union_polygon)) {
-					std::vector<Vertex> union_vertices;
-					for (int k = 0; k < union_polygon.size(); ++k) {
-						union_vertices.push_back(Vertex(union_polygon[k], glm::vec3(0, 0, 1), glm::vec4(0, 0, 0, 1)));
-					}
-
-					vertices.erase(vertices.begin() + j);
-					vertices.erase(vertices.begin() + i);
-					vertices.push_back(union_vertices);
-
-					merged = true;
-				}
-			}
-		}
-
-		if (!merged) break;
-	}
+	PolygonMerger::merge(vertices);
 }
 
 void GLWidget3D::normalizeObjectSize(std::vector<std::vector<Vertex> >& vertices) {
@@ -190,7 +217,40 @@ void GLWidget3D::normalizeObjectSize(std::vector<std::vector<Vertex> >& vertices
 	}
 }
 
-void GLWidget3D::generateImages(int image_width, int image_height, bool invertImage, bool blur) {
+/**
+ * Scale and move the instanced geometry into the unit cube in the same way as the polygons.
+ * Only the model matrices of the instances are changed.
+ */
+void GLWidget3D::normalizeObjectSize(InstancedGeometry& geometry) {
+	if (geometry.empty()) return;
+
+	glm::vec3 minPt, maxPt;
+	geometry.boundingBox(minPt, maxPt);
+
+	geometry.transform(normalizationMatrix(minPt, maxPt));
+}
+
+/**
+ * Return the transformation that scales and moves the bounding box into the unit cube, which normalizeObjectSize() applies.
+ */
+glm::mat4 GLWidget3D::normalizationMatrix(const glm::vec3& minPt, const glm::vec3& maxPt) {
+	glm::vec3 center = (maxPt + minPt) * 0.5f;
+
+	float size = max(maxPt.x - minPt.x, max(maxPt.y - minPt.y, maxPt.z - minPt.z));
+	float scale = 1.0f / size;
+
+	return glm::translate(glm::scale(glm::mat4(), glm::vec3(scale, scale, scale)), -center);
+}
+
+/**
+ * Generate images of windows for all the grammars in cga/window.
+ * The derivation, the rasterization, and the encoding of the images run in parallel by ImagePipeline.
+ *
+ * @param output_format	the format of the dataset (DatasetWriter::FORMAT_PNG, FORMAT_SHARDED, FORMAT_SHARDED_PNG, or FORMAT_NPY)
+ * @param lod_min_pixels	the shapes smaller than this number of pixels are not derived (0 to derive all the shapes)
+ * @param batch_size		the number of the samples derived at once by CGA::deriveBatch() (1 to derive each sample by itself)
+ */
+void GLWidget3D::generateImages(int image_width, int image_height, bool invertImage, bool blur, int output_format, float lod_min_pixels, int batch_size) {
 	QDir dir("..\\cga\\window\\");
 	//QDir dir("..\\cga\\windows_low_LOD\\");
 
@@ -210,94 +270,76 @@ void GLWidget3D::generateImages(int image_width, int image_height, bool invertIm
 	resizeGL(image_width, image_height);
 
 	QStringList filters;
-	filters << "*.xml";
+	filters << "*.xml" << "*.cga";
 	QFileInfoList fileInfoList = dir.entryInfoList(filters, QDir::Files|QDir::NoDotAndDotDot);
 	for (int i = 0; i < fileInfoList.size(); ++i) {
 		int count = 0;
 	
 		if (!QDir("results/" + fileInfoList[i].baseName()).exists()) QDir().mkdir("results/" + fileInfoList[i].baseName());
 
-		QFile file("results/" + fileInfoList[i].baseName() + "/parameters.txt");
-		if (!file.open(QIODevice::WriteOnly)) {
-			std::cerr << "Cannot open file for writing: " << qPrintable(file.errorString()) << std::endl;
-			return;
+		cga::Grammar grammar;
+		try {
+			cga::loadGrammar(fileInfoList[i].absoluteFilePath().toUtf8().constData(), grammar);
+		} catch (const std::string& ex) {
+			std::cout << "ERROR:" << std::endl << ex << std::endl;
+			continue;
+		} catch (const char* ex) {
+			std::cout << "ERROR:" << std::endl << ex << std::endl;
+			continue;
 		}
 
-		QTextStream out(&file);
+		ImagePipeline pipeline("results/" + fileInfoList[i].baseName(), image_width, image_height, invertImage, blur, output_format);
+		pipeline.setLevelOfDetail(lod_min_pixels);
+		pipeline.setBatchSize(batch_size);
+		if (!pipeline.start()) return;
 
 		for (float object_width = 1.0f; object_width <= 2.6f; object_width += 0.05f) {
 			for (float object_height = 1.0f; object_height <= 1.8f; object_height += 0.05f) {
 				for (int k = 0; k < 2; ++k) { // 1 images (parameter values are randomly selected) for each width and height
-					std::vector<float> param_values;
-
-					vertices.clear();
-
-					// generate a window
-					cga::Rectangle* start = new cga::Rectangle("Start", glm::translate(glm::rotate(glm::mat4(), -3.141592f * 0.5f, glm::vec3(1, 0, 0)), glm::vec3(-object_width*0.5f, -object_height*0.5f, 0)), glm::mat4(), object_width, object_height, glm::vec3(1, 1, 1));
-					system.stack.push_back(boost::shared_ptr<cga::Shape>(start));
-
-					try {
-						cga::Grammar grammar;
-						cga::parseGrammar(fileInfoList[i].absoluteFilePath().toUtf8().constData(), grammar);
-						param_values = system.randomParamValues(grammar);
-						system.derive(grammar, true);
-						system.generateGeometry(vertices);
-					} catch (const std::string& ex) {
-						std::cout << "ERROR:" << std::endl << ex << std::endl;
-					} catch (const char* ex) {
-						std::cout << "ERROR:" << std::endl << ex << std::endl;
-					}
-
-					normalizeObjectSize(vertices);
+					ImageSample* sample = new ImageSample(count, count, grammar, object_width, object_height);
+					sample->cameras.push_back(camera);
+					sample->param_values = system.randomParamValues(sample->grammar);
 
 					// put ratio of width/height at the begining of the param values array
-					param_values.insert(param_values.begin(), object_width / object_height);
-
-					// write all the param values to the file
-					for (int pi = 0; pi < param_values.size(); ++pi) {
-						if (pi > 0) {
-							out << ",";
-						}
-						out << param_values[pi];
-					}
-					out << "\n";
-
-					// render a window
-					fb->setClearColor(glm::vec3(1, 1, 1));
-					fb->clear();
-					fb->rasterize(&camera, vertices, count);
-					fb->draw();
+					sample->param_values.insert(sample->param_values.begin(), object_width / object_height);
 
-					QString filename = "results/" + fileInfoList[i].baseName() + "/" + QString("image_%1.png").arg(count, 4, 10, QChar('0'));
-					QImage image = grabFrameBuffer();
-
-					if (invertImage) {
-						image.invertPixels();
-					}
-
-					if (blur) {
-						cv::Mat mat(image.height(), image.width(), CV_8UC4, image.bits(), image.bytesPerLine());
-						cv::GaussianBlur(mat, mat, cv::Size(7, 7), 0, 0);
-					}
-			
-					image.save(filename);
+					pipeline.push(sample);
 
 					count++;
 				}
 			}
 		}
 
-		file.close();
+		pipeline.finish();
 	}
 
 	resize(origWidth, origHeight);
 	resizeGL(origWidth, origHeight);
 }
 
-void GLWidget3D::generateBuildingImages(int image_width, int image_height, bool invertImage, bool blur) {
+/**
+ * Generate images of buildings for all the grammars in cga/building.
+ * The derivation, the rasterization, and the encoding of the images run in parallel by ImagePipeline.
+ * 16 images are generated for each width and height. Each sampled building is derived once and rendered
+ * from num_views random cameras, so 16 / num_views buildings (rounded up) are sampled for each width and height,
+ * and the last one gets the rest of the 16 views if num_views does not divide 16.
+ * The polygons are triangulated once on their own plane for all the views, so a concave polygon may be filled
+ * slightly differently from the triangulation on the screen even with one view.
+ *
+ * @param output_format	the format of the dataset (DatasetWriter::FORMAT_PNG, FORMAT_SHARDED, FORMAT_SHARDED_PNG, or FORMAT_NPY)
+ * @param lod_min_pixels	the shapes smaller than this number of pixels are not derived (0 to derive all the shapes)
+ * @param batch_size		the number of the samples derived at once by CGA::deriveBatch() (1 to derive each sample by itself)
+ * @param num_views		the number of views per building, from 1 to 16 (1 to derive a new building for every image)
+ */
+void GLWidget3D::generateBuildingImages(int image_width, int image_height, bool invertImage, bool blur, int output_format, float lod_min_pixels, int batch_size, int num_views) {
 	QDir dir("..\\cga\\building\\");
 	//QDir dir("..\\cga\\windows_low_LOD\\");
 
+	if (num_views < 1 || num_views > 16) {
+		std::cout << "ERROR:" << std::endl << "The number of views must be from 1 to 16." << std::endl;
+		return;
+	}
+
 	if (!QDir("results").exists()) QDir().mkdir("results");
 
 	srand(0);
@@ -308,95 +350,348 @@ void GLWidget3D::generateBuildingImages(int image_width, int image_height, bool
 	resizeGL(image_width, image_height);
 
 	QStringList filters;
-	filters << "*.xml";
+	filters << "*.xml" << "*.cga";
 	QFileInfoList fileInfoList = dir.entryInfoList(filters, QDir::Files|QDir::NoDotAndDotDot);
 	for (int i = 0; i < fileInfoList.size(); ++i) {
 		int count = 0;
+		int image_count = 0;
 	
 		if (!QDir("results/" + fileInfoList[i].baseName()).exists()) QDir().mkdir("results/" + fileInfoList[i].baseName());
 
-		QFile file("results/" + fileInfoList[i].baseName() + "/parameters.txt");
-		if (!file.open(QIODevice::WriteOnly)) {
-			std::cerr << "Cannot open file for writing: " << qPrintable(file.errorString()) << std::endl;
-			return;
+		cga::Grammar grammar;
+		try {
+			cga::loadGrammar(fileInfoList[i].absoluteFilePath().toUtf8().constData(), grammar);
+		} catch (const std::string& ex) {
+			std::cout << "ERROR:" << std::endl << ex << std::endl;
+			continue;
+		} catch (const char* ex) {
+			std::cout << "ERROR:" << std::endl << ex << std::endl;
+			continue;
 		}
 
-		QTextStream out(&file);
+		ImagePipeline pipeline("results/" + fileInfoList[i].baseName(), image_width, image_height, invertImage, blur, output_format);
+		pipeline.setLevelOfDetail(lod_min_pixels);
+		pipeline.setBatchSize(batch_size);
+		if (!pipeline.start()) return;
 
 		for (float object_width = 10.0f; object_width <= 14.0f; object_width += 0.5f) {
 			for (float object_height = 10.0f; object_height <= 14.0f; object_height += 0.5f) {
-				for (int k = 0; k < 16; ++k) { // 1 images (parameter values are randomly selected) for each width and height
-					// change camera view direction
-					camera.xrot = 35.0f + ((float)rand() / RAND_MAX - 0.5f) * 40.0f;
-					camera.yrot = -45.0f + ((float)rand() / RAND_MAX - 0.5f) * 40.0f;
-					camera.zrot = 0.0f;
-					camera.pos = glm::vec3(0, 0, 2.5f);
-					camera.updateMVPMatrix();
-
-					std::vector<float> param_values;
-
-					vertices.clear();
-
-					// generate a window
-					cga::Rectangle* start = new cga::Rectangle("Start", glm::translate(glm::rotate(glm::mat4(), -3.141592f * 0.5f, glm::vec3(1, 0, 0)), glm::vec3(-object_width*0.5f, -object_height*0.5f, 0)), glm::mat4(), object_width, object_height, glm::vec3(1, 1, 1));
-					system.stack.push_back(boost::shared_ptr<cga::Shape>(start));
-
-					try {
-						cga::Grammar grammar;
-						cga::parseGrammar(fileInfoList[i].absoluteFilePath().toUtf8().constData(), grammar);
-						param_values = system.randomParamValues(grammar);
-						system.derive(grammar, true);
-						system.generateGeometry(vertices);
-					} catch (const std::string& ex) {
-						std::cout << "ERROR:" << std::endl << ex << std::endl;
-					} catch (const char* ex) {
-						std::cout << "ERROR:" << std::endl << ex << std::endl;
+				for (int k = 0; k < 16; k += num_views) { // 1 building (parameter values are randomly selected) for every num_views images
+					ImageSample* sample = new ImageSample(count, image_count, grammar, object_width, object_height);
+
+					int sample_views = (std::min)(num_views, 16 - k);
+					for (int v = 0; v < sample_views; ++v) {
+						// change camera view direction
+						camera.xrot = 35.0f + ((float)rand() / RAND_MAX - 0.5f) * 40.0f;
+						camera.yrot = -45.0f + ((float)rand() / RAND_MAX - 0.5f) * 40.0f;
+						camera.zrot = 0.0f;
+						camera.pos = glm::vec3(0, 0, 2.5f);
+						camera.updateMVPMatrix();
+
+						sample->cameras.push_back(camera);
 					}
 
-					normalizeObjectSize(vertices);
+					sample->param_values = system.randomParamValues(sample->grammar);
 
 					// put ratio of width/height at the begining of the param values array
-					param_values.insert(param_values.begin(), object_width / object_height);
-
-					// write all the param values to the file
-					for (int pi = 0; pi < param_values.size(); ++pi) {
-						if (pi > 0) {
-							out << ",";
-						}
-						out << param_values[pi];
-					}
-					out << "\n";
+					sample->param_values.insert(sample->param_values.begin(), object_width / object_height);
 
-					// render a window
-					fb->setClearColor(glm::vec3(1, 1, 1));
-					fb->clear();
-					fb->rasterize(&camera, vertices, count);
-					fb->draw();
+					pipeline.push(sample);
 
-					QString filename = "results/" + fileInfoList[i].baseName() + "/" + QString("image_%1.png").arg(count, 4, 10, QChar('0'));
-					QImage image = grabFrameBuffer();
+					count++;
+					image_count += sample_views;
+				}
+			}
+		}
 
-					if (invertImage) {
-						image.invertPixels();
-					}
+		pipeline.finish();
+	}
 
-					if (blur) {
-						cv::Mat mat(image.height(), image.width(), CV_8UC4, image.bits(), image.bytesPerLine());
-						cv::GaussianBlur(mat, mat, cv::Size(7, 7), 0, 0);
+	resize(origWidth, origHeight);
+	resizeGL(origWidth, origHeight);
+}
+
+/**
+ * Derive the grammar repeatedly with the random parameter values, and report the time of each rule and operator.
+ * The statistics are printed, and the trace is written to "<grammar file>.trace.json", which can be opened by chrome://tracing.
+ * The data are recorded only if the program is built with CGA_PROFILE.
+ * The same samples are then derived by CGA::deriveMemoized(), and the hits and misses of its subtree cache are reported.
+ */
+void GLWidget3D::profileDerivation(const std::string& filename, int num_repeats) {
+	if (!cga::DerivationProfiler::isEnabled()) {
+		std::cout << "The derivation profiler is disabled. Build with CGA_PROFILE to enable it." << std::endl;
+		return;
+	}
+
+	cga::Grammar grammar;
+	try {
+		cga::loadGrammar(filename.c_str(), grammar);
+	} catch (const std::string& ex) {
+		std::cout << "ERROR:" << std::endl << ex << std::endl;
+		return;
+	} catch (const char* ex) {
+		std::cout << "ERROR:" << std::endl << ex << std::endl;
+		return;
+	}
+
+	float object_width = 10.0f;
+	float object_height = 8.0f;
+
+	srand(0);
+	cga::DerivationProfiler::reset();
+	for (int i = 0; i < num_repeats; ++i) {
+		cga::CGA system;
+		system.pivot = glm::translate(glm::rotate(glm::mat4(), -3.141592f * 0.5f, glm::vec3(1, 0, 0)), glm::vec3(-object_width*0.5f, -object_height*0.5f, 0));
+		cga::Rectangle* start = new cga::Rectangle("Start", glm::mat4(), object_width, object_height, glm::vec3(1, 1, 1));
+		system.stack.push_back(boost::shared_ptr<cga::Shape>(start));
+
+		try {
+			system.randomParamValues(grammar);
+			system.derive(grammar, true);
+		} catch (const std::string& ex) {
+			std::cout << "ERROR:" << std::endl << ex << std::endl;
+			return;
+		} catch (const char* ex) {
+			std::cout << "ERROR:" << std::endl << ex << std::endl;
+			return;
+		}
+	}
+
+	std::cout << filename << " (" << num_repeats << " derivations)" << std::endl;
+	cga::DerivationProfiler::printSummary(std::cout);
+
+	QString trace_filename = QString::fromUtf8(filename.c_str()) + ".trace.json";
+	if (cga::DerivationProfiler::writeChromeTrace(trace_filename)) {
+		std::cout << "Trace: " << trace_filename.toUtf8().constData() << std::endl;
+	}
+
+	// the memoized derivations are not profiled, so that they do not change the statistics above
+	srand(0);
+	int num_hits = 0;
+	int num_misses = 0;
+	for (int i = 0; i < num_repeats; ++i) {
+		cga::CGA system;
+		cga::Rectangle* start = new cga::Rectangle("Start", glm::mat4(), object_width, object_height, glm::vec3(1, 1, 1));
+		system.stack.push_back(boost::shared_ptr<cga::Shape>(start));
+
+		try {
+			system.randomParamValues(grammar);
+			cga::MemoizedDerivation derivation(grammar, system.budget, true);
+			derivation.derive(system.stack, system.shapes);
+			num_hits += derivation.numHits();
+			num_misses += derivation.numMisses();
+		} catch (const std::string& ex) {
+			std::cout << "ERROR:" << std::endl << ex << std::endl;
+			return;
+		} catch (const char* ex) {
+			std::cout << "ERROR:" << std::endl << ex << std::endl;
+			return;
+		}
+	}
+	std::cout << "Memoization: " << num_hits << " hits, " << num_misses << " misses";
+	if (num_hits + num_misses > 0) {
+		std::cout << " (" << num_hits * 100 / (num_hits + num_misses) << "% of the cacheable subtrees)";
+	}
+	std::cout << std::endl;
+}
+
+/**
+ * Derive the grammar with the random parameter values by the serial derivations and by the batch derivation,
+ * and report the throughput of each. The samples that the batch derivation leaves to CGA::derive() are derived
+ * serially in the batch derivation as ImagePipeline does, so the time includes them.
+ *
+ * @param batch_size	the number of the samples derived at once by CGA::deriveBatch()
+ */
+void GLWidget3D::benchmarkBatchDerivation(const std::string& filename, int num_samples, int batch_size) {
+	cga::Grammar grammar;
+	try {
+		cga::loadGrammar(filename.c_str(), grammar);
+	} catch (const std::string& ex) {
+		std::cout << "ERROR:" << std::endl << ex << std::endl;
+		return;
+	} catch (const char* ex) {
+		std::cout << "ERROR:" << std::endl << ex << std::endl;
+		return;
+	}
+
+	float object_width = 10.0f;
+	float object_height = 8.0f;
+	cga::AffineTransform pivot = glm::translate(glm::rotate(glm::mat4(), -3.141592f * 0.5f, glm::vec3(1, 0, 0)), glm::vec3(-object_width*0.5f, -object_height*0.5f, 0));
+
+	srand(0);
+	std::vector<cga::Grammar> grammars(num_samples, grammar);
+	for (int i = 0; i < num_samples; ++i) {
+		system.randomParamValues(grammars[i]);
+	}
+
+	std::cout << filename << " (" << num_samples << " samples)" << std::endl;
+
+	// 0: derive(), 1: deriveMemoized(), 2: deriveBatch()
+	static const char* method_names[] = { "derive", "deriveMemoized", "deriveBatch" };
+	for (int method = 0; method < 3; ++method) {
+		int num_skipped = 0;
+		QElapsedTimer timer;
+		timer.start();
+
+		for (int i = 0; i < num_samples; i += (method == 2 ? batch_size : 1)) {
+			int n = method == 2 ? (std::min)(batch_size, num_samples - i) : 1;
+			std::vector<cga::CGA> systems(n);
+			std::vector<cga::CGA*> system_ptrs(n);
+			std::vector<const cga::Grammar*> grammar_ptrs(n);
+			for (int k = 0; k < n; ++k) {
+				systems[k].pivot = pivot;
+				systems[k].stack.push_back(boost::shared_ptr<cga::Shape>(new cga::Rectangle("Start", glm::mat4(), object_width, object_height, glm::vec3(1, 1, 1))));
+				system_ptrs[k] = &systems[k];
+				grammar_ptrs[k] = &grammars[i + k];
+			}
+
+			std::vector<boost::shared_ptr<cga::BudgetExceededError> > errors(n);
+			if (method == 2) {
+				cga::CGA::deriveBatch(system_ptrs, grammar_ptrs, errors, true);
+			}
+
+			for (int k = 0; k < n; ++k) {
+				if (errors[k]) {
+					num_skipped++;
+					continue;
+				}
+				if (systems[k].stack.empty()) continue;
+
+				try {
+					if (method == 1) {
+						systems[k].deriveMemoized(grammars[i + k], true);
+					} else {
+						systems[k].derive(grammars[i + k], true);
 					}
-			
-					image.save(filename);
+				} catch (const cga::BudgetExceededError&) {
+					num_skipped++;
+				} catch (const std::string& ex) {
+					std::cout << "ERROR:" << std::endl << ex << std::endl;
+					return;
+				} catch (const char* ex) {
+					std::cout << "ERROR:" << std::endl << ex << std::endl;
+					return;
+				}
+			}
+		}
 
-					count++;
+		qint64 elapsed_nsec = timer.nsecsElapsed();
+		std::cout << "  " << method_names[method] << ": " << elapsed_nsec * 1e-9 << " sec (" << (elapsed_nsec > 0 ? num_samples / (elapsed_nsec * 1e-9) : 0) << " samples/sec, " << num_skipped << " skipped)" << std::endl;
+	}
+}
+
+/**
+ * Derive every grammar in the directory with the random parameter values by CGA::derive(), by CGA::deriveParallel(),
+ * and by CGA::deriveBatch(), and report whether the terminal shapes are the same, including their order.
+ * The samples that exceed the budget by CGA::derive() have to exceed it by CGA::deriveBatch() as well.
+ *
+ * @param num_samples	the number of the random parameter values for each grammar, all of which are derived at once by CGA::deriveBatch()
+ */
+void GLWidget3D::checkDerivations(const QString& dir_name, int num_samples) {
+	float object_width = 10.0f;
+	float object_height = 8.0f;
+	int num_threads = (std::max)(2, (int)boost::thread::hardware_concurrency());
+
+	QStringList filters;
+	filters << "*.xml" << "*.cga";
+	QFileInfoList fileInfoList = QDir(dir_name).entryInfoList(filters, QDir::Files|QDir::NoDotAndDotDot);
+	int num_failed_grammars = 0;
+	for (int i = 0; i < fileInfoList.size(); ++i) {
+		cga::Grammar grammar;
+		try {
+			cga::loadGrammar(fileInfoList[i].absoluteFilePath().toUtf8().constData(), grammar);
+		} catch (const std::string& ex) {
+			std::cout << "ERROR:" << std::endl << ex << std::endl;
+			continue;
+		} catch (const char* ex) {
+			std::cout << "ERROR:" << std::endl << ex << std::endl;
+			continue;
+		}
+
+		srand(0);
+		std::vector<cga::Grammar> grammars(num_samples, grammar);
+		for (int k = 0; k < num_samples; ++k) {
+			system.randomParamValues(grammars[k]);
+		}
+
+		// all the samples are derived in lockstep, and the samples left in the stack are derived by derive() as the dataset does
+		std::vector<cga::CGA> batch(num_samples);
+		std::vector<cga::CGA*> batch_ptrs(num_samples);
+		std::vector<const cga::Grammar*> grammar_ptrs(num_samples);
+		for (int k = 0; k < num_samples; ++k) {
+			batch[k].stack.push_back(boost::shared_ptr<cga::Shape>(new cga::Rectangle("Start", glm::mat4(), object_width, object_height, glm::vec3(1, 1, 1))));
+			batch_ptrs[k] = &batch[k];
+			grammar_ptrs[k] = &grammars[k];
+		}
+		std::vector<boost::shared_ptr<cga::BudgetExceededError> > batch_errors(num_samples);
+		cga::CGA::deriveBatch(batch_ptrs, grammar_ptrs, batch_errors, true);
+
+		int num_mismatches = 0;
+		for (int k = 0; k < num_samples; ++k) {
+			cga::CGA serial;
+			cga::CGA parallel;
+			serial.stack.push_back(boost::shared_ptr<cga::Shape>(new cga::Rectangle("Start", glm::mat4(), object_width, object_height, glm::vec3(1, 1, 1))));
+			parallel.stack.push_back(boost::shared_ptr<cga::Shape>(new cga::Rectangle("Start", glm::mat4(), object_width, object_height, glm::vec3(1, 1, 1))));
+
+			bool exceeded = false;
+			try {
+				serial.derive(grammars[k], true);
+			} catch (const cga::BudgetExceededError&) {
+				exceeded = true;
+			} catch (const std::string& ex) {
+				std::cout << "ERROR:" << std::endl << ex << std::endl;
+				num_mismatches++;
+				continue;
+			} catch (const char* ex) {
+				std::cout << "ERROR:" << std::endl << ex << std::endl;
+				num_mismatches++;
+				continue;
+			}
+
+			bool batch_exceeded = batch_errors[k] != NULL;
+			try {
+				if (!exceeded) {
+					parallel.deriveParallel(grammars[k], num_threads, true);
 				}
+				if (!batch_exceeded && !batch[k].stack.empty()) {
+					batch[k].derive(grammars[k], true);
+				}
+			} catch (const cga::BudgetExceededError&) {
+				batch_exceeded = true;
+			} catch (const std::string& ex) {
+				std::cout << "ERROR:" << std::endl << ex << std::endl;
+				num_mismatches++;
+				continue;
+			} catch (const char* ex) {
+				std::cout << "ERROR:" << std::endl << ex << std::endl;
+				num_mismatches++;
+				continue;
+			}
+
+			if (exceeded != batch_exceeded) {
+				std::cout << "  sample " << k << ": " << (exceeded ? "derive" : "deriveBatch") << " exceeds the budget but " << (exceeded ? "deriveBatch" : "derive") << " does not" << std::endl;
+				num_mismatches++;
+				continue;
+			}
+			if (exceeded) continue;
+
+			int index = findMismatch(serial.shapes, parallel.shapes);
+			if (index >= 0) {
+				std::cout << "  sample " << k << ": deriveParallel differs from derive at terminal shape " << index << std::endl;
+				num_mismatches++;
+			}
+			index = findMismatch(serial.shapes, batch[k].shapes);
+			if (index >= 0) {
+				std::cout << "  sample " << k << ": deriveBatch differs from derive at terminal shape " << index << std::endl;
+				num_mismatches++;
 			}
 		}
 
-		file.close();
+		std::cout << fileInfoList[i].fileName().toUtf8().constData() << ": " << (num_mismatches == 0 ? "OK" : "MISMATCH") << " (" << num_samples << " samples)" << std::endl;
+		if (num_mismatches > 0) num_failed_grammars++;
 	}
 
-	resize(origWidth, origHeight);
-	resizeGL(origWidth, origHeight);
+	std::cout << num_failed_grammars << " of " << fileInfoList.size() << " grammars failed." << std::endl;
 }
 
 void GLWidget3D::hoge() {
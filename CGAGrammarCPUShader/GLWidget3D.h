@@ -8,6 +8,7 @@
 #include <vector>
 #include "FrameBuffer.h"
 #include "CGA.h"
+#include "IncrementalDerivation.h"
 
 using namespace std;
 
@@ -19,16 +20,28 @@ private:
 	QPoint lastPos;
 	FrameBuffer* fb;
 	cga::CGA system;
+	cga::IncrementalDerivation derivation;
+	std::string derived_filename;
+	/** the file, the definitions in the file, and the random values of the attributes that have a range */
+	std::string param_filename;
+	std::map<std::string, cga::Attribute> param_definitions;
+	std::map<std::string, std::string> param_values;
 	std::vector<std::vector<Vertex> > vertices;
 
 public:
 	GLWidget3D();
 
-	void loadCGA(const std::string& filename);
-	void simplifyGeometry(std::vector<std::vector<Vertex> >& vertices);
-	void normalizeObjectSize(std::vector<std::vector<Vertex> >& vertices);
-	void generateImages(int image_width, int image_height, bool invertImage, bool blur);
-	void generateBuildingImages(int image_width, int image_height, bool invertImage, bool blur);
+	void loadCGA(const std::string& filename, bool randomize);
+	void randomizeParams(const std::string& filename, cga::Grammar& grammar, bool randomize);
+	static void simplifyGeometry(std::vector<std::vector<Vertex> >& vertices);
+	static void normalizeObjectSize(std::vector<std::vector<Vertex> >& vertices);
+	static void normalizeObjectSize(InstancedGeometry& geometry);
+	static glm::mat4 normalizationMatrix(const glm::vec3& minPt, const glm::vec3& maxPt);
+	void generateImages(int image_width, int image_height, bool invertImage, bool blur, int output_format, float lod_min_pixels, int batch_size);
+	void generateBuildingImages(int image_width, int image_height, bool invertImage, bool blur, int output_format, float lod_min_pixels, int batch_size, int num_views);
+	void profileDerivation(const std::string& filename, int num_repeats);
+	void benchmarkBatchDerivation(const std::string& filename, int num_samples, int batch_size);
+	void checkDerivations(const QString& dir_name, int num_samples);
 	void hoge();
 
 protected:
@@ -15,10 +15,9 @@ typedef boost::shared_ptr<Ss> SsPtr ;
 
 namespace cga {
 
-GableRoof::GableRoof(const std::string& name, const glm::mat4& pivot, const glm::mat4& modelMat, const std::vector<glm::vec2>& points, float angle, const glm::vec3& color) {
+GableRoof::GableRoof(const std::string& name, const AffineTransform& modelMat, const std::vector<glm::vec2>& points, float angle, const glm::vec3& color) {
 	this->_name = name;
 	this->_removed = false;
-	this->_pivot = pivot;
 	this->_modelMat = modelMat;
 	this->_points = points;
 	this->_angle = angle;
@@ -128,7 +127,7 @@ void GableRoof::comp(const std::map<std::string, std::string>& name_map, std::ve
 						pts2d.push_back(glm::vec2(inv * glm::vec4(prev_p, 1)));
 						pts2d.push_back(glm::vec2(pts2d[1].x * 0.5, z));
 
-						shapes.push_back(boost::shared_ptr<Shape>(new Polygon(name_map.at("vertical"), _pivot, _modelMat * mat, pts2d, _color, _texture)));
+						shapes.push_back(boost::shared_ptr<Shape>(new Polygon(name_map.at("vertical"), _modelMat * mat, pts2d, _color, _texture)));
 					} else if (num_edges[count] > 3 && name_map.find("top") != name_map.end() && name_map.at("top") != "NIL") {
 						std::vector<glm::vec3> pts3d;
 						std::vector<glm::vec3> normals;
@@ -139,7 +138,7 @@ void GableRoof::comp(const std::map<std::string, std::string>& name_map, std::ve
 						normals.push_back(n);
 						normals.push_back(n);
 						normals.push_back(n);
-						shapes.push_back(boost::shared_ptr<Shape>(new GeneralObject(name_map.at("top"), _pivot, _modelMat, pts3d, normals, _color)));
+						shapes.push_back(boost::shared_ptr<Shape>(new GeneralObject(name_map.at("top"), _modelMat, pts3d, normals, _color)));
 					}
 	
 					prev_p = glm::vec3(p2, z);
@@ -149,7 +148,9 @@ void GableRoof::comp(const std::map<std::string, std::string>& name_map, std::ve
 	}
 }
 
-void GableRoof::generateGeometry(float opacity, std::vector<std::vector<Vertex> >& vertices) const {
+void GableRoof::generateGeometry(const AffineTransform& pivot, float opacity, std::vector<std::vector<Vertex> >& vertices) const {
+	AffineTransform worldMat = pivot * _modelMat;
+
 	Polygon_2 poly;
 	for (int i = 0; i < _points.size(); ++i) {
 		poly.push_back(KPoint(_points[i].x, _points[i].y));
@@ -231,9 +232,9 @@ void GableRoof::generateGeometry(float opacity, std::vector<std::vector<Vertex>
 
 					// 三角形を作成
 					pts.push_back(glm::vec3(p2, z));
-					/*glm::vec3 v0 = glm::vec3(_pivot * _modelMat * glm::vec4(p0, 0, 1));
-					glm::vec3 v1 = glm::vec3(_pivot * _modelMat * glm::vec4(prev_p, 1));
-					glm::vec3 v2 = glm::vec3(_pivot * _modelMat * glm::vec4(p2, z, 1));
+					/*glm::vec3 v0 = glm::vec3(worldMat * glm::vec4(p0, 0, 1));
+					glm::vec3 v1 = glm::vec3(worldMat * glm::vec4(prev_p, 1));
+					glm::vec3 v2 = glm::vec3(worldMat * glm::vec4(p2, z, 1));
 
 					glm::vec3 normal = glm::normalize(glm::cross(v1 - v0, v2 - v0));
 
@@ -248,7 +249,7 @@ void GableRoof::generateGeometry(float opacity, std::vector<std::vector<Vertex>
 
 		int offset = vertices.size();
 		vertices.resize(offset + 1);
-		glutils::drawPolygon(pts, glm::vec4(_color, opacity), _pivot * _modelMat, vertices[offset]);
+		glutils::drawPolygon(pts, glm::vec4(_color, opacity), worldMat, vertices[offset]);
 	}
 }
 
@@ -5,10 +5,9 @@
 
 namespace cga {
 
-GeneralObject::GeneralObject(const std::string& name, const glm::mat4& pivot, const glm::mat4& modelMat, const std::vector<glm::vec3>& points, const std::vector<glm::vec3>& normals, const glm::vec3& color) {
+GeneralObject::GeneralObject(const std::string& name, const AffineTransform& modelMat, const std::vector<glm::vec3>& points, const std::vector<glm::vec3>& normals, const glm::vec3& color) {
 	this->_name = name;
 	this->_removed = false;
-	this->_pivot = pivot;
 	this->_modelMat = modelMat;
 	this->_points.push_back(points);
 	this->_normals.push_back(normals);
@@ -16,10 +15,9 @@ GeneralObject::GeneralObject(const std::string& name, const glm::mat4& pivot, co
 	this->_textureEnabled = false;
 }
 
-GeneralObject::GeneralObject(const std::string& name, const glm::mat4& pivot, const glm::mat4& modelMat, const std::vector<std::vector<glm::vec3> >& points, const std::vector<std::vector<glm::vec3> >& normals, const glm::vec3& color) {
+GeneralObject::GeneralObject(const std::string& name, const AffineTransform& modelMat, const std::vector<std::vector<glm::vec3> >& points, const std::vector<std::vector<glm::vec3> >& normals, const glm::vec3& color) {
 	this->_name = name;
 	this->_removed = false;
-	this->_pivot = pivot;
 	this->_modelMat = modelMat;
 	this->_points = points;
 	this->_normals = normals;
@@ -27,10 +25,9 @@ GeneralObject::GeneralObject(const std::string& name, const glm::mat4& pivot, co
 	this->_textureEnabled = false;
 }
 
-GeneralObject::GeneralObject(const std::string& name, const glm::mat4& pivot, const glm::mat4& modelMat, const std::vector<glm::vec3>& points, const std::vector<glm::vec3>& normals, const glm::vec3& color, const std::vector<glm::vec2>& texCoords, const std::string& texture) {
+GeneralObject::GeneralObject(const std::string& name, const AffineTransform& modelMat, const std::vector<glm::vec3>& points, const std::vector<glm::vec3>& normals, const glm::vec3& color, const std::vector<glm::vec2>& texCoords, const std::string& texture) {
 	this->_name = name;
 	this->_removed = false;
-	this->_pivot = pivot;
 	this->_modelMat = modelMat;
 	this->_points.push_back(points);
 	this->_normals.push_back(normals);
@@ -40,10 +37,9 @@ GeneralObject::GeneralObject(const std::string& name, const glm::mat4& pivot, co
 	this->_textureEnabled = true;
 }
 
-GeneralObject::GeneralObject(const std::string& name, const glm::mat4& pivot, const glm::mat4& modelMat, const std::vector<std::vector<glm::vec3> >& points, const std::vector<std::vector<glm::vec3> >& normals, const glm::vec3& color, const std::vector<std::vector<glm::vec2> >& texCoords, const std::string& texture) {
+GeneralObject::GeneralObject(const std::string& name, const AffineTransform& modelMat, const std::vector<std::vector<glm::vec3> >& points, const std::vector<std::vector<glm::vec3> >& normals, const glm::vec3& color, const std::vector<std::vector<glm::vec2> >& texCoords, const std::string& texture) {
 	this->_name = name;
 	this->_removed = false;
-	this->_pivot = pivot;
 	this->_modelMat = modelMat;
 	this->_points = points;
 	this->_normals = normals;
@@ -53,6 +49,49 @@ GeneralObject::GeneralObject(const std::string& name, const glm::mat4& pivot, co
 	this->_textureEnabled = true;
 }
 
+/**
+ * The asset is placed so that the minimum corner of its bounding box is at the origin, and it is scaled by the given scale.
+ */
+GeneralObject::GeneralObject(const std::string& name, const AffineTransform& modelMat, const boost::shared_ptr<const Asset>& asset, const glm::vec3& scale, const glm::vec3& color) {
+	this->_name = name;
+	this->_removed = false;
+	this->_modelMat = modelMat;
+	this->_asset = asset;
+	this->_assetScale = scale;
+	this->_color = color;
+	this->_textureEnabled = false;
+	this->_generateTexCoords = false;
+}
+
+GeneralObject::GeneralObject(const std::string& name, const AffineTransform& modelMat, const boost::shared_ptr<const Asset>& asset, const glm::vec3& scale, const glm::vec3& color, const std::string& texture) {
+	this->_name = name;
+	this->_removed = false;
+	this->_modelMat = modelMat;
+	this->_asset = asset;
+	this->_assetScale = scale;
+	this->_color = color;
+	this->_texture = texture;
+	this->_textureEnabled = true;
+	this->_generateTexCoords = false;
+}
+
+/**
+ * The texture coordinates of the asset are generated from the scaled points by texOrigin + (x, y) * texScale.
+ */
+GeneralObject::GeneralObject(const std::string& name, const AffineTransform& modelMat, const boost::shared_ptr<const Asset>& asset, const glm::vec3& scale, const glm::vec3& color, const std::string& texture, const glm::vec2& texOrigin, const glm::vec2& texScale) {
+	this->_name = name;
+	this->_removed = false;
+	this->_modelMat = modelMat;
+	this->_asset = asset;
+	this->_assetScale = scale;
+	this->_color = color;
+	this->_texture = texture;
+	this->_textureEnabled = true;
+	this->_generateTexCoords = true;
+	this->_texOrigin = texOrigin;
+	this->_texScale = texScale;
+}
+
 boost::shared_ptr<Shape> GeneralObject::clone(const std::string& name) const {
 	boost::shared_ptr<Shape> copy = boost::shared_ptr<Shape>(new GeneralObject(*this));
 	copy->_name = name;
@@ -62,6 +101,14 @@ boost::shared_ptr<Shape> GeneralObject::clone(const std::string& name) const {
 void GeneralObject::size(float xSize, float ySize, float zSize) {
 	_prev_scope = _scope;
 
+	if (_asset) {
+		glm::vec3 size = _asset->size() * _assetScale;
+		_assetScale.x *= xSize / size.x;
+		_assetScale.y *= xSize / size.y;
+		_assetScale.z *= xSize / size.z;
+		return;
+	}
+
 	BoundingBox bbox(_points);
 	float scale_x = xSize / bbox.sx();
 	float scale_y = xSize / bbox.sy();
@@ -76,18 +123,56 @@ void GeneralObject::size(float xSize, float ySize, float zSize) {
 	}
 }
 
-void GeneralObject::generateGeometry(float opacity, std::vector<std::vector<Vertex> >& vertices) const {
+void GeneralObject::generateGeometry(const AffineTransform& pivot, float opacity, std::vector<std::vector<Vertex> >& vertices) const {
 	if (_removed) return;
 
+	if (_asset) {
+		generateAssetGeometry(pivot, opacity, vertices);
+		return;
+	}
+
+	glm::mat4 worldMat = pivot * _modelMat;
 	int offset = vertices.size();
 	vertices.resize(offset + _points.size());
 	for (int i = 0; i < _points.size(); ++i) {
 		if (_textureEnabled) {
-			glutils::drawPolygon(_points[i], glm::vec4(_color, opacity), _texCoords[i], _pivot * _modelMat, vertices[offset + i]);
+			glutils::drawPolygon(_points[i], glm::vec4(_color, opacity), _texCoords[i], worldMat, vertices[offset + i]);
 		} else {
-			glutils::drawPolygon(_points[i], glm::vec4(_color, opacity), _pivot * _modelMat, vertices[offset + i]);
+			glutils::drawPolygon(_points[i], glm::vec4(_color, opacity), worldMat, vertices[offset + i]);
 		}
 	}
 }
 
+void GeneralObject::generateAssetGeometry(const AffineTransform& pivot, float opacity, std::vector<std::vector<Vertex> >& vertices) const {
+	glm::mat4 mat = pivot * _modelMat;
+	glm::vec4 color(_color, opacity);
+
+	int offset = vertices.size();
+	vertices.resize(offset + _asset->numFaces());
+	std::vector<glm::vec3> points;
+	std::vector<glm::vec2> texCoords;
+	for (int i = 0; i < _asset->numFaces(); ++i) {
+		int begin = _asset->offsets[i];
+		int num = _asset->faceSize(i);
+
+		points.resize(num);
+		for (int k = 0; k < num; ++k) {
+			points[k] = (_asset->points[begin + k] - _asset->minPt) * _assetScale;
+		}
+
+		if (!_textureEnabled) {
+			glutils::drawPolygon(points, color, mat, vertices[offset + i]);
+		} else if (_generateTexCoords) {
+			texCoords.resize(num);
+			for (int k = 0; k < num; ++k) {
+				texCoords[k] = _texOrigin + glm::vec2(points[k]) * _texScale;
+			}
+			glutils::drawPolygon(points, color, texCoords, mat, vertices[offset + i]);
+		} else {
+			texCoords.assign(_asset->texCoords + begin, _asset->texCoords + begin + num);
+			glutils::drawPolygon(points, color, texCoords, mat, vertices[offset + i]);
+		}
+	}
 }
+
+}
\ No newline at end of file
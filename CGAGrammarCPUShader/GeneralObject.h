@@ -16,14 +16,27 @@ private:
 	std::vector<std::vector<glm::vec3> > _normals;
 	std::vector<std::vector<glm::vec2> > _texCoords;
 
+	// inserted asset, which is used instead of the points above
+	boost::shared_ptr<const Asset> _asset;
+	glm::vec3 _assetScale;
+	bool _generateTexCoords;
+	glm::vec2 _texOrigin;
+	glm::vec2 _texScale;
+
 public:
-	GeneralObject(const std::string& name, const glm::mat4& pivot, const glm::mat4& modelMat, const std::vector<glm::vec3>& points, const std::vector<glm::vec3>& normals, const glm::vec3& color);
-	GeneralObject(const std::string& name, const glm::mat4& pivot, const glm::mat4& modelMat, const std::vector<std::vector<glm::vec3> >& points, const std::vector<std::vector<glm::vec3> >& normals, const glm::vec3& color);
-	GeneralObject(const std::string& name, const glm::mat4& pivot, const glm::mat4& modelMat, const std::vector<glm::vec3>& points, const std::vector<glm::vec3>& normals, const glm::vec3& color, const std::vector<glm::vec2>& texCoords, const std::string& texture);
-	GeneralObject(const std::string& name, const glm::mat4& pivot, const glm::mat4& modelMat, const std::vector<std::vector<glm::vec3> >& points, const std::vector<std::vector<glm::vec3> >& normals, const glm::vec3& color, const std::vector<std::vector<glm::vec2> >& texCoords, const std::string& texture);
+	GeneralObject(const std::string& name, const AffineTransform& modelMat, const std::vector<glm::vec3>& points, const std::vector<glm::vec3>& normals, const glm::vec3& color);
+	GeneralObject(const std::string& name, const AffineTransform& modelMat, const std::vector<std::vector<glm::vec3> >& points, const std::vector<std::vector<glm::vec3> >& normals, const glm::vec3& color);
+	GeneralObject(const std::string& name, const AffineTransform& modelMat, const std::vector<glm::vec3>& points, const std::vector<glm::vec3>& normals, const glm::vec3& color, const std::vector<glm::vec2>& texCoords, const std::string& texture);
+	GeneralObject(const std::string& name, const AffineTransform& modelMat, const std::vector<std::vector<glm::vec3> >& points, const std::vector<std::vector<glm::vec3> >& normals, const glm::vec3& color, const std::vector<std::vector<glm::vec2> >& texCoords, const std::string& texture);
+	GeneralObject(const std::string& name, const AffineTransform& modelMat, const boost::shared_ptr<const Asset>& asset, const glm::vec3& scale, const glm::vec3& color);
+	GeneralObject(const std::string& name, const AffineTransform& modelMat, const boost::shared_ptr<const Asset>& asset, const glm::vec3& scale, const glm::vec3& color, const std::string& texture);
+	GeneralObject(const std::string& name, const AffineTransform& modelMat, const boost::shared_ptr<const Asset>& asset, const glm::vec3& scale, const glm::vec3& color, const std::string& texture, const glm::vec2& texOrigin, const glm::vec2& texScale);
 	boost::shared_ptr<Shape> clone(const std::string& name) const;
 	void size(float xSize, float ySize, float zSize);
-	void generateGeometry(float opacity, std::vector<std::vector<Vertex> >& vertices) const;
+	void generateGeometry(const AffineTransform& pivot, float opacity, std::vector<std::vector<Vertex> >& vertices) const;
+
+private:
+	void generateAssetGeometry(const AffineTransform& pivot, float opacity, std::vector<std::vector<Vertex> >& vertices) const;
 };
 
 }
@@ -33,10 +33,24 @@ public:
     QAction *actionHoge;
     QAction *actionGenerateBuildingImages;
     QAction *actionViewRefresh;
+    QAction *actionViewRandomize;
+    QAction *actionGenerateBuildingImagesMultiView;
+    QAction *actionDatasetFormatPNG;
+    QAction *actionDatasetFormatSharded;
+    QAction *actionDatasetFormatShardedPNG;
+    QAction *actionDatasetFormatNpy;
+    QAction *actionBenchmarkOBJLoader;
+    QAction *actionBenchmarkGrammarParser;
+    QAction *actionProfileDerivation;
+    QAction *actionLevelOfDetail;
+    QAction *actionBatchDerivation;
+    QAction *actionBenchmarkBatchDerivation;
+    QAction *actionCheckDerivations;
     QWidget *centralWidget;
     QMenuBar *menuBar;
     QMenu *menuFile;
     QMenu *menuTest;
+    QMenu *menuDatasetFormat;
     QMenu *menuView;
     QToolBar *mainToolBar;
     QStatusBar *statusBar;
@@ -58,6 +72,40 @@ public:
         actionGenerateBuildingImages->setObjectName(QString::fromUtf8("actionGenerateBuildingImages"));
         actionViewRefresh = new QAction(MainWindowClass);
         actionViewRefresh->setObjectName(QString::fromUtf8("actionViewRefresh"));
+        actionViewRandomize = new QAction(MainWindowClass);
+        actionViewRandomize->setObjectName(QString::fromUtf8("actionViewRandomize"));
+        actionGenerateBuildingImagesMultiView = new QAction(MainWindowClass);
+        actionGenerateBuildingImagesMultiView->setObjectName(QString::fromUtf8("actionGenerateBuildingImagesMultiView"));
+        actionDatasetFormatPNG = new QAction(MainWindowClass);
+        actionDatasetFormatPNG->setObjectName(QString::fromUtf8("actionDatasetFormatPNG"));
+        actionDatasetFormatPNG->setCheckable(true);
+        actionDatasetFormatPNG->setChecked(true);
+        actionDatasetFormatSharded = new QAction(MainWindowClass);
+        actionDatasetFormatSharded->setObjectName(QString::fromUtf8("actionDatasetFormatSharded"));
+        actionDatasetFormatSharded->setCheckable(true);
+        actionDatasetFormatShardedPNG = new QAction(MainWindowClass);
+        actionDatasetFormatShardedPNG->setObjectName(QString::fromUtf8("actionDatasetFormatShardedPNG"));
+        actionDatasetFormatShardedPNG->setCheckable(true);
+        actionDatasetFormatNpy = new QAction(MainWindowClass);
+        actionDatasetFormatNpy->setObjectName(QString::fromUtf8("actionDatasetFormatNpy"));
+        actionDatasetFormatNpy->setCheckable(true);
+        actionBenchmarkOBJLoader = new QAction(MainWindowClass);
+        actionBenchmarkOBJLoader->setObjectName(QString::fromUtf8("actionBenchmarkOBJLoader"));
+        actionBenchmarkGrammarParser = new QAction(MainWindowClass);
+        actionBenchmarkGrammarParser->setObjectName(QString::fromUtf8("actionBenchmarkGrammarParser"));
+        actionProfileDerivation = new QAction(MainWindowClass);
+        actionProfileDerivation->setObjectName(QString::fromUtf8("actionProfileDerivation"));
+        actionLevelOfDetail = new QAction(MainWindowClass);
+        actionLevelOfDetail->setObjectName(QString::fromUtf8("actionLevelOfDetail"));
+        actionLevelOfDetail->setCheckable(true);
+        actionBatchDerivation = new QAction(MainWindowClass);
+        actionBatchDerivation->setObjectName(QString::fromUtf8("actionBatchDerivation"));
+        actionBatchDerivation->setCheckable(true);
+        actionBatchDerivation->setChecked(true);
+        actionBenchmarkBatchDerivation = new QAction(MainWindowClass);
+        actionBenchmarkBatchDerivation->setObjectName(QString::fromUtf8("actionBenchmarkBatchDerivation"));
+        actionCheckDerivations = new QAction(MainWindowClass);
+        actionCheckDerivations->setObjectName(QString::fromUtf8("actionCheckDerivations"));
         centralWidget = new QWidget(MainWindowClass);
         centralWidget->setObjectName(QString::fromUtf8("centralWidget"));
         MainWindowClass->setCentralWidget(centralWidget);
@@ -68,6 +116,8 @@ public:
         menuFile->setObjectName(QString::fromUtf8("menuFile"));
         menuTest = new QMenu(menuBar);
         menuTest->setObjectName(QString::fromUtf8("menuTest"));
+        menuDatasetFormat = new QMenu(menuTest);
+        menuDatasetFormat->setObjectName(QString::fromUtf8("menuDatasetFormat"));
         menuView = new QMenu(menuBar);
         menuView->setObjectName(QString::fromUtf8("menuView"));
         MainWindowClass->setMenuBar(menuBar);
@@ -86,8 +136,22 @@ public:
         menuFile->addAction(actionExit);
         menuTest->addAction(actionGenerateImages);
         menuTest->addAction(actionGenerateBuildingImages);
+        menuTest->addAction(actionGenerateBuildingImagesMultiView);
+        menuTest->addAction(menuDatasetFormat->menuAction());
+        menuTest->addAction(actionLevelOfDetail);
+        menuTest->addAction(actionBatchDerivation);
+        menuTest->addAction(actionBenchmarkOBJLoader);
+        menuTest->addAction(actionBenchmarkGrammarParser);
+        menuTest->addAction(actionProfileDerivation);
+        menuTest->addAction(actionBenchmarkBatchDerivation);
+        menuTest->addAction(actionCheckDerivations);
         menuTest->addAction(actionHoge);
+        menuDatasetFormat->addAction(actionDatasetFormatPNG);
+        menuDatasetFormat->addAction(actionDatasetFormatSharded);
+        menuDatasetFormat->addAction(actionDatasetFormatShardedPNG);
+        menuDatasetFormat->addAction(actionDatasetFormatNpy);
         menuView->addAction(actionViewRefresh);
+        menuView->addAction(actionViewRandomize);
 
         retranslateUi(MainWindowClass);
 
@@ -105,8 +169,23 @@ public:
         actionGenerateBuildingImages->setText(QApplication::translate("MainWindowClass", "Generate Building Images", 0, QApplication::UnicodeUTF8));
         actionViewRefresh->setText(QApplication::translate("MainWindowClass", "Refresh", 0, QApplication::UnicodeUTF8));
         actionViewRefresh->setShortcut(QApplication::translate("MainWindowClass", "F5", 0, QApplication::UnicodeUTF8));
+        actionViewRandomize->setText(QApplication::translate("MainWindowClass", "Randomize Parameters", 0, QApplication::UnicodeUTF8));
+        actionViewRandomize->setShortcut(QApplication::translate("MainWindowClass", "Ctrl+R", 0, QApplication::UnicodeUTF8));
+        actionGenerateBuildingImagesMultiView->setText(QApplication::translate("MainWindowClass", "Generate Building Images (Multi-View)", 0, QApplication::UnicodeUTF8));
+        actionDatasetFormatPNG->setText(QApplication::translate("MainWindowClass", "PNG Files", 0, QApplication::UnicodeUTF8));
+        actionDatasetFormatSharded->setText(QApplication::translate("MainWindowClass", "Sharded Binary Files", 0, QApplication::UnicodeUTF8));
+        actionDatasetFormatShardedPNG->setText(QApplication::translate("MainWindowClass", "Sharded Binary Files (PNG)", 0, QApplication::UnicodeUTF8));
+        actionDatasetFormatNpy->setText(QApplication::translate("MainWindowClass", "NumPy Arrays", 0, QApplication::UnicodeUTF8));
+        actionBenchmarkOBJLoader->setText(QApplication::translate("MainWindowClass", "Benchmark OBJ Loader...", 0, QApplication::UnicodeUTF8));
+        actionBenchmarkGrammarParser->setText(QApplication::translate("MainWindowClass", "Benchmark Grammar Parser...", 0, QApplication::UnicodeUTF8));
+        actionProfileDerivation->setText(QApplication::translate("MainWindowClass", "Profile Derivation...", 0, QApplication::UnicodeUTF8));
+        actionLevelOfDetail->setText(QApplication::translate("MainWindowClass", "Level of Detail", 0, QApplication::UnicodeUTF8));
+        actionBatchDerivation->setText(QApplication::translate("MainWindowClass", "Batch Derivation", 0, QApplication::UnicodeUTF8));
+        actionBenchmarkBatchDerivation->setText(QApplication::translate("MainWindowClass", "Benchmark Batch Derivation...", 0, QApplication::UnicodeUTF8));
+        actionCheckDerivations->setText(QApplication::translate("MainWindowClass", "Check Derivations...", 0, QApplication::UnicodeUTF8));
         menuFile->setTitle(QApplication::translate("MainWindowClass", "File", 0, QApplication::UnicodeUTF8));
         menuTest->setTitle(QApplication::translate("MainWindowClass", "Test", 0, QApplication::UnicodeUTF8));
+        menuDatasetFormat->setTitle(QApplication::translate("MainWindowClass", "Dataset Format", 0, QApplication::UnicodeUTF8));
         menuView->setTitle(QApplication::translate("MainWindowClass", "View", 0, QApplication::UnicodeUTF8));
     } // retranslateUi
 
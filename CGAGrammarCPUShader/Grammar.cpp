@@ -2,7 +2,10 @@
 #include "CGA.h"
 #include "Shape.h"
 #include "NumberEval.h"
+#include "DerivationProfiler.h"
+#include "BatchDerivation.h"
 #include <sstream>
+#include <limits>
 #include <boost/algorithm/string/replace.hpp>
 
 namespace cga {
@@ -32,6 +35,19 @@ float Value::getEstimateValue(float size, const Grammar& grammar, const boost::s
 	}
 }
 
+/**
+ * Return the type in the grammar file, i.e., "absolute", "relative", or "floating".
+ */
+const char* Value::typeName() const {
+	if (type == Value::TYPE_ABSOLUTE) {
+		return "absolute";
+	} else if (type == Value::TYPE_RELATIVE) {
+		return "relative";
+	} else {
+		return "floating";
+	}
+}
+
 /**
  * このルールを指定されたshapeに適用する。
  * いくつかのオペレーション (compやsplitなど)は、適用後のshapeをstackに格納する。
@@ -42,7 +58,10 @@ float Value::getEstimateValue(float size, const Grammar& grammar, const boost::s
  */
 void Rule::apply(boost::shared_ptr<Shape>& shape, const Grammar& grammar, std::list<boost::shared_ptr<Shape> >& stack) const {
 	for (int i = 0; i < operators.size(); ++i) {
-		shape = operators[i]->apply(shape, grammar, stack);
+		{
+			CGA_PROFILE_OPERATOR(operators[i]->name, stack);
+			shape = operators[i]->apply(shape, grammar, stack);
+		}
 		if (shape == NULL) break;
 	}
 	
@@ -63,6 +82,29 @@ void Rule::apply(boost::shared_ptr<Shape>& shape, const Grammar& grammar, std::l
 	}
 }
 
+/**
+ * Apply this operator to the shapes of multiple samples of BatchDerivation.
+ * The operators that evaluate expressions can evaluate them for all the samples at once by the evaluator.
+ * By default, the operator is applied to each shape in the same way as apply().
+ *
+ * @param shapes	the shape of each sample, which is replaced with the result of the operator
+ * @param samples	the index of the sample of each shape
+ * @param stacks	the stack of each shape, to which the generated shapes are appended
+ * @param errors	[OUT] the error thrown for each shape, if any, in which case the shape is removed without generating shapes
+ */
+void Operator::applyBatch(std::vector<boost::shared_ptr<Shape> >& shapes, const std::vector<int>& samples, BatchEvaluator& evaluator, std::vector<std::list<boost::shared_ptr<Shape> > >& stacks, std::vector<std::exception_ptr>& errors) {
+	for (int i = 0; i < shapes.size(); ++i) {
+		try {
+			shapes[i] = apply(shapes[i], evaluator.grammar(samples[i]), stacks[i]);
+		} catch (...) {
+			// an error of one sample does not stop the others
+			shapes[i] = boost::shared_ptr<Shape>();
+			stacks[i].clear();
+			errors[i] = std::current_exception();
+		}
+	}
+}
+
 /**
  * 指定されたsizeをsplitした後の、各断片のサイズを計算する。
  *
@@ -74,6 +116,24 @@ void Rule::apply(boost::shared_ptr<Shape>& shape, const Grammar& grammar, std::l
  * @param decoded_output_names [OUT]	計算された、各断片の名前
  */
 void Rule::decodeSplitSizes(float size, const std::vector<Value>& sizes, const std::vector<std::string>& output_names, const Grammar& grammar, const boost::shared_ptr<Shape>& shape, std::vector<float>& decoded_sizes, std::vector<std::string>& decoded_output_names) {
+	// each size is evaluated only once
+	std::vector<float> values(sizes.size());
+	for (int i = 0; i < sizes.size(); ++i) {
+		values[i] = grammar.evalFloat(sizes[i].value, shape);
+	}
+
+	decodeSplitSizes(size, sizes, values, output_names, decoded_sizes, decoded_output_names);
+}
+
+/**
+ * Same as above, but the sizes have already been evaluated, such as by BatchEvaluator.
+ * A repeat size that is not a positive number generates one piece that fills the remaining size, and BudgetExceededError
+ * is thrown before the pieces are allocated if they exceed the shape budget of the current derivation.
+ *
+ * @param values	the value of each size expression
+ */
+void Rule::decodeSplitSizes(float size, const std::vector<Value>& sizes, std::vector<float> values, const std::vector<std::string>& output_names, std::vector<float>& decoded_sizes, std::vector<std::string>& decoded_output_names) {
+	// the relative sizes are converted to the absolute sizes here
 	float regular_sum = 0.0f;
 	float floating_sum = 0.0f;
 	int repeat_count = 0;
@@ -83,11 +143,12 @@ void Rule::decodeSplitSizes(float size, const std::vector<Value>& sizes, const s
 			repeat_count++;
 		} else {
 			if (sizes[i].type == Value::TYPE_ABSOLUTE) {
-				regular_sum += grammar.evalFloat(sizes[i].value, shape);
+				regular_sum += values[i];
 			} else if (sizes[i].type == Value::TYPE_RELATIVE) {
-				regular_sum += size * grammar.evalFloat(sizes[i].value, shape);
+				values[i] *= size;
+				regular_sum += values[i];
 			} else if (sizes[i].type == Value::TYPE_FLOATING) {
-				floating_sum += grammar.evalFloat(sizes[i].value, shape);
+				floating_sum += values[i];
 			}
 		}
 	}
@@ -96,29 +157,43 @@ void Rule::decodeSplitSizes(float size, const std::vector<Value>& sizes, const s
 	if (floating_sum > 0 && repeat_count == 0) {
 		floating_scale = std::max(0.0f, size - regular_sum) / floating_sum;
 	}
+	float remaining = size - regular_sum - floating_sum * floating_scale;
 
+	// the number of the pieces is computed first, so that the outputs are allocated only once
+	// a tiny repeat size would generate too many pieces, so they are checked against the budget before the allocation
+	// without the budget, the total still has to fit in int
+	const DerivationBudget* budget = DerivationBudget::current();
+	float max_count = budget != NULL && budget->max_shapes > 0 ? (float)budget->max_shapes : (float)(std::numeric_limits<int>::max() / 2);
+	std::vector<int> counts(sizes.size(), 1);
+	float total_count = 0;
 	for (int i = 0; i < sizes.size(); ++i) {
 		if (sizes[i].repeat) {
-			float s = sizes[i].getEstimateValue(size - regular_sum - floating_sum * floating_scale, grammar, shape);
-			int num = (size - regular_sum - floating_sum * floating_scale) / s + 0.5;
-			if (num <= 0) num = 1;
-			s = (size - regular_sum - floating_sum * floating_scale) / num;
-			for (int k = 0; k < num; ++k) {
-				decoded_sizes.push_back(s);
-				decoded_output_names.push_back(output_names[i]);
+			if (sizes[i].type == Value::TYPE_RELATIVE) {
+				values[i] *= remaining;
 			}
-		} else {
-			if (sizes[i].type == Value::TYPE_ABSOLUTE) {
-				decoded_sizes.push_back(grammar.evalFloat(sizes[i].value, shape));
-				decoded_output_names.push_back(output_names[i]);
-			} else if (sizes[i].type == Value::TYPE_RELATIVE) {
-				decoded_sizes.push_back(grammar.evalFloat(sizes[i].value, shape) * size);
-				decoded_output_names.push_back(output_names[i]);
-			} else if (sizes[i].type == Value::TYPE_FLOATING) {
-				decoded_sizes.push_back(grammar.evalFloat(sizes[i].value, shape) * floating_scale);
-				decoded_output_names.push_back(output_names[i]);
+
+			// the comparisons are false for NaN, so NaN generates one piece as well
+			float count = remaining > 0.0f && values[i] > 0.0f ? remaining / values[i] + 0.5f : 1.0f;
+			if (!(total_count + count <= max_count)) {
+				if (budget != NULL && budget->max_shapes > 0) {
+					throw BudgetExceededError(BudgetExceededError::BUDGET_SHAPES, budget->max_shapes, "", 0, 0);
+				} else {
+					throw std::string("Repeat split generates too many pieces: ") + sizes[i].value;
+				}
 			}
+			counts[i] = std::max(1, (int)count);
+			values[i] = remaining / counts[i];
+		} else if (sizes[i].type == Value::TYPE_FLOATING) {
+			values[i] *= floating_scale;
 		}
+		total_count += counts[i];
+	}
+
+	decoded_sizes.reserve(decoded_sizes.size() + total_count);
+	decoded_output_names.reserve(decoded_output_names.size() + total_count);
+	for (int i = 0; i < sizes.size(); ++i) {
+		decoded_sizes.insert(decoded_sizes.end(), counts[i], values[i]);
+		decoded_output_names.insert(decoded_output_names.end(), counts[i], output_names[i]);
 	}
 }
 
@@ -164,20 +239,24 @@ void Grammar::addOperator(const std::string& name, const boost::shared_ptr<Opera
  * @return				変換された数値
  */
 float Grammar::evalFloat(const std::string& attr_name, const boost::shared_ptr<Shape>& shape) const {
-	myeval::calculator<std::string::const_iterator> calc;
+	CGA_PROFILE_EVAL();
 
-	myeval::variables.clear();
-	myeval::variables.add("scope.sx", shape->_scope.x);
-	myeval::variables.add("scope.sy", shape->_scope.y);
-	myeval::variables.add("scope.sz", shape->_scope.z);
+	// the variables are local to this call so that multiple threads can evaluate expressions at the same time.
+	boost::spirit::qi::symbols<char, float> variables;
+	variables.add("scope.sx", shape->_scope.x);
+	variables.add("scope.sy", shape->_scope.y);
+	variables.add("scope.sz", shape->_scope.z);
 
 	for (auto it = attrs.begin(); it != attrs.end(); ++it) {
 		float val;
-		if (sscanf(it->second.value.c_str(), "%f", &val) != EOF) {
-			myeval::variables.add(it->first, val);
+		// the attributes that are not numbers, such as the texture paths, cannot be used in the expressions
+		if (sscanf(it->second.value.c_str(), "%f", &val) == 1) {
+			variables.add(it->first, val);
 		}
 	}
 
+	myeval::calculator<std::string::const_iterator> calc(variables);
+
 	float result;
 	std::string::const_iterator iter = attr_name.begin();
 	std::string::const_iterator end = attr_name.end();
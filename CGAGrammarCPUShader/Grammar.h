@@ -4,12 +4,15 @@
 #include <vector>
 #include <map>
 #include <list>
+#include <exception>
 #include <boost/shared_ptr.hpp>
 #include "Shape.h"
+#include "GrammarNode.h"
 
 namespace cga {
 
 class Grammar;
+class BatchEvaluator;
 
 class Attribute {
 public:
@@ -39,6 +42,7 @@ public:
 	Value(int type, const std::string& value, bool repeat = false) : type(type), value(value), repeat(repeat) {}
 	
 	float getEstimateValue(float size, const Grammar& grammar, const boost::shared_ptr<Shape>& shape) const;
+	const char* typeName() const;
 };
 
 class Operator {
@@ -49,6 +53,8 @@ public:
 	Operator() {}
 
 	virtual boost::shared_ptr<Shape> apply(boost::shared_ptr<Shape>& shape, const Grammar& grammar, std::list<boost::shared_ptr<Shape> >& stack) = 0;
+	virtual void applyBatch(std::vector<boost::shared_ptr<Shape> >& shapes, const std::vector<int>& samples, BatchEvaluator& evaluator, std::vector<std::list<boost::shared_ptr<Shape> > >& stacks, std::vector<std::exception_ptr>& errors);
+	virtual void toNode(GrammarNode& node) const = 0;
 };
 
 class Rule {
@@ -60,6 +66,7 @@ public:
 
 	void apply(boost::shared_ptr<Shape>& shape, const Grammar& grammar, std::list<boost::shared_ptr<Shape> >& stack) const;
 	static void decodeSplitSizes(float size, const std::vector<Value>& sizes, const std::vector<std::string>& output_names, const Grammar& grammar, const boost::shared_ptr<Shape>& shape, std::vector<float>& decoded_sizes, std::vector<std::string>& decoded_output_names);
+	static void decodeSplitSizes(float size, const std::vector<Value>& sizes, std::vector<float> values, const std::vector<std::string>& output_names, std::vector<float>& decoded_sizes, std::vector<std::string>& decoded_output_names);
 };
 
 class Grammar {
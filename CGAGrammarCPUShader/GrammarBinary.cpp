@@ -0,0 +1,295 @@
+#include "GrammarBinary.h"
+#include "GrammarParser.h"
+#include "TextGrammarParser.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QTemporaryFile>
+
+namespace cga {
+
+const char* GrammarBinaryWriter::MAGIC = "CGAGRAMR";
+
+/**
+ * Write the grammar to the binary file.
+ * It is written to a temporary file first and then renamed, so that other processes never read a partially written file.
+ *
+ * @param filename			the binary file
+ * @param grammar			the grammar
+ * @param source_filename	the XML file of the grammar, whose size and modification time are recorded for the validation
+ */
+bool GrammarBinaryWriter::write(const char* filename, const Grammar& grammar, const char* source_filename) {
+	string_ids.clear();
+	strings.clear();
+	body.clear();
+
+	for (auto it = grammar.attrs.begin(); it != grammar.attrs.end(); ++it) {
+		writeUInt(intern(it->first));
+		writeUInt(intern(it->second.value));
+		writeUInt(it->second.hasRange ? 1 : 0);
+		writeFloat(it->second.hasRange ? it->second.range_start : 0.0f);
+		writeFloat(it->second.hasRange ? it->second.range_end : 0.0f);
+	}
+
+	for (auto it = grammar.rules.begin(); it != grammar.rules.end(); ++it) {
+		writeUInt(intern(it->first));
+		writeUInt(it->second.operators.size());
+		for (int i = 0; i < it->second.operators.size(); ++i) {
+			GrammarNode node;
+			it->second.operators[i]->toNode(node);
+			writeNode(node);
+		}
+	}
+
+	GrammarFileHeader header;
+	memset(&header, 0, sizeof(GrammarFileHeader));
+	memcpy(header.magic, MAGIC, 8);
+	header.version = VERSION;
+	header.num_strings = strings.size();
+	header.num_attrs = grammar.attrs.size();
+	header.num_rules = grammar.rules.size();
+	if (source_filename != NULL) {
+		QFileInfo source_info(QString::fromUtf8(source_filename));
+		header.source_size = source_info.size();
+		header.source_mtime = source_info.lastModified().toMSecsSinceEpoch();
+	}
+
+	QString qfilename = QString::fromUtf8(filename);
+	QTemporaryFile file(qfilename + ".XXXXXX");
+	file.setAutoRemove(false);
+	if (!file.open()) return false;
+
+	file.write((const char*)&header, sizeof(GrammarFileHeader));
+	for (int i = 0; i < strings.size(); ++i) {
+		quint32 length = strings[i]->size();
+		file.write((const char*)&length, sizeof(quint32));
+		file.write(strings[i]->data(), length);
+	}
+	file.write(body);
+	file.close();
+
+	QFile::remove(qfilename);
+	if (!QFile::rename(file.fileName(), qfilename)) {
+		QFile::remove(file.fileName());
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Return the index of the string in the string table, and add it if it is new.
+ */
+quint32 GrammarBinaryWriter::intern(const std::string& str) {
+	auto it = string_ids.find(str);
+	if (it != string_ids.end()) return it->second;
+
+	quint32 id = strings.size();
+	it = string_ids.insert(std::make_pair(str, id)).first;
+	strings.push_back(&it->first);
+	return id;
+}
+
+void GrammarBinaryWriter::writeUInt(quint32 val) {
+	body.append((const char*)&val, sizeof(quint32));
+}
+
+void GrammarBinaryWriter::writeFloat(float val) {
+	body.append((const char*)&val, sizeof(float));
+}
+
+void GrammarBinaryWriter::writeNode(const GrammarNode& node) {
+	writeUInt(intern(node.tagName));
+	writeUInt(node.attributes.size());
+	for (int i = 0; i < node.attributes.size(); ++i) {
+		writeUInt(intern(node.attributes[i].first));
+		writeUInt(intern(node.attributes[i].second));
+	}
+	writeUInt(node.children.size());
+	for (int i = 0; i < node.children.size(); ++i) {
+		writeNode(node.children[i]);
+	}
+}
+
+void GrammarBinaryReader::read(const char* filename, Grammar& grammar) {
+	QFile file(QString::fromUtf8(filename));
+	if (!file.open(QIODevice::ReadOnly)) {
+		throw std::string("Binary grammar file cannot be read: ") + filename + ".";
+	}
+
+	const uchar* data = file.size() > 0 ? file.map(0, file.size()) : NULL;
+	if (data == NULL) {
+		throw std::string("Binary grammar file cannot be read: ") + filename + ".";
+	}
+
+	read(data, file.size(), grammar);
+}
+
+/**
+ * Restore the grammar from the binary data.
+ * The operators are created by the same functions as the XML parser, so they behave exactly the same.
+ */
+void GrammarBinaryReader::read(const uchar* data, qint64 size, Grammar& grammar) {
+	if (size < (qint64)sizeof(GrammarFileHeader)) {
+		throw "Binary grammar file is broken.";
+	}
+	const GrammarFileHeader* header = (const GrammarFileHeader*)data;
+	if (memcmp(header->magic, GrammarBinaryWriter::MAGIC, 8) != 0 || header->version != (quint32)GrammarBinaryWriter::VERSION) {
+		throw "Binary grammar file is not supported.";
+	}
+
+	p = data + sizeof(GrammarFileHeader);
+	end = data + size;
+
+	strings.resize(header->num_strings);
+	for (quint32 i = 0; i < header->num_strings; ++i) {
+		quint32 length = readUInt();
+		if (end - p < (qint64)length) {
+			throw "Binary grammar file is broken.";
+		}
+		strings[i].assign((const char*)p, length);
+		p += length;
+	}
+
+	for (quint32 i = 0; i < header->num_attrs; ++i) {
+		const std::string& name = readString();
+		const std::string& value = readString();
+		quint32 hasRange = readUInt();
+		float range_start = readFloat();
+		float range_end = readFloat();
+
+		if (hasRange) {
+			grammar.addAttr(name, Attribute(name, value, range_start, range_end));
+		} else {
+			grammar.addAttr(name, Attribute(name, value));
+		}
+	}
+
+	for (quint32 i = 0; i < header->num_rules; ++i) {
+		const std::string& name = readString();
+		grammar.addRule(name);
+
+		quint32 num_operators = readUInt();
+		for (quint32 k = 0; k < num_operators; ++k) {
+			GrammarNode node;
+			readNode(node);
+			boost::shared_ptr<Operator> op = parseOperator(node);
+			if (op) {
+				grammar.addOperator(name, op);
+			}
+		}
+	}
+}
+
+/**
+ * Check if the binary file is up to date with the XML file.
+ */
+bool GrammarBinaryReader::isValid(const char* filename, const char* source_filename) {
+	QFileInfo source_info(QString::fromUtf8(source_filename));
+	if (!source_info.exists()) return false;
+
+	QFile file(QString::fromUtf8(filename));
+	if (!file.open(QIODevice::ReadOnly)) return false;
+
+	GrammarFileHeader header;
+	if (file.read((char*)&header, sizeof(GrammarFileHeader)) != sizeof(GrammarFileHeader)) return false;
+
+	return memcmp(header.magic, GrammarBinaryWriter::MAGIC, 8) == 0 && header.version == (quint32)GrammarBinaryWriter::VERSION
+		&& header.source_size == source_info.size() && header.source_mtime == source_info.lastModified().toMSecsSinceEpoch();
+}
+
+quint32 GrammarBinaryReader::readUInt() {
+	if (end - p < (qint64)sizeof(quint32)) {
+		throw "Binary grammar file is broken.";
+	}
+	quint32 val;
+	memcpy(&val, p, sizeof(quint32));
+	p += sizeof(quint32);
+	return val;
+}
+
+float GrammarBinaryReader::readFloat() {
+	if (end - p < (qint64)sizeof(float)) {
+		throw "Binary grammar file is broken.";
+	}
+	float val;
+	memcpy(&val, p, sizeof(float));
+	p += sizeof(float);
+	return val;
+}
+
+const std::string& GrammarBinaryReader::readString() {
+	quint32 id = readUInt();
+	if (id >= strings.size()) {
+		throw "Binary grammar file is broken.";
+	}
+	return strings[id];
+}
+
+void GrammarBinaryReader::readNode(GrammarNode& node) {
+	node.tagName = readString();
+
+	quint32 num_attributes = readUInt();
+	node.attributes.resize(num_attributes);
+	for (quint32 i = 0; i < num_attributes; ++i) {
+		node.attributes[i].first = readString();
+		node.attributes[i].second = readString();
+	}
+
+	quint32 num_children = readUInt();
+	node.children.resize(num_children);
+	for (quint32 i = 0; i < num_children; ++i) {
+		readNode(node.children[i]);
+	}
+}
+
+/**
+ * Load the grammar.
+ * A binary grammar file is read directly. For a XML file or a CGA text file (.cga), its binary file in the cache directory is used if it is up to date.
+ * Otherwise, the source file is parsed and the binary file is written for the next time.
+ */
+void loadGrammar(const char* filename, Grammar& grammar) {
+	QFile file(QString::fromUtf8(filename));
+	char magic[8];
+	if (file.open(QIODevice::ReadOnly) && file.read(magic, 8) == 8 && memcmp(magic, GrammarBinaryWriter::MAGIC, 8) == 0) {
+		file.close();
+		GrammarBinaryReader reader;
+		reader.read(filename, grammar);
+		return;
+	}
+	file.close();
+
+	std::string binary_filename = binaryGrammarFileName(filename);
+	if (GrammarBinaryReader::isValid(binary_filename.c_str(), filename)) {
+		GrammarBinaryReader reader;
+		reader.read(binary_filename.c_str(), grammar);
+		return;
+	}
+
+	if (isTextGrammarFile(filename)) {
+		parseTextGrammar(filename, grammar);
+	} else {
+		parseGrammar(filename, grammar);
+	}
+
+	// the grammar can be used even if the file cannot be written
+	QDir().mkpath(QFileInfo(QString::fromUtf8(binary_filename.c_str())).absolutePath());
+	GrammarBinaryWriter writer;
+	writer.write(binary_filename.c_str(), grammar, filename);
+}
+
+/**
+ * Return the binary file of the grammar file in the cache directory under the temporary directory, so that the source tree is not changed.
+ * The name has the hash of the absolute path, so the grammar files of the same name in different directories do not share the binary file.
+ */
+std::string binaryGrammarFileName(const char* filename) {
+	QFileInfo info(QString::fromUtf8(filename));
+	QByteArray hash = QCryptographicHash::hash(info.absoluteFilePath().toUtf8(), QCryptographicHash::Md5).toHex();
+
+	QString name = info.fileName() + "." + QString::fromUtf8(hash.constData()) + ".bin";
+	return QDir::temp().filePath("cga_grammar_cache/" + name).toUtf8().constData();
+}
+
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <QByteArray>
+#include "Grammar.h"
+#include "GrammarNode.h"
+
+namespace cga {
+
+/**
+ * Layout of a binary grammar file (little endian), which is written to the cache directory (see binaryGrammarFileName()) for each XML file (or .cga file):
+ *
+ *   GrammarFileHeader
+ *   strings x num_strings           (each is quint32 length and the bytes)
+ *   attrs x num_attrs               (quint32 name, quint32 value, quint32 has_range, float range_start, float range_end)
+ *   rules x num_rules               (quint32 name, quint32 num_operators, and the operator nodes)
+ *
+ * A node is quint32 tag name, quint32 num_attributes, (quint32 name, quint32 value) x num_attributes, quint32 num_children, and the child nodes.
+ * All the names and the values are the indices to the string table, so each rule name and expression is stored only once.
+ * The file is valid as long as the size and the modification time of the XML file are the same as the ones in the header.
+ */
+struct GrammarFileHeader {
+	char magic[8];
+	quint32 version;
+	quint32 num_strings;
+	quint32 num_attrs;
+	quint32 num_rules;
+	quint64 source_size;
+	qint64 source_mtime;
+};
+
+/**
+ * Writer of the binary grammar file.
+ */
+class GrammarBinaryWriter {
+public:
+	static const char* MAGIC;
+	static const int VERSION = 1;
+
+private:
+	std::map<std::string, quint32> string_ids;
+	std::vector<const std::string*> strings;
+	QByteArray body;
+
+public:
+	GrammarBinaryWriter() {}
+
+	bool write(const char* filename, const Grammar& grammar, const char* source_filename = NULL);
+
+private:
+	quint32 intern(const std::string& str);
+	void writeUInt(quint32 val);
+	void writeFloat(float val);
+	void writeNode(const GrammarNode& node);
+};
+
+/**
+ * Reader of the binary grammar file.
+ * The file is memory-mapped, and the grammar is restored without parsing XML or evaluating anything.
+ */
+class GrammarBinaryReader {
+private:
+	const uchar* p;
+	const uchar* end;
+	std::vector<std::string> strings;
+
+public:
+	GrammarBinaryReader() {}
+
+	void read(const char* filename, Grammar& grammar);
+	void read(const uchar* data, qint64 size, Grammar& grammar);
+	static bool isValid(const char* filename, const char* source_filename);
+
+private:
+	quint32 readUInt();
+	float readFloat();
+	const std::string& readString();
+	void readNode(GrammarNode& node);
+};
+
+void loadGrammar(const char* filename, Grammar& grammar);
+std::string binaryGrammarFileName(const char* filename);
+
+}
@@ -0,0 +1,65 @@
+#include "GrammarNode.h"
+#include <sstream>
+#include <cstdlib>
+
+namespace cga {
+
+bool GrammarNode::hasAttribute(const std::string& name) const {
+	for (int i = 0; i < attributes.size(); ++i) {
+		if (attributes[i].first == name) return true;
+	}
+	return false;
+}
+
+/**
+ * Return the value of the attribute, or an empty string if the element does not have it.
+ */
+const std::string& GrammarNode::attribute(const std::string& name) const {
+	static const std::string empty;
+
+	for (int i = 0; i < attributes.size(); ++i) {
+		if (attributes[i].first == name) return attributes[i].second;
+	}
+	return empty;
+}
+
+/**
+ * Return the value of the attribute as a number, or 0 if the element does not have it.
+ */
+float GrammarNode::floatAttribute(const std::string& name) const {
+	return (float)atof(attribute(name).c_str());
+}
+
+void GrammarNode::setAttribute(const std::string& name, const std::string& value) {
+	for (int i = 0; i < attributes.size(); ++i) {
+		if (attributes[i].first == name) {
+			attributes[i].second = value;
+			return;
+		}
+	}
+	attributes.push_back(std::make_pair(name, value));
+}
+
+void GrammarNode::setAttribute(const std::string& name, float value) {
+	std::stringstream ss;
+	ss.precision(9);
+	ss << value;
+	setAttribute(name, ss.str());
+}
+
+GrammarNode& GrammarNode::addChild(const std::string& tagName) {
+	children.push_back(GrammarNode(tagName));
+	return children.back();
+}
+
+/**
+ * Add <param name="..." value="..."/>.
+ */
+GrammarNode& GrammarNode::addParam(const std::string& name, const std::string& value) {
+	GrammarNode& param = addChild("param");
+	param.setAttribute("name", name);
+	param.setAttribute("value", value);
+	return param;
+}
+
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+
+namespace cga {
+
+/**
+ * Element of the grammar, such as <extrude height="10"/> or <param name="front" value="Facade"/>.
+ * The operators are created from the elements, and they are written back to the elements,
+ * so the XML file and the binary grammar file share the same schema.
+ */
+class GrammarNode {
+public:
+	std::string tagName;
+	std::vector<std::pair<std::string, std::string> > attributes;
+	std::vector<GrammarNode> children;
+
+public:
+	GrammarNode() {}
+	GrammarNode(const std::string& tagName) : tagName(tagName) {}
+
+	bool hasAttribute(const std::string& name) const;
+	const std::string& attribute(const std::string& name) const;
+	float floatAttribute(const std::string& name) const;
+	void setAttribute(const std::string& name, const std::string& value);
+	void setAttribute(const std::string& name, float value);
+	GrammarNode& addChild(const std::string& tagName);
+	GrammarNode& addParam(const std::string& name, const std::string& value);
+};
+
+}
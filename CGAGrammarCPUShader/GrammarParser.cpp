@@ -21,120 +21,316 @@
 #include "CGA.h"
 #include <iostream>
 #include "Grammar.h"
-#include <QStringList>
+#include "GrammarBinary.h"
+#include <QFile>
+#include <QXmlStreamReader>
+#include <QDomDocument>
+#include <QDomNode>
+#include <QDirIterator>
+#include <QDir>
+#include <QElapsedTimer>
+#include <cstdio>
+#include <sstream>
 
 namespace cga {
 
+namespace {
+
+/**
+ * Copy the attributes of the current element.
+ */
+void readAttributes(QXmlStreamReader& xml, GrammarNode& node) {
+	QXmlStreamAttributes attributes = xml.attributes();
+	node.attributes.resize(attributes.size());
+	for (int i = 0; i < attributes.size(); ++i) {
+		node.attributes[i].first = attributes[i].name().toUtf8().constData();
+		node.attributes[i].second = attributes[i].value().toUtf8().constData();
+	}
+}
+
+/**
+ * Read the current element and its child elements, and move to the end of the element.
+ */
+void readElement(QXmlStreamReader& xml, GrammarNode& node) {
+	node.tagName = xml.name().toUtf8().constData();
+	readAttributes(xml, node);
+
+	while (xml.readNextStartElement()) {
+		node.children.push_back(GrammarNode());
+		readElement(xml, node.children.back());
+	}
+}
+
+/**
+ * Copy the XML element and its child elements.
+ */
+void toGrammarNode(const QDomElement& element, GrammarNode& node) {
+	node.tagName = element.tagName().toUtf8().constData();
+
+	QDomNamedNodeMap attributes = element.attributes();
+	for (int i = 0; i < attributes.count(); ++i) {
+		QDomAttr attr = attributes.item(i).toAttr();
+		node.attributes.push_back(std::make_pair(std::string(attr.name().toUtf8().constData()), std::string(attr.value().toUtf8().constData())));
+	}
+
+	QDomElement child = element.firstChildElement();
+	while (!child.isNull()) {
+		node.children.push_back(GrammarNode());
+		toGrammarNode(child, node.children.back());
+		child = child.nextSiblingElement();
+	}
+}
+
+}
+
+/**
+ * Parse the XML grammar file in one pass.
+ * Each operator is created as soon as its element is read, so only the element of the current operator is held in memory.
+ */
 void parseGrammar(const char* filename, Grammar& grammar) {
 	QFile file(filename);
+	if (!file.open(QIODevice::ReadOnly)) {
+		throw std::string("Grammar file cannot be read: ") + filename + ".";
+	}
+
+	QXmlStreamReader xml(&file);
+	if (xml.readNextStartElement()) {
+		while (xml.readNextStartElement()) {
+			if (xml.name() == QLatin1String("rule")) {
+				GrammarNode rule_node;
+				readAttributes(xml, rule_node);
+				if (!rule_node.hasAttribute("name")) {
+					throw "<rule> tag must contain name attribute.";
+				}
+				std::string name = rule_node.attribute("name");
+
+				grammar.addRule(name);
+
+				while (xml.readNextStartElement()) {
+					GrammarNode node;
+					readElement(xml, node);
+					boost::shared_ptr<Operator> op = parseOperator(node);
+					if (op) {
+						grammar.addOperator(name, op);
+					}
+				}
+			} else {
+				GrammarNode node;
+				readElement(xml, node);
+				parseGrammarNode(node, grammar);
+			}
+		}
+	}
+
+	if (xml.hasError()) {
+		std::stringstream ss;
+		ss << "XML error in " << filename << " at line " << xml.lineNumber() << ": " << xml.errorString().toUtf8().constData();
+		throw ss.str();
+	}
+}
+
+/**
+ * Parse the XML grammar file by building the DOM tree.
+ * This is the original parser, which is kept only to compare the parse time.
+ */
+void parseGrammarDOM(const char* filename, Grammar& grammar) {
+	QFile file(filename);
 
 	QDomDocument doc;
 	doc.setContent(&file, true);
 	QDomElement root = doc.documentElement();
 
-	QDomNode child_node = root.firstChild();
-	while (!child_node.isNull()) {
-		if (child_node.toElement().tagName() == "attr") {
-			if (!child_node.toElement().hasAttribute("name")) {
-				throw "<attr> tag must contain name attribute.";
-			}
-			std::string name = child_node.toElement().attribute("name").toUtf8().constData();
+	QDomElement child_element = root.firstChildElement();
+	while (!child_element.isNull()) {
+		GrammarNode node;
+		toGrammarNode(child_element, node);
+		parseGrammarNode(node, grammar);
 
-			if (!child_node.toElement().hasAttribute("value")) {
-				throw "<attr> tag must contain value attribute.";
-			}
-			std::string value = child_node.toElement().attribute("value").toUtf8().constData();
+		child_element = child_element.nextSiblingElement();
+	}
+}
 
-			std::vector<float> range;
-			if (child_node.toElement().hasAttribute("range")) {
-				QStringList value = child_node.toElement().attribute("range").split(",");
-				range.push_back(value[0].toFloat());
-				range.push_back(value[1].toFloat());
-			}
+/**
+ * Print the average parse time of the XML grammar files under the directory
+ * by the DOM parser, the streaming parser, and the binary grammar reader.
+ */
+void benchmarkGrammarParsers(const QString& dir, int num_repeats) {
+	std::vector<std::string> filenames;
+	QDirIterator it(dir, QStringList() << "*.xml", QDir::Files, QDirIterator::Subdirectories);
+	while (it.hasNext()) {
+		filenames.push_back(it.next().toUtf8().constData());
+	}
+	if (filenames.size() == 0) {
+		std::cout << "No grammar file is found in " << dir.toUtf8().constData() << std::endl;
+		return;
+	}
+
+	// the binary files are written to the temporary directory
+	std::vector<std::string> binary_filenames(filenames.size());
+	for (int i = 0; i < filenames.size(); ++i) {
+		binary_filenames[i] = QDir::temp().filePath(QString("cga_benchmark_%1.bin").arg(i)).toUtf8().constData();
+		try {
+			Grammar grammar;
+			parseGrammar(filenames[i].c_str(), grammar);
+			GrammarBinaryWriter writer;
+			writer.write(binary_filenames[i].c_str(), grammar);
+		} catch (...) {
+			binary_filenames[i].clear();
+		}
+	}
 
-			if (range.size() > 0) {
-				grammar.addAttr(name, Attribute(name, value, range[0], range[1]));
-			} else {
-				grammar.addAttr(name, Attribute(name, value));
-			}
-		} else if (child_node.toElement().tagName() == "rule") {
-			if (!child_node.toElement().hasAttribute("name")) {
-				throw "<rule> tag must contain name attribute.";
-			}
-			std::string name = child_node.toElement().attribute("name").toUtf8().constData();
-
-			grammar.addRule(name);
-
-			QDomNode operator_node = child_node.firstChild();
-			while (!operator_node.isNull()) {
-				std::string operator_name = operator_node.toElement().tagName().toUtf8().constData();
-
-				if (operator_name == "center") {
-					grammar.addOperator(name, parseCenterOperator(operator_node));
-				} else if (operator_name == "color") {
-					grammar.addOperator(name, parseColorOperator(operator_node));
-				} else if (operator_name == "comp") {
-					grammar.addOperator(name, parseCompOperator(operator_node));
-				} else if (operator_name == "copy") {
-					grammar.addOperator(name, parseCopyOperator(operator_node));
-				} else if (operator_name == "cornerCut") {
-					grammar.addOperator(name, parseCornerCutOperator(operator_node));
-				} else if (operator_name == "extrude") {
-					grammar.addOperator(name, parseExtrudeOperator(operator_node));
-				} else if (operator_name == "innerSemiCircle") {
-					grammar.addOperator(name, parseInnerSemiCircleOperator(operator_node));
-				} else if (operator_name == "insert") {
-					grammar.addOperator(name, parseInsertOperator(operator_node));
-				} else if (operator_name == "offset") {
-					grammar.addOperator(name, parseOffsetOperator(operator_node));
-				} else if (operator_name == "roofGable") {
-					grammar.addOperator(name, parseRoofGableOperator(operator_node));
-				} else if (operator_name == "roofHip") {
-					grammar.addOperator(name, parseRoofHipOperator(operator_node));
-				} else if (operator_name == "rotate") {
-					grammar.addOperator(name, parseRotateOperator(operator_node));
-				} else if (operator_name == "setupProjection") {
-					grammar.addOperator(name, parseSetupProjectionOperator(operator_node));
-				} else if (operator_name == "shapeL") {
-					grammar.addOperator(name, parseShapeLOperator(operator_node));
-				} else if (operator_name == "size") {
-					grammar.addOperator(name, parseSizeOperator(operator_node));
-				} else if (operator_name == "split") {
-					grammar.addOperator(name, parseSplitOperator(operator_node));
-				} else if (operator_name == "taper") {
-					grammar.addOperator(name, parseTaperOperator(operator_node));
-				} else if (operator_name == "texture") {
-					grammar.addOperator(name, parseTextureOperator(operator_node));
-				} else if (operator_name == "translate") {
-					grammar.addOperator(name, parseTranslateOperator(operator_node));
+	qint64 times[3] = { 0, 0, 0 };
+	int num_files = 0;
+	for (int i = 0; i < filenames.size(); ++i) {
+		if (binary_filenames[i].empty()) {
+			std::cout << "Skipped " << filenames[i] << std::endl;
+			continue;
+		}
+		num_files++;
+
+		QElapsedTimer timer;
+		for (int method = 0; method < 3; ++method) {
+			timer.start();
+			for (int k = 0; k < num_repeats; ++k) {
+				Grammar grammar;
+				if (method == 0) {
+					parseGrammarDOM(filenames[i].c_str(), grammar);
+				} else if (method == 1) {
+					parseGrammar(filenames[i].c_str(), grammar);
+				} else {
+					GrammarBinaryReader reader;
+					reader.read(binary_filenames[i].c_str(), grammar);
 				}
+			}
+			times[method] += timer.nsecsElapsed();
+		}
+	}
+
+	for (int i = 0; i < binary_filenames.size(); ++i) {
+		if (!binary_filenames[i].empty()) {
+			QFile::remove(QString::fromUtf8(binary_filenames[i].c_str()));
+		}
+	}
+
+	const char* names[3] = { "DOM", "streaming", "binary" };
+	std::cout << num_files << " grammar files, " << num_repeats << " runs" << std::endl;
+	for (int method = 0; method < 3; ++method) {
+		std::cout << "  " << names[method] << ": " << (double)times[method] / num_files / num_repeats / 1000.0 << " us/file" << std::endl;
+	}
+}
+
+/**
+ * Add <attr> or <rule> to the grammar. The other elements are ignored.
+ */
+void parseGrammarNode(const GrammarNode& node, Grammar& grammar) {
+	if (node.tagName == "attr") {
+		parseAttr(node, grammar);
+	} else if (node.tagName == "rule") {
+		if (!node.hasAttribute("name")) {
+			throw "<rule> tag must contain name attribute.";
+		}
+		std::string name = node.attribute("name");
 
-				operator_node = operator_node.nextSibling();
+		grammar.addRule(name);
+
+		for (int i = 0; i < node.children.size(); ++i) {
+			boost::shared_ptr<Operator> op = parseOperator(node.children[i]);
+			if (op) {
+				grammar.addOperator(name, op);
 			}
 		}
+	}
+}
+
+void parseAttr(const GrammarNode& node, Grammar& grammar) {
+	if (!node.hasAttribute("name")) {
+		throw "<attr> tag must contain name attribute.";
+	}
+	std::string name = node.attribute("name");
 
-		child_node = child_node.nextSibling();
+	if (!node.hasAttribute("value")) {
+		throw "<attr> tag must contain value attribute.";
+	}
+	std::string value = node.attribute("value");
+
+	float range_start;
+	float range_end;
+	if (node.hasAttribute("range") && sscanf(node.attribute("range").c_str(), "%f , %f", &range_start, &range_end) == 2) {
+		grammar.addAttr(name, Attribute(name, value, range_start, range_end));
+	} else {
+		grammar.addAttr(name, Attribute(name, value));
+	}
+}
+
+/**
+ * Create the operator of the element.
+ *
+ * @return	the operator, or NULL if the element is not an operator
+ */
+boost::shared_ptr<Operator> parseOperator(const GrammarNode& node) {
+	const std::string& operator_name = node.tagName;
+
+	if (operator_name == "center") {
+		return parseCenterOperator(node);
+	} else if (operator_name == "color") {
+		return parseColorOperator(node);
+	} else if (operator_name == "comp") {
+		return parseCompOperator(node);
+	} else if (operator_name == "copy") {
+		return parseCopyOperator(node);
+	} else if (operator_name == "cornerCut") {
+		return parseCornerCutOperator(node);
+	} else if (operator_name == "extrude") {
+		return parseExtrudeOperator(node);
+	} else if (operator_name == "innerSemiCircle") {
+		return parseInnerSemiCircleOperator(node);
+	} else if (operator_name == "insert") {
+		return parseInsertOperator(node);
+	} else if (operator_name == "offset") {
+		return parseOffsetOperator(node);
+	} else if (operator_name == "roofGable") {
+		return parseRoofGableOperator(node);
+	} else if (operator_name == "roofHip") {
+		return parseRoofHipOperator(node);
+	} else if (operator_name == "rotate") {
+		return parseRotateOperator(node);
+	} else if (operator_name == "setupProjection") {
+		return parseSetupProjectionOperator(node);
+	} else if (operator_name == "shapeL") {
+		return parseShapeLOperator(node);
+	} else if (operator_name == "size") {
+		return parseSizeOperator(node);
+	} else if (operator_name == "split") {
+		return parseSplitOperator(node);
+	} else if (operator_name == "taper") {
+		return parseTaperOperator(node);
+	} else if (operator_name == "texture") {
+		return parseTextureOperator(node);
+	} else if (operator_name == "translate") {
+		return parseTranslateOperator(node);
+	} else {
+		return boost::shared_ptr<Operator>();
 	}
 }
 
-boost::shared_ptr<Operator> parseCenterOperator(const QDomNode& node) {
+boost::shared_ptr<Operator> parseCenterOperator(const GrammarNode& node) {
 	int axesSelector;
 
-	if (!node.toElement().hasAttribute("axesSelector")) {
+	if (!node.hasAttribute("axesSelector")) {
 		throw "center node has to have axesSelector attribute.";
 	}
 
-	if (node.toElement().attribute("axesSelector") == "xyz") {
+	if (node.attribute("axesSelector") == "xyz") {
 		axesSelector = AXES_SELECTOR_XYZ;
-	} else if (node.toElement().attribute("axesSelector") == "x") {
+	} else if (node.attribute("axesSelector") == "x") {
 		axesSelector = AXES_SELECTOR_X;
-	} else if (node.toElement().attribute("axesSelector") == "y") {
+	} else if (node.attribute("axesSelector") == "y") {
 		axesSelector = AXES_SELECTOR_Y;
-	} else if (node.toElement().attribute("axesSelector") == "z") {
+	} else if (node.attribute("axesSelector") == "z") {
 		axesSelector = AXES_SELECTOR_Z;
-	} else if (node.toElement().attribute("axesSelector") == "xy") {
+	} else if (node.attribute("axesSelector") == "xy") {
 		axesSelector = AXES_SELECTOR_XY;
-	} else if (node.toElement().attribute("axesSelector") == "xz") {
+	} else if (node.attribute("axesSelector") == "xz") {
 		axesSelector = AXES_SELECTOR_XZ;
 	} else {
 		axesSelector = AXES_SELECTOR_YZ;
@@ -143,23 +339,23 @@ boost::shared_ptr<Operator> parseCenterOperator(const QDomNode& node) {
 	return boost::shared_ptr<Operator>(new CenterOperator(axesSelector));
 }
 
-boost::shared_ptr<Operator> parseColorOperator(const QDomNode& node) {
+boost::shared_ptr<Operator> parseColorOperator(const GrammarNode& node) {
 	std::string r;
 	std::string g;
 	std::string b;
 	std::string s;
 
-	if (node.toElement().hasAttribute("r")) {
-		r = node.toElement().attribute("r").toUtf8().constData();
+	if (node.hasAttribute("r")) {
+		r = node.attribute("r");
 	}
-	if (node.toElement().hasAttribute("g")) {
-		g = node.toElement().attribute("g").toUtf8().constData();
+	if (node.hasAttribute("g")) {
+		g = node.attribute("g");
 	}
-	if (node.toElement().hasAttribute("b")) {
-		b = node.toElement().attribute("b").toUtf8().constData();
+	if (node.hasAttribute("b")) {
+		b = node.attribute("b");
 	}
-	if (node.toElement().hasAttribute("s")) {
-		s = node.toElement().attribute("s").toUtf8().constData();
+	if (node.hasAttribute("s")) {
+		s = node.attribute("s");
 	}
 
 	if (s.empty()) {
@@ -169,7 +365,7 @@ boost::shared_ptr<Operator> parseColorOperator(const QDomNode& node) {
 	}
 }
 
-boost::shared_ptr<Operator> parseCompOperator(const QDomNode& node) {
+boost::shared_ptr<Operator> parseCompOperator(const GrammarNode& node) {
 	std::string front_name;
 	std::string side_name;
 	std::string top_name;
@@ -179,11 +375,11 @@ boost::shared_ptr<Operator> parseCompOperator(const QDomNode& node) {
 	std::string vertical_name;
 	std::map<std::string, std::string> name_map;
 
-	QDomNode child = node.firstChild();
-	while (!child.isNull()) {
-		if (child.toElement().tagName() == "param") {
-			QString name = child.toElement().attribute("name");
-			std::string value = child.toElement().attribute("value").toUtf8().constData();
+	for (int i = 0; i < node.children.size(); ++i) {
+		const GrammarNode& child = node.children[i];
+		if (child.tagName == "param") {
+			std::string name = child.attribute("name");
+			std::string value = child.attribute("value");
 
 			if (name == "front") {
 				name_map["front"] = value;
@@ -207,80 +403,78 @@ boost::shared_ptr<Operator> parseCompOperator(const QDomNode& node) {
 				name_map["vertical"] = value;
 			}
 		}
-
-		child = child.nextSibling();
 	}
 
 	return boost::shared_ptr<Operator>(new CompOperator(name_map));
 }
 
-boost::shared_ptr<Operator> parseCopyOperator(const QDomNode& node) {
-	if (!node.toElement().hasAttribute("name")) {
+boost::shared_ptr<Operator> parseCopyOperator(const GrammarNode& node) {
+	if (!node.hasAttribute("name")) {
 		throw "copy node has to have name attribute.";
 	}
 
-	std::string copy_name = node.toElement().attribute("name").toUtf8().constData();
+	std::string copy_name = node.attribute("name");
 
 	return boost::shared_ptr<Operator>(new CopyOperator(copy_name));
 }
 
-boost::shared_ptr<Operator> parseCornerCutOperator(const QDomNode& node) {
-	if (!node.toElement().hasAttribute("type")) {
+boost::shared_ptr<Operator> parseCornerCutOperator(const GrammarNode& node) {
+	if (!node.hasAttribute("type")) {
 		throw "curnerCut node has to have type attribute.";
 	}
 	int type;
-	if (node.toElement().attribute("type") == "straight") {
+	if (node.attribute("type") == "straight") {
 		type = CORNER_CUT_STRAIGHT;
-	} else if (node.toElement().attribute("type") == "curve") {
+	} else if (node.attribute("type") == "curve") {
 		type = CORNER_CUT_CURVE;
 	} else {
 		type = CORNER_CUT_NEGATIVE_CURVE;
 	}
 
-	if (!node.toElement().hasAttribute("length")) {
+	if (!node.hasAttribute("length")) {
 		throw "curnerCut node has to have length attribute.";
 	}
-	std::string length = node.toElement().attribute("length").toUtf8().constData();
+	std::string length = node.attribute("length");
 
 	return boost::shared_ptr<Operator>(new CornerCutOperator(type, length));
 }
 
-boost::shared_ptr<Operator> parseExtrudeOperator(const QDomNode& node) {
-	if (!node.toElement().hasAttribute("height")) {
+boost::shared_ptr<Operator> parseExtrudeOperator(const GrammarNode& node) {
+	if (!node.hasAttribute("height")) {
 		throw "extrude node has to have height attribute.";
 	}
 
-	std::string height = node.toElement().attribute("height").toUtf8().constData();
+	std::string height = node.attribute("height");
 
 	return boost::shared_ptr<Operator>(new ExtrudeOperator(height));
 }
 
-boost::shared_ptr<Operator> parseInnerSemiCircleOperator(const QDomNode& node) {
+boost::shared_ptr<Operator> parseInnerSemiCircleOperator(const GrammarNode& node) {
 	return boost::shared_ptr<Operator>(new InnerSemiCircleOperator());
 }
 
-boost::shared_ptr<Operator> parseInsertOperator(const QDomNode& node) {
-	if (!node.toElement().hasAttribute("geometryPath")) {
+boost::shared_ptr<Operator> parseInsertOperator(const GrammarNode& node) {
+	if (!node.hasAttribute("geometryPath")) {
 		throw "insert node has to have geometryPath attribute.";
 	}
 
-	std::string geometryPath = node.toElement().attribute("geometryPath").toUtf8().constData();
+	std::string geometryPath = node.attribute("geometryPath");
 
 	return boost::shared_ptr<Operator>(new InsertOperator(geometryPath));
 }
 
-boost::shared_ptr<Operator> parseOffsetOperator(const QDomNode& node) {
-	if (!node.toElement().hasAttribute("offsetDistance")) {
+boost::shared_ptr<Operator> parseOffsetOperator(const GrammarNode& node) {
+	if (!node.hasAttribute("offsetDistance")) {
 		throw "offset node has to have offsetDistance attribute.";
 	}
 
-	std::string offsetDistance = node.toElement().attribute("offsetDistance").toUtf8().constData();
+	std::string offsetDistance = node.attribute("offsetDistance");
 
 	int offsetSelector = SELECTOR_ALL;
-	if (node.toElement().hasAttribute("offsetSelector")) {
-		if (node.toElement().attribute("offsetSelector") == "all") {
+	if (node.hasAttribute("offsetSelector")) {
+		if (node.attribute("offsetSelector") == "all") {
 			offsetSelector = SELECTOR_ALL;
-		} else if (node.toElement().attribute("offsetSelector") == "inside") {
+		} else if (node.attribute("offsetSelector") == "inside") {
 			offsetSelector = SELECTOR_INSIDE;
 		} else {
 			offsetSelector = SELECTOR_BORDER;
@@ -290,58 +484,56 @@ boost::shared_ptr<Operator> parseOffsetOperator(const QDomNode& node) {
 	return boost::shared_ptr<Operator>(new OffsetOperator(offsetDistance, offsetSelector));
 }
 
-boost::shared_ptr<Operator> parseRoofGableOperator(const QDomNode& node) {
-	if (!node.toElement().hasAttribute("angle")) {
+boost::shared_ptr<Operator> parseRoofGableOperator(const GrammarNode& node) {
+	if (!node.hasAttribute("angle")) {
 		throw "roofGable node has to have angle attribute.";
 	}
 
-	std::string angle = node.toElement().attribute("angle").toUtf8().constData();
+	std::string angle = node.attribute("angle");
 
 	return boost::shared_ptr<Operator>(new RoofGableOperator(angle));
 }
 
-boost::shared_ptr<Operator> parseRoofHipOperator(const QDomNode& node) {
-	if (!node.toElement().hasAttribute("angle")) {
+boost::shared_ptr<Operator> parseRoofHipOperator(const GrammarNode& node) {
+	if (!node.hasAttribute("angle")) {
 		throw "roofHip node has to have angle attribute.";
 	}
 
-	std::string angle = node.toElement().attribute("angle").toUtf8().constData();
+	std::string angle = node.attribute("angle");
 
 	return boost::shared_ptr<Operator>(new RoofHipOperator(angle));
 }
 
-boost::shared_ptr<Operator> parseRotateOperator(const QDomNode& node) {
+boost::shared_ptr<Operator> parseRotateOperator(const GrammarNode& node) {
 	float xAngle = 0.0f;
 	float yAngle = 0.0f;
 	float zAngle = 0.0f;
 
-	QDomNode child = node.firstChild();
-	while (!child.isNull()) {
-		if (child.toElement().tagName() == "param") {
-			QString name = child.toElement().attribute("name");
+	for (int i = 0; i < node.children.size(); ++i) {
+		const GrammarNode& child = node.children[i];
+		if (child.tagName == "param") {
+			std::string name = child.attribute("name");
 
 			if (name == "xAngle") {
-				xAngle = child.toElement().attribute("value").toFloat();
+				xAngle = child.floatAttribute("value");
 			} else if (name == "yAngle") {
-				yAngle = child.toElement().attribute("value").toFloat();
+				yAngle = child.floatAttribute("value");
 			} else if (name == "zAngle") {
-				zAngle = child.toElement().attribute("value").toFloat();
+				zAngle = child.floatAttribute("value");
 			}
 		}
-
-		child = child.nextSibling();
 	}
 
 	return boost::shared_ptr<Operator>(new RotateOperator(xAngle, yAngle, zAngle));
 }
 
-boost::shared_ptr<Operator> parseSetupProjectionOperator(const QDomNode& node) {
-	if (!node.toElement().hasAttribute("axesSelector")) {
+boost::shared_ptr<Operator> parseSetupProjectionOperator(const GrammarNode& node) {
+	if (!node.hasAttribute("axesSelector")) {
 		throw "setupProjection node has to have axesSelector attribute.";
 	}
 
 	int axesSelector;
-	std::string sAxesSelector = node.toElement().attribute("axesSelector").toUtf8().constData();
+	std::string sAxesSelector = node.attribute("axesSelector");
 	if (sAxesSelector == "scope.xy") {
 		axesSelector = AXES_SCOPE_XY;
 	} else if (sAxesSelector == "scope.xz") {
@@ -353,14 +545,14 @@ boost::shared_ptr<Operator> parseSetupProjectionOperator(const QDomNode& node) {
 	Value texWidth;
 	Value texHeight;
 
-	QDomNode child = node.firstChild();
-	while (!child.isNull()) {
-		if (child.toElement().tagName() == "param") {
-			QString name = child.toElement().attribute("name");
+	for (int i = 0; i < node.children.size(); ++i) {
+		const GrammarNode& child = node.children[i];
+		if (child.tagName == "param") {
+			std::string name = child.attribute("name");
 
 			if (name == "texWidth") {
-				std::string type =  child.toElement().attribute("type").toUtf8().constData();
-				std::string value =  child.toElement().attribute("value").toUtf8().constData();
+				std::string type =  child.attribute("type");
+				std::string value =  child.attribute("value");
 				if (type == "absolute") {
 					texWidth = Value(Value::TYPE_ABSOLUTE, value);
 				} else if (type == "relative") {
@@ -369,8 +561,8 @@ boost::shared_ptr<Operator> parseSetupProjectionOperator(const QDomNode& node) {
 					throw "type of texWidth for texture has to be either absolute or relative.";
 				}
 			} else if (name == "texHeight") {
-				std::string type =  child.toElement().attribute("type").toUtf8().constData();
-				std::string value =  child.toElement().attribute("value").toUtf8().constData();
+				std::string type =  child.attribute("type");
+				std::string value =  child.attribute("value");
 				if (type == "absolute") {
 					texHeight = Value(Value::TYPE_ABSOLUTE, value);
 				} else if (type == "relative") {
@@ -380,52 +572,48 @@ boost::shared_ptr<Operator> parseSetupProjectionOperator(const QDomNode& node) {
 				}
 			}
 		}
-
-		child = child.nextSibling();
 	}
 
 	return boost::shared_ptr<Operator>(new SetupProjectionOperator(axesSelector, texWidth, texHeight));
 }
 
-boost::shared_ptr<Operator> parseShapeLOperator(const QDomNode& node) {
+boost::shared_ptr<Operator> parseShapeLOperator(const GrammarNode& node) {
 	float frontWidth;
 	float leftWidth;
 
-	QDomNode child = node.firstChild();
-	while (!child.isNull()) {
-		if (child.toElement().tagName() == "param") {
-			QString name = child.toElement().attribute("name");
+	for (int i = 0; i < node.children.size(); ++i) {
+		const GrammarNode& child = node.children[i];
+		if (child.tagName == "param") {
+			std::string name = child.attribute("name");
 
 			if (name == "frontWidth") {
-				frontWidth = child.toElement().attribute("value").toFloat();
+				frontWidth = child.floatAttribute("value");
 			} else if (name == "leftWidth") {
-				leftWidth = child.toElement().attribute("value").toFloat();
+				leftWidth = child.floatAttribute("value");
 			}
 		}
-
-		child = child.nextSibling();
 	}
 
 	return boost::shared_ptr<Operator>(new ShapeLOperator(frontWidth, leftWidth));
 }
 
-boost::shared_ptr<Operator> parseSizeOperator(const QDomNode& node) {
+boost::shared_ptr<Operator> parseSizeOperator(const GrammarNode& node) {
 	Value xSize;
 	Value ySize;
 	Value zSize;
 
-	QDomNode child = node.firstChild();
-	while (!child.isNull()) {
-		if (child.toElement().tagName() == "param") {
-			QString name = child.toElement().attribute("name");
-			QString type;
+	for (int i = 0; i < node.children.size(); ++i) {
+		const GrammarNode& child = node.children[i];
+		if (child.tagName == "param") {
+			std::string name = child.attribute("name");
+			std::string type;
 
-			if (!child.toElement().hasAttribute("type")) {
+			if (!child.hasAttribute("type")) {
 				throw "param node under size node has to have type attribute.";
 			}
 
-			type = child.toElement().attribute("type");
-			std::string value = child.toElement().attribute("value").toUtf8().constData();
+			type = child.attribute("type");
+			std::string value = child.attribute("value");
 
 			if (name == "xSize") {
 				if (type == "relative") {
@@ -453,36 +641,34 @@ boost::shared_ptr<Operator> parseSizeOperator(const QDomNode& node) {
 				}
 			}
 		}
-
-		child = child.nextSibling();
 	}
 
 	return boost::shared_ptr<Operator>(new SizeOperator(xSize, ySize, zSize));
 }
 
-boost::shared_ptr<Operator> parseSplitOperator(const QDomNode& node) {
+boost::shared_ptr<Operator> parseSplitOperator(const GrammarNode& node) {
 	int splitAxis;
 	std::vector<Value> sizes;
 	std::vector<std::string> names;
 
-	if (!node.toElement().hasAttribute("splitAxis")) {
+	if (!node.hasAttribute("splitAxis")) {
 		throw "split node has to have splitAxis attribute.";
 	}
-	if (node.toElement().attribute("splitAxis") == "x") {
+	if (node.attribute("splitAxis") == "x") {
 		splitAxis = DIRECTION_X;
-	} else if (node.toElement().attribute("splitAxis") == "y") {
+	} else if (node.attribute("splitAxis") == "y") {
 		splitAxis = DIRECTION_Y;
 	} else {
 		splitAxis = DIRECTION_Z;
 	}
 
-	QDomNode child = node.firstChild();
-	while (!child.isNull()) {
-		if (child.toElement().tagName() == "param") {
-			QString type = child.toElement().attribute("type");
-			std::string value = child.toElement().attribute("value").toUtf8().constData();
+	for (int i = 0; i < node.children.size(); ++i) {
+		const GrammarNode& child = node.children[i];
+		if (child.tagName == "param") {
+			std::string type = child.attribute("type");
+			std::string value = child.attribute("value");
 			bool repeat = false;
-			if (child.toElement().hasAttribute("repeat")) {
+			if (child.hasAttribute("repeat")) {
 				repeat = true;
 			}
 
@@ -504,25 +690,23 @@ boost::shared_ptr<Operator> parseSplitOperator(const QDomNode& node) {
 				}
 			}
 
-			names.push_back(child.toElement().attribute("name").toUtf8().constData());
+			names.push_back(child.attribute("name"));
 		}
-
-		child = child.nextSibling();
 	}
 
 	return boost::shared_ptr<Operator>(new SplitOperator(splitAxis, sizes, names));
 }
 
-boost::shared_ptr<Operator> parseTaperOperator(const QDomNode& node) {
-	if (!node.toElement().hasAttribute("height")) {
+boost::shared_ptr<Operator> parseTaperOperator(const GrammarNode& node) {
+	if (!node.hasAttribute("height")) {
 		throw "taper node has to have height attribute.";
 	}
 
-	std::string height = node.toElement().attribute("height").toUtf8().constData();
+	std::string height = node.attribute("height");
 
 	std::string top_ratio;
-	if (node.toElement().hasAttribute("top_ratio")) {
-		top_ratio = node.toElement().attribute("top_ratio").toUtf8().constData();
+	if (node.hasAttribute("top_ratio")) {
+		top_ratio = node.attribute("top_ratio");
 
 	} else {
 		top_ratio = "0.0";
@@ -531,60 +715,60 @@ boost::shared_ptr<Operator> parseTaperOperator(const QDomNode& node) {
 	return boost::shared_ptr<Operator>(new TaperOperator(height, top_ratio));
 }
 
-boost::shared_ptr<Operator> parseTextureOperator(const QDomNode& node) {
-	if (!node.toElement().hasAttribute("texturePath")) {
+boost::shared_ptr<Operator> parseTextureOperator(const GrammarNode& node) {
+	if (!node.hasAttribute("texturePath")) {
 		throw "texture node has to have texturePathtexturePath attribute.";
 	}
 
-	std::string texture = node.toElement().attribute("texturePath").toUtf8().constData();
+	std::string texture = node.attribute("texturePath");
 
 	return boost::shared_ptr<Operator>(new TextureOperator(texture));
 }
 
-boost::shared_ptr<Operator> parseTranslateOperator(const QDomNode& node) {
+boost::shared_ptr<Operator> parseTranslateOperator(const GrammarNode& node) {
 	int mode;
 	int coordSystem;
 	Value x;
 	Value y;
 	Value z;
 
-	if (!node.toElement().hasAttribute("mode")) {
+	if (!node.hasAttribute("mode")) {
 		throw "translate node has to have mode attribute.";
 	}
-	if (node.toElement().attribute("mode") == "abs") {
+	if (node.attribute("mode") == "abs") {
 		mode = MODE_ABSOLUTE;
-	} else if (node.toElement().attribute("mode") == "rel") {
+	} else if (node.attribute("mode") == "rel") {
 		mode = MODE_RELATIVE;
 	} else {
 		throw "mode has to be either abs or rel.";
 	}
 
-	if (!node.toElement().hasAttribute("coordSystem")) {
+	if (!node.hasAttribute("coordSystem")) {
 		throw "translate node has to have coordSystem attribute.";
 	}
-	if (node.toElement().attribute("coordSystem") == "world") {
+	if (node.attribute("coordSystem") == "world") {
 		coordSystem = COORD_SYSTEM_WORLD;
-	} else if (node.toElement().attribute("coordSystem") == "object") {
+	} else if (node.attribute("coordSystem") == "object") {
 		coordSystem = COORD_SYSTEM_OBJECT;
 	} else {
 		throw "coordSystem has to be either world or object.";
 	}
 
-	QDomNode child = node.firstChild();
-	while (!child.isNull()) {
-		if (child.toElement().tagName() == "param") {
-			if (!child.toElement().hasAttribute("name")) {
+	for (int i = 0; i < node.children.size(); ++i) {
+		const GrammarNode& child = node.children[i];
+		if (child.tagName == "param") {
+			if (!child.hasAttribute("name")) {
 				throw "param has to have name attribute.";
 			}
-			std::string name = child.toElement().attribute("name").toUtf8().constData();
-			if (!child.toElement().hasAttribute("value")) {
+			std::string name = child.attribute("name");
+			if (!child.hasAttribute("value")) {
 				throw "param has to have value attribute.";
 			}
-			std::string value = child.toElement().attribute("value").toUtf8().constData();
-			if (!child.toElement().hasAttribute("type")) {
+			std::string value = child.attribute("value");
+			if (!child.hasAttribute("type")) {
 				throw "param has to have type attribute.";
 			}
-			std::string type = child.toElement().attribute("type").toUtf8().constData();
+			std::string type = child.attribute("type");
 
 			if (name == "x") {
 				if (type == "absolute") {
@@ -612,8 +796,6 @@ boost::shared_ptr<Operator> parseTranslateOperator(const QDomNode& node) {
 				}
 			}
 		}
-
-		child = child.nextSibling();
 	}
 
 	return boost::shared_ptr<Operator>(new TranslateOperator(mode, coordSystem, x, y, z));
@@ -2,31 +2,35 @@
 
 #include <map>
 #include "Grammar.h"
-#include <QFile>
-#include <QDomDocument>
-#include <QDomNode>
+#include "GrammarNode.h"
+#include <QString>
 
 namespace cga {
 
 void parseGrammar(const char* filename, Grammar& grammar);
-boost::shared_ptr<Operator> parseCenterOperator(const QDomNode& node);
-boost::shared_ptr<Operator> parseColorOperator(const QDomNode& node);
-boost::shared_ptr<Operator> parseCompOperator(const QDomNode& node);
-boost::shared_ptr<Operator> parseCopyOperator(const QDomNode& node);
-boost::shared_ptr<Operator> parseCornerCutOperator(const QDomNode& node);
-boost::shared_ptr<Operator> parseExtrudeOperator(const QDomNode& node);
-boost::shared_ptr<Operator> parseInnerSemiCircleOperator(const QDomNode& node);
-boost::shared_ptr<Operator> parseInsertOperator(const QDomNode& node);
-boost::shared_ptr<Operator> parseOffsetOperator(const QDomNode& node);
-boost::shared_ptr<Operator> parseRoofGableOperator(const QDomNode& node);
-boost::shared_ptr<Operator> parseRoofHipOperator(const QDomNode& node);
-boost::shared_ptr<Operator> parseRotateOperator(const QDomNode& node);
-boost::shared_ptr<Operator> parseSetupProjectionOperator(const QDomNode& node);
-boost::shared_ptr<Operator> parseShapeLOperator(const QDomNode& node);
-boost::shared_ptr<Operator> parseSizeOperator(const QDomNode& node);
-boost::shared_ptr<Operator> parseSplitOperator(const QDomNode& node);
-boost::shared_ptr<Operator> parseTaperOperator(const QDomNode& node);
-boost::shared_ptr<Operator> parseTextureOperator(const QDomNode& node);
-boost::shared_ptr<Operator> parseTranslateOperator(const QDomNode& node);
+void parseGrammarDOM(const char* filename, Grammar& grammar);
+void benchmarkGrammarParsers(const QString& dir, int num_repeats);
+void parseGrammarNode(const GrammarNode& node, Grammar& grammar);
+void parseAttr(const GrammarNode& node, Grammar& grammar);
+boost::shared_ptr<Operator> parseOperator(const GrammarNode& node);
+boost::shared_ptr<Operator> parseCenterOperator(const GrammarNode& node);
+boost::shared_ptr<Operator> parseColorOperator(const GrammarNode& node);
+boost::shared_ptr<Operator> parseCompOperator(const GrammarNode& node);
+boost::shared_ptr<Operator> parseCopyOperator(const GrammarNode& node);
+boost::shared_ptr<Operator> parseCornerCutOperator(const GrammarNode& node);
+boost::shared_ptr<Operator> parseExtrudeOperator(const GrammarNode& node);
+boost::shared_ptr<Operator> parseInnerSemiCircleOperator(const GrammarNode& node);
+boost::shared_ptr<Operator> parseInsertOperator(const GrammarNode& node);
+boost::shared_ptr<Operator> parseOffsetOperator(const GrammarNode& node);
+boost::shared_ptr<Operator> parseRoofGableOperator(const GrammarNode& node);
+boost::shared_ptr<Operator> parseRoofHipOperator(const GrammarNode& node);
+boost::shared_ptr<Operator> parseRotateOperator(const GrammarNode& node);
+boost::shared_ptr<Operator> parseSetupProjectionOperator(const GrammarNode& node);
+boost::shared_ptr<Operator> parseShapeLOperator(const GrammarNode& node);
+boost::shared_ptr<Operator> parseSizeOperator(const GrammarNode& node);
+boost::shared_ptr<Operator> parseSplitOperator(const GrammarNode& node);
+boost::shared_ptr<Operator> parseTaperOperator(const GrammarNode& node);
+boost::shared_ptr<Operator> parseTextureOperator(const GrammarNode& node);
+boost::shared_ptr<Operator> parseTranslateOperator(const GrammarNode& node);
 
 }
\ No newline at end of file
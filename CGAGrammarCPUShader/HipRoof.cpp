@@ -13,10 +13,9 @@ typedef boost::shared_ptr<Ss> SsPtr ;
 
 namespace cga {
 
-HipRoof::HipRoof(const std::string& name, const glm::mat4& pivot, const glm::mat4& modelMat, const std::vector<glm::vec2>& points, float angle, const glm::vec3& color) {
+HipRoof::HipRoof(const std::string& name, const AffineTransform& modelMat, const std::vector<glm::vec2>& points, float angle, const glm::vec3& color) {
 	this->_name = name;
 	this->_removed = false;
-	this->_pivot = pivot;
 	this->_modelMat = modelMat;
 	this->_points = points;
 	this->_angle = angle;
@@ -29,7 +28,9 @@ boost::shared_ptr<Shape> HipRoof::clone(const std::string& name) const {
 	return copy;
 }
 
-void HipRoof::generateGeometry(float opacity, std::vector<std::vector<Vertex> >& vertices) const {
+void HipRoof::generateGeometry(const AffineTransform& pivot, float opacity, std::vector<std::vector<Vertex> >& vertices) const {
+	AffineTransform worldMat = pivot * _modelMat;
+
 	Polygon_2 poly;
 	for (int i = 0; i < _points.size(); ++i) {
 		poly.push_back(KPoint(_points[i].x, _points[i].y));
@@ -65,8 +66,8 @@ void HipRoof::generateGeometry(float opacity, std::vector<std::vector<Vertex> >&
 				p1 = glm::vec2(head->point().x(), head->point().y());
 				first = false;
 
-				points.push_back(glm::vec3(_pivot * _modelMat * glm::vec4(p0, 0, 1)));
-				points.push_back(glm::vec3(_pivot * _modelMat * glm::vec4(p1, 0, 1)));
+				points.push_back(glm::vec3(worldMat * glm::vec4(p0, 0, 1)));
+				points.push_back(glm::vec3(worldMat * glm::vec4(p1, 0, 1)));
 			} else {
 				glm::vec2 p2 = glm::vec2(head->point().x(), head->point().y());
 
@@ -74,7 +75,7 @@ void HipRoof::generateGeometry(float opacity, std::vector<std::vector<Vertex> >&
 					// p2の高さを計算
 					float z = glutils::distance(p0, p1, p2) * tanf(_angle * M_PI / 180.0f);
 
-					points.push_back(glm::vec3(_pivot * _modelMat * glm::vec4(head->point().x(), head->point().y(), z, 1)));
+					points.push_back(glm::vec3(worldMat * glm::vec4(head->point().x(), head->point().y(), z, 1)));
 				}
 			}
 		} while ((edge = edge->next()) != edge0);
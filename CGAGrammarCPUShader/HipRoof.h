@@ -16,9 +16,9 @@ private:
 	float _angle;
 
 public:
-	HipRoof(const std::string& name, const glm::mat4& pivot, const glm::mat4& modelMat, const std::vector<glm::vec2>& points, float angle, const glm::vec3& color);
+	HipRoof(const std::string& name, const AffineTransform& modelMat, const std::vector<glm::vec2>& points, float angle, const glm::vec3& color);
 	boost::shared_ptr<Shape> clone(const std::string& name) const;
-	void generateGeometry(float opacity, std::vector<std::vector<Vertex> >& vertices) const;
+	void generateGeometry(const AffineTransform& pivot, float opacity, std::vector<std::vector<Vertex> >& vertices) const;
 };
 
 }
@@ -0,0 +1,464 @@
+#include "ImagePipeline.h"
+#include "GLWidget3D.h"
+#include "FrameBuffer.h"
+#include "Rectangle.h"
+#include "CGA.h"
+#include <iostream>
+#include <algorithm>
+#include <map>
+
+namespace {
+
+/**
+ * Wait a moment before retrying a queue operation.
+ * It yields for the first few retries, and then sleeps so that idle workers do not eat the CPU of the busy ones.
+ */
+void backoff(int& num_retries) {
+	if (num_retries++ < 64) {
+		boost::this_thread::yield();
+	} else {
+		boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+	}
+}
+
+}
+
+/**
+ * @param index			the index of the sample
+ * @param seed			the seed of the strokes, which is usually the index of the first image of the sample
+ */
+ImageSample::ImageSample(int index, int seed, const cga::Grammar& grammar, float object_width, float object_height) {
+	this->index = index;
+	this->image_index = -1;
+	this->seed = seed;
+	this->grammar = grammar;
+	this->object_width = object_width;
+	this->object_height = object_height;
+	this->skipped = false;
+}
+
+SampleQueue::SampleQueue(int capacity, int num_producers) : queue(capacity), num_producers(num_producers) {
+}
+
+/**
+ * Add a sample to the queue.
+ * If the queue is full, it blocks until the consumer takes a sample.
+ */
+void SampleQueue::push(ImageSample* sample) {
+	int num_retries = 0;
+	while (!queue.bounded_push(sample)) {
+		backoff(num_retries);
+	}
+}
+
+/**
+ * Take a sample from the queue.
+ * If the queue is empty, it blocks until a producer adds a sample.
+ *
+ * @param sample	[OUT] the sample
+ * @return			false if all the producers are closed and the queue is drained
+ */
+bool SampleQueue::pop(ImageSample*& sample) {
+	int num_retries = 0;
+	while (true) {
+		// check this before pop() so that a sample pushed right before the last close() is not missed.
+		bool closed = num_producers.load() == 0;
+		if (queue.pop(sample)) return true;
+		if (closed) return false;
+
+		backoff(num_retries);
+	}
+}
+
+/**
+ * Notify that one of the producers has finished.
+ */
+void SampleQueue::close() {
+	num_producers--;
+}
+
+StageStats::StageStats(const std::string& name, int num_workers) {
+	this->name = name;
+	this->num_workers = num_workers;
+	this->num_samples = 0;
+	this->busy_nsec = 0;
+}
+
+void StageStats::add(int num_samples, qint64 busy_nsec) {
+	boost::mutex::scoped_lock lock(mutex);
+	this->num_samples += num_samples;
+	this->busy_nsec += busy_nsec;
+}
+
+/**
+ * Print the throughput of this stage.
+ *
+ * @param elapsed_nsec	the wall time of the whole pipeline
+ */
+void StageStats::report(qint64 elapsed_nsec) const {
+	double busy_sec = busy_nsec * 1e-9;
+	double throughput = busy_sec > 0 ? num_samples * num_workers / busy_sec : 0;
+	double utilization = elapsed_nsec > 0 ? (double)busy_nsec / elapsed_nsec / num_workers * 100.0 : 0;
+
+	std::cout << "  " << name << ": " << num_workers << " workers, " << num_samples << " samples, busy " << busy_sec << " sec, "
+		<< throughput << " samples/sec, utilization " << utilization << "%" << std::endl;
+}
+
+/**
+ * @param output_format	the format of the dataset (DatasetWriter::FORMAT_PNG, FORMAT_SHARDED, FORMAT_SHARDED_PNG, or FORMAT_NPY)
+ */
+ImagePipeline::ImagePipeline(const QString& output_dir, int image_width, int image_height, bool invertImage, bool blur, int output_format) :
+	output_dir(output_dir), image_width(image_width), image_height(image_height), invertImage(invertImage), blur(blur),
+	num_derive_workers(std::max(1, (int)boost::thread::hardware_concurrency())),
+	num_raster_workers(std::max(1, (int)boost::thread::hardware_concurrency() / 2)),
+	num_encode_workers(std::max(1, (int)boost::thread::hardware_concurrency() / 2)),
+	derive_queue(num_derive_workers * 2, 1),
+	raster_queue(num_raster_workers * 2, num_derive_workers),
+	encode_queue(num_encode_workers * 2, num_raster_workers),
+	write_queue(num_encode_workers * 2, num_encode_workers),
+	derive_stats("derive", num_derive_workers),
+	raster_stats("raster", num_raster_workers),
+	encode_stats("encode", num_encode_workers),
+	write_stats("write", 1),
+	writer(DatasetWriter::create(output_format)),
+	num_images(0),
+	budget(1000000, 1000, 1000000, 10000),
+	lod_min_pixels(0.0f),
+	batch_size(1),
+	num_skipped(0) {
+}
+
+/**
+ * Set the budget of each derivation.
+ * The default is 1,000,000 shapes, 1,000 rules deep, 1,000,000 terminal polygons, and 10 seconds.
+ */
+void ImagePipeline::setBudget(const cga::DerivationBudget& budget) {
+	this->budget = budget;
+}
+
+/**
+ * Stop deriving the shapes that are smaller than min_pixels in all the views of the sample.
+ * The default is 0, which derives all the shapes. The identical subtrees are not shared when this is enabled,
+ * because whether a shape is derived depends on its position.
+ */
+void ImagePipeline::setLevelOfDetail(float min_pixels) {
+	this->lod_min_pixels = min_pixels;
+}
+
+/**
+ * Set the number of the samples that each derive worker derives at once by CGA::deriveBatch().
+ * The default is 1, which derives each sample by itself. The identical subtrees are not shared within a batch,
+ * so this is faster than the serial derivation without the level of detail only when the samples have few repeated tiles.
+ */
+void ImagePipeline::setBatchSize(int batch_size) {
+	this->batch_size = std::max(1, batch_size);
+}
+
+/**
+ * Open the dataset and start all the workers.
+ *
+ * @return		false if the dataset cannot be opened
+ */
+bool ImagePipeline::start() {
+	if (!writer->open(output_dir, image_width, image_height)) return false;
+
+	timer.start();
+
+	for (int i = 0; i < num_derive_workers; ++i) {
+		threads.create_thread(boost::bind(&ImagePipeline::deriveWorker, this));
+	}
+	for (int i = 0; i < num_raster_workers; ++i) {
+		threads.create_thread(boost::bind(&ImagePipeline::rasterWorker, this));
+	}
+	for (int i = 0; i < num_encode_workers; ++i) {
+		threads.create_thread(boost::bind(&ImagePipeline::encodeWorker, this));
+	}
+	threads.create_thread(boost::bind(&ImagePipeline::writeWorker, this));
+
+	return true;
+}
+
+/**
+ * Add a sample to the pipeline.
+ * The indices of the samples have to be 0, 1, 2, ... without a gap, but they can be pushed in any order.
+ * The pipeline takes the ownership of the sample.
+ */
+void ImagePipeline::push(ImageSample* sample) {
+	derive_queue.push(sample);
+}
+
+/**
+ * Wait until all the samples are written, and report the throughput of each stage.
+ */
+void ImagePipeline::finish() {
+	derive_queue.close();
+	threads.join_all();
+	writer->close();
+
+	qint64 elapsed_nsec = timer.nsecsElapsed();
+	std::cout << "Pipeline: " << write_stats.num_samples << " samples (" << num_skipped.load() << " skipped), " << num_images << " images in " << elapsed_nsec * 1e-9 << " sec ("
+		<< (elapsed_nsec > 0 ? num_images / (elapsed_nsec * 1e-9) : 0) << " images/sec), batch size " << batch_size << ", level of detail " << lod_min_pixels << " pixels" << std::endl;
+	derive_stats.report(elapsed_nsec);
+	raster_stats.report(elapsed_nsec);
+	encode_stats.report(elapsed_nsec);
+	write_stats.report(elapsed_nsec);
+}
+
+/**
+ * Derive the grammar and generate the normalized geometry.
+ * The identical subtrees such as the window tiles are derived only once, unless the level of detail is enabled.
+ * If the batch size is more than 1, the samples are derived in batches instead.
+ */
+void ImagePipeline::deriveWorker() {
+	int num_samples = 0;
+	qint64 busy_nsec = 0;
+	QElapsedTimer stage_timer;
+
+	ImageSample* sample;
+	while (derive_queue.pop(sample)) {
+		std::vector<ImageSample*> batch(1, sample);
+		if (batch_size > 1) {
+			while (batch.size() < batch_size && derive_queue.pop(sample)) {
+				batch.push_back(sample);
+			}
+		}
+
+		stage_timer.start();
+
+		if (batch.size() > 1) {
+			deriveBatch(batch);
+		} else {
+			deriveSample(batch[0]);
+		}
+
+		for (int i = 0; i < batch.size(); ++i) {
+			GLWidget3D::normalizeObjectSize(batch[i]->geometry);
+		}
+
+		busy_nsec += stage_timer.nsecsElapsed();
+		num_samples += batch.size();
+
+		for (int i = 0; i < batch.size(); ++i) {
+			raster_queue.push(batch[i]);
+		}
+	}
+
+	raster_queue.close();
+	derive_stats.add(num_samples, busy_nsec);
+}
+
+/**
+ * Set up the derivation of the sample, which starts from the rectangle of its size.
+ * If the level of detail is enabled, the views of all the cameras of the sample are added to the lod of the system.
+ */
+void ImagePipeline::initSystem(ImageSample* sample, cga::CGA& system) {
+	system.budget = budget;
+	system.pivot = glm::translate(glm::rotate(glm::mat4(), -3.141592f * 0.5f, glm::vec3(1, 0, 0)), glm::vec3(-sample->object_width*0.5f, -sample->object_height*0.5f, 0));
+	cga::Rectangle* start = new cga::Rectangle("Start", glm::mat4(), sample->object_width, sample->object_height, glm::vec3(1, 1, 1));
+	system.stack.push_back(boost::shared_ptr<cga::Shape>(start));
+
+	if (lod_min_pixels > 0.0f) {
+		// the geometry is normalized into the unit cube after the derivation, so its bounding box is approximated by the start shape here
+		glm::vec3 minPt, maxPt;
+		for (int i = 0; i < 4; ++i) {
+			glm::vec3 p = glm::vec3(system.pivot * glm::vec4(i & 1 ? sample->object_width : 0, i & 2 ? sample->object_height : 0, 0, 1));
+			minPt = i == 0 ? p : glm::min(minPt, p);
+			maxPt = i == 0 ? p : glm::max(maxPt, p);
+		}
+		glm::mat4 objectMat = GLWidget3D::normalizationMatrix(minPt, maxPt);
+		system.lod.setViewport(image_width, image_height, lod_min_pixels);
+		for (int i = 0; i < sample->cameras.size(); ++i) {
+			system.lod.addView(sample->cameras[i], objectMat);
+		}
+	}
+}
+
+/**
+ * Derive the grammar of the sample and generate its geometry.
+ */
+void ImagePipeline::deriveSample(ImageSample* sample) {
+	cga::CGA system;
+	initSystem(sample, system);
+
+	try {
+		if (system.lod.isEnabled()) {
+			cga::InstancedGeometryGenerator generator(sample->geometry, system.pivot, budget.max_terminal_polygons);
+			system.derive(sample->grammar, generator, true);
+		} else {
+			system.deriveMemoized(sample->grammar, true);
+			system.generateInstancedGeometry(sample->geometry);
+		}
+	} catch (const cga::BudgetExceededError& ex) {
+		skipSample(sample, ex);
+	} catch (const std::string& ex) {
+		std::cout << "ERROR:" << std::endl << ex << std::endl;
+	} catch (const char* ex) {
+		std::cout << "ERROR:" << std::endl << ex << std::endl;
+	}
+}
+
+/**
+ * Derive the grammars of the samples at once by CGA::deriveBatch() and generate their geometry.
+ * A sample that fails with an error other than the budget is derived again by itself, so that only that sample is affected.
+ */
+void ImagePipeline::deriveBatch(const std::vector<ImageSample*>& samples) {
+	std::vector<cga::CGA> systems(samples.size());
+	std::vector<cga::CGA*> system_ptrs(samples.size());
+	std::vector<const cga::Grammar*> grammars(samples.size());
+	for (int i = 0; i < samples.size(); ++i) {
+		initSystem(samples[i], systems[i]);
+		system_ptrs[i] = &systems[i];
+		grammars[i] = &samples[i]->grammar;
+	}
+
+	std::vector<boost::shared_ptr<cga::BudgetExceededError> > errors;
+	cga::CGA::deriveBatch(system_ptrs, grammars, errors, true);
+
+	for (int i = 0; i < samples.size(); ++i) {
+		if (errors[i]) {
+			skipSample(samples[i], *errors[i]);
+			continue;
+		}
+		if (!systems[i].stack.empty()) {
+			deriveSample(samples[i]);
+			continue;
+		}
+
+		try {
+			systems[i].generateInstancedGeometry(samples[i]->geometry);
+		} catch (const cga::BudgetExceededError& ex) {
+			skipSample(samples[i], ex);
+		}
+	}
+}
+
+/**
+ * Mark the sample whose derivation exceeded the budget as skipped.
+ */
+void ImagePipeline::skipSample(ImageSample* sample, const cga::BudgetExceededError& ex) {
+	std::cout << "Skipped sample " << sample->index << ": " << ex.message() << std::endl;
+	sample->geometry.clear();
+	sample->skipped = true;
+	num_skipped++;
+}
+
+/**
+ * Render the geometry from all the cameras of the sample by the software rasterizer.
+ * The geometry is prepared only once for all the views. Each worker has its own frame buffer.
+ */
+void ImagePipeline::rasterWorker() {
+	int num_samples = 0;
+	qint64 busy_nsec = 0;
+	QElapsedTimer stage_timer;
+
+	FrameBuffer fb(image_width, image_height);
+	fb.setClearColor(glm::vec3(1, 1, 1));
+
+	ImageSample* sample;
+	while (raster_queue.pop(sample)) {
+		stage_timer.start();
+
+		if (sample->skipped) {
+			encode_queue.push(sample);
+			continue;
+		}
+
+		RenderMesh mesh;
+		fb.prepare(sample->geometry, sample->seed, mesh);
+
+		// the geometry is no longer needed
+		sample->geometry.clear();
+
+		sample->images.resize(sample->cameras.size());
+		for (int i = 0; i < sample->cameras.size(); ++i) {
+			fb.clear();
+			fb.rasterize(&sample->cameras[i], mesh);
+			fb.postProcess(invertImage, blur);
+			sample->images[i] = fb.toImage();
+		}
+
+		busy_nsec += stage_timer.nsecsElapsed();
+		num_samples++;
+
+		encode_queue.push(sample);
+	}
+
+	encode_queue.close();
+	raster_stats.add(num_samples, busy_nsec);
+}
+
+/**
+ * Compress the image into the format of the dataset.
+ */
+void ImagePipeline::encodeWorker() {
+	int num_samples = 0;
+	qint64 busy_nsec = 0;
+	QElapsedTimer stage_timer;
+
+	ImageSample* sample;
+	while (encode_queue.pop(sample)) {
+		stage_timer.start();
+
+		writer->encode(sample);
+		std::vector<QImage>().swap(sample->images);
+
+		busy_nsec += stage_timer.nsecsElapsed();
+		num_samples++;
+
+		write_queue.push(sample);
+	}
+
+	write_queue.close();
+	encode_stats.add(num_samples, busy_nsec);
+}
+
+/**
+ * Write the images and the parameter values in the order of the index.
+ * The samples that arrive earlier than their turn are kept until all the preceding samples are written.
+ */
+void ImagePipeline::writeWorker() {
+	int num_samples = 0;
+	qint64 busy_nsec = 0;
+	QElapsedTimer stage_timer;
+
+	std::map<int, ImageSample*> pending;
+	int next_index = 0;
+
+	ImageSample* sample;
+	while (write_queue.pop(sample)) {
+		pending[sample->index] = sample;
+
+		while (!pending.empty() && pending.begin()->first == next_index) {
+			stage_timer.start();
+			writeSample(pending.begin()->second);
+			delete pending.begin()->second;
+			busy_nsec += stage_timer.nsecsElapsed();
+			num_samples++;
+
+			pending.erase(pending.begin());
+			next_index++;
+		}
+	}
+
+	// the indices should not have a gap, but write the remaining samples anyway so that nothing is lost.
+	for (auto it = pending.begin(); it != pending.end(); ++it) {
+		writeSample(it->second);
+		delete it->second;
+		num_samples++;
+	}
+
+	write_stats.add(num_samples, busy_nsec);
+}
+
+/**
+ * Write the sample unless it is skipped.
+ * The images are numbered by the written images only, so the names of the image files stay aligned with the lines of
+ * the parameter values and the cameras even after a skipped sample.
+ */
+void ImagePipeline::writeSample(ImageSample* sample) {
+	if (sample->skipped) return;
+
+	sample->image_index = num_images;
+	writer->write(sample);
+	num_images += sample->cameras.size();
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <boost/atomic.hpp>
+#include <boost/lockfree/queue.hpp>
+#include <boost/thread.hpp>
+#include <QString>
+#include <QImage>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <boost/shared_ptr.hpp>
+#include "Camera.h"
+#include "Vertex.h"
+#include "InstancedGeometry.h"
+#include "Grammar.h"
+#include "CGA.h"
+#include "DatasetWriter.h"
+
+/**
+ * One sample of the image dataset.
+ * It is created by the producer with the sampled parameter values, and then filled in by each stage of the pipeline.
+ * The sample is derived once and rendered from all of its cameras, and each view becomes one image of the dataset.
+ */
+class ImageSample {
+public:
+	int index;
+	/** the index of the first image in the dataset, which is assigned by the writer so that the skipped samples leave no gap */
+	int image_index;
+	/** the seed of the strokes, which does not depend on the skipped samples */
+	int seed;
+	cga::Grammar grammar;
+	float object_width;
+	float object_height;
+	std::vector<Camera> cameras;
+	std::vector<float> param_values;
+	InstancedGeometry geometry;
+	std::vector<QImage> images;
+	std::vector<QByteArray> encoded_images;
+
+	/** true if the derivation exceeded the budget, in which case the sample is passed through the pipeline without images and not written */
+	bool skipped;
+
+public:
+	ImageSample(int index, int seed, const cga::Grammar& grammar, float object_width, float object_height);
+};
+
+/**
+ * Bounded multi-producer multi-consumer queue that connects two stages of the pipeline.
+ * push() blocks while the queue is full so that a fast stage cannot run ahead of a slow one.
+ */
+class SampleQueue {
+private:
+	boost::lockfree::queue<ImageSample*, boost::lockfree::fixed_sized<true> > queue;
+	boost::atomic<int> num_producers;
+
+public:
+	SampleQueue(int capacity, int num_producers);
+
+	void push(ImageSample* sample);
+	bool pop(ImageSample*& sample);
+	void close();
+};
+
+/**
+ * Throughput statistics of one stage of the pipeline.
+ */
+class StageStats {
+public:
+	std::string name;
+	int num_workers;
+	int num_samples;
+	qint64 busy_nsec;
+	boost::mutex mutex;
+
+public:
+	StageStats(const std::string& name, int num_workers);
+
+	void add(int num_samples, qint64 busy_nsec);
+	void report(qint64 elapsed_nsec) const;
+};
+
+/**
+ * Pipeline that generates the images of a dataset.
+ *
+ * derive workers --> raster workers --> encode workers --> writer
+ *
+ * The derive workers derive the grammar and generate the geometry, the raster workers render it by the software rasterizer,
+ * the encode workers compress the image, and the writer saves the images and the parameter values by DatasetWriter.
+ * The stages are connected by bounded lock-free queues. The samples may be processed out of order,
+ * but the writer puts them back in the order of the index so that the output is the same as the sequential generation.
+ */
+class ImagePipeline {
+private:
+	QString output_dir;
+	int image_width;
+	int image_height;
+	bool invertImage;
+	bool blur;
+
+	int num_derive_workers;
+	int num_raster_workers;
+	int num_encode_workers;
+
+	SampleQueue derive_queue;
+	SampleQueue raster_queue;
+	SampleQueue encode_queue;
+	SampleQueue write_queue;
+
+	StageStats derive_stats;
+	StageStats raster_stats;
+	StageStats encode_stats;
+	StageStats write_stats;
+
+	boost::shared_ptr<DatasetWriter> writer;
+	int num_images;
+	cga::DerivationBudget budget;
+	float lod_min_pixels;
+	int batch_size;
+	boost::atomic<int> num_skipped;
+	boost::thread_group threads;
+	QElapsedTimer timer;
+
+public:
+	ImagePipeline(const QString& output_dir, int image_width, int image_height, bool invertImage, bool blur, int output_format = DatasetWriter::FORMAT_PNG);
+
+	void setBudget(const cga::DerivationBudget& budget);
+	void setLevelOfDetail(float min_pixels);
+	void setBatchSize(int batch_size);
+	bool start();
+	void push(ImageSample* sample);
+	void finish();
+
+private:
+	void deriveWorker();
+	void initSystem(ImageSample* sample, cga::CGA& system);
+	void deriveSample(ImageSample* sample);
+	void deriveBatch(const std::vector<ImageSample*>& samples);
+	void skipSample(ImageSample* sample, const cga::BudgetExceededError& ex);
+	void rasterWorker();
+	void encodeWorker();
+	void writeWorker();
+	void writeSample(ImageSample* sample);
+};
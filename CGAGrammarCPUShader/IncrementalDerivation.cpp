@@ -0,0 +1,314 @@
+#include "IncrementalDerivation.h"
+#include "ParallelDerivation.h"
+#include <iostream>
+#include <sstream>
+#include <cctype>
+
+namespace cga {
+
+IncrementalDerivation::IncrementalDerivation() {
+	suppressWarning = false;
+	num_threads = 1;
+}
+
+/**
+ * Set the number of the threads to derive the whole tree, including the calling thread.
+ * The subtrees that are derived again by update() are small, so they are always derived on the calling thread.
+ */
+void IncrementalDerivation::setNumThreads(int num_threads) {
+	this->num_threads = num_threads;
+}
+
+bool IncrementalDerivation::isEmpty() const {
+	return roots.empty();
+}
+
+/**
+ * Derive the shapes in the stack from scratch, and keep the derivation tree.
+ * The shapes in the stack are copied, so the stack is not changed.
+ *
+ * @param pivot	the transformation applied after the model matrix of every shape, as CGA::pivot
+ */
+void IncrementalDerivation::derive(const Grammar& grammar, const std::list<boost::shared_ptr<Shape> >& stack, const AffineTransform& pivot, bool suppressWarning) {
+	this->pivot = pivot;
+	this->suppressWarning = suppressWarning;
+
+	start_shapes.clear();
+	for (auto it = stack.begin(); it != stack.end(); ++it) {
+		start_shapes.push_back((*it)->clone((*it)->_name));
+	}
+	deriveTree(grammar);
+
+	analyze(grammar);
+	collectTerminals();
+}
+
+/**
+ * Update the derivation for the current attribute values of the grammar.
+ * Only the subtrees whose rule reads a changed attribute are derived again.
+ * If the rules themselves have changed, everything is derived again.
+ *
+ * @return		the number of the subtrees derived again
+ */
+int IncrementalDerivation::update(const Grammar& grammar) {
+	std::map<std::string, std::string> new_rule_signatures;
+	for (auto it = grammar.rules.begin(); it != grammar.rules.end(); ++it) {
+		new_rule_signatures[it->first] = ruleSignature(it->second);
+	}
+
+	int num_subtrees = 0;
+	if (new_rule_signatures != rule_signatures) {
+		deriveTree(grammar);
+		num_subtrees = roots.size();
+	} else {
+		// the attributes whose value is changed, added, or removed
+		std::set<std::string> changed_attrs;
+		for (auto it = grammar.attrs.begin(); it != grammar.attrs.end(); ++it) {
+			auto it2 = attr_values.find(it->first);
+			if (it2 == attr_values.end() || it2->second != it->second.value) {
+				changed_attrs.insert(it->first);
+			}
+		}
+		for (auto it = attr_values.begin(); it != attr_values.end(); ++it) {
+			if (grammar.attrs.find(it->first) == grammar.attrs.end()) {
+				changed_attrs.insert(it->first);
+			}
+		}
+		if (changed_attrs.empty()) return 0;
+
+		std::set<std::string> dirty_rules;
+		for (auto it = rule_dependencies.begin(); it != rule_dependencies.end(); ++it) {
+			for (auto it2 = it->second.begin(); it2 != it->second.end(); ++it2) {
+				if (changed_attrs.find(*it2) != changed_attrs.end()) {
+					dirty_rules.insert(it->first);
+					break;
+				}
+			}
+		}
+
+		for (int i = 0; i < roots.size(); ++i) {
+			rederive(grammar, roots[i], dirty_rules, num_subtrees);
+		}
+	}
+
+	analyze(grammar);
+	collectTerminals();
+
+	return num_subtrees;
+}
+
+const std::vector<boost::shared_ptr<Shape> >& IncrementalDerivation::terminalShapes() const {
+	return shapes;
+}
+
+/**
+ * Generate the geometry of all the terminal shapes.
+ * The geometry of each terminal shape is generated only once and reused until its subtree is derived again.
+ */
+void IncrementalDerivation::generateGeometry(std::vector<std::vector<Vertex> >& vertices) {
+	for (int i = 0; i < terminal_nodes.size(); ++i) {
+		Node* node = terminal_nodes[i];
+		if (!node->has_geometry) {
+			node->terminal->generateGeometry(pivot, 1.0f, node->geometry);
+			node->has_geometry = true;
+		}
+		vertices.insert(vertices.end(), node->geometry.begin(), node->geometry.end());
+	}
+}
+
+/**
+ * Derive the whole tree from the start shapes.
+ * ParallelDerivation returns the nodes in the breadth-first order, so each node is assigned to the next node of the tree
+ * in the breadth-first order, and the children of the node are appended to the queue.
+ */
+void IncrementalDerivation::deriveTree(const Grammar& grammar) {
+	roots.clear();
+	for (int i = 0; i < start_shapes.size(); ++i) {
+		roots.push_back(boost::shared_ptr<Node>(new Node()));
+	}
+
+	if (num_threads <= 1) {
+		for (int i = 0; i < roots.size(); ++i) {
+			deriveSubtree(grammar, roots[i], start_shapes[i]);
+		}
+		return;
+	}
+
+	std::list<boost::shared_ptr<Shape> > stack;
+	for (int i = 0; i < start_shapes.size(); ++i) {
+		stack.push_back(start_shapes[i]->clone(start_shapes[i]->_name));
+	}
+	std::vector<ParallelDerivation::TreeNode> tree_nodes;
+	ParallelDerivation derivation(grammar, DerivationBudget(), num_threads, suppressWarning);
+	derivation.derive(stack, tree_nodes);
+
+	std::list<Node*> queue;
+	for (int i = 0; i < roots.size(); ++i) {
+		queue.push_back(roots[i].get());
+	}
+	for (int i = 0; i < tree_nodes.size(); ++i) {
+		Node* node = queue.front();
+		queue.pop_front();
+
+		node->input = tree_nodes[i].input;
+		node->terminal = tree_nodes[i].terminal;
+		for (int k = 0; k < tree_nodes[i].num_children; ++k) {
+			node->children.push_back(boost::shared_ptr<Node>(new Node()));
+			queue.push_back(node->children.back().get());
+		}
+	}
+}
+
+/**
+ * Derive the shape in the same way as CGA::derive(), and build the subtree under the given node.
+ * The shape is copied, so it can be derived again later.
+ */
+void IncrementalDerivation::deriveSubtree(const Grammar& grammar, const boost::shared_ptr<Node>& root, const boost::shared_ptr<Shape>& shape) {
+	std::list<std::pair<boost::shared_ptr<Node>, boost::shared_ptr<Shape> > > queue;
+	queue.push_back(std::make_pair(root, shape->clone(shape->_name)));
+
+	while (!queue.empty()) {
+		boost::shared_ptr<Node> node = queue.front().first;
+		boost::shared_ptr<Shape> current = queue.front().second;
+		queue.pop_front();
+
+		node->children.clear();
+		node->terminal.reset();
+		node->has_geometry = false;
+		std::vector<std::vector<Vertex> >().swap(node->geometry);
+
+		if (grammar.contain(current->_name)) {
+			node->input = current->clone(current->_name);
+
+			std::list<boost::shared_ptr<Shape> > children;
+			int depth = current->_depth + 1;
+			grammar.getRule(current->_name).apply(current, grammar, children);
+
+			for (auto it = children.begin(); it != children.end(); ++it) {
+				(*it)->_depth = depth;
+				node->children.push_back(boost::shared_ptr<Node>(new Node()));
+				queue.push_back(std::make_pair(node->children.back(), *it));
+			}
+		} else {
+			if (!suppressWarning && current->_name.back() != '!' && current->_name.back() != '.') {
+				std::cout << "Warning: " << "no rule is found for " << current->_name << "." << std::endl;
+			}
+			node->input.reset();
+			node->terminal = current;
+		}
+	}
+}
+
+/**
+ * Derive again the topmost subtrees whose rule is dirty.
+ */
+void IncrementalDerivation::rederive(const Grammar& grammar, const boost::shared_ptr<Node>& node, const std::set<std::string>& dirty_rules, int& num_subtrees) {
+	if (node->input && dirty_rules.find(node->input->_name) != dirty_rules.end()) {
+		boost::shared_ptr<Shape> input = node->input;
+		deriveSubtree(grammar, node, input);
+		num_subtrees++;
+		return;
+	}
+
+	for (int i = 0; i < node->children.size(); ++i) {
+		rederive(grammar, node->children[i], dirty_rules, num_subtrees);
+	}
+}
+
+/**
+ * Collect the terminal shapes in the breadth-first order of the tree, which is the order of CGA::derive().
+ */
+void IncrementalDerivation::collectTerminals() {
+	shapes.clear();
+	terminal_nodes.clear();
+
+	std::list<Node*> queue;
+	for (int i = 0; i < roots.size(); ++i) {
+		queue.push_back(roots[i].get());
+	}
+	while (!queue.empty()) {
+		Node* node = queue.front();
+		queue.pop_front();
+
+		if (node->terminal) {
+			shapes.push_back(node->terminal);
+			terminal_nodes.push_back(node);
+		}
+		for (int i = 0; i < node->children.size(); ++i) {
+			queue.push_back(node->children[i].get());
+		}
+	}
+}
+
+/**
+ * Record the attribute values, the rules, and the attributes that each rule reads.
+ * An attribute is read by a rule if its name appears in the expressions of the operators of the rule.
+ */
+void IncrementalDerivation::analyze(const Grammar& grammar) {
+	attr_values.clear();
+	for (auto it = grammar.attrs.begin(); it != grammar.attrs.end(); ++it) {
+		attr_values[it->first] = it->second.value;
+	}
+
+	rule_signatures.clear();
+	rule_dependencies.clear();
+	for (auto it = grammar.rules.begin(); it != grammar.rules.end(); ++it) {
+		rule_signatures[it->first] = ruleSignature(it->second);
+
+		std::set<std::string>& dependencies = rule_dependencies[it->first];
+		for (int i = 0; i < it->second.operators.size(); ++i) {
+			GrammarNode node;
+			it->second.operators[i]->toNode(node);
+			collectIdentifiers(node, dependencies);
+		}
+	}
+}
+
+/**
+ * Serialize the operators of the rule, so that two rules can be compared.
+ */
+std::string IncrementalDerivation::ruleSignature(const Rule& rule) {
+	std::stringstream ss;
+	std::list<GrammarNode> nodes;
+	for (int i = 0; i < rule.operators.size(); ++i) {
+		nodes.push_back(GrammarNode());
+		rule.operators[i]->toNode(nodes.back());
+	}
+
+	while (!nodes.empty()) {
+		const GrammarNode& node = nodes.front();
+		ss << "<" << node.tagName;
+		for (int i = 0; i < node.attributes.size(); ++i) {
+			ss << " " << node.attributes[i].first << "=\"" << node.attributes[i].second << "\"";
+		}
+		ss << " " << node.children.size() << ">";
+		nodes.insert(nodes.end(), node.children.begin(), node.children.end());
+		nodes.pop_front();
+	}
+
+	return ss.str();
+}
+
+/**
+ * Collect the identifiers in the attribute values of the node and its children, such as "height" in "height * 0.5".
+ */
+void IncrementalDerivation::collectIdentifiers(const GrammarNode& node, std::set<std::string>& identifiers) {
+	for (int i = 0; i < node.attributes.size(); ++i) {
+		const std::string& value = node.attributes[i].second;
+		for (int k = 0; k < value.size(); ) {
+			if (isalpha((unsigned char)value[k]) || value[k] == '_') {
+				int begin = k;
+				while (k < value.size() && (isalnum((unsigned char)value[k]) || value[k] == '_' || value[k] == '.')) k++;
+				identifiers.insert(value.substr(begin, k - begin));
+			} else {
+				k++;
+			}
+		}
+	}
+
+	for (int i = 0; i < node.children.size(); ++i) {
+		collectIdentifiers(node.children[i], identifiers);
+	}
+}
+
+}
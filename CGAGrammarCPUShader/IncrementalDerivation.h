@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <boost/shared_ptr.hpp>
+#include "Grammar.h"
+#include "Shape.h"
+#include "Vertex.h"
+
+namespace cga {
+
+/**
+ * Derivation that keeps its derivation tree, so that it can be updated when some attributes change.
+ *
+ * Each node of the tree keeps a copy of the shape before its rule is applied, and the attributes that
+ * the expressions of each rule read are collected from the operators. When the attributes change,
+ * only the subtrees whose rule reads a changed attribute are derived again, and the other subtrees,
+ * including the geometry of their terminal shapes, are reused.
+ * The terminal shapes are collected in the breadth-first order of the tree, which is the same order as CGA::derive().
+ * When the whole tree is derived, the subtrees are derived on multiple threads by ParallelDerivation.
+ */
+class IncrementalDerivation {
+private:
+	struct Node {
+		/** the shape before the rule is applied, or NULL for a terminal shape */
+		boost::shared_ptr<Shape> input;
+		/** the terminal shape, or NULL if a rule is applied */
+		boost::shared_ptr<Shape> terminal;
+		std::vector<boost::shared_ptr<Node> > children;
+		bool has_geometry;
+		std::vector<std::vector<Vertex> > geometry;
+
+		Node() : has_geometry(false) {}
+	};
+
+	std::vector<boost::shared_ptr<Shape> > start_shapes;
+	AffineTransform pivot;
+	std::vector<boost::shared_ptr<Node> > roots;
+	std::vector<Node*> terminal_nodes;
+	std::map<std::string, std::string> attr_values;
+	std::map<std::string, std::string> rule_signatures;
+	std::map<std::string, std::set<std::string> > rule_dependencies;
+	std::vector<boost::shared_ptr<Shape> > shapes;
+	bool suppressWarning;
+	int num_threads;
+
+public:
+	IncrementalDerivation();
+
+	void setNumThreads(int num_threads);
+	bool isEmpty() const;
+	void derive(const Grammar& grammar, const std::list<boost::shared_ptr<Shape> >& stack, const AffineTransform& pivot, bool suppressWarning = false);
+	int update(const Grammar& grammar);
+	const std::vector<boost::shared_ptr<Shape> >& terminalShapes() const;
+	void generateGeometry(std::vector<std::vector<Vertex> >& vertices);
+
+private:
+	void deriveTree(const Grammar& grammar);
+	void deriveSubtree(const Grammar& grammar, const boost::shared_ptr<Node>& root, const boost::shared_ptr<Shape>& shape);
+	void rederive(const Grammar& grammar, const boost::shared_ptr<Node>& node, const std::set<std::string>& dirty_rules, int& num_subtrees);
+	void collectTerminals();
+	void analyze(const Grammar& grammar);
+	static std::string ruleSignature(const Rule& rule);
+	static void collectIdentifiers(const GrammarNode& node, std::set<std::string>& identifiers);
+};
+
+}
@@ -12,4 +12,8 @@ boost::shared_ptr<Shape> InnerSemiCircleOperator::apply(boost::shared_ptr<Shape>
 	return shape->innerSemiCircle(shape->_name);
 }
 
+void InnerSemiCircleOperator::toNode(GrammarNode& node) const {
+	node.tagName = "innerSemiCircle";
+}
+
 }
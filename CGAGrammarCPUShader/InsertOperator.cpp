@@ -13,4 +13,9 @@ boost::shared_ptr<Shape> InsertOperator::apply(boost::shared_ptr<Shape>& shape,
 	return shape->insert(shape->_name, grammar.evalString(geometryPath, shape));
 }
 
+void InsertOperator::toNode(GrammarNode& node) const {
+	node.tagName = "insert";
+	node.setAttribute("geometryPath", geometryPath);
+}
+
 }
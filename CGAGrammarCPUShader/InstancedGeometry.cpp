@@ -0,0 +1,116 @@
+#include "InstancedGeometry.h"
+#include <limits>
+#include <algorithm>
+
+GeometryInstance::GeometryInstance(int mesh_index, const glm::mat4& modelMat) {
+	this->mesh_index = mesh_index;
+	this->modelMat = modelMat;
+}
+
+void InstancedGeometry::clear() {
+	std::vector<std::vector<std::vector<Vertex> > >().swap(meshes);
+	std::vector<GeometryInstance>().swap(instances);
+	mesh_indices.clear();
+}
+
+bool InstancedGeometry::empty() const {
+	return instances.empty();
+}
+
+/**
+ * Add the mesh if the same mesh has not been added yet.
+ *
+ * @param mesh	the polygons in the local coordinates
+ * @return		the index of the mesh
+ */
+int InstancedGeometry::addMesh(const std::vector<std::vector<Vertex> >& mesh) {
+	std::string key;
+	for (int i = 0; i < mesh.size(); ++i) {
+		int num_vertices = mesh[i].size();
+		key.append((const char*)&num_vertices, sizeof(int));
+		if (num_vertices > 0) {
+			key.append((const char*)&mesh[i][0], sizeof(Vertex) * num_vertices);
+		}
+	}
+
+	auto it = mesh_indices.find(key);
+	if (it != mesh_indices.end()) return it->second;
+
+	int mesh_index = meshes.size();
+	meshes.push_back(mesh);
+	mesh_indices[key] = mesh_index;
+	return mesh_index;
+}
+
+void InstancedGeometry::addInstance(int mesh_index, const glm::mat4& modelMat) {
+	instances.push_back(GeometryInstance(mesh_index, modelMat));
+}
+
+/**
+ * Return the number of the polygons of all the instances.
+ */
+int InstancedGeometry::numPolygons() const {
+	int num_polygons = 0;
+	for (int i = 0; i < instances.size(); ++i) {
+		num_polygons += meshes[instances[i].mesh_index].size();
+	}
+	return num_polygons;
+}
+
+/**
+ * Transform all the instances by the matrix, which is applied after their model matrix.
+ */
+void InstancedGeometry::transform(const glm::mat4& mat) {
+	for (int i = 0; i < instances.size(); ++i) {
+		instances[i].modelMat = mat * instances[i].modelMat;
+	}
+}
+
+/**
+ * Compute the bounding box of all the instances in the world coordinates.
+ */
+void InstancedGeometry::boundingBox(glm::vec3& minPt, glm::vec3& maxPt) const {
+	minPt = glm::vec3((std::numeric_limits<float>::max)(), (std::numeric_limits<float>::max)(), (std::numeric_limits<float>::max)());
+	maxPt = -minPt;
+
+	for (int i = 0; i < instances.size(); ++i) {
+		const std::vector<std::vector<Vertex> >& mesh = meshes[instances[i].mesh_index];
+		for (int j = 0; j < mesh.size(); ++j) {
+			for (int k = 0; k < mesh[j].size(); ++k) {
+				glm::vec3 p(instances[i].modelMat * glm::vec4(mesh[j][k].position, 1));
+				minPt = glm::min(minPt, p);
+				maxPt = glm::max(maxPt, p);
+			}
+		}
+	}
+}
+
+/**
+ * Expand the instances into the polygons in the world coordinates.
+ */
+void InstancedGeometry::expand(std::vector<std::vector<Vertex> >& vertices) const {
+	vertices.reserve(vertices.size() + numPolygons());
+	for (int i = 0; i < instances.size(); ++i) {
+		const std::vector<std::vector<Vertex> >& mesh = meshes[instances[i].mesh_index];
+		for (int j = 0; j < mesh.size(); ++j) {
+			vertices.push_back(std::vector<Vertex>());
+			transformPolygon(mesh[j], instances[i].modelMat, vertices.back());
+		}
+	}
+}
+
+/**
+ * Transform the polygon by the matrix.
+ * The matrix consists of rotations, translations, and a uniform scaling, so the normal is only rotated.
+ */
+void InstancedGeometry::transformPolygon(const std::vector<Vertex>& polygon, const glm::mat4& mat, std::vector<Vertex>& result) {
+	result.resize(polygon.size());
+	for (int i = 0; i < polygon.size(); ++i) {
+		result[i] = polygon[i];
+		result[i].position = glm::vec3(mat * glm::vec4(polygon[i].position, 1));
+
+		glm::vec3 normal(mat * glm::vec4(polygon[i].normal, 0));
+		float length = glm::length(normal);
+		result[i].normal = length > 0.0f ? normal / length : normal;
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <map>
+#include <string>
+#include "Vertex.h"
+
+/**
+ * One placement of a mesh of InstancedGeometry.
+ */
+class GeometryInstance {
+public:
+	int mesh_index;
+	glm::mat4 modelMat;
+
+public:
+	GeometryInstance(int mesh_index, const glm::mat4& modelMat);
+};
+
+/**
+ * Geometry in which the identical meshes are stored only once.
+ *
+ * Each mesh is a list of polygons in its local coordinates, and each instance places one of the meshes by its model matrix.
+ * The facade grammars generate many identical windows, whose polygons differ only in their position, so this takes
+ * much less memory than the list of all the polygons in the world coordinates. The meshes are compared by their vertices,
+ * so the same mesh is found for any kind of shape.
+ * The polygons of the instances in the order of the instances are the same as the ones of CGA::generateGeometry().
+ */
+class InstancedGeometry {
+public:
+	std::vector<std::vector<std::vector<Vertex> > > meshes;
+	std::vector<GeometryInstance> instances;
+
+private:
+	/** the index of each mesh by its vertex data */
+	std::map<std::string, int> mesh_indices;
+
+public:
+	InstancedGeometry() {}
+
+	void clear();
+	bool empty() const;
+	int addMesh(const std::vector<std::vector<Vertex> >& mesh);
+	void addInstance(int mesh_index, const glm::mat4& modelMat);
+	int numPolygons() const;
+	void transform(const glm::mat4& mat);
+	void boundingBox(glm::vec3& minPt, glm::vec3& maxPt) const;
+	void expand(std::vector<std::vector<Vertex> >& vertices) const;
+	static void transformPolygon(const std::vector<Vertex>& polygon, const glm::mat4& mat, std::vector<Vertex>& result);
+};
@@ -1,5 +1,9 @@
 #include "MainWindow.h"
 #include <QFileDialog>
+#include <QActionGroup>
+#include "DatasetWriter.h"
+#include "OBJLoader.h"
+#include "GrammarParser.h"
 
 MainWindow::MainWindow(QWidget *parent, Qt::WFlags flags) : QMainWindow(parent, flags) { 
 	ui.setupUi(this);
@@ -7,10 +11,23 @@ MainWindow::MainWindow(QWidget *parent, Qt::WFlags flags) : QMainWindow(parent,
 	connect(ui.actionExit, SIGNAL(triggered()), this, SLOT(close()));
 	connect(ui.actionOpenCGAGrammar, SIGNAL(triggered()), this, SLOT(onOpenCGAGrammar()));
 	connect(ui.actionViewRefresh, SIGNAL(triggered()), this, SLOT(onViewRefresh()));
+	connect(ui.actionViewRandomize, SIGNAL(triggered()), this, SLOT(onViewRandomize()));
 	connect(ui.actionGenerateImages, SIGNAL(triggered()), this, SLOT(onGenerateImages()));
 	connect(ui.actionGenerateBuildingImages, SIGNAL(triggered()), this, SLOT(onGenerateBuildingImages()));
+	connect(ui.actionGenerateBuildingImagesMultiView, SIGNAL(triggered()), this, SLOT(onGenerateBuildingImagesMultiView()));
+	connect(ui.actionBenchmarkOBJLoader, SIGNAL(triggered()), this, SLOT(onBenchmarkOBJLoader()));
+	connect(ui.actionBenchmarkGrammarParser, SIGNAL(triggered()), this, SLOT(onBenchmarkGrammarParser()));
+	connect(ui.actionProfileDerivation, SIGNAL(triggered()), this, SLOT(onProfileDerivation()));
+	connect(ui.actionBenchmarkBatchDerivation, SIGNAL(triggered()), this, SLOT(onBenchmarkBatchDerivation()));
+	connect(ui.actionCheckDerivations, SIGNAL(triggered()), this, SLOT(onCheckDerivations()));
 	connect(ui.actionHoge, SIGNAL(triggered()), this, SLOT(onHoge()));
 
+	QActionGroup* groupDatasetFormat = new QActionGroup(this);
+	groupDatasetFormat->addAction(ui.actionDatasetFormatPNG);
+	groupDatasetFormat->addAction(ui.actionDatasetFormatSharded);
+	groupDatasetFormat->addAction(ui.actionDatasetFormatShardedPNG);
+	groupDatasetFormat->addAction(ui.actionDatasetFormatNpy);
+
 	glWidget = new GLWidget3D();
 	setCentralWidget(glWidget);
 }
@@ -19,27 +36,102 @@ MainWindow::~MainWindow() {
 }
 
 void MainWindow::onOpenCGAGrammar() {
-	QString new_filename = QFileDialog::getOpenFileName(this, tr("Open CGA file..."), "", tr("CGA Files (*.xml)"));
+	QString new_filename = QFileDialog::getOpenFileName(this, tr("Open CGA file..."), "", tr("CGA Files (*.xml *.cga)"));
 	if (new_filename.isEmpty()) return;
 
 	fileLoaded = true;
 	filename = new_filename;
-	glWidget->loadCGA(filename.toUtf8().data());
+	glWidget->loadCGA(filename.toUtf8().data(), true);
 	this->setWindowTitle("CGA Shape Grammar - " + new_filename);
 }
 
 void MainWindow::onViewRefresh() {
 	if (fileLoaded) {
-		glWidget->loadCGA(filename.toUtf8().data());
+		glWidget->loadCGA(filename.toUtf8().data(), false);
+	}
+}
+
+void MainWindow::onViewRandomize() {
+	if (fileLoaded) {
+		glWidget->loadCGA(filename.toUtf8().data(), true);
 	}
 }
 
 void MainWindow::onGenerateImages() {
-	glWidget->generateImages(256, 256, false, false);
+	glWidget->generateImages(256, 256, false, false, datasetFormat(), levelOfDetail(), batchSize());
 }
 
 void MainWindow::onGenerateBuildingImages() {
-	glWidget->generateBuildingImages(256, 256, false, false);
+	glWidget->generateBuildingImages(256, 256, false, false, datasetFormat(), levelOfDetail(), batchSize(), 1);
+}
+
+void MainWindow::onGenerateBuildingImagesMultiView() {
+	glWidget->generateBuildingImages(256, 256, false, false, datasetFormat(), levelOfDetail(), batchSize(), 16);
+}
+
+/**
+ * Return the dataset format selected in the menu.
+ */
+int MainWindow::datasetFormat() {
+	if (ui.actionDatasetFormatSharded->isChecked()) {
+		return DatasetWriter::FORMAT_SHARDED;
+	} else if (ui.actionDatasetFormatShardedPNG->isChecked()) {
+		return DatasetWriter::FORMAT_SHARDED_PNG;
+	} else if (ui.actionDatasetFormatNpy->isChecked()) {
+		return DatasetWriter::FORMAT_NPY;
+	} else {
+		return DatasetWriter::FORMAT_PNG;
+	}
+}
+
+/**
+ * Return the threshold of the level of detail in pixels, or 0 if it is disabled in the menu.
+ * The shapes smaller than one pixel in all the views hardly change the images.
+ */
+float MainWindow::levelOfDetail() {
+	return ui.actionLevelOfDetail->isChecked() ? 1.0f : 0.0f;
+}
+
+/**
+ * Return the number of the samples derived at once, or 1 if the batch derivation is disabled in the menu.
+ */
+int MainWindow::batchSize() {
+	return ui.actionBatchDerivation->isChecked() ? 16 : 1;
+}
+
+void MainWindow::onBenchmarkOBJLoader() {
+	QStringList filenames = QFileDialog::getOpenFileNames(this, tr("Open OBJ files..."), "", tr("OBJ Files (*.obj)"));
+	for (int i = 0; i < filenames.size(); ++i) {
+		OBJLoader::benchmark(filenames[i].toUtf8().data(), 10);
+	}
+}
+
+void MainWindow::onBenchmarkGrammarParser() {
+	QString dir = QFileDialog::getExistingDirectory(this, tr("Open directory of CGA files..."), "../cga");
+	if (dir.isEmpty()) return;
+
+	cga::benchmarkGrammarParsers(dir, 10);
+}
+
+void MainWindow::onProfileDerivation() {
+	QString filename = QFileDialog::getOpenFileName(this, tr("Open CGA file..."), "", tr("CGA Files (*.xml *.cga)"));
+	if (filename.isEmpty()) return;
+
+	glWidget->profileDerivation(filename.toUtf8().data(), 100);
+}
+
+void MainWindow::onBenchmarkBatchDerivation() {
+	QString filename = QFileDialog::getOpenFileName(this, tr("Open CGA file..."), "", tr("CGA Files (*.xml *.cga)"));
+	if (filename.isEmpty()) return;
+
+	glWidget->benchmarkBatchDerivation(filename.toUtf8().data(), 256, 16);
+}
+
+void MainWindow::onCheckDerivations() {
+	QString dir = QFileDialog::getExistingDirectory(this, tr("Open directory of CGA files..."), "../cga/building");
+	if (dir.isEmpty()) return;
+
+	glWidget->checkDerivations(dir, 16);
 }
 
 void MainWindow::onHoge() {
@@ -18,11 +18,22 @@ public:
 	MainWindow(QWidget *parent = 0, Qt::WFlags flags = 0);
 	~MainWindow();
 
+	int datasetFormat();
+	float levelOfDetail();
+	int batchSize();
+
 public slots:
 	void onOpenCGAGrammar();
 	void onViewRefresh();
+	void onViewRandomize();
 	void onGenerateImages();
 	void onGenerateBuildingImages();
+	void onGenerateBuildingImagesMultiView();
+	void onBenchmarkOBJLoader();
+	void onBenchmarkGrammarParser();
+	void onProfileDerivation();
+	void onBenchmarkBatchDerivation();
+	void onCheckDerivations();
 	void onHoge();
 };
 
@@ -0,0 +1,237 @@
+#include "MemoizedDerivation.h"
+#include "DerivationProfiler.h"
+#include "Rectangle.h"
+#include "Cuboid.h"
+#include <algorithm>
+#include <iostream>
+#include <typeinfo>
+#include <cmath>
+
+namespace cga {
+
+namespace {
+
+template<typename T>
+void appendBytes(std::string& key, const T& value) {
+	key.append((const char*)&value, sizeof(T));
+}
+
+void appendString(std::string& key, const std::string& str) {
+	appendBytes(key, (int)str.size());
+	key.append(str);
+}
+
+}
+
+const float MemoizedDerivation::SCOPE_QUANTUM = 0.0001f;
+
+MemoizedDerivation::MemoizedDerivation(const Grammar& grammar, const DerivationBudget& budget, bool suppressWarning) : grammar(grammar), budget(budget) {
+	this->suppressWarning = suppressWarning;
+	this->memoizable = isTransformInvariant(grammar);
+	this->num_shapes = 0;
+	this->num_hits = 0;
+	this->num_misses = 0;
+}
+
+/**
+ * Derive all the shapes in the stack, and put the terminal shapes to shapes in the same order as CGA::derive().
+ * BudgetExceededError is thrown if the derivation exceeds the budget.
+ */
+void MemoizedDerivation::derive(std::list<boost::shared_ptr<Shape> >& stack, std::vector<boost::shared_ptr<Shape> >& shapes) {
+	DerivationBudgetScope budget_scope(budget);
+	shapes.clear();
+	terminals.clear();
+	cache.clear();
+	timer.start();
+
+	std::list<boost::shared_ptr<Shape> > start_shapes;
+	start_shapes.swap(stack);
+
+	std::vector<int> path;
+	int index = 0;
+	for (auto it = start_shapes.begin(); it != start_shapes.end(); ++it, ++index) {
+		path.push_back(index);
+		deriveShape(*it, path);
+		path.pop_back();
+	}
+	cache.clear();
+
+	std::sort(terminals.begin(), terminals.end(), compareTerminals);
+	shapes.resize(terminals.size());
+	for (int i = 0; i < terminals.size(); ++i) {
+		shapes[i] = terminals[i].shape;
+	}
+	std::vector<Terminal>().swap(terminals);
+}
+
+/**
+ * Derive the subtree of the shape depth first, or copy it from the cache if the same subtree has been derived.
+ * The terminal shapes are added to terminals with their path from the start shape.
+ *
+ * @return		the depth of the deepest shape in the subtree
+ */
+int MemoizedDerivation::deriveShape(const boost::shared_ptr<Shape>& shape, std::vector<int>& path) {
+	countShapes(shape->_name, 1);
+
+	if (!grammar.contain(shape->_name)) {
+		if (!suppressWarning && shape->_name.back() != '!' && shape->_name.back() != '.') {
+			std::cout << "Warning: " << "no rule is found for " << shape->_name << "." << std::endl;
+		}
+		terminals.push_back(Terminal());
+		terminals.back().path = path;
+		terminals.back().shape = shape;
+		return shape->_depth;
+	}
+
+	std::string key;
+	bool cacheable = makeKey(shape, key);
+	if (cacheable) {
+		auto it = cache.find(key);
+		if (it != cache.end()) {
+			num_hits++;
+			instantiate(it->second, shape, path);
+			return shape->_depth + it->second.depth;
+		}
+		num_misses++;
+	}
+
+	// the rule changes the shape, so the model matrix is kept for the cache
+	std::string rule_name = shape->_name;
+	AffineTransform modelMat = shape->_modelMat;
+	int root_depth = shape->_depth;
+	int depth = root_depth + 1;
+	int first_terminal = terminals.size();
+	int first_num_shapes = num_shapes;
+
+	std::list<boost::shared_ptr<Shape> > children;
+	try {
+		CGA_PROFILE_RULE(rule_name, children);
+		boost::shared_ptr<Shape> current = shape;
+		grammar.getRule(rule_name).apply(current, grammar, children);
+	} catch (const BudgetExceededError& ex) {
+		// the operator does not know the rule and the number of the shapes
+		throw BudgetExceededError(ex.type, ex.limit, rule_name, num_shapes, (int)timer.elapsed());
+	}
+
+	int max_depth = root_depth;
+	if (!children.empty()) {
+		if (budget.max_depth > 0 && depth > budget.max_depth) {
+			throw BudgetExceededError(BudgetExceededError::BUDGET_DEPTH, budget.max_depth, rule_name, num_shapes, (int)timer.elapsed());
+		}
+
+		int index = 0;
+		for (auto it = children.begin(); it != children.end(); ++it, ++index) {
+			(*it)->_depth = depth;
+			path.push_back(index);
+			max_depth = std::max(max_depth, deriveShape(*it, path));
+			path.pop_back();
+		}
+	}
+
+	if (cacheable && (int)terminals.size() - first_terminal <= MAX_ENTRY_TERMINALS) {
+		Entry& entry = cache[key];
+		entry.num_shapes = num_shapes - first_num_shapes + 1;
+		entry.depth = max_depth - root_depth;
+
+		AffineTransform invModelMat = glm::inverse(modelMat);
+		entry.terminals.resize(terminals.size() - first_terminal);
+		for (int i = 0; i < entry.terminals.size(); ++i) {
+			const Terminal& terminal = terminals[first_terminal + i];
+			entry.terminals[i].path.assign(terminal.path.begin() + path.size(), terminal.path.end());
+			entry.terminals[i].shape = terminal.shape->clone(terminal.shape->_name);
+			entry.terminals[i].shape->_modelMat = invModelMat * terminal.shape->_modelMat;
+			entry.terminals[i].shape->_depth = terminal.shape->_depth - root_depth;
+		}
+	}
+
+	return max_depth;
+}
+
+/**
+ * Add the copies of the cached terminal shapes, which are placed by the model matrix of the shape.
+ */
+void MemoizedDerivation::instantiate(const Entry& entry, const boost::shared_ptr<Shape>& shape, const std::vector<int>& path) {
+	// the shape itself has been counted
+	countShapes(shape->_name, entry.num_shapes - 1);
+	if (budget.max_depth > 0 && entry.depth > 0 && shape->_depth + entry.depth > budget.max_depth) {
+		throw BudgetExceededError(BudgetExceededError::BUDGET_DEPTH, budget.max_depth, shape->_name, num_shapes, (int)timer.elapsed());
+	}
+
+	for (int i = 0; i < entry.terminals.size(); ++i) {
+		const Terminal& cached = entry.terminals[i];
+		terminals.push_back(Terminal());
+		terminals.back().path = path;
+		terminals.back().path.insert(terminals.back().path.end(), cached.path.begin(), cached.path.end());
+		terminals.back().shape = cached.shape->clone(cached.shape->_name);
+		terminals.back().shape->_modelMat = shape->_modelMat * cached.shape->_modelMat;
+		terminals.back().shape->_depth = shape->_depth + cached.shape->_depth;
+	}
+}
+
+/**
+ * Count the derived shapes, and throw BudgetExceededError if the number of the shapes or the time exceeds the budget.
+ */
+void MemoizedDerivation::countShapes(const std::string& rule_name, int count) {
+	int prev_num_shapes = num_shapes;
+	num_shapes += count;
+	if (budget.max_shapes > 0 && num_shapes > budget.max_shapes) {
+		throw BudgetExceededError(BudgetExceededError::BUDGET_SHAPES, budget.max_shapes, rule_name, num_shapes, (int)timer.elapsed());
+	}
+	// checking the clock for every shape is not necessary
+	if (budget.max_msec > 0 && num_shapes / 256 != prev_num_shapes / 256 && timer.elapsed() > budget.max_msec) {
+		throw BudgetExceededError(BudgetExceededError::BUDGET_TIME, budget.max_msec, rule_name, num_shapes, (int)timer.elapsed());
+	}
+}
+
+/**
+ * Make the key of the subtree of the shape, which consists of the rule, the type, the quantized scope,
+ * the color, and the texture of the shape.
+ *
+ * @return		false if the subtree of the shape cannot be cached
+ */
+bool MemoizedDerivation::makeKey(const boost::shared_ptr<Shape>& shape, std::string& key) const {
+	if (!memoizable) return false;
+	if (shape->_removed) return false;
+	if (typeid(*shape) != typeid(Rectangle) && typeid(*shape) != typeid(Cuboid)) return false;
+
+	appendString(key, shape->_name);
+	appendString(key, typeid(*shape).name());
+	for (int i = 0; i < 3; ++i) {
+		appendBytes(key, (int)floor(shape->_scope[i] / SCOPE_QUANTUM + 0.5f));
+	}
+	for (int i = 0; i < 3; ++i) {
+		appendBytes(key, (int)floor(shape->_prev_scope[i] / SCOPE_QUANTUM + 0.5f));
+	}
+	appendBytes(key, shape->_color);
+	appendBytes(key, shape->_textureEnabled);
+	appendString(key, shape->_texture);
+	appendBytes(key, (int)shape->_texCoords.size());
+	for (int i = 0; i < shape->_texCoords.size(); ++i) {
+		appendBytes(key, shape->_texCoords[i]);
+	}
+	return true;
+}
+
+/**
+ * Return false if some rule translates a shape in the world coordinates.
+ */
+bool MemoizedDerivation::isTransformInvariant(const Grammar& grammar) {
+	for (auto it = grammar.rules.begin(); it != grammar.rules.end(); ++it) {
+		for (int i = 0; i < it->second.operators.size(); ++i) {
+			GrammarNode node;
+			it->second.operators[i]->toNode(node);
+			if (node.tagName == "translate" && node.hasAttribute("coordSystem") && node.attribute("coordSystem") == "world") return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * The order of the serial derivation, which is the breadth-first order of the derivation tree.
+ */
+bool MemoizedDerivation::compareTerminals(const Terminal& t1, const Terminal& t2) {
+	if (t1.path.size() != t2.path.size()) return t1.path.size() < t2.path.size();
+	return t1.path < t2.path;
+}
+
+}
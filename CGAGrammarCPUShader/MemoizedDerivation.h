@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vector>
+#include <list>
+#include <map>
+#include <string>
+#include <boost/shared_ptr.hpp>
+#include <QElapsedTimer>
+#include "CGA.h"
+
+namespace cga {
+
+/**
+ * Derivation that derives identical subtrees only once.
+ *
+ * Facade grammars apply the same rule to many shapes that are the same except for their position, such as window tiles.
+ * The result of such a subtree depends only on the rule, the scope, the attributes, and the color and texture of the shape,
+ * so the terminal shapes of the subtree are cached in the local coordinates of the shape, and when the same rule is applied
+ * to the same kind of shape again, the cached terminal shapes are copied and placed by the model matrix of the new shape.
+ * The attributes do not change during a derivation, so the cache is kept only for one derivation.
+ *
+ * Only Rectangle and Cuboid are cached because they are completely defined by their scope, and nothing is cached
+ * if the grammar translates a shape in the world coordinates, which makes the subtree depend on the position.
+ * The terminal shapes are sorted by the length of their path from the start shape and then the path itself,
+ * which is the breadth-first order of CGA::derive(), so the result is the same as CGA::derive(), including the order of the terminal shapes,
+ * up to the rounding of the scope in the key: the shapes whose scopes differ by less than SCOPE_QUANTUM share the subtree of the first one.
+ */
+class MemoizedDerivation {
+private:
+	struct Terminal {
+		std::vector<int> path;
+		boost::shared_ptr<Shape> shape;
+	};
+
+	struct Entry {
+		/** the terminal shapes in the local coordinates of the shape, and their path from the shape */
+		std::vector<Terminal> terminals;
+		/** the number of the shapes derived in the subtree */
+		int num_shapes;
+		/** the depth of the deepest shape in the subtree from the shape */
+		int depth;
+	};
+
+	/** the subtrees that have more terminal shapes than this are not cached to limit the memory */
+	static const int MAX_ENTRY_TERMINALS = 256;
+	/** the unit to which the scope is rounded before it is compared */
+	static const float SCOPE_QUANTUM;
+
+	const Grammar& grammar;
+	DerivationBudget budget;
+	bool suppressWarning;
+	bool memoizable;
+	std::map<std::string, Entry> cache;
+	std::vector<Terminal> terminals;
+	int num_shapes;
+	int num_hits;
+	int num_misses;
+	QElapsedTimer timer;
+
+public:
+	MemoizedDerivation(const Grammar& grammar, const DerivationBudget& budget, bool suppressWarning);
+
+	void derive(std::list<boost::shared_ptr<Shape> >& stack, std::vector<boost::shared_ptr<Shape> >& shapes);
+	/** the number of the subtrees copied from the cache, and the number of the cacheable subtrees that were derived */
+	int numHits() const { return num_hits; }
+	int numMisses() const { return num_misses; }
+
+private:
+	int deriveShape(const boost::shared_ptr<Shape>& shape, std::vector<int>& path);
+	void instantiate(const Entry& entry, const boost::shared_ptr<Shape>& shape, const std::vector<int>& path);
+	void countShapes(const std::string& rule_name, int count);
+	bool makeKey(const boost::shared_ptr<Shape>& shape, std::string& key) const;
+	static bool isTransformInvariant(const Grammar& grammar);
+	static bool compareTerminals(const Terminal& t1, const Terminal& t2);
+};
+
+}
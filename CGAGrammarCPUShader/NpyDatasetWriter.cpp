@@ -0,0 +1,136 @@
+#include "NpyDatasetWriter.h"
+#include "ImagePipeline.h"
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+
+NpyDatasetWriter::NpyDatasetWriter() {
+	this->image_width = 0;
+	this->image_height = 0;
+	this->num_params = -1;
+	this->num_samples = 0;
+}
+
+NpyDatasetWriter::~NpyDatasetWriter() {
+	close();
+}
+
+bool NpyDatasetWriter::open(const QString& output_dir, int image_width, int image_height) {
+	this->image_width = image_width;
+	this->image_height = image_height;
+	this->num_params = -1;
+	this->num_samples = 0;
+
+	image_file.setFileName(output_dir + "/images.npy");
+	param_file.setFileName(output_dir + "/params.npy");
+	camera_file.setFileName(output_dir + "/cameras.npy");
+	if (!image_file.open(QIODevice::WriteOnly) || !param_file.open(QIODevice::WriteOnly) || !camera_file.open(QIODevice::WriteOnly)) {
+		std::cerr << "Cannot open file for writing: " << qPrintable(output_dir) << std::endl;
+		image_file.close();
+		param_file.close();
+		camera_file.close();
+		return false;
+	}
+
+	// the headers are written again with the actual number of samples when the files are closed
+	image_file.write(QByteArray(HEADER_SIZE, ' '));
+	param_file.write(QByteArray(HEADER_SIZE, ' '));
+	camera_file.write(QByteArray(HEADER_SIZE, ' '));
+
+	return true;
+}
+
+void NpyDatasetWriter::encode(ImageSample* sample) const {
+	sample->encoded_images.resize(sample->images.size());
+	for (int i = 0; i < sample->images.size(); ++i) {
+		sample->encoded_images[i] = encodeGrayscale(sample->images[i]);
+	}
+}
+
+/**
+ * Append the images, the parameter values, and the cameras of the sample.
+ * All the samples have to have the same number of parameter values as the first one.
+ */
+void NpyDatasetWriter::write(ImageSample* sample) {
+	if (num_params < 0) {
+		num_params = sample->param_values.size();
+	}
+
+	if (sample->param_values.size() != num_params) {
+		std::cerr << "The number of parameter values of the sample " << sample->index << " is " << sample->param_values.size() << ", but " << num_params << " is expected." << std::endl;
+		sample->param_values.resize(num_params, 0.0f);
+	}
+
+	for (int i = 0; i < sample->encoded_images.size(); ++i) {
+		float camera_values[NUM_CAMERA_VALUES];
+		cameraValues(sample->cameras[i], camera_values);
+
+		image_file.write(sample->encoded_images[i]);
+		if (num_params > 0) {
+			param_file.write((const char*)&sample->param_values[0], num_params * sizeof(float));
+		}
+		camera_file.write((const char*)camera_values, NUM_CAMERA_VALUES * sizeof(float));
+
+		num_samples++;
+	}
+}
+
+void NpyDatasetWriter::close() {
+	if (image_file.isOpen()) {
+		std::vector<int> shape(3);
+		shape[0] = num_samples;
+		shape[1] = image_height;
+		shape[2] = image_width;
+		writeHeader(image_file, "|u1", shape);
+		image_file.close();
+	}
+
+	if (param_file.isOpen()) {
+		std::vector<int> shape(2);
+		shape[0] = num_samples;
+		shape[1] = std::max(0, num_params);
+		writeHeader(param_file, "<f4", shape);
+		param_file.close();
+	}
+
+	if (camera_file.isOpen()) {
+		std::vector<int> shape(2);
+		shape[0] = num_samples;
+		shape[1] = NUM_CAMERA_VALUES;
+		writeHeader(camera_file, "<f4", shape);
+		camera_file.close();
+	}
+}
+
+/**
+ * Write the header of the .npy format (version 1.0) at the beginning of the file.
+ * The header is padded to HEADER_SIZE bytes so that it can be overwritten without moving the data.
+ *
+ * @param descr		the data type (e.g. "|u1" for uint8, "<f4" for little endian float32)
+ * @param shape		the shape of the array
+ * @return			false if the header does not fit in HEADER_SIZE bytes
+ */
+bool NpyDatasetWriter::writeHeader(QFile& file, const std::string& descr, const std::vector<int>& shape) {
+	std::stringstream ss;
+	ss << "{'descr': '" << descr << "', 'fortran_order': False, 'shape': (";
+	for (int i = 0; i < shape.size(); ++i) {
+		if (i > 0) ss << ", ";
+		ss << shape[i];
+	}
+	if (shape.size() == 1) ss << ",";
+	ss << "), }";
+
+	std::string dict = ss.str();
+	if (dict.size() + 11 > HEADER_SIZE) return false;
+	dict.resize(HEADER_SIZE - 11, ' ');
+	dict += "\n";
+
+	QByteArray header("\x93NUMPY\x01\x00", 8);
+	unsigned short header_len = dict.size();
+	header.append((char)(header_len & 0xFF));
+	header.append((char)(header_len >> 8));
+	header.append(dict.c_str(), dict.size());
+
+	file.seek(0);
+	return file.write(header) == HEADER_SIZE;
+}
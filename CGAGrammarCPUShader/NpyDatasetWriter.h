@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <QString>
+#include <QFile>
+#include "DatasetWriter.h"
+
+/**
+ * Writer of the dataset as NumPy arrays.
+ *
+ *   images.npy	N x H x W uint8 (grayscale, top row first)
+ *   params.npy	N x P float32
+ *   cameras.npy	N x NUM_CAMERA_VALUES float32
+ *
+ * The samples are appended to the files as they arrive, and N in the headers is updated when the files are closed.
+ * Therefore, the dataset is never held in the memory as a whole.
+ */
+class NpyDatasetWriter : public DatasetWriter {
+public:
+	static const int HEADER_SIZE = 128;
+
+private:
+	int image_width;
+	int image_height;
+	int num_params;
+	int num_samples;
+	QFile image_file;
+	QFile param_file;
+	QFile camera_file;
+
+public:
+	NpyDatasetWriter();
+	~NpyDatasetWriter();
+
+	bool open(const QString& output_dir, int image_width, int image_height);
+	void encode(ImageSample* sample) const;
+	void write(ImageSample* sample);
+	void close();
+
+	static bool writeHeader(QFile& file, const std::string& descr, const std::vector<int>& shape);
+};
@@ -30,15 +30,13 @@ namespace myeval {
     namespace qi = boost::spirit::qi;
     namespace ascii = boost::spirit::ascii;
 
-	static qi::symbols<char, float> variables;
-
     ///////////////////////////////////////////////////////////////////////////
     //  Our calculator grammar
     ///////////////////////////////////////////////////////////////////////////
     template <typename Iterator>
     struct calculator : qi::grammar<Iterator, float(), ascii::space_type>
     {
-        calculator() : calculator::base_type(expression)
+        calculator(qi::symbols<char, float>& variables) : calculator::base_type(expression)
         {
             using qi::_val;
             using qi::_1;
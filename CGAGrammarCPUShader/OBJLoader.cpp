@@ -2,10 +2,118 @@
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <cmath>
 #include <QString>
 #include <QTextStream>
 #include <QStringList>
 #include <QFile>
+#include <QElapsedTimer>
+
+namespace {
+
+const double POW10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18 };
+
+inline bool isSpace(char c) {
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline bool isDigit(char c) {
+	return c >= '0' && c <= '9';
+}
+
+inline void skipSpaces(const char*& p, const char* end) {
+	while (p < end && isSpace(*p)) ++p;
+}
+
+inline void skipLine(const char*& p, const char* end) {
+	while (p < end && *p != '\n') ++p;
+	if (p < end) ++p;
+}
+
+/**
+ * Parse a decimal number such as "-1.25e-3" in place, and advance the pointer after it.
+ * Return false if there is no number at the pointer.
+ */
+bool parseFloat(const char*& p, const char* end, float& val) {
+	const char* s = p;
+	bool negative = false;
+	if (s < end && (*s == '-' || *s == '+')) {
+		negative = *s == '-';
+		++s;
+	}
+
+	double mantissa = 0.0;
+	int exponent = 0;
+	int num_digits = 0;
+	for (; s < end && isDigit(*s); ++s, ++num_digits) {
+		mantissa = mantissa * 10.0 + (*s - '0');
+	}
+	if (s < end && *s == '.') {
+		for (++s; s < end && isDigit(*s); ++s, ++num_digits) {
+			mantissa = mantissa * 10.0 + (*s - '0');
+			exponent--;
+		}
+	}
+	if (num_digits == 0) return false;
+
+	if (s < end && (*s == 'e' || *s == 'E')) {
+		const char* e = s + 1;
+		bool negative_exponent = false;
+		if (e < end && (*e == '-' || *e == '+')) {
+			negative_exponent = *e == '-';
+			++e;
+		}
+		if (e < end && isDigit(*e)) {
+			int exp = 0;
+			for (; e < end && isDigit(*e); ++e) {
+				exp = exp * 10 + (*e - '0');
+			}
+			exponent += negative_exponent ? -exp : exp;
+			s = e;
+		}
+	}
+
+	if (exponent < 0) {
+		mantissa /= -exponent <= 18 ? POW10[-exponent] : pow(10.0, -exponent);
+	} else if (exponent > 0) {
+		mantissa *= exponent <= 18 ? POW10[exponent] : pow(10.0, exponent);
+	}
+
+	val = (float)(negative ? -mantissa : mantissa);
+	p = s;
+	return true;
+}
+
+/**
+ * Parse an integer in place, and advance the pointer after it.
+ */
+bool parseInt(const char*& p, const char* end, int& val) {
+	const char* s = p;
+	bool negative = false;
+	if (s < end && (*s == '-' || *s == '+')) {
+		negative = *s == '-';
+		++s;
+	}
+	if (s >= end || !isDigit(*s)) return false;
+
+	int v = 0;
+	for (; s < end && isDigit(*s); ++s) {
+		v = v * 10 + (*s - '0');
+	}
+
+	val = negative ? -v : v;
+	p = s;
+	return true;
+}
+
+/**
+ * Convert an OBJ index, which is 1-based or negative for the relative index from the end, to a 0-based index.
+ */
+inline int resolveIndex(int index, int num) {
+	return index < 0 ? num + index : index - 1;
+}
+
+}
 
 /**
  * Load vertices data from a OBJ file.
@@ -245,3 +353,192 @@ bool OBJLoader::load(const char* filename, std::vector<std::vector<glm::vec3> >&
 
 	return true;
 }
+
+/**
+ * Load the faces from a OBJ file into flat arrays.
+ * The file is memory-mapped and parsed in place, so no string is allocated for each line.
+ * The vertices of the face i are in [offsets[i], offsets[i + 1]), and texCoords is left empty if the file does not define them.
+ */
+bool OBJLoader::loadMapped(const char* filename, std::vector<glm::vec3>& points, std::vector<glm::vec3>& normals, std::vector<glm::vec2>& texCoords, std::vector<int>& offsets) {
+	QFile file(filename);
+	if (!file.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+
+	points.clear();
+	normals.clear();
+	texCoords.clear();
+	offsets.assign(1, 0);
+	if (file.size() == 0) return true;
+
+	const char* data = (const char*)file.map(0, file.size());
+	if (data == NULL) {
+		return false;
+	}
+	const char* p = data;
+	const char* end = data + file.size();
+
+	std::vector<glm::vec3> raw_vertices;
+	std::vector<glm::vec3> raw_normals;
+	std::vector<glm::vec2> raw_texCoords;
+
+	// indices of all the face vertices (-1 if not specified)
+	std::vector<int> v_elements;
+	std::vector<int> t_elements;
+	std::vector<int> n_elements;
+
+	while (p < end) {
+		skipSpaces(p, end);
+		if (p + 1 < end && p[0] == 'v' && isSpace(p[1])) {
+			p += 2;
+			glm::vec3 v;
+			for (int i = 0; i < 3; ++i) {
+				skipSpaces(p, end);
+				if (!parseFloat(p, end, v[i])) v[i] = 0.0f;
+			}
+			raw_vertices.push_back(v);
+		} else if (p + 2 < end && p[0] == 'v' && p[1] == 'n' && isSpace(p[2])) {
+			p += 3;
+			glm::vec3 n;
+			for (int i = 0; i < 3; ++i) {
+				skipSpaces(p, end);
+				if (!parseFloat(p, end, n[i])) n[i] = 0.0f;
+			}
+			raw_normals.push_back(n);
+		} else if (p + 2 < end && p[0] == 'v' && p[1] == 't' && isSpace(p[2])) {
+			p += 3;
+			glm::vec2 t;
+			for (int i = 0; i < 2; ++i) {
+				skipSpaces(p, end);
+				if (!parseFloat(p, end, t[i])) t[i] = 0.0f;
+			}
+			raw_texCoords.push_back(t);
+		} else if (p + 1 < end && p[0] == 'f' && isSpace(p[1])) {
+			p += 2;
+			int num = 0;
+			while (true) {
+				skipSpaces(p, end);
+				int v, t = 0, n = 0;
+				if (!parseInt(p, end, v)) break;
+				if (p < end && *p == '/') {
+					++p;
+					parseInt(p, end, t);
+					if (p < end && *p == '/') {
+						++p;
+						parseInt(p, end, n);
+					}
+				}
+
+				v_elements.push_back(resolveIndex(v, raw_vertices.size()));
+				t_elements.push_back(t != 0 ? resolveIndex(t, raw_texCoords.size()) : -1);
+				n_elements.push_back(n != 0 ? resolveIndex(n, raw_normals.size()) : -1);
+				num++;
+			}
+
+			if (num >= 3) {
+				offsets.push_back(v_elements.size());
+			} else {
+				v_elements.resize(v_elements.size() - num);
+				t_elements.resize(t_elements.size() - num);
+				n_elements.resize(n_elements.size() - num);
+			}
+		}
+
+		/* ignore the rest of the line, comment line, and other lines */
+		skipLine(p, end);
+	}
+
+	bool hasTexCoords = false;
+	for (int i = 0; i < t_elements.size(); ++i) {
+		if (t_elements[i] >= 0) {
+			hasTexCoords = true;
+			break;
+		}
+	}
+
+	points.resize(v_elements.size());
+	normals.resize(v_elements.size());
+	if (hasTexCoords) {
+		texCoords.resize(v_elements.size(), glm::vec2(0, 0));
+	}
+	for (int i = 0; i + 1 < offsets.size(); ++i) {
+		int begin = offsets[i];
+		int num = offsets[i + 1] - begin;
+		for (int j = begin; j < begin + num; ++j) {
+			if (v_elements[j] < 0 || v_elements[j] >= raw_vertices.size()) return false;
+			points[j] = raw_vertices[v_elements[j]];
+		}
+
+		bool hasNormals = true;
+		for (int j = begin; j < begin + num; ++j) {
+			if (n_elements[j] < 0 || n_elements[j] >= raw_normals.size()) {
+				hasNormals = false;
+				break;
+			}
+		}
+		if (hasNormals) {
+			for (int j = begin; j < begin + num; ++j) {
+				normals[j] = raw_normals[n_elements[j]];
+			}
+		} else {
+			glm::vec3 normal = glm::normalize(glm::cross(points[begin + 1] - points[begin], points[begin + 2] - points[begin]));
+			for (int j = begin; j < begin + num; ++j) {
+				normals[j] = normal;
+			}
+		}
+
+		if (hasTexCoords) {
+			for (int j = begin; j < begin + num; ++j) {
+				if (t_elements[j] >= 0 && t_elements[j] < raw_texCoords.size()) {
+					texCoords[j] = raw_texCoords[t_elements[j]];
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Compare the loading time of the QTextStream based loader and the memory-mapped loader, and print the result.
+ */
+void OBJLoader::benchmark(const char* filename, int num_repeats) {
+	QElapsedTimer timer;
+	int num_faces = 0;
+
+	timer.start();
+	for (int i = 0; i < num_repeats; ++i) {
+		std::vector<std::vector<glm::vec3> > points;
+		std::vector<std::vector<glm::vec3> > normals;
+		std::vector<std::vector<glm::vec2> > texCoords;
+		if (!load(filename, points, normals, texCoords)) {
+			std::cerr << "OBJ file cannot be read: " << filename << std::endl;
+			return;
+		}
+		num_faces = points.size();
+	}
+	qint64 text_time = timer.elapsed();
+
+	int num_mapped_faces = 0;
+	timer.restart();
+	for (int i = 0; i < num_repeats; ++i) {
+		std::vector<glm::vec3> points;
+		std::vector<glm::vec3> normals;
+		std::vector<glm::vec2> texCoords;
+		std::vector<int> offsets;
+		if (!loadMapped(filename, points, normals, texCoords, offsets)) {
+			std::cerr << "OBJ file cannot be read: " << filename << std::endl;
+			return;
+		}
+		num_mapped_faces = offsets.size() - 1;
+	}
+	qint64 mapped_time = timer.elapsed();
+
+	std::cout << filename << ": " << num_faces << " faces (" << num_mapped_faces << " by the mapped loader), " << num_repeats << " runs" << std::endl;
+	std::cout << "  QTextStream: " << (double)text_time / num_repeats << " ms/file" << std::endl;
+	std::cout << "  mapped: " << (double)mapped_time / num_repeats << " ms/file";
+	if (mapped_time > 0) {
+		std::cout << " (x" << (double)text_time / mapped_time << ")";
+	}
+	std::cout << std::endl;
+}
@@ -1,6 +1,7 @@
 #include "OffsetOperator.h"
 #include "CGA.h"
 #include "Shape.h"
+#include "BatchDerivation.h"
 
 namespace cga {
 
@@ -16,4 +17,41 @@ boost::shared_ptr<Shape> OffsetOperator::apply(boost::shared_ptr<Shape>& shape,
 	return shape->offset(shape->_name, actual_offsetDistancet, offsetSelector);
 }
 
+/**
+ * Offset the shapes of multiple samples.
+ * The distance is evaluated for all the samples at once, and then each shape is offset in the same way as apply().
+ */
+void OffsetOperator::applyBatch(std::vector<boost::shared_ptr<Shape> >& shapes, const std::vector<int>& samples, BatchEvaluator& evaluator, std::vector<std::list<boost::shared_ptr<Shape> > >& stacks, std::vector<std::exception_ptr>& errors) {
+	std::vector<float> distances;
+	try {
+		evaluator.evalFloat(offsetDistance, samples, shapes, distances);
+	} catch (...) {
+		// the shapes are offset one by one so that only the samples with the error fail
+		Operator::applyBatch(shapes, samples, evaluator, stacks, errors);
+		return;
+	}
+
+	for (int k = 0; k < shapes.size(); ++k) {
+		try {
+			shapes[k] = shapes[k]->offset(shapes[k]->_name, distances[k], offsetSelector);
+		} catch (...) {
+			shapes[k] = boost::shared_ptr<Shape>();
+			stacks[k].clear();
+			errors[k] = std::current_exception();
+		}
+	}
+}
+
+void OffsetOperator::toNode(GrammarNode& node) const {
+	node.tagName = "offset";
+	node.setAttribute("offsetDistance", offsetDistance);
+	if (offsetSelector == SELECTOR_ALL) {
+		node.setAttribute("offsetSelector", "all");
+	} else if (offsetSelector == SELECTOR_INSIDE) {
+		node.setAttribute("offsetSelector", "inside");
+	} else {
+		node.setAttribute("offsetSelector", "border");
+	}
+}
+
 }
@@ -7,10 +7,9 @@
 
 namespace cga {
 
-OffsetPolygon::OffsetPolygon(const std::string& name, const glm::mat4& pivot, const glm::mat4& modelMat, const std::vector<glm::vec2>& points, float offsetDistance, const glm::vec3& color, const std::string& texture) {
+OffsetPolygon::OffsetPolygon(const std::string& name, const AffineTransform& modelMat, const std::vector<glm::vec2>& points, float offsetDistance, const glm::vec3& color, const std::string& texture) {
 	this->_name = name;
 	this->_removed = false;
-	this->_pivot = pivot;
 	this->_modelMat = modelMat;
 	this->_points = points;
 	this->_offsetDistance = offsetDistance;
@@ -45,8 +44,8 @@ void OffsetPolygon::comp(const std::map<std::string, std::string>& name_map, std
 			pts[i] -= t;
 		}
 
-		glm::mat4 mat = glm::translate(_modelMat, glm::vec3(t, 0));
-		shapes.push_back(boost::shared_ptr<Shape>(new Polygon(name_map.at("inside"), _pivot, mat, pts, _color, _texture)));
+		AffineTransform mat = glm::translate(_modelMat, glm::vec3(t, 0));
+		shapes.push_back(boost::shared_ptr<Shape>(new Polygon(name_map.at("inside"), mat, pts, _color, _texture)));
 	}
 
 	// border face
@@ -70,19 +69,21 @@ void OffsetPolygon::comp(const std::map<std::string, std::string>& name_map, std
 			normals.push_back(glm::vec3(0, 0, 1));
 		}
 		
-		shapes.push_back(boost::shared_ptr<Shape>(new GeneralObject(name_map.at("border"), _pivot, _modelMat, pts, normals, _color)));
+		shapes.push_back(boost::shared_ptr<Shape>(new GeneralObject(name_map.at("border"), _modelMat, pts, normals, _color)));
 	}
 }
 
-void OffsetPolygon::generateGeometry(float opacity, std::vector<std::vector<Vertex> >& vertices) const {
+void OffsetPolygon::generateGeometry(const AffineTransform& pivot, float opacity, std::vector<std::vector<Vertex> >& vertices) const {
 	if (_removed) return;
 
+	AffineTransform worldMat = pivot * _modelMat;
+
 	std::vector<glm::vec2> offset_points;
 	glutils::offsetPolygon(_points, _offsetDistance, offset_points);
 
 	int offset = vertices.size();
 	vertices.resize(offset + 1);
-	glutils::drawPolygon(offset_points, glm::vec4(_color, opacity), _pivot * _modelMat, vertices[offset]);
+	glutils::drawPolygon(offset_points, glm::vec4(_color, opacity), worldMat, vertices[offset]);
 
 	offset++;
 	vertices.resize(offset + _points.size());
@@ -92,7 +93,7 @@ void OffsetPolygon::generateGeometry(float opacity, std::vector<std::vector<Vert
 		pts[1] = _points[i];
 		pts[2] = _points[(i+1) % _points.size()];
 		pts[3] = offset_points[(i+1) % offset_points.size()];
-		glutils::drawPolygon(pts, glm::vec4(_color, opacity), _pivot * _modelMat, vertices[i]);
+		glutils::drawPolygon(pts, glm::vec4(_color, opacity), worldMat, vertices[i]);
 	}
 }
 
@@ -7,10 +7,9 @@
 
 namespace cga {
 
-OffsetRectangle::OffsetRectangle(const std::string& name, const glm::mat4& pivot, const glm::mat4& modelMat, float width, float height, float offsetDistance, const glm::vec3& color, const std::string& texture) {
+OffsetRectangle::OffsetRectangle(const std::string& name, const AffineTransform& modelMat, float width, float height, float offsetDistance, const glm::vec3& color, const std::string& texture) {
 	this->_name = name;
 	this->_removed = false;
-	this->_pivot = pivot;
 	this->_modelMat = modelMat;
 	this->_scope.x = width; 
 	this->_scope.y = height;
@@ -28,8 +27,8 @@ boost::shared_ptr<Shape> OffsetRectangle::clone(const std::string& name) const {
 void OffsetRectangle::comp(const std::map<std::string, std::string>& name_map, std::vector<boost::shared_ptr<Shape> >& shapes) {
 	// inside face
 	if (name_map.find("inside") != name_map.end() && name_map.at("inside") != "NIL") {
-		glm::mat4 mat = glm::translate(_modelMat, glm::vec3(-_offsetDistance, -_offsetDistance, 0));
-		shapes.push_back(boost::shared_ptr<Shape>(new Rectangle(name_map.at("inside"), _pivot, mat, _scope.x + _offsetDistance * 2.0f, _scope.y + _offsetDistance * 2.0f, _color)));
+		AffineTransform mat = glm::translate(_modelMat, glm::vec3(-_offsetDistance, -_offsetDistance, 0));
+		shapes.push_back(boost::shared_ptr<Shape>(new Rectangle(name_map.at("inside"), mat, _scope.x + _offsetDistance * 2.0f, _scope.y + _offsetDistance * 2.0f, _color)));
 	}
 
 	// border face
@@ -69,16 +68,18 @@ void OffsetRectangle::comp(const std::map<std::string, std::string>& name_map, s
 			normals.push_back(ns);
 		}
 		
-		shapes.push_back(boost::shared_ptr<Shape>(new GeneralObject(name_map.at("border"), _pivot, _modelMat, points, normals, _color)));
+		shapes.push_back(boost::shared_ptr<Shape>(new GeneralObject(name_map.at("border"), _modelMat, points, normals, _color)));
 	}
 }
 
-void OffsetRectangle::generateGeometry(float opacity, std::vector<std::vector<Vertex> >& vertices) const {
+void OffsetRectangle::generateGeometry(const AffineTransform& pivot, float opacity, std::vector<std::vector<Vertex> >& vertices) const {
 	if (_removed) return;
 
+	AffineTransform worldMat = pivot * _modelMat;
+
 	int offset = vertices.size();
 	vertices.resize(offset + 1);
-	glm::mat4 mat = glm::translate(_pivot * _modelMat, glm::vec3(_scope.x * 0.5f, _scope.y * 0.5f, 0.0f));
+	AffineTransform mat = glm::translate(worldMat, glm::vec3(_scope.x * 0.5f, _scope.y * 0.5f, 0.0f));
 	glutils::drawQuad(_scope.x - _offsetDistance * 2.0f, _scope.y  - _offsetDistance * 2.0f, glm::vec4(_color, opacity), mat, vertices[offset]);
 
 	std::vector<glm::vec3> pts(4);
@@ -93,12 +94,12 @@ void OffsetRectangle::generateGeometry(float opacity, std::vector<std::vector<Ve
 	pts2[3] = glm::vec3(_offsetDistance, _scope.y - _offsetDistance, 0);
 
 	for (int i = 0; i < 4; ++i) {
-		pts[i] = glm::vec3(_pivot * _modelMat * glm::vec4(pts[i], 1));
-		pts2[i] = glm::vec3(_pivot * _modelMat * glm::vec4(pts2[i], 1));
+		pts[i] = glm::vec3(worldMat * glm::vec4(pts[i], 1));
+		pts2[i] = glm::vec3(worldMat * glm::vec4(pts2[i], 1));
 	}
 
 	glm::vec3 normal(0, 0, 1);
-	normal = glm::vec3(_pivot * _modelMat * glm::vec4(normal, 1));
+	normal = glm::vec3(worldMat * glm::vec4(normal, 1));
 
 	offset++;
 	vertices.resize(offset + pts.size());
@@ -18,10 +18,10 @@ private:
 
 public:
 	OffsetRectangle() {}
-	OffsetRectangle(const std::string& name, const glm::mat4& pivot, const glm::mat4& modelMat, float width, float height, float offsetDistance, const glm::vec3& color, const std::string& texture);
+	OffsetRectangle(const std::string& name, const AffineTransform& modelMat, float width, float height, float offsetDistance, const glm::vec3& color, const std::string& texture);
 	boost::shared_ptr<Shape> clone(const std::string& name) const;
 	void comp(const std::map<std::string, std::string>& name_map, std::vector<boost::shared_ptr<Shape> >& shapes);
-	void generateGeometry(float opacity, std::vector<std::vector<Vertex> >& vertices) const;
+	void generateGeometry(const AffineTransform& pivot, float opacity, std::vector<std::vector<Vertex> >& vertices) const;
 };
 
 }
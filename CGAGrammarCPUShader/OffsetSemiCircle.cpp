@@ -5,10 +5,9 @@
 
 namespace cga {
 
-OffsetSemiCircle::OffsetSemiCircle(const std::string& name, const glm::mat4& pivot, const glm::mat4& modelMat, float width, float height, float offsetDistance, const glm::vec3& color) {
+OffsetSemiCircle::OffsetSemiCircle(const std::string& name, const AffineTransform& modelMat, float width, float height, float offsetDistance, const glm::vec3& color) {
 	this->_name = name;
 	this->_removed = false;
-	this->_pivot = pivot;
 	this->_modelMat = modelMat;
 	this->_scope = glm::vec3(width, height, 0);
 	this->_offsetDistance = offsetDistance;
@@ -24,8 +23,8 @@ boost::shared_ptr<Shape> OffsetSemiCircle::clone(const std::string& name) const
 void OffsetSemiCircle::comp(const std::map<std::string, std::string>& name_map, std::vector<boost::shared_ptr<Shape> >& shapes) {
 	// inside face
 	if (name_map.find("inside") != name_map.end() && name_map.at("inside") != "NIL") {
-		glm::mat4 mat = glm::translate(_modelMat, glm::vec3(-_offsetDistance, 0, 0));
-		shapes.push_back(boost::shared_ptr<Shape>(new SemiCircle(name_map.at("inside"), _pivot, mat, _scope.x + _offsetDistance * 2.0f, _scope.y + _offsetDistance, _color)));
+		AffineTransform mat = glm::translate(_modelMat, glm::vec3(-_offsetDistance, 0, 0));
+		shapes.push_back(boost::shared_ptr<Shape>(new SemiCircle(name_map.at("inside"), mat, _scope.x + _offsetDistance * 2.0f, _scope.y + _offsetDistance, _color)));
 	}
 
 	// border face
@@ -49,7 +48,7 @@ void OffsetSemiCircle::comp(const std::map<std::string, std::string>& name_map,
 			points.push_back(glm::vec2(_scope.x * 0.5f + rx * cosf(theta), ry * sinf(theta)));
 		}
 		
-		shapes.push_back(boost::shared_ptr<Shape>(new Polygon(name_map.at("border"), _pivot, _modelMat, points, _color, _texture)));
+		shapes.push_back(boost::shared_ptr<Shape>(new Polygon(name_map.at("border"), _modelMat, points, _color, _texture)));
 	}
 }
 
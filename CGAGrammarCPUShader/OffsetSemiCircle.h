@@ -16,7 +16,7 @@ public:
 
 public:
 	OffsetSemiCircle() {}
-	OffsetSemiCircle(const std::string& name, const glm::mat4& pivot, const glm::mat4& modelMat, float width, float height, float offsetDistance, const glm::vec3& color);
+	OffsetSemiCircle(const std::string& name, const AffineTransform& modelMat, float width, float height, float offsetDistance, const glm::vec3& color);
 	boost::shared_ptr<Shape> clone(const std::string& name) const;
 	void comp(const std::map<std::string, std::string>& name_map, std::vector<boost::shared_ptr<Shape> >& shapes);
 };
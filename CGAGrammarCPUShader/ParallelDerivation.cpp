@@ -0,0 +1,263 @@
+#include "ParallelDerivation.h"
+#include "DerivationProfiler.h"
+#include <algorithm>
+#include <iostream>
+
+namespace cga {
+
+ParallelDerivation::ParallelDerivation(const Grammar& grammar, const DerivationBudget& budget, int num_threads, bool suppressWarning) :
+	grammar(grammar), budget(budget), suppressWarning(suppressWarning), record_tree(false), num_pending(0), num_shapes(0), aborted(false), error_type(ERROR_NONE), error_cstr(NULL) {
+	for (int i = 0; i < std::max(1, num_threads); ++i) {
+		workers.push_back(boost::shared_ptr<Worker>(new Worker()));
+		workers.back()->num_shapes = 0;
+	}
+}
+
+/**
+ * Derive all the shapes in the stack, and put the terminal shapes to shapes in the same order as CGA::derive().
+ * The calling thread works as one of the workers.
+ */
+void ParallelDerivation::derive(std::list<boost::shared_ptr<Shape> >& stack, std::vector<boost::shared_ptr<Shape> >& shapes) {
+	shapes.clear();
+	record_tree = false;
+	execute(stack);
+
+	// merge the terminal shapes of all the workers in the serial order
+	std::vector<Task> terminals;
+	for (int i = 0; i < workers.size(); ++i) {
+		terminals.insert(terminals.end(), workers[i]->terminals.begin(), workers[i]->terminals.end());
+		std::vector<Task>().swap(workers[i]->terminals);
+	}
+	std::sort(terminals.begin(), terminals.end(), compareTerminals);
+
+	shapes.resize(terminals.size());
+	for (int i = 0; i < terminals.size(); ++i) {
+		shapes[i] = terminals[i].shape;
+	}
+}
+
+/**
+ * Derive all the shapes in the stack, and put all the nodes of the derivation tree to nodes in the breadth-first order,
+ * so the terminal shapes are in the same order as CGA::derive(), and the children of each node follow the children of the previous nodes.
+ * The calling thread works as one of the workers.
+ */
+void ParallelDerivation::derive(std::list<boost::shared_ptr<Shape> >& stack, std::vector<TreeNode>& nodes) {
+	nodes.clear();
+	record_tree = true;
+	execute(stack);
+
+	for (int i = 0; i < workers.size(); ++i) {
+		nodes.insert(nodes.end(), workers[i]->nodes.begin(), workers[i]->nodes.end());
+		std::vector<TreeNode>().swap(workers[i]->nodes);
+		std::vector<Task>().swap(workers[i]->terminals);
+	}
+	std::sort(nodes.begin(), nodes.end(), compareNodes);
+}
+
+/**
+ * Derive all the shapes in the stack on all the workers, and throw the first error of the workers.
+ */
+void ParallelDerivation::execute(std::list<boost::shared_ptr<Shape> >& stack) {
+	timer.start();
+
+	int index = 0;
+	for (auto it = stack.begin(); it != stack.end(); ++it, ++index) {
+		Task task;
+		task.shape = *it;
+		task.path.push_back(index);
+		workers[0]->tasks.push_back(task);
+	}
+	num_pending = stack.size();
+	stack.clear();
+
+	boost::thread_group threads;
+	for (int i = 1; i < workers.size(); ++i) {
+		threads.create_thread(boost::bind(&ParallelDerivation::run, this, i));
+	}
+	run(0);
+	threads.join_all();
+
+	if (error_type == ERROR_BUDGET) {
+		throw *budget_error;
+	} else if (error_type == ERROR_STRING) {
+		throw error_string;
+	} else if (error_type == ERROR_CSTR) {
+		throw error_cstr;
+	}
+}
+
+/**
+ * Process the tasks until all the shapes are derived or an error occurs.
+ */
+void ParallelDerivation::run(int worker_id) {
+	DerivationBudgetScope budget_scope(budget);
+	Task task;
+	while (!aborted) {
+		if (pop(worker_id, task) || steal(worker_id, task)) {
+			try {
+				process(worker_id, task);
+			} catch (const BudgetExceededError& ex) {
+				abort(ex);
+			} catch (const std::string& ex) {
+				abort(ex);
+			} catch (const char* ex) {
+				abort(ex);
+			}
+			task.shape.reset();
+
+			// the children have been pushed before this, so the count never reaches 0 while some tasks remain
+			num_pending--;
+		} else if (num_pending == 0) {
+			break;
+		} else {
+			boost::this_thread::yield();
+		}
+	}
+}
+
+/**
+ * Apply the rule to the shape, and push the generated shapes as new tasks.
+ * The shape without a rule is a terminal shape.
+ */
+void ParallelDerivation::process(int worker_id, Task& task) {
+	Worker& worker = *workers[worker_id];
+	boost::shared_ptr<Shape>& shape = task.shape;
+
+	int count = ++num_shapes;
+	if (budget.max_shapes > 0 && count > budget.max_shapes) {
+		throw BudgetExceededError(BudgetExceededError::BUDGET_SHAPES, budget.max_shapes, shape->_name, count, (int)timer.elapsed());
+	}
+	// checking the clock for every shape is not necessary
+	if (budget.max_msec > 0 && ++worker.num_shapes % 256 == 0 && timer.elapsed() > budget.max_msec) {
+		throw BudgetExceededError(BudgetExceededError::BUDGET_TIME, budget.max_msec, shape->_name, count, (int)timer.elapsed());
+	}
+
+	if (!grammar.contain(shape->_name)) {
+		if (!suppressWarning && shape->_name.back() != '!' && shape->_name.back() != '.') {
+			std::cout << "Warning: " << "no rule is found for " << shape->_name << "." << std::endl;
+		}
+		if (record_tree) {
+			worker.nodes.push_back(TreeNode());
+			worker.nodes.back().path = task.path;
+			worker.nodes.back().terminal = shape;
+			worker.nodes.back().num_children = 0;
+		} else {
+			worker.terminals.push_back(task);
+		}
+		return;
+	}
+
+	// the rule changes the shape, so the tree keeps its copy
+	if (record_tree) {
+		worker.nodes.push_back(TreeNode());
+		worker.nodes.back().path = task.path;
+		worker.nodes.back().input = shape->clone(shape->_name);
+		worker.nodes.back().num_children = 0;
+	}
+
+	std::string rule_name = shape->_name;
+	int depth = shape->_depth + 1;
+	std::list<boost::shared_ptr<Shape> > children;
+	try {
+		CGA_PROFILE_RULE(rule_name, children);
+		grammar.getRule(rule_name).apply(shape, grammar, children);
+	} catch (const BudgetExceededError& ex) {
+		// the operator does not know the rule and the number of the shapes
+		throw BudgetExceededError(ex.type, ex.limit, rule_name, count, (int)timer.elapsed());
+	}
+	if (children.empty()) return;
+
+	if (record_tree) {
+		worker.nodes.back().num_children = children.size();
+	}
+
+	if (budget.max_depth > 0 && depth > budget.max_depth) {
+		throw BudgetExceededError(BudgetExceededError::BUDGET_DEPTH, budget.max_depth, rule_name, count, (int)timer.elapsed());
+	}
+
+	num_pending += (int)children.size();
+
+	boost::mutex::scoped_lock lock(worker.mutex);
+	int index = 0;
+	for (auto it = children.begin(); it != children.end(); ++it, ++index) {
+		(*it)->_depth = depth;
+
+		worker.tasks.push_back(Task());
+		worker.tasks.back().shape = *it;
+		worker.tasks.back().path = task.path;
+		worker.tasks.back().path.push_back(index);
+	}
+}
+
+/**
+ * Take the newest task of the worker.
+ */
+bool ParallelDerivation::pop(int worker_id, Task& task) {
+	Worker& worker = *workers[worker_id];
+	boost::mutex::scoped_lock lock(worker.mutex);
+	if (worker.tasks.empty()) return false;
+
+	task.shape.swap(worker.tasks.back().shape);
+	task.path.swap(worker.tasks.back().path);
+	worker.tasks.pop_back();
+	return true;
+}
+
+/**
+ * Take the oldest task of another worker.
+ */
+bool ParallelDerivation::steal(int worker_id, Task& task) {
+	for (int i = 1; i < workers.size(); ++i) {
+		Worker& victim = *workers[(worker_id + i) % workers.size()];
+		boost::mutex::scoped_lock lock(victim.mutex);
+		if (victim.tasks.empty()) continue;
+
+		task.shape.swap(victim.tasks.front().shape);
+		task.path.swap(victim.tasks.front().path);
+		victim.tasks.pop_front();
+		return true;
+	}
+	return false;
+}
+
+void ParallelDerivation::abort(const BudgetExceededError& ex) {
+	boost::mutex::scoped_lock lock(error_mutex);
+	if (error_type == ERROR_NONE) {
+		error_type = ERROR_BUDGET;
+		budget_error = boost::shared_ptr<BudgetExceededError>(new BudgetExceededError(ex));
+	}
+	aborted = true;
+}
+
+void ParallelDerivation::abort(const std::string& ex) {
+	boost::mutex::scoped_lock lock(error_mutex);
+	if (error_type == ERROR_NONE) {
+		error_type = ERROR_STRING;
+		error_string = ex;
+	}
+	aborted = true;
+}
+
+void ParallelDerivation::abort(const char* ex) {
+	boost::mutex::scoped_lock lock(error_mutex);
+	if (error_type == ERROR_NONE) {
+		error_type = ERROR_CSTR;
+		error_cstr = ex;
+	}
+	aborted = true;
+}
+
+/**
+ * The order of the serial derivation, which is the breadth-first order of the derivation tree.
+ */
+bool ParallelDerivation::compareTerminals(const Task& t1, const Task& t2) {
+	if (t1.path.size() != t2.path.size()) return t1.path.size() < t2.path.size();
+	return t1.path < t2.path;
+}
+
+bool ParallelDerivation::compareNodes(const TreeNode& n1, const TreeNode& n2) {
+	if (n1.path.size() != n2.path.size()) return n1.path.size() < n2.path.size();
+	return n1.path < n2.path;
+}
+
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <list>
+#include <string>
+#include <boost/shared_ptr.hpp>
+#include <boost/atomic.hpp>
+#include <boost/thread.hpp>
+#include <QElapsedTimer>
+#include "CGA.h"
+
+namespace cga {
+
+/**
+ * Derivation of the grammar on multiple threads.
+ *
+ * Each shape is a task. The children that a rule appends to the stack are independent of each other,
+ * so they are pushed to the deque of the worker as new tasks. The worker takes its own tasks from the back (depth first),
+ * and an idle worker steals from the front of another worker, where the tasks near the root, i.e., large subtrees, are.
+ *
+ * The serial derivation processes the shapes in FIFO order, which is the breadth-first order of the derivation tree.
+ * Each task keeps the path of the child indices from the start shape, and the terminal shapes are sorted by
+ * the length of the path and then the path itself, so the result is exactly the same as the serial derivation.
+ * The derivation tree can be recorded in the same order for IncrementalDerivation.
+ */
+class ParallelDerivation {
+public:
+	/** node of the derivation tree */
+	struct TreeNode {
+		std::vector<int> path;
+		/** the shape before the rule is applied, or NULL for a terminal shape */
+		boost::shared_ptr<Shape> input;
+		/** the terminal shape, or NULL if a rule is applied */
+		boost::shared_ptr<Shape> terminal;
+		/** the number of the shapes generated by the rule */
+		int num_children;
+	};
+
+private:
+	struct Task {
+		boost::shared_ptr<Shape> shape;
+		std::vector<int> path;
+	};
+
+	struct Worker {
+		boost::mutex mutex;
+		std::deque<Task> tasks;
+		std::vector<Task> terminals;
+		std::vector<TreeNode> nodes;
+		int num_shapes;
+	};
+
+	enum { ERROR_NONE = 0, ERROR_BUDGET, ERROR_STRING, ERROR_CSTR };
+
+	const Grammar& grammar;
+	DerivationBudget budget;
+	bool suppressWarning;
+	bool record_tree;
+	std::vector<boost::shared_ptr<Worker> > workers;
+	boost::atomic<int> num_pending;
+	boost::atomic<int> num_shapes;
+	boost::atomic<bool> aborted;
+	QElapsedTimer timer;
+
+	/** the first error thrown by the workers, which is thrown again by the calling thread */
+	boost::mutex error_mutex;
+	int error_type;
+	boost::shared_ptr<BudgetExceededError> budget_error;
+	std::string error_string;
+	const char* error_cstr;
+
+public:
+	ParallelDerivation(const Grammar& grammar, const DerivationBudget& budget, int num_threads, bool suppressWarning);
+
+	void derive(std::list<boost::shared_ptr<Shape> >& stack, std::vector<boost::shared_ptr<Shape> >& shapes);
+	void derive(std::list<boost::shared_ptr<Shape> >& stack, std::vector<TreeNode>& nodes);
+
+private:
+	void execute(std::list<boost::shared_ptr<Shape> >& stack);
+	void run(int worker_id);
+	void process(int worker_id, Task& task);
+	bool pop(int worker_id, Task& task);
+	bool steal(int worker_id, Task& task);
+	void abort(const BudgetExceededError& ex);
+	void abort(const std::string& ex);
+	void abort(const char* ex);
+	static bool compareTerminals(const Task& t1, const Task& t2);
+	static bool compareNodes(const TreeNode& n1, const TreeNode& n2);
+};
+
+}
@@ -11,10 +11,9 @@
 
 namespace cga {
 
-Polygon::Polygon(const std::string& name, const glm::mat4& pivot, const glm::mat4& modelMat, const std::vector<glm::vec2>& points, const glm::vec3& color, const std::string& texture) {
+Polygon::Polygon(const std::string& name, const AffineTransform& modelMat, const std::vector<glm::vec2>& points, const glm::vec3& color, const std::string& texture) {
 	this->_name = name;
 	this->_removed = false;
-	this->_pivot = pivot;
 	this->_modelMat = modelMat;
 	this->_points = points;
 	this->_color = color;
@@ -37,7 +36,7 @@ boost::shared_ptr<Shape> Polygon::clone(const std::string& name) const {
 }
 
 boost::shared_ptr<Shape> Polygon::extrude(const std::string& name, float height) {
-	return boost::shared_ptr<Shape>(new Prism(name, _pivot, _modelMat, _points, height, _color));
+	return boost::shared_ptr<Shape>(new Prism(name, _modelMat, _points, height, _color));
 }
 
 boost::shared_ptr<Shape> Polygon::inscribeCircle(const std::string& name) {
@@ -46,11 +45,11 @@ boost::shared_ptr<Shape> Polygon::inscribeCircle(const std::string& name) {
 
 boost::shared_ptr<Shape> Polygon::offset(const std::string& name, float offsetDistance, int offsetSelector) {
 	if (offsetSelector == SELECTOR_ALL) {
-		return boost::shared_ptr<Shape>(new OffsetPolygon(name, _pivot, _modelMat, _points, offsetDistance, _color, _texture));
+		return boost::shared_ptr<Shape>(new OffsetPolygon(name, _modelMat, _points, offsetDistance, _color, _texture));
 	} else if (offsetSelector == SELECTOR_INSIDE) {
 		std::vector<glm::vec2> offset_points;
 		glutils::offsetPolygon(_points, offsetDistance, offset_points);
-		return boost::shared_ptr<Shape>(new Polygon(name, _pivot, _modelMat, offset_points, _color, _texture));
+		return boost::shared_ptr<Shape>(new Polygon(name, _modelMat, offset_points, _color, _texture));
 	} else {
 		std::vector<glm::vec2> offset_points;
 		glutils::offsetPolygon(_points, offsetDistance, offset_points);
@@ -74,16 +73,16 @@ boost::shared_ptr<Shape> Polygon::offset(const std::string& name, float offsetDi
 			normals.push_back(glm::vec3(0, 0, 1));
 		}
 		
-		return boost::shared_ptr<Shape>(new GeneralObject(name, _pivot, _modelMat, pts, normals, _color));
+		return boost::shared_ptr<Shape>(new GeneralObject(name, _modelMat, pts, normals, _color));
 	}
 }
 
 boost::shared_ptr<Shape> Polygon::roofHip(const std::string& name, float angle) {
-	return boost::shared_ptr<Shape>(new HipRoof(name, _pivot, _modelMat, _points, angle, _color));
+	return boost::shared_ptr<Shape>(new HipRoof(name, _modelMat, _points, angle, _color));
 }
 
 boost::shared_ptr<Shape> Polygon::roofGable(const std::string& name, float angle) {
-	return boost::shared_ptr<Shape>(new GableRoof(name, _pivot, _modelMat, _points, angle, _color));
+	return boost::shared_ptr<Shape>(new GableRoof(name, _modelMat, _points, angle, _color));
 }
 
 void Polygon::setupProjection(float texWidth, float texHeight) {
@@ -108,15 +107,17 @@ void Polygon::size(float xSize, float ySize, float zSize) {
 }
 
 boost::shared_ptr<Shape> Polygon::taper(const std::string& name, float height, float top_ratio) {
-	return boost::shared_ptr<Shape>(new Pyramid(name, _pivot, _modelMat, _points, _center, height, top_ratio, _color, _texture));
+	return boost::shared_ptr<Shape>(new Pyramid(name, _modelMat, _points, _center, height, top_ratio, _color, _texture));
 }
 
-void Polygon::generateGeometry(float opacity, std::vector<std::vector<Vertex> >& vertices) const {
+void Polygon::generateGeometry(const AffineTransform& pivot, float opacity, std::vector<std::vector<Vertex> >& vertices) const {
 	if (_removed) return;
 
+	AffineTransform worldMat = pivot * _modelMat;
+
 	int offset = vertices.size();
 	vertices.resize(offset + 1);
-	glutils::drawPolygon(_points, glm::vec4(_color, opacity), _pivot * _modelMat, vertices[offset]);
+	glutils::drawPolygon(_points, glm::vec4(_color, opacity), worldMat, vertices[offset]);
 }
 
 }
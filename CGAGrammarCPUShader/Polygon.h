@@ -17,7 +17,7 @@ private:
 
 public:
 	Polygon() {}
-	Polygon(const std::string& name, const glm::mat4& pivot, const glm::mat4& modelMat, const std::vector<glm::vec2>& points, const glm::vec3& color, const std::string& texture);
+	Polygon(const std::string& name, const AffineTransform& modelMat, const std::vector<glm::vec2>& points, const glm::vec3& color, const std::string& texture);
 	boost::shared_ptr<Shape> clone(const std::string& name) const;
 	boost::shared_ptr<Shape> extrude(const std::string& name, float height);
 	boost::shared_ptr<Shape> inscribeCircle(const std::string& name);
@@ -28,7 +28,7 @@ public:
 	void size(float xSize, float ySize, float zSize);
 	//void split(int direction, const std::vector<float> ratios, const std::vector<std::string> names, std::vector<Object*>& objects);
 	boost::shared_ptr<Shape> taper(const std::string& name, float height, float top_ratio = 0.0f);
-	void generateGeometry(float opacity, std::vector<std::vector<Vertex> >& vertices) const;
+	void generateGeometry(const AffineTransform& pivot, float opacity, std::vector<std::vector<Vertex> >& vertices) const;
 };
 
 }
@@ -0,0 +1,318 @@
+#include "PolygonMerger.h"
+#include "Utils.h"
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+namespace {
+
+/** quantization of the plane, which is close to the tolerance of the coplanarity (the dot product of the normals > 0.99, and the offsets within 0.01) */
+const float NORMAL_QUANTUM = 0.1f;
+const float OFFSET_QUANTUM = 0.01f;
+
+struct PlaneKey {
+	int nx, ny, nz, d;
+
+	bool operator<(const PlaneKey& other) const {
+		if (nx != other.nx) return nx < other.nx;
+		if (ny != other.ny) return ny < other.ny;
+		if (nz != other.nz) return nz < other.nz;
+		return d < other.d;
+	}
+};
+
+/** tolerance of the coplanarity of two buckets */
+const float NORMAL_TOLERANCE = 0.99f;
+const float OFFSET_TOLERANCE = 0.01f;
+
+int quantize(float val, float quantum) {
+	return (int)floor(val / quantum + 0.5f);
+}
+
+/**
+ * Return the representative of the group of the bucket, and shorten the path to it.
+ */
+PlaneKey findPlane(std::map<PlaneKey, PlaneKey>& parents, const PlaneKey& key) {
+	PlaneKey root = key;
+	while (true) {
+		const PlaneKey& parent = parents[root];
+		if (!(parent < root) && !(root < parent)) break;
+		root = parent;
+	}
+
+	PlaneKey cur = key;
+	while (cur < root || root < cur) {
+		PlaneKey next = parents[cur];
+		parents[cur] = root;
+		cur = next;
+	}
+
+	return root;
+}
+
+}
+
+/**
+ * Merge the coplanar polygons that overlap or touch each other.
+ * The polygons that are not merged are kept as they are in the original order, and the merged polygons follow them.
+ *
+ * @param vertices	[IN/OUT] the polygons
+ */
+void PolygonMerger::merge(std::vector<std::vector<Vertex> >& vertices) {
+	// bucket the polygons by the plane
+	std::map<PlaneKey, std::vector<int> > buckets;
+	std::map<PlaneKey, glm::vec3> plane_normals;
+	std::map<PlaneKey, float> plane_offsets;
+	for (int i = 0; i < vertices.size(); ++i) {
+		if (vertices[i].size() < 3) continue;
+
+		glm::vec3 n = glm::normalize(glm::cross(vertices[i][1].position - vertices[i][0].position, vertices[i][2].position - vertices[i][0].position));
+		if (n.x != n.x || n.y != n.y || n.z != n.z) continue;
+		float d = glm::dot(n, vertices[i][0].position);
+
+		PlaneKey key;
+		key.nx = quantize(n.x, NORMAL_QUANTUM);
+		key.ny = quantize(n.y, NORMAL_QUANTUM);
+		key.nz = quantize(n.z, NORMAL_QUANTUM);
+		key.d = quantize(d, OFFSET_QUANTUM);
+		buckets[key].push_back(i);
+		plane_normals[key] = n;
+		plane_offsets[key] = d;
+	}
+
+	// the coplanar polygons may fall on the opposite sides of a rounding boundary,
+	// so the neighboring buckets are grouped if their planes are within the tolerance
+	std::map<PlaneKey, PlaneKey> parents;
+	for (auto it = buckets.begin(); it != buckets.end(); ++it) {
+		parents[it->first] = it->first;
+	}
+	for (auto it = buckets.begin(); it != buckets.end(); ++it) {
+		const PlaneKey& key = it->first;
+		for (int dx = -1; dx <= 1; ++dx) {
+			for (int dy = -1; dy <= 1; ++dy) {
+				for (int dz = -1; dz <= 1; ++dz) {
+					for (int dd = -1; dd <= 1; ++dd) {
+						PlaneKey neighbor;
+						neighbor.nx = key.nx + dx;
+						neighbor.ny = key.ny + dy;
+						neighbor.nz = key.nz + dz;
+						neighbor.d = key.d + dd;
+						// each pair of the buckets is checked once
+						if (!(key < neighbor) || buckets.find(neighbor) == buckets.end()) continue;
+
+						if (glm::dot(plane_normals[key], plane_normals[neighbor]) < NORMAL_TOLERANCE) continue;
+						if (fabs(plane_offsets[key] - plane_offsets[neighbor]) > OFFSET_TOLERANCE) continue;
+
+						PlaneKey root1 = findPlane(parents, key);
+						PlaneKey root2 = findPlane(parents, neighbor);
+						if (root1 < root2) {
+							parents[root2] = root1;
+						} else if (root2 < root1) {
+							parents[root1] = root2;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// the polygons in a group are kept in the original order
+	std::map<PlaneKey, std::vector<int> > planes;
+	for (auto it = buckets.begin(); it != buckets.end(); ++it) {
+		std::vector<int>& polygons = planes[findPlane(parents, it->first)];
+		polygons.insert(polygons.end(), it->second.begin(), it->second.end());
+	}
+	for (auto it = planes.begin(); it != planes.end(); ++it) {
+		std::sort(it->second.begin(), it->second.end());
+	}
+
+	std::vector<bool> merged(vertices.size(), false);
+	std::vector<std::vector<Vertex> > union_vertices;
+	for (auto it = planes.begin(); it != planes.end(); ++it) {
+		if (it->second.size() < 2) continue;
+
+		// use the two axes other than the dominant axis of the normal as the coordinates on the plane
+		const glm::vec3& n = plane_normals[it->first];
+		int axis = 2;
+		if (fabs(n.x) >= fabs(n.y) && fabs(n.x) >= fabs(n.z)) {
+			axis = 0;
+		} else if (fabs(n.y) >= fabs(n.z)) {
+			axis = 1;
+		}
+
+		// the cell size of the grid is the average size of the polygons
+		float total_size = 0.0f;
+		for (int k = 0; k < it->second.size(); ++k) {
+			const std::vector<Vertex>& polygon = vertices[it->second[k]];
+			glm::vec3 minPt = polygon[0].position;
+			glm::vec3 maxPt = polygon[0].position;
+			for (int l = 1; l < polygon.size(); ++l) {
+				minPt = glm::min(minPt, polygon[l].position);
+				maxPt = glm::max(maxPt, polygon[l].position);
+			}
+			glm::vec3 size = maxPt - minPt;
+			total_size += std::max(size[(axis + 1) % 3], size[(axis + 2) % 3]);
+		}
+
+		PolygonMerger merger(axis, std::max(0.1f, total_size / it->second.size()));
+		for (int k = 0; k < it->second.size(); ++k) {
+			const std::vector<Vertex>& polygon = vertices[it->second[k]];
+			std::vector<glm::vec3> points(polygon.size());
+			for (int l = 0; l < polygon.size(); ++l) {
+				points[l] = polygon[l].position;
+			}
+			merger.add(points);
+		}
+
+		// each input polygon has its item in the same order, and it is replaced by the union if the item was united with others
+		for (int k = 0; k < it->second.size(); ++k) {
+			if (!merger.items[k].alive || merger.items[k].num_sources > 1) {
+				merged[it->second[k]] = true;
+			}
+		}
+		merger.output(union_vertices);
+	}
+
+	std::vector<std::vector<Vertex> > result;
+	for (int i = 0; i < vertices.size(); ++i) {
+		if (merged[i]) continue;
+
+		result.push_back(std::vector<Vertex>());
+		result.back().swap(vertices[i]);
+	}
+	for (int i = 0; i < union_vertices.size(); ++i) {
+		result.push_back(std::vector<Vertex>());
+		result.back().swap(union_vertices[i]);
+	}
+
+	vertices.swap(result);
+}
+
+PolygonMerger::PolygonMerger(int axis, float cell_size) {
+	this->axis = axis;
+	this->cell_size = cell_size;
+}
+
+/**
+ * Add a polygon.
+ * It is united with the polygons in the grid as long as they overlap, and then the result is put in the grid.
+ * The polygons that are united are removed from the grid.
+ */
+void PolygonMerger::add(const std::vector<glm::vec3>& points) {
+	Item item;
+	item.points = points;
+	item.alive = true;
+	item.num_sources = 1;
+	updateBounds(item);
+
+	while (true) {
+		std::vector<int> candidates;
+		query(item, candidates);
+
+		bool united = false;
+		for (int i = 0; i < candidates.size(); ++i) {
+			std::vector<glm::vec3> union_points;
+			if (!utils::union_polygons(items[candidates[i]].points, item.points, union_points)) continue;
+			if (union_points.size() < 3) continue;
+
+			items[candidates[i]].alive = false;
+			item.points = union_points;
+			item.num_sources += items[candidates[i]].num_sources;
+			updateBounds(item);
+			united = true;
+			break;
+		}
+
+		if (!united) break;
+	}
+
+	items.push_back(item);
+	insert(items.size() - 1);
+}
+
+void PolygonMerger::updateBounds(Item& item) const {
+	item.minPt = glm::vec2((std::numeric_limits<float>::max)(), (std::numeric_limits<float>::max)());
+	item.maxPt = -item.minPt;
+	for (int i = 0; i < item.points.size(); ++i) {
+		glm::vec2 p(item.points[i][(axis + 1) % 3], item.points[i][(axis + 2) % 3]);
+		item.minPt = glm::min(item.minPt, p);
+		item.maxPt = glm::max(item.maxPt, p);
+	}
+}
+
+/**
+ * Put the polygon in all the cells that its bounding box covers.
+ */
+void PolygonMerger::insert(int id) {
+	const Item& item = items[id];
+	int u0 = (int)floor(item.minPt.x / cell_size);
+	int u1 = (int)floor(item.maxPt.x / cell_size);
+	int v0 = (int)floor(item.minPt.y / cell_size);
+	int v1 = (int)floor(item.maxPt.y / cell_size);
+
+	if ((u1 - u0 + 1) * (v1 - v0 + 1) > MAX_CELLS_PER_ITEM) {
+		large_items.push_back(id);
+		return;
+	}
+
+	for (int u = u0; u <= u1; ++u) {
+		for (int v = v0; v <= v1; ++v) {
+			cells[std::make_pair(u, v)].push_back(id);
+		}
+	}
+}
+
+/**
+ * Find the alive polygons whose bounding box intersects that of the given polygon.
+ * The candidates are sorted in the order of the insertion, so that the result does not depend on the grid.
+ */
+void PolygonMerger::query(const Item& item, std::vector<int>& candidates) const {
+	int u0 = (int)floor(item.minPt.x / cell_size);
+	int u1 = (int)floor(item.maxPt.x / cell_size);
+	int v0 = (int)floor(item.minPt.y / cell_size);
+	int v1 = (int)floor(item.maxPt.y / cell_size);
+
+	candidates = large_items;
+	if ((u1 - u0 + 1) * (v1 - v0 + 1) > MAX_CELLS_PER_ITEM) {
+		// the polygon is so large that scanning all the items is faster than looking up the cells
+		for (int i = 0; i < items.size(); ++i) {
+			candidates.push_back(i);
+		}
+	} else {
+		for (int u = u0; u <= u1; ++u) {
+			for (int v = v0; v <= v1; ++v) {
+				auto it = cells.find(std::make_pair(u, v));
+				if (it == cells.end()) continue;
+				candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+			}
+		}
+	}
+
+	std::sort(candidates.begin(), candidates.end());
+	candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+	int num = 0;
+	for (int i = 0; i < candidates.size(); ++i) {
+		const Item& other = items[candidates[i]];
+		if (!other.alive) continue;
+		if (other.maxPt.x < item.minPt.x || other.minPt.x > item.maxPt.x) continue;
+		if (other.maxPt.y < item.minPt.y || other.minPt.y > item.maxPt.y) continue;
+		candidates[num++] = candidates[i];
+	}
+	candidates.resize(num);
+}
+
+/**
+ * Append the polygons that are the union of two or more input polygons.
+ */
+void PolygonMerger::output(std::vector<std::vector<Vertex> >& vertices) const {
+	for (int i = 0; i < items.size(); ++i) {
+		if (!items[i].alive || items[i].num_sources < 2) continue;
+
+		std::vector<Vertex> union_vertices;
+		for (int k = 0; k < items[i].points.size(); ++k) {
+			union_vertices.push_back(Vertex(items[i].points[k], glm::vec3(0, 0, 1), glm::vec4(0, 0, 0, 1)));
+		}
+		vertices.push_back(union_vertices);
+	}
+}
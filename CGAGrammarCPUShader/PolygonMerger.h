@@ -0,0 +1,47 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <map>
+#include "Vertex.h"
+
+/**
+ * Merger of the coplanar polygons that overlap or touch each other.
+ *
+ * The polygons are bucketed by their quantized plane (normal and offset), so that only the polygons on the same plane are compared.
+ * The neighboring buckets whose planes are within the tolerance are grouped, so a rounding boundary does not separate coplanar polygons.
+ * In each bucket, the polygons are indexed by a uniform grid on the plane, and merged in one pass:
+ * each polygon is united with the overlapping polygons that are already in the grid, and the result is put back into the grid.
+ */
+class PolygonMerger {
+private:
+	/** polygon on a plane, which may be the union of some input polygons */
+	struct Item {
+		std::vector<glm::vec3> points;
+		glm::vec2 minPt;
+		glm::vec2 maxPt;
+		bool alive;
+		int num_sources;
+	};
+
+	/** the polygons whose bounding box covers more cells than this are not put in the grid, but always checked */
+	static const int MAX_CELLS_PER_ITEM = 256;
+
+	int axis;
+	float cell_size;
+	std::vector<Item> items;
+	std::map<std::pair<int, int>, std::vector<int> > cells;
+	std::vector<int> large_items;
+
+public:
+	static void merge(std::vector<std::vector<Vertex> >& vertices);
+
+private:
+	PolygonMerger(int axis, float cell_size);
+
+	void add(const std::vector<glm::vec3>& points);
+	void updateBounds(Item& item) const;
+	void insert(int id);
+	void query(const Item& item, std::vector<int>& candidates) const;
+	void output(std::vector<std::vector<Vertex> >& vertices) const;
+};
@@ -7,10 +7,9 @@
 
 namespace cga {
 
-Prism::Prism(const std::string& name, const glm::mat4& pivot, const glm::mat4& modelMat, const std::vector<glm::vec2>& points, float height, const glm::vec3& color) {
+Prism::Prism(const std::string& name, const AffineTransform& modelMat, const std::vector<glm::vec2>& points, float height, const glm::vec3& color) {
 	this->_name = name;
 	this->_removed = false;
-	this->_pivot = pivot;
 	this->_modelMat = modelMat;
 	this->_points = points;
 	this->_color = color;
@@ -28,7 +27,7 @@ boost::shared_ptr<Shape> Prism::clone(const std::string& name) const {
 void Prism::comp(const std::map<std::string, std::string>& name_map, std::vector<boost::shared_ptr<Shape> >& shapes) {
 	// front face
 	if (name_map.find("front") != name_map.end() && name_map.at("front") != "NIL") {
-		shapes.push_back(boost::shared_ptr<Shape>(new Rectangle(name_map.at("front"), _pivot, glm::rotate(_modelMat, M_PI * 0.5f, glm::vec3(1, 0, 0)), glm::length(_points[1] - _points[0]), _scope.z, _color)));
+		shapes.push_back(boost::shared_ptr<Shape>(new Rectangle(name_map.at("front"), glm::rotate(_modelMat, M_PI * 0.5f, glm::vec3(1, 0, 0)), glm::length(_points[1] - _points[0]), _scope.z, _color)));
 	}
 
 	// side faces
@@ -50,20 +49,20 @@ void Prism::comp(const std::map<std::string, std::string>& name_map, std::vector
 			sidePoints[2] = glm::vec2(invMat * glm::vec4(_points[(i + 1) % _points.size()], _scope.z, 1));
 			sidePoints[3] = glm::vec2(invMat * glm::vec4(_points[i], _scope.z, 1));
 
-			shapes.push_back(boost::shared_ptr<Shape>(new Rectangle(name_map.at("side"), _pivot, _modelMat * mat2, glm::length(_points[(i + 1) % _points.size()] - _points[i]), _scope.z, _color)));
+			shapes.push_back(boost::shared_ptr<Shape>(new Rectangle(name_map.at("side"), _modelMat * mat2, glm::length(_points[(i + 1) % _points.size()] - _points[i]), _scope.z, _color)));
 		}
 	}
 
 	// top face
 	if (name_map.find("top") != name_map.end() && name_map.at("top") != "NIL") {
-		shapes.push_back(boost::shared_ptr<Shape>(new Polygon(name_map.at("top"), _pivot, glm::translate(_modelMat, glm::vec3(0, 0, _scope.z)), _points, _color, _texture)));
+		shapes.push_back(boost::shared_ptr<Shape>(new Polygon(name_map.at("top"), glm::translate(_modelMat, glm::vec3(0, 0, _scope.z)), _points, _color, _texture)));
 	}
 
 	// bottom face
 	if (name_map.find("bottom") != name_map.end() && name_map.at("bottom") != "NIL") {
 		//std::vector<glm::vec2> basePoints = _points;
 		//std::reverse(basePoints.begin(), basePoints.end());
-		shapes.push_back(boost::shared_ptr<Shape>(new Polygon(name_map.at("bottom"), _pivot, _modelMat, _points, _color, _texture)));
+		shapes.push_back(boost::shared_ptr<Shape>(new Polygon(name_map.at("bottom"), _modelMat, _points, _color, _texture)));
 	}
 }
 
@@ -92,7 +91,7 @@ void Prism::size(float xSize, float ySize, float zSize) {
  * Z方向のsplitしか対応していない。
  */
 void Prism::split(int splitAxis, const std::vector<float>& sizes, const std::vector<std::string>& names, std::vector<boost::shared_ptr<Shape> >& objects) {
-	glm::mat4 modelMat = this->_modelMat;
+	AffineTransform modelMat = this->_modelMat;
 
 	for (int i = 0; i < sizes.size(); ++i) {
 		Prism* obj = new Prism(*this);
@@ -105,9 +104,11 @@ void Prism::split(int splitAxis, const std::vector<float>& sizes, const std::vec
 	}
 }
 
-void Prism::generateGeometry(float opacity, std::vector<std::vector<Vertex> >& vertices) const {
+void Prism::generateGeometry(const AffineTransform& pivot, float opacity, std::vector<std::vector<Vertex> >& vertices) const {
 	if (_removed) return;
 
+	AffineTransform worldMat = pivot * _modelMat;
+
 	int num = 0;
 
 	int offset = vertices.size();
@@ -115,29 +116,29 @@ void Prism::generateGeometry(float opacity, std::vector<std::vector<Vertex> >& v
 	// top
 	if (_scope.z >= 0) {
 		vertices.resize(offset + 1);
-		glm::mat4 mat = _pivot * glm::translate(_modelMat, glm::vec3(0, 0, _scope.z));
+		glm::mat4 mat = glm::translate(worldMat, glm::vec3(0, 0, _scope.z));
 		glutils::drawPolygon(_points, glm::vec4(_color, opacity), mat, vertices[offset++]);
 	}
 
 	// bottom
 	{
 		vertices.resize(offset + 1);
-		glutils::drawPolygon(_points, glm::vec4(_color, opacity), _pivot * _modelMat, vertices[offset++]);
+		glutils::drawPolygon(_points, glm::vec4(_color, opacity), worldMat, vertices[offset++]);
 	}
 
 	// side
 	{
 		glm::vec4 p1(_points.back(), 0, 1);
 		glm::vec4 p2(_points.back(), _scope.z, 1);
-		p1 = _pivot * _modelMat * p1;
-		p2 = _pivot * _modelMat * p2;
+		p1 = worldMat * p1;
+		p2 = worldMat * p2;
 
 		vertices.resize(offset + _points.size());
 		for (int i = 0; i < _points.size(); ++i) {
 			glm::vec4 p3(_points[i], 0, 1);
 			glm::vec4 p4(_points[i], _scope.z, 1);
-			p3 = _pivot * _modelMat * p3;
-			p4 = _pivot * _modelMat * p4;
+			p3 = worldMat * p3;
+			p4 = worldMat * p4;
 
 			glm::vec3 normal = glm::normalize(glm::cross(glm::vec3(p3) - glm::vec3(p1), glm::vec3(p2) - glm::vec3(p1)));
 			
@@ -7,10 +7,9 @@
 
 namespace cga {
 
-Pyramid::Pyramid(const std::string& name, const glm::mat4& pivot, const glm::mat4& modelMat, const std::vector<glm::vec2>& points, const glm::vec2& center, float height, float top_ratio, const glm::vec3& color, const std::string& texture) {
+Pyramid::Pyramid(const std::string& name, const AffineTransform& modelMat, const std::vector<glm::vec2>& points, const glm::vec2& center, float height, float top_ratio, const glm::vec3& color, const std::string& texture) {
 	this->_name = name;
 	this->_removed = false;
-	this->_pivot = pivot;
 	this->_modelMat = modelMat;
 	this->_points = points;
 	this->_center = center;
@@ -51,7 +50,7 @@ void Pyramid::comp(const std::map<std::string, std::string>& name_map, std::vect
 		}
 
 		mat = glm::rotate(_modelMat, angle, glm::vec3(1, 0, 0));
-		shapes.push_back(boost::shared_ptr<Shape>(new Polygon(name_map.at("front"), _pivot, mat, points, _color, _texture)));
+		shapes.push_back(boost::shared_ptr<Shape>(new Polygon(name_map.at("front"), mat, points, _color, _texture)));
 	}
 
 	// side faces (To be fixed);
@@ -90,7 +89,7 @@ void Pyramid::comp(const std::map<std::string, std::string>& name_map, std::vect
 			}
 
 			glm::mat4 mat2 = glm::rotate(mat, angle, glm::vec3(1, 0, 0));
-			shapes.push_back(boost::shared_ptr<Shape>(new Polygon(name_map.at("side"), _pivot, _modelMat * mat2, points, _color, _texture)));
+			shapes.push_back(boost::shared_ptr<Shape>(new Polygon(name_map.at("side"), _modelMat * mat2, points, _color, _texture)));
 		}
 	}
 
@@ -101,34 +100,36 @@ void Pyramid::comp(const std::map<std::string, std::string>& name_map, std::vect
 		for (int i = 0; i < points.size(); ++i) {
 			points[i] -= offset;
 		}
-		glm::mat4 mat = glm::translate(_modelMat, glm::vec3(offset, _height));
+		AffineTransform mat = glm::translate(_modelMat, glm::vec3(offset, _height));
 
-		shapes.push_back(boost::shared_ptr<Shape>(new Polygon(name_map.at("top"), _pivot, mat, points, _color, _texture)));
+		shapes.push_back(boost::shared_ptr<Shape>(new Polygon(name_map.at("top"), mat, points, _color, _texture)));
 	}
 
 	// bottom face
 	if (name_map.find("bottom") != name_map.end() && name_map.at("bottom") != "NIL") {
 		//std::vector<glm::vec2> basePoints = _points;
 		//std::reverse(basePoints.begin(), basePoints.end());
-		shapes.push_back(boost::shared_ptr<Shape>(new Polygon(name_map.at("bottom"), _pivot, _modelMat, _points, _color, _texture)));
+		shapes.push_back(boost::shared_ptr<Shape>(new Polygon(name_map.at("bottom"), _modelMat, _points, _color, _texture)));
 	}
 }
 
-void Pyramid::generateGeometry(float opacity, std::vector<std::vector<Vertex> >& vertices) const {
+void Pyramid::generateGeometry(const AffineTransform& pivot, float opacity, std::vector<std::vector<Vertex> >& vertices) const {
 	if (_removed) return;
 
+	AffineTransform worldMat = pivot * _modelMat;
+
 	if (_top_ratio == 0.0f) {
 		glm::vec4 p0(_center, _height, 1);
-		p0 = _pivot * _modelMat * p0;
+		p0 = worldMat * p0;
 
 		glm::vec4 p1(_points.back(), 0, 1);
-		p1 = _pivot * _modelMat * p1;
+		p1 = worldMat * p1;
 
 		int offset = vertices.size();
 		vertices.resize(offset + _points.size());
 		for (int i = 0; i < _points.size(); ++i) {
 			glm::vec4 p2(_points[i], 0, 1);
-			p2 = _pivot * _modelMat * p2;
+			p2 = worldMat * p2;
 
 			glm::vec3 normal = glm::cross(glm::vec3(p1 - p0), glm::vec3(p2 - p0));
 
@@ -140,10 +141,10 @@ void Pyramid::generateGeometry(float opacity, std::vector<std::vector<Vertex> >&
 		}
 	} else {
 		glm::vec4 p0(_points.back(), 0, 1);
-		p0 = _pivot * _modelMat * p0;
+		p0 = worldMat * p0;
 
 		glm::vec4 p1(_points.back() * _top_ratio + _center * (1.0f - _top_ratio), _height, 1);
-		p1 = _pivot * _modelMat * p1;
+		p1 = worldMat * p1;
 
 		int offset = vertices.size();
 		vertices.resize(offset + _points.size());
@@ -151,11 +152,11 @@ void Pyramid::generateGeometry(float opacity, std::vector<std::vector<Vertex> >&
 		std::vector<glm::vec3> pts3(_points.size());
 		for (int i = 0; i < _points.size(); ++i) {
 			glm::vec4 p2(_points[i], 0, 1);
-			p2 = _pivot * _modelMat * p2;
+			p2 = worldMat * p2;
 
 			glm::vec4 p3(_points[i] * _top_ratio + _center * (1.0f - _top_ratio), _height, 1);
 			pts3[i] = glm::vec3(p3);
-			p3 = _pivot * _modelMat * p3;
+			p3 = worldMat * p3;
 
 			glm::vec3 normal = glm::cross(glm::vec3(p2 - p0), glm::vec3(p3 - p0));
 
@@ -170,7 +171,7 @@ void Pyramid::generateGeometry(float opacity, std::vector<std::vector<Vertex> >&
 
 		offset += _points.size();
 		vertices.resize(offset + 1);
-		glutils::drawPolygon(pts3, glm::vec4(_color, opacity), _pivot * _modelMat, vertices[offset]);
+		glutils::drawPolygon(pts3, glm::vec4(_color, opacity), worldMat, vertices[offset]);
 	}
 }
 
@@ -12,20 +12,18 @@
 
 namespace cga {
 
-Rectangle::Rectangle(const std::string& name, const glm::mat4& pivot, const glm::mat4& modelMat, float width, float height, const glm::vec3& color) {
+Rectangle::Rectangle(const std::string& name, const AffineTransform& modelMat, float width, float height, const glm::vec3& color) {
 	this->_name = name;
 	this->_removed = false;
-	this->_pivot = pivot;
 	this->_modelMat = modelMat;
 	this->_scope = glm::vec3(width, height, 0);
 	this->_color = color;
 	this->_textureEnabled = false;
 }
 
-Rectangle::Rectangle(const std::string& name, const glm::mat4& pivot, const glm::mat4& modelMat, float width, float height, const glm::vec3& color, const std::string& texture, float u1, float v1, float u2, float v2) {
+Rectangle::Rectangle(const std::string& name, const AffineTransform& modelMat, float width, float height, const glm::vec3& color, const std::string& texture, float u1, float v1, float u2, float v2) {
 	this->_name = name;
 	this->_removed = false;
-	this->_pivot = pivot;
 	this->_modelMat = modelMat;
 	this->_scope = glm::vec3(width, height, 0);
 	this->_color = color;
@@ -66,15 +64,15 @@ boost::shared_ptr<Shape> Rectangle::cornerCut(const std::string& name, int type,
 	points.push_back(glm::vec2(_scope.x, length));
 	points.push_back(glm::vec2(_scope.x, _scope.y));
 	points.push_back(glm::vec2(0, _scope.y));
-	return boost::shared_ptr<Shape>(new Polygon(name, _pivot, _modelMat, points, _color, _texture));
+	return boost::shared_ptr<Shape>(new Polygon(name, _modelMat, points, _color, _texture));
 }
 
 boost::shared_ptr<Shape> Rectangle::extrude(const std::string& name, float height) {
-	return boost::shared_ptr<Shape>(new Cuboid(name, _pivot, _modelMat, _scope.x, _scope.y, height, _color));
+	return boost::shared_ptr<Shape>(new Cuboid(name, _modelMat, _scope.x, _scope.y, height, _color));
 }
 
 boost::shared_ptr<Shape> Rectangle::innerSemiCircle(const std::string& name) {
-	return boost::shared_ptr<Shape>(new SemiCircle(name, _pivot, _modelMat, _scope.x, _scope.y, _color));
+	return boost::shared_ptr<Shape>(new SemiCircle(name, _modelMat, _scope.x, _scope.y, _color));
 }
 
 boost::shared_ptr<Shape> Rectangle::inscribeCircle(const std::string& name) {
@@ -83,11 +81,11 @@ boost::shared_ptr<Shape> Rectangle::inscribeCircle(const std::string& name) {
 
 boost::shared_ptr<Shape> Rectangle::offset(const std::string& name, float offsetDistance, int offsetSelector) {
 	if (offsetSelector == SELECTOR_ALL) {
-		return boost::shared_ptr<Shape>(new OffsetRectangle(name, _pivot, _modelMat, _scope.x, _scope.y, offsetDistance, _color, _texture));
+		return boost::shared_ptr<Shape>(new OffsetRectangle(name, _modelMat, _scope.x, _scope.y, offsetDistance, _color, _texture));
 	} else if (offsetSelector == SELECTOR_INSIDE) {
 		float offset_width = _scope.x + offsetDistance * 2.0f;
 		float offset_height = _scope.y + offsetDistance * 2.0f;
-		glm::mat4 mat = glm::translate(_modelMat, glm::vec3(-offsetDistance, -offsetDistance, 0));
+		AffineTransform mat = glm::translate(_modelMat, glm::vec3(-offsetDistance, -offsetDistance, 0));
 		if (_textureEnabled) {
 			float offset_u1 = _texCoords[0].x;
 			float offset_v1 = _texCoords[0].y;
@@ -99,9 +97,9 @@ boost::shared_ptr<Shape> Rectangle::offset(const std::string& name, float offset
 				float offset_u2 = (_texCoords[2].x - _texCoords[0].x) * (_scope.x + offsetDistance) / _scope.x + _texCoords[0].x;
 				float offset_v2 = (_texCoords[2].y - _texCoords[0].y) * (_scope.y + offsetDistance) / _scope.y + _texCoords[0].y;
 			}
-			return boost::shared_ptr<Shape>(new Rectangle(name, _pivot, mat, offset_width, offset_height, _color, _texture, offset_u1, offset_v1, offset_u2, offset_v2));
+			return boost::shared_ptr<Shape>(new Rectangle(name, mat, offset_width, offset_height, _color, _texture, offset_u1, offset_v1, offset_u2, offset_v2));
 		} else {
-			return boost::shared_ptr<Shape>(new Rectangle(name, _pivot, mat, offset_width, offset_height, _color));
+			return boost::shared_ptr<Shape>(new Rectangle(name, mat, offset_width, offset_height, _color));
 		}
 	} else {
 		throw "border of offset is not supported by rectangle.";
@@ -114,7 +112,7 @@ boost::shared_ptr<Shape> Rectangle::roofGable(const std::string& name, float ang
 	points[1] = glm::vec2(_scope.x, 0);
 	points[2] = glm::vec2(_scope.x, _scope.y);
 	points[3] = glm::vec2(0, _scope.y);
-	return boost::shared_ptr<Shape>(new GableRoof(name, _pivot, _modelMat, points, angle, _color));
+	return boost::shared_ptr<Shape>(new GableRoof(name, _modelMat, points, angle, _color));
 }
 
 boost::shared_ptr<Shape> Rectangle::roofHip(const std::string& name, float angle) {
@@ -123,7 +121,7 @@ boost::shared_ptr<Shape> Rectangle::roofHip(const std::string& name, float angle
 	points[1] = glm::vec2(_scope.x, 0);
 	points[2] = glm::vec2(_scope.x, _scope.y);
 	points[3] = glm::vec2(0, _scope.y);
-	return boost::shared_ptr<Shape>(new HipRoof(name, _pivot, _modelMat, points, angle, _color));
+	return boost::shared_ptr<Shape>(new HipRoof(name, _modelMat, points, angle, _color));
 }
 
 void Rectangle::setupProjection(int axesSelector, float texWidth, float texHeight) {
@@ -143,7 +141,7 @@ boost::shared_ptr<Shape> Rectangle::shapeL(const std::string& name, float frontW
 	points[4] = glm::vec2(leftWidth, _scope.y);
 	points[5] = glm::vec2(0, _scope.y);
 
-	return boost::shared_ptr<Shape>(new Polygon(name, _pivot, _modelMat, points, _color, _texture));
+	return boost::shared_ptr<Shape>(new Polygon(name, _modelMat, points, _color, _texture));
 }
 
 void Rectangle::size(float xSize, float ySize, float zSize) {
@@ -154,37 +152,69 @@ void Rectangle::size(float xSize, float ySize, float zSize) {
 	_scope.z = zSize;
 }
 
+/**
+ * Split the rectangle into the pieces along the axis.
+ * All the pieces are allocated in one block, which is shared by the pieces and released when all of them are released.
+ * The pieces are copied from the same prototype, which has the color and the texture of this rectangle.
+ */
 void Rectangle::split(int splitAxis, const std::vector<float>& sizes, const std::vector<std::string>& names, std::vector<boost::shared_ptr<Shape> >& objects) {
+	if (splitAxis == DIRECTION_Z) {
+		for (int i = 0; i < sizes.size(); ++i) {
+			objects.push_back(this->clone(this->_name));
+		}
+		return;
+	}
+
+	int num_pieces = 0;
+	for (int i = 0; i < sizes.size(); ++i) {
+		if (names[i] != "NIL") num_pieces++;
+	}
+	if (num_pieces == 0) return;
+
+	Rectangle prototype;
+	prototype._removed = false;
+	prototype._scope = glm::vec3(_scope.x, _scope.y, 0);
+	prototype._color = _color;
+	prototype._textureEnabled = _texCoords.size() > 0;
+	if (prototype._textureEnabled) {
+		prototype._texture = _texture;
+		prototype._texCoords.resize(4);
+	}
+	boost::shared_ptr<std::vector<Rectangle> > pieces(new std::vector<Rectangle>(num_pieces, prototype));
+	objects.reserve(objects.size() + num_pieces);
+
 	float offset = 0.0f;
-	
+	int index = 0;
 	for (int i = 0; i < sizes.size(); ++i) {
-		if (splitAxis == DIRECTION_X) {
-			if (names[i] != "NIL") {
-				glm::mat4 mat = glm::translate(glm::mat4(), glm::vec3(offset, 0, 0));
-				if (_texCoords.size() > 0) {
-					objects.push_back(boost::shared_ptr<Shape>(new Rectangle(names[i], _pivot, _modelMat * mat, sizes[i], _scope.y, _color, _texture,
-						_texCoords[0].x + (_texCoords[1].x - _texCoords[0].x) * offset / _scope.x, _texCoords[0].y,
-						_texCoords[0].x + (_texCoords[1].x - _texCoords[0].x) * (offset + sizes[i]) / _scope.x, _texCoords[2].y)));
-				} else {
-					objects.push_back(boost::shared_ptr<Shape>(new Rectangle(names[i], _pivot, _modelMat * mat, sizes[i], _scope.y, _color)));
-				}
-			}
-			offset += sizes[i];
-		} else if (splitAxis == DIRECTION_Y) {
-			if (names[i] != "NIL") {
-				glm::mat4 mat = glm::translate(glm::mat4(), glm::vec3(0, offset, 0));
-				if (_texCoords.size() > 0) {
-					objects.push_back(boost::shared_ptr<Shape>(new Rectangle(names[i], _pivot, _modelMat * mat, _scope.x, sizes[i], _color, _texture,
-						_texCoords[0].x, _texCoords[0].y + (_texCoords[2].y - _texCoords[0].y) * offset / _scope.y,
-						_texCoords[1].x, _texCoords[0].y + (_texCoords[2].y - _texCoords[0].y) * (offset + sizes[i]) / _scope.y)));
+		if (names[i] != "NIL") {
+			Rectangle& piece = (*pieces)[index++];
+			piece._name = names[i];
+			glm::vec3 translation(0, 0, 0);
+			translation[splitAxis] = offset;
+			piece._modelMat = glm::translate(_modelMat, translation);
+			piece._scope[splitAxis] = sizes[i];
+
+			if (piece._textureEnabled) {
+				float u1 = _texCoords[0].x;
+				float v1 = _texCoords[0].y;
+				float u2 = _texCoords[1].x;
+				float v2 = _texCoords[2].y;
+				if (splitAxis == DIRECTION_X) {
+					u1 = _texCoords[0].x + (_texCoords[1].x - _texCoords[0].x) * offset / _scope.x;
+					u2 = _texCoords[0].x + (_texCoords[1].x - _texCoords[0].x) * (offset + sizes[i]) / _scope.x;
 				} else {
-					objects.push_back(boost::shared_ptr<Shape>(new Rectangle(names[i], _pivot, _modelMat * mat, _scope.x, sizes[i], _color)));
+					v1 = _texCoords[0].y + (_texCoords[2].y - _texCoords[0].y) * offset / _scope.y;
+					v2 = _texCoords[0].y + (_texCoords[2].y - _texCoords[0].y) * (offset + sizes[i]) / _scope.y;
 				}
+				piece._texCoords[0] = glm::vec2(u1, v1);
+				piece._texCoords[1] = glm::vec2(u2, v1);
+				piece._texCoords[2] = glm::vec2(u2, v2);
+				piece._texCoords[3] = glm::vec2(u1, v2);
 			}
-			offset += sizes[i];
-		} else if (splitAxis == DIRECTION_Z) {
-			objects.push_back(this->clone(this->_name));
+
+			objects.push_back(boost::shared_ptr<Shape>(pieces, &piece));
 		}
+		offset += sizes[i];
 	}
 }
 
@@ -194,26 +224,28 @@ boost::shared_ptr<Shape> Rectangle::taper(const std::string& name, float height,
 	points[1] = glm::vec2(_scope.x, 0);
 	points[2] = glm::vec2(_scope.x, _scope.y);
 	points[3] = glm::vec2(0, _scope.y);
-	return boost::shared_ptr<Shape>(new Pyramid(name, _pivot, _modelMat, points, glm::vec2(_scope.x * 0.5, _scope.y * 0.5), height, top_ratio, _color, _texture));
+	return boost::shared_ptr<Shape>(new Pyramid(name, _modelMat, points, glm::vec2(_scope.x * 0.5, _scope.y * 0.5), height, top_ratio, _color, _texture));
 }
 
-void Rectangle::generateGeometry(float opacity, std::vector<std::vector<Vertex> >& vertices) const {
+void Rectangle::generateGeometry(const AffineTransform& pivot, float opacity, std::vector<std::vector<Vertex> >& vertices) const {
 	if (_removed) return;
 
+	AffineTransform worldMat = pivot * _modelMat;
+
 	int offset = vertices.size();
 	vertices.resize(offset + 1);
 
 	glm::vec4 p1(0, 0, 0, 1);
-	p1 = _pivot * _modelMat * p1;
+	p1 = worldMat * p1;
 	glm::vec4 p2(_scope.x, 0, 0, 1);
-	p2 = _pivot * _modelMat * p2;
+	p2 = worldMat * p2;
 	glm::vec4 p3(_scope.x, _scope.y, 0, 1);
-	p3 = _pivot * _modelMat * p3;
+	p3 = worldMat * p3;
 	glm::vec4 p4(0, _scope.y, 0, 1);
-	p4 = _pivot * _modelMat * p4;
+	p4 = worldMat * p4;
 
 	glm::vec4 normal(0, 0, 1, 0);
-	normal = _pivot * _modelMat * normal;
+	normal = worldMat * normal;
 
 	if (_textureEnabled) {
 		vertices[offset].push_back(Vertex(glm::vec3(p1), glm::vec3(normal), glm::vec4(_color, opacity), _texCoords[0]));
@@ -13,8 +13,8 @@ namespace cga {
 class Rectangle : public Shape {
 public:
 	Rectangle() {}
-	Rectangle(const std::string& name, const glm::mat4& pivot, const glm::mat4& modelMat, float width, float height, const glm::vec3& color);
-	Rectangle(const std::string& name, const glm::mat4& pivot, const glm::mat4& modelMat, float width, float height, const glm::vec3& color, const std::string& texture, float u1, float v1, float u2, float v2);
+	Rectangle(const std::string& name, const AffineTransform& modelMat, float width, float height, const glm::vec3& color);
+	Rectangle(const std::string& name, const AffineTransform& modelMat, float width, float height, const glm::vec3& color, const std::string& texture, float u1, float v1, float u2, float v2);
 	boost::shared_ptr<Shape> clone(const std::string& name) const;
 	boost::shared_ptr<Shape> cornerCut(const std::string& name, int type, float length);
 	boost::shared_ptr<Shape> extrude(const std::string& name, float height);
@@ -28,7 +28,7 @@ public:
 	void size(float xSize, float ySize, float zSize);
 	void split(int splitAxis, const std::vector<float>& ratios, const std::vector<std::string>& names, std::vector<boost::shared_ptr<Shape> >& objects);
 	boost::shared_ptr<Shape> taper(const std::string& name, float height, float top_ratio = 0.0f);
-	void generateGeometry(float opacity, std::vector<std::vector<Vertex> >& vertices) const;
+	void generateGeometry(const AffineTransform& pivot, float opacity, std::vector<std::vector<Vertex> >& vertices) const;
 };
 
 }
@@ -14,4 +14,9 @@ boost::shared_ptr<Shape> RoofGableOperator::apply(boost::shared_ptr<Shape>& shap
 	return shape->roofGable(shape->_name, actual_angle);
 }
 
+void RoofGableOperator::toNode(GrammarNode& node) const {
+	node.tagName = "roofGable";
+	node.setAttribute("angle", angle);
+}
+
 }
@@ -14,4 +14,9 @@ boost::shared_ptr<Shape> RoofHipOperator::apply(boost::shared_ptr<Shape>& shape,
 	return shape->roofHip(shape->_name, actual_angle);
 }
 
+void RoofHipOperator::toNode(GrammarNode& node) const {
+	node.tagName = "roofHip";
+	node.setAttribute("angle", angle);
+}
+
 }
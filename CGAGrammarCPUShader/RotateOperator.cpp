@@ -16,4 +16,11 @@ boost::shared_ptr<Shape> RotateOperator::apply(boost::shared_ptr<Shape>& shape,
 	return shape;
 }
 
+void RotateOperator::toNode(GrammarNode& node) const {
+	node.tagName = "rotate";
+	node.addParam("xAngle", "").setAttribute("value", xAngle);
+	node.addParam("yAngle", "").setAttribute("value", yAngle);
+	node.addParam("zAngle", "").setAttribute("value", zAngle);
+}
+
 }
@@ -0,0 +1,135 @@
+#include "ScreenSpaceLOD.h"
+#include <algorithm>
+
+namespace cga {
+
+namespace {
+
+/**
+ * The operators that change the shape without generating a new shape.
+ * This is a plain array at the file scope because the derive workers call generatesNothing() at the same time,
+ * and a function-local static is not initialized thread-safely by Visual C++ 2010.
+ */
+const char* MODIFIER_OPERATORS[] = { "center", "color", "extrude", "insert", "roofGable", "roofHip", "rotate", "setupProjection", "size", "taper", "texture", "translate" };
+const int NUM_MODIFIER_OPERATORS = sizeof(MODIFIER_OPERATORS) / sizeof(MODIFIER_OPERATORS[0]);
+
+bool isModifier(const std::string& name) {
+	for (int i = 0; i < NUM_MODIFIER_OPERATORS; ++i) {
+		if (name == MODIFIER_OPERATORS[i]) return true;
+	}
+	return false;
+}
+
+}
+
+ScreenSpaceLOD::ScreenSpaceLOD() {
+	this->width = 0;
+	this->height = 0;
+	this->min_pixels = 0.0f;
+}
+
+bool ScreenSpaceLOD::isEnabled() const {
+	return !mvpMatrices.empty() && min_pixels > 0.0f;
+}
+
+void ScreenSpaceLOD::clear() {
+	mvpMatrices.clear();
+}
+
+/**
+ * Set the size of the images and the threshold.
+ *
+ * @param min_pixels	the shapes smaller than this number of pixels in every view are not derived any more
+ */
+void ScreenSpaceLOD::setViewport(int width, int height, float min_pixels) {
+	this->width = width;
+	this->height = height;
+	this->min_pixels = min_pixels;
+}
+
+/**
+ * Add a view of the camera.
+ *
+ * @param objectMat	the transformation applied to the derived geometry before rendering, such as the normalization of its size
+ */
+void ScreenSpaceLOD::addView(const Camera& camera, const glm::mat4& objectMat) {
+	mvpMatrices.push_back(camera.mvpMatrix * objectMat);
+}
+
+/**
+ * Return true if the scope of the shape is smaller than the threshold in every view.
+ * The size is the larger side of the bounding rectangle of the projected corners of the scope.
+ *
+ * @param pivot	the pivot of the derivation, which is applied after the model matrix of the shape
+ */
+bool ScreenSpaceLOD::isTooSmall(const Shape& shape, const AffineTransform& pivot) const {
+	if (!isEnabled()) return false;
+
+	AffineTransform worldMat = pivot * shape._modelMat;
+	glm::vec4 corners[8];
+	for (int i = 0; i < 8; ++i) {
+		corners[i] = worldMat * glm::vec4(i & 1 ? shape._scope.x : 0, i & 2 ? shape._scope.y : 0, i & 4 ? shape._scope.z : 0, 1);
+	}
+
+	for (int k = 0; k < mvpMatrices.size(); ++k) {
+		glm::vec2 minPt, maxPt;
+		for (int i = 0; i < 8; ++i) {
+			glm::vec4 p = mvpMatrices[k] * corners[i];
+			if (p.w <= 0.0f) return false;
+
+			glm::vec2 pp((p.x / p.w + 1.0f) * 0.5f * width, (p.y / p.w + 1.0f) * 0.5f * height);
+			if (i == 0) {
+				minPt = pp;
+				maxPt = pp;
+			} else {
+				minPt = glm::min(minPt, pp);
+				maxPt = glm::max(maxPt, pp);
+			}
+		}
+
+		if (std::max(maxPt.x - minPt.x, maxPt.y - minPt.y) >= min_pixels) return false;
+	}
+
+	return true;
+}
+
+/**
+ * Return the terminal shape that is drawn instead of the subtree of the shape, or NULL if the subtree has no terminal shape.
+ * The name ends with "!" as the shapes that the rules are applied to, so no rule is applied to it and no warning is shown.
+ */
+boost::shared_ptr<Shape> ScreenSpaceLOD::proxy(const boost::shared_ptr<Shape>& shape, const Grammar& grammar) {
+	std::set<std::string> visited;
+	if (generatesNothing(grammar, shape->_name, visited)) return boost::shared_ptr<Shape>();
+
+	return shape->clone(shape->_name + "!");
+}
+
+/**
+ * Return true if the rule never generates a terminal shape.
+ * This is the case if the rule has no operator, or if it ends with copy and it only changes the shape and copies it
+ * to the rules that generate nothing. The other rules, such as split, are assumed to generate something.
+ *
+ * @param visited	the rules that have been checked, which avoids the infinite recursion of the copies
+ */
+bool ScreenSpaceLOD::generatesNothing(const Grammar& grammar, const std::string& rule_name, std::set<std::string>& visited) {
+	if (!grammar.contain(rule_name)) return false;
+	if (!visited.insert(rule_name).second) return true;
+
+	const Rule& rule = grammar.rules.at(rule_name);
+	if (rule.operators.empty()) return true;
+	if (rule.operators.back()->name != "copy") return false;
+
+	for (int i = 0; i < rule.operators.size(); ++i) {
+		if (rule.operators[i]->name == "copy") {
+			GrammarNode node;
+			rule.operators[i]->toNode(node);
+			if (!generatesNothing(grammar, node.attribute("name"), visited)) return false;
+		} else if (!isModifier(rule.operators[i]->name)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+}
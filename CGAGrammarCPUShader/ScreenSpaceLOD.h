@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+#include <set>
+#include <string>
+#include <boost/shared_ptr.hpp>
+#include <glm/glm.hpp>
+#include "Camera.h"
+#include "Shape.h"
+#include "Grammar.h"
+
+namespace cga {
+
+/**
+ * View-dependent termination of the derivation.
+ *
+ * A shape whose scope covers fewer pixels than the threshold in every view is not derived any more,
+ * and the shape itself, i.e., the face or the box of its scope, is used as the terminal shape instead of its details.
+ * The details such as the frames and the sills of a window cannot be seen in a few pixels, so the image hardly changes.
+ * The shapes whose scope is partly behind a camera are always derived.
+ * A shape whose rule generates nothing, such as NIL, is removed instead, because its proxy would add geometry that is not there.
+ */
+class ScreenSpaceLOD {
+private:
+	/** the transformation from the world coordinates to the normalized device coordinates of each view */
+	std::vector<glm::mat4> mvpMatrices;
+	int width;
+	int height;
+	float min_pixels;
+
+public:
+	ScreenSpaceLOD();
+
+	bool isEnabled() const;
+	void clear();
+	void setViewport(int width, int height, float min_pixels);
+	void addView(const Camera& camera, const glm::mat4& objectMat = glm::mat4());
+	bool isTooSmall(const Shape& shape, const AffineTransform& pivot = AffineTransform()) const;
+	static boost::shared_ptr<Shape> proxy(const boost::shared_ptr<Shape>& shape, const Grammar& grammar);
+
+private:
+	static bool generatesNothing(const Grammar& grammar, const std::string& rule_name, std::set<std::string>& visited);
+};
+
+}
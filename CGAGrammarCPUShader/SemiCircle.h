@@ -13,10 +13,10 @@ namespace cga {
 class SemiCircle : public Shape {
 public:
 	SemiCircle() {}
-	SemiCircle(const std::string& name, const glm::mat4& pivot, const glm::mat4& modelMat, float width, float height, const glm::vec3& color);
+	SemiCircle(const std::string& name, const AffineTransform& modelMat, float width, float height, const glm::vec3& color);
 	boost::shared_ptr<Shape> clone(const std::string& name) const;
 	boost::shared_ptr<Shape> offset(const std::string& name, float offsetDistance, int offsetSelector);
-	void generateGeometry(float opacity, std::vector<std::vector<Vertex> >& vertices) const;
+	void generateGeometry(const AffineTransform& pivot, float opacity, std::vector<std::vector<Vertex> >& vertices) const;
 };
 
 }
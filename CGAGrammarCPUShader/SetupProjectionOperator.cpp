@@ -32,4 +32,15 @@ boost::shared_ptr<Shape> SetupProjectionOperator::apply(boost::shared_ptr<Shape>
 	return shape;
 }
 
+void SetupProjectionOperator::toNode(GrammarNode& node) const {
+	node.tagName = "setupProjection";
+	if (axesSelector == AXES_SCOPE_XZ) {
+		node.setAttribute("axesSelector", "scope.xz");
+	} else {
+		node.setAttribute("axesSelector", "scope.xy");
+	}
+	node.addParam("texWidth", texWidth.value).setAttribute("type", texWidth.typeName());
+	node.addParam("texHeight", texHeight.value).setAttribute("type", texHeight.typeName());
+}
+
 }
@@ -13,6 +13,7 @@ private:
 public:
 	SetupProjectionOperator(int axesSelector, const Value& texWidth, const Value& texHeight);
 	boost::shared_ptr<Shape> apply(boost::shared_ptr<Shape>& shape, const Grammar& grammar, std::list<boost::shared_ptr<Shape> >& stack);
+	void toNode(GrammarNode& node) const;
 };
 
 }
\ No newline at end of file
@@ -5,11 +5,11 @@
 #include <iostream>
 #include <sstream>
 #include "CGA.h"
-#include "BoundingBox.h"
 
 namespace cga {
 
-std::map<std::string, Asset> Shape::assets;
+std::map<std::string, boost::shared_ptr<const Asset> > Shape::assets;
+boost::shared_mutex Shape::assets_mutex;
 
 void Shape::center(int axesSelector) {
 	if (axesSelector == AXES_SELECTOR_XYZ || axesSelector == AXES_SELECTOR_XY || axesSelector == AXES_SELECTOR_XZ || axesSelector == AXES_SELECTOR_X) {
@@ -49,83 +49,59 @@ boost::shared_ptr<Shape> Shape::inscribeCircle(const std::string& name) {
 	throw "inscribeCircle() is not supported.";
 }
 
+/**
+ * Insert the geometry of the OBJ file, which is scaled to fit the scope.
+ * The inserted shape refers to the shared asset with the scale instead of copying its geometry.
+ */
 boost::shared_ptr<Shape> Shape::insert(const std::string& name, const std::string& geometryPath) {
-	Asset asset = getAsset(geometryPath);
-	/*
-	std::vector<glm::vec3> points;
-	std::vector<glm::vec3> normals;
-	std::vector<glm::vec2> texCoords;
-	if (!OBJLoader::load(geometryPath.c_str(), points, normals, texCoords)) {
-		std::stringstream ss;
-		ss << "OBJ file cannot be read: " << geometryPath.c_str() << "." << std::endl;
-		std::cout << ss.str() << std::endl;
-		throw ss.str();
-	}
-	*/
+	boost::shared_ptr<const Asset> asset = getAsset(geometryPath);
 
 	// compute scale
 	float scaleX = 1.0f;
 	float scaleY = 1.0f;
 	float scaleZ = 1.0f;
 
-	BoundingBox bbox(asset.points);
+	glm::vec3 size = asset->size();
 	if (_scope.x != 0 && _scope.y != 0 && _scope.z != 0) {			// all non-zero
-		scaleX = _scope.x / bbox.sx();
-		scaleY = _scope.y / bbox.sy();
-		scaleZ = _scope.z / bbox.sz();
+		scaleX = _scope.x / size.x;
+		scaleY = _scope.y / size.y;
+		scaleZ = _scope.z / size.z;
 	} else if (_scope.x == 0 && _scope.y != 0 && _scope.z != 0) {	// sx == 0
-		scaleY = _scope.y / bbox.sy();
-		scaleZ = _scope.z / bbox.sz();
+		scaleY = _scope.y / size.y;
+		scaleZ = _scope.z / size.z;
 		scaleX = (scaleY + scaleZ) * 0.5f;
 	} else if (_scope.x != 0 && _scope.y == 0 && _scope.z != 0) {	// sy == 0
-		scaleX = _scope.x / bbox.sx();
-		scaleZ = _scope.z / bbox.sz();
+		scaleX = _scope.x / size.x;
+		scaleZ = _scope.z / size.z;
 		scaleY = (scaleX + scaleZ) * 0.5f;
 	} else if (_scope.x != 0 && _scope.y != 0 && _scope.z == 0) {	// sz == 0
-		scaleX = _scope.x / bbox.sx();
-		scaleY = _scope.y / bbox.sy();
+		scaleX = _scope.x / size.x;
+		scaleY = _scope.y / size.y;
 		scaleZ = (scaleX + scaleY) * 0.5f;
 	} else if (_scope.x != 0) {										// sy == 0 && sz == 0
-		scaleX = _scope.x / bbox.sx();
+		scaleX = _scope.x / size.x;
 		scaleY = scaleX;
 		scaleZ = scaleX;
 	} else if (_scope.y != 0) {										// sx == 0 && sz == 0
-		scaleY = _scope.y / bbox.sy();
+		scaleY = _scope.y / size.y;
 		scaleX = scaleY;
 		scaleZ = scaleY;
 	} else if (_scope.z != 0) {										// sx == 0 && sy == 0
-		scaleZ = _scope.z / bbox.sz();
+		scaleZ = _scope.z / size.z;
 		scaleX = scaleZ;
 		scaleY = scaleZ;
 	} else { // all zero
 		// do nothing
 	}
 
-	// scale the points
-	for (int i = 0; i < asset.points.size(); ++i) {
-		for (int k = 0; k < asset.points[i].size(); ++k) {
-			asset.points[i][k].x = (asset.points[i][k].x - bbox.minPt.x) * scaleX;
-			asset.points[i][k].y = (asset.points[i][k].y - bbox.minPt.y) * scaleY;
-			asset.points[i][k].z = (asset.points[i][k].z - bbox.minPt.z) * scaleZ;
-		}
-	}
-
-	// if texCoords are not defined in obj file, generate them automatically.
-	if (_texCoords.size() > 0 && asset.texCoords.size() == 0) {
-		asset.texCoords.resize(asset.points.size());
-		for (int i = 0; i < asset.points.size(); ++i) {
-			asset.texCoords[i].resize(asset.points[i].size());
-			for (int k = 0; k < asset.points[i].size(); ++k) {
-				asset.texCoords[i][k].x = asset.points[i][k].x / _scope.x * (_texCoords[1].x - _texCoords[0].x) + _texCoords[0].x;
-				asset.texCoords[i][k].y = asset.points[i][k].y / _scope.y * (_texCoords[2].y - _texCoords[0].y) + _texCoords[0].y;
-			}
-		}
-	}
-
-	if (asset.texCoords.size() > 0) {
-		return boost::shared_ptr<Shape>(new GeneralObject(name, _pivot, _modelMat, asset.points, asset.normals, _color, asset.texCoords, _texture));
+	if (asset->texCoords != NULL) {
+		return boost::shared_ptr<Shape>(new GeneralObject(name, _modelMat, asset, glm::vec3(scaleX, scaleY, scaleZ), _color, _texture));
+	} else if (_texCoords.size() > 0) {
+		// if texCoords are not defined in obj file, generate them automatically.
+		glm::vec2 texScale((_texCoords[1].x - _texCoords[0].x) / _scope.x, (_texCoords[2].y - _texCoords[0].y) / _scope.y);
+		return boost::shared_ptr<Shape>(new GeneralObject(name, _modelMat, asset, glm::vec3(scaleX, scaleY, scaleZ), _color, _texture, _texCoords[0], texScale));
 	} else {
-		return boost::shared_ptr<Shape>(new GeneralObject(name, _pivot, _modelMat, asset.points, asset.normals, _color));
+		return boost::shared_ptr<Shape>(new GeneralObject(name, _modelMat, asset, glm::vec3(scaleX, scaleY, scaleZ), _color));
 	}
 }
 
@@ -196,7 +172,7 @@ void Shape::translate(int mode, int coordSystem, float x, float y, float z) {
 	}
 }
 
-void Shape::generateGeometry(float opacity, std::vector<std::vector<Vertex> >& vertices) const {
+void Shape::generateGeometry(const AffineTransform& pivot, float opacity, std::vector<std::vector<Vertex> >& vertices) const {
 	throw "render() is not supported.";
 }
 
@@ -206,19 +182,29 @@ void Shape::generateGeometry(float opacity, std::vector<std::vector<Vertex> >& v
 	renderManager->addObject("axis", "", vertices);
 }*/
 
-Asset Shape::getAsset(const std::string& filename) {
-	if (assets.find(filename) == assets.end()) {
-		std::vector<std::vector<glm::vec3> > points;
-		std::vector<std::vector<glm::vec3> > normals;
-		std::vector<std::vector<glm::vec2> > texCoords;
-		if (!OBJLoader::load(filename.c_str(), points, normals, texCoords)) {
-			throw std::string("OBJ file cannot be read: ") + filename.c_str() + ".";
-		}
+/**
+ * Return the asset of the OBJ file, which is loaded only when it is requested for the first time.
+ * The derivations on multiple threads look up the cache concurrently, and the file is loaded without holding the lock.
+ */
+boost::shared_ptr<const Asset> Shape::getAsset(const std::string& filename) {
+	{
+		boost::shared_lock<boost::shared_mutex> lock(assets_mutex);
+		auto it = assets.find(filename);
+		if (it != assets.end()) return it->second;
+	}
 
-		assets[filename] = Asset(points, normals, texCoords);
+	boost::shared_ptr<const Asset> asset(Asset::load(filename));
+	if (!asset) {
+		throw std::string("OBJ file cannot be read: ") + filename.c_str() + ".";
 	}
 
-	return assets[filename];
+	// another thread may have loaded the same file in the meantime
+	boost::unique_lock<boost::shared_mutex> lock(assets_mutex);
+	auto it = assets.find(filename);
+	if (it != assets.end()) return it->second;
+
+	assets[filename] = asset;
+	return asset;
 }
 
 }
\ No newline at end of file
@@ -6,8 +6,11 @@
 #include <vector>
 #include <string>
 #include <boost/shared_ptr.hpp>
+#include <boost/thread/shared_mutex.hpp>
 #include "Asset.h"
 #include "Vertex.h"
+#include "AffineTransform.h"
+#include "TexCoordList.h"
 
 namespace cga {
 
@@ -15,18 +18,23 @@ class Shape {
 public:
 	std::string _name;
 	bool _removed;
-	glm::mat4 _modelMat;
+	AffineTransform _modelMat;
 	glm::vec3 _color;
 	bool _textureEnabled;
 	std::string _texture;
-	std::vector<glm::vec2> _texCoords;
+	TexCoordList _texCoords;
 	glm::vec3 _scope;
 	glm::vec3 _prev_scope;
-	glm::mat4 _pivot;
 
-	static std::map<std::string, Asset> assets;
+	/** the number of the rules applied to derive this shape from the start shape, which is set by CGA::derive */
+	int _depth;
+
+	static std::map<std::string, boost::shared_ptr<const Asset> > assets;
+	static boost::shared_mutex assets_mutex;
 
 public:
+	Shape() : _depth(0) {}
+
 	void center(int axesSelector);
 	virtual boost::shared_ptr<Shape> clone(const std::string& name) const;
 	virtual void comp(const std::map<std::string, std::string>& name_map, std::vector<boost::shared_ptr<Shape> >& shapes);
@@ -47,11 +55,11 @@ public:
 	virtual boost::shared_ptr<Shape> taper(const std::string& name, float height, float top_ratio = 0.0f);
 	void texture(const std::string& tex);
 	void translate(int mode, int coordSystem, float x, float y, float z);
-	virtual void generateGeometry(float opacity, std::vector<std::vector<Vertex> >& vertices) const;
+	virtual void generateGeometry(const AffineTransform& pivot, float opacity, std::vector<std::vector<Vertex> >& vertices) const;
 
 protected:
 	//void drawAxes(RenderManager* renderManager, const glm::mat4& modelMat) const;
-	static Asset getAsset(const std::string& filename);
+	static boost::shared_ptr<const Asset> getAsset(const std::string& filename);
 };
 
 }
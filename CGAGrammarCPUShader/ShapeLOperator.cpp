@@ -14,4 +14,10 @@ boost::shared_ptr<Shape> ShapeLOperator::apply(boost::shared_ptr<Shape>& shape,
 	return shape->shapeL(shape->_name, frontWidth, leftWidth);
 }
 
+void ShapeLOperator::toNode(GrammarNode& node) const {
+	node.tagName = "shapeL";
+	node.addParam("frontWidth", "").setAttribute("value", frontWidth);
+	node.addParam("leftWidth", "").setAttribute("value", leftWidth);
+}
+
 }
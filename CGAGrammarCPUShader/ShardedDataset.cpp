@@ -0,0 +1,314 @@
+#include "ShardedDataset.h"
+#include "ImagePipeline.h"
+#include <iostream>
+#include <cstring>
+#include <climits>
+
+const char* ShardedDatasetWriter::MAGIC = "CGASHARD";
+
+/**
+ * @param image_format		IMAGE_RAW to store the grayscale pixels as they are, or IMAGE_PNG to compress them as PNG files
+ * @param samples_per_shard	the number of samples in one shard file
+ */
+ShardedDatasetWriter::ShardedDatasetWriter(int image_format, int samples_per_shard) {
+	this->image_format = image_format;
+	this->samples_per_shard = samples_per_shard;
+	this->image_width = 0;
+	this->image_height = 0;
+	this->shard_id = 0;
+	this->offset = 0;
+}
+
+ShardedDatasetWriter::~ShardedDatasetWriter() {
+	close();
+}
+
+bool ShardedDatasetWriter::open(const QString& output_dir, int image_width, int image_height) {
+	this->output_dir = output_dir;
+	this->image_width = image_width;
+	this->image_height = image_height;
+	this->shard_id = 0;
+
+	return openShard();
+}
+
+void ShardedDatasetWriter::encode(ImageSample* sample) const {
+	sample->encoded_images.resize(sample->images.size());
+	for (int i = 0; i < sample->images.size(); ++i) {
+		const QImage& image = sample->images[i];
+		if (image_format == IMAGE_PNG) {
+			QByteArray pixels = encodeGrayscale(image);
+			QImage gray((const uchar*)pixels.constData(), image.width(), image.height(), image.width(), QImage::Format_Indexed8);
+			gray.setColorTable(grayColorTable());
+
+			// the images are mostly white, so a middle compression level (zlib level 4) is enough
+			sample->encoded_images[i] = encodePNG(gray, 50);
+		} else {
+			sample->encoded_images[i] = encodeGrayscale(image);
+		}
+	}
+}
+
+/**
+ * Append the images of the sample to the current shard.
+ * The samples have to come in the order of the index.
+ */
+void ShardedDatasetWriter::write(ImageSample* sample) {
+	for (int i = 0; i < sample->encoded_images.size(); ++i) {
+		// the images are dropped after a shard cannot be opened
+		if (!file.isOpen()) return;
+
+		if (index.size() >= samples_per_shard) {
+			closeShard();
+			shard_id++;
+			if (!openShard()) return;
+		}
+
+		ShardIndexEntry entry;
+		entry.offset = offset;
+		entry.num_params = sample->param_values.size();
+		entry.image_size = sample->encoded_images[i].size();
+
+		float camera_values[NUM_CAMERA_VALUES];
+		cameraValues(sample->cameras[i], camera_values);
+
+		static const char padding[SHARD_ALIGNMENT] = { 0 };
+		qint64 record_size = (entry.num_params + NUM_CAMERA_VALUES) * sizeof(float) + entry.image_size;
+		int padding_size = (SHARD_ALIGNMENT - record_size % SHARD_ALIGNMENT) % SHARD_ALIGNMENT;
+
+		if (entry.num_params > 0) {
+			file.write((const char*)&sample->param_values[0], entry.num_params * sizeof(float));
+		}
+		file.write((const char*)camera_values, NUM_CAMERA_VALUES * sizeof(float));
+		file.write(sample->encoded_images[i]);
+		if (file.write(padding, padding_size) < 0) {
+			std::cerr << "Cannot write the image " << sample->image_index + i << ": " << qPrintable(file.errorString()) << std::endl;
+		}
+
+		offset += record_size + padding_size;
+		index.push_back(entry);
+	}
+}
+
+void ShardedDatasetWriter::close() {
+	if (file.isOpen()) {
+		closeShard();
+	}
+}
+
+QString ShardedDatasetWriter::shardFileName(const QString& dir, int shard_id) {
+	return dir + "/" + QString("shard_%1.bin").arg(shard_id, 4, 10, QChar('0'));
+}
+
+/**
+ * Start a new shard file.
+ * The header is written when the shard is closed, because the number of samples is not known yet.
+ */
+bool ShardedDatasetWriter::openShard() {
+	index.clear();
+
+	file.setFileName(shardFileName(output_dir, shard_id));
+	if (!file.open(QIODevice::WriteOnly)) {
+		std::cerr << "Cannot open file for writing: " << qPrintable(file.errorString()) << std::endl;
+		return false;
+	}
+
+	ShardHeader header;
+	memset(&header, 0, sizeof(ShardHeader));
+	file.write((const char*)&header, sizeof(ShardHeader));
+
+	offset = sizeof(ShardHeader);
+
+	return true;
+}
+
+/**
+ * Write the index and the header, and close the shard file.
+ */
+void ShardedDatasetWriter::closeShard() {
+	ShardHeader header;
+	memcpy(header.magic, MAGIC, sizeof(header.magic));
+	header.version = VERSION;
+	header.image_format = image_format;
+	header.image_width = image_width;
+	header.image_height = image_height;
+	header.samples_per_shard = samples_per_shard;
+	header.num_samples = index.size();
+	header.first_index = (quint64)shard_id * samples_per_shard;
+	header.index_offset = offset;
+
+	if (!index.empty()) {
+		file.write((const char*)&index[0], index.size() * sizeof(ShardIndexEntry));
+	}
+	file.seek(0);
+	file.write((const char*)&header, sizeof(ShardHeader));
+	file.close();
+}
+
+/**
+ * Color table that maps the 8-bit pixel values to the gray levels.
+ */
+QVector<QRgb> ShardedDatasetWriter::grayColorTable() {
+	QVector<QRgb> colors(256);
+	for (int i = 0; i < 256; ++i) {
+		colors[i] = qRgb(i, i, i);
+	}
+	return colors;
+}
+
+ShardedDatasetReader::ShardedDatasetReader() {
+	samples_per_shard = 0;
+	num_samples = 0;
+}
+
+ShardedDatasetReader::~ShardedDatasetReader() {
+	close();
+}
+
+/**
+ * Map all the shards in the directory.
+ *
+ * @param dir	the directory that contains shard_0000.bin, shard_0001.bin, ...
+ * @return		false if no valid shard is found
+ */
+bool ShardedDatasetReader::open(const QString& dir) {
+	close();
+
+	for (int shard_id = 0; QFile::exists(ShardedDatasetWriter::shardFileName(dir, shard_id)); ++shard_id) {
+		QFile* file = new QFile(ShardedDatasetWriter::shardFileName(dir, shard_id));
+		files.push_back(file);
+
+		if (!file->open(QIODevice::ReadOnly) || file->size() < sizeof(ShardHeader)) {
+			std::cerr << "Cannot open the shard: " << qPrintable(file->fileName()) << std::endl;
+			close();
+			return false;
+		}
+
+		const uchar* data = file->map(0, file->size());
+		if (data == NULL) {
+			std::cerr << "Cannot map the shard: " << qPrintable(file->errorString()) << std::endl;
+			close();
+			return false;
+		}
+		shards.push_back(data);
+
+		const ShardHeader* header = (const ShardHeader*)data;
+		if (!isValidShard(header, file->size(), shard_id)) {
+			std::cerr << "Invalid shard: " << qPrintable(file->fileName()) << std::endl;
+			close();
+			return false;
+		}
+
+		samples_per_shard = header->samples_per_shard;
+		num_samples += header->num_samples;
+	}
+
+	return !shards.empty();
+}
+
+/**
+ * Check the header and the index of the shard against the file size, so that no sample points outside the mapped file.
+ * The shards before this one have been checked, and all of them must be full.
+ */
+bool ShardedDatasetReader::isValidShard(const ShardHeader* header, qint64 file_size, int shard_id) const {
+	if (memcmp(header->magic, ShardedDatasetWriter::MAGIC, sizeof(header->magic)) != 0 || header->version != ShardedDatasetWriter::VERSION) return false;
+	if (header->image_format != ShardedDatasetWriter::IMAGE_RAW && header->image_format != ShardedDatasetWriter::IMAGE_PNG) return false;
+	if (header->samples_per_shard == 0 || header->samples_per_shard > INT_MAX || header->num_samples > header->samples_per_shard) return false;
+	if (shard_id > 0) {
+		if ((int)header->samples_per_shard != samples_per_shard || num_samples != shard_id * samples_per_shard) return false;
+	}
+	if (header->first_index != (quint64)shard_id * header->samples_per_shard) return false;
+
+	if (header->index_offset < sizeof(ShardHeader) || header->index_offset > (quint64)file_size) return false;
+	if (((quint64)file_size - header->index_offset) / sizeof(ShardIndexEntry) < header->num_samples) return false;
+
+	const uchar* data = (const uchar*)header;
+	const ShardIndexEntry* entries = (const ShardIndexEntry*)(data + header->index_offset);
+	for (quint32 i = 0; i < header->num_samples; ++i) {
+		if (entries[i].offset < sizeof(ShardHeader)) return false;
+		if (header->image_format == ShardedDatasetWriter::IMAGE_RAW && entries[i].image_size < (quint64)header->image_width * header->image_height) return false;
+
+		// the record must end before the index
+		quint64 record_size = ((quint64)entries[i].num_params + DatasetWriter::NUM_CAMERA_VALUES) * sizeof(float) + entries[i].image_size;
+		if (entries[i].offset > header->index_offset || record_size > header->index_offset - entries[i].offset) return false;
+	}
+
+	return true;
+}
+
+void ShardedDatasetReader::close() {
+	for (int i = 0; i < files.size(); ++i) {
+		delete files[i];
+	}
+	files.clear();
+	shards.clear();
+	samples_per_shard = 0;
+	num_samples = 0;
+}
+
+int ShardedDatasetReader::size() const {
+	return num_samples;
+}
+
+int ShardedDatasetReader::numParams(int index) const {
+	return entry(index)->num_params;
+}
+
+/**
+ * Return the parameter values of the sample.
+ * The pointer is valid until the reader is closed.
+ */
+const float* ShardedDatasetReader::params(int index) const {
+	return (const float*)(shards[index / samples_per_shard] + entry(index)->offset);
+}
+
+/**
+ * Return the camera values of the sample (see DatasetWriter::cameraValues()).
+ * The pointer is valid until the reader is closed.
+ */
+const float* ShardedDatasetReader::camera(int index) const {
+	return params(index) + numParams(index);
+}
+
+/**
+ * Return the image bytes of the sample as they are stored in the shard.
+ * The pointer is valid until the reader is closed.
+ *
+ * @param image_size	[OUT] the number of bytes
+ */
+const uchar* ShardedDatasetReader::imageData(int index, int& image_size) const {
+	const ShardIndexEntry* e = entry(index);
+	image_size = e->image_size;
+	return shards[index / samples_per_shard] + e->offset + (e->num_params + DatasetWriter::NUM_CAMERA_VALUES) * sizeof(float);
+}
+
+/**
+ * Return the image of the sample as an 8-bit grayscale image.
+ */
+QImage ShardedDatasetReader::image(int index) const {
+	const ShardHeader* h = header(index);
+	int image_size;
+	const uchar* data = imageData(index, image_size);
+
+	if (h->image_format == ShardedDatasetWriter::IMAGE_PNG) {
+		return QImage::fromData(data, image_size, "PNG");
+	}
+
+	QImage image(h->image_width, h->image_height, QImage::Format_Indexed8);
+	image.setColorTable(ShardedDatasetWriter::grayColorTable());
+	for (int y = 0; y < h->image_height; ++y) {
+		memcpy(image.scanLine(y), data + y * h->image_width, h->image_width);
+	}
+	return image;
+}
+
+const ShardHeader* ShardedDatasetReader::header(int index) const {
+	if (index < 0 || index >= num_samples) throw "sample index is out of range.";
+
+	return (const ShardHeader*)shards[index / samples_per_shard];
+}
+
+const ShardIndexEntry* ShardedDatasetReader::entry(int index) const {
+	const ShardHeader* h = header(index);
+	return (const ShardIndexEntry*)(shards[index / samples_per_shard] + h->index_offset) + index % samples_per_shard;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <vector>
+#include <QString>
+#include <QImage>
+#include <QFile>
+#include <QVector>
+#include "DatasetWriter.h"
+
+/**
+ * Layout of a shard file (little endian):
+ *
+ *   ShardHeader
+ *   record 0, record 1, ...       (each record starts at a multiple of SHARD_ALIGNMENT)
+ *   ShardIndexEntry x num_samples (at header.index_offset)
+ *
+ * A record is the float parameter values, the float camera values, and the image bytes.
+ * The image is 8-bit grayscale pixels (IMAGE_RAW, image_width x image_height, top row first) or a PNG file (IMAGE_PNG).
+ * The sample of the global index i is the record (i - first_index) of the shard (i / samples_per_shard),
+ * so any sample can be located without scanning the files.
+ */
+struct ShardHeader {
+	char magic[8];
+	quint32 version;
+	quint32 image_format;
+	quint32 image_width;
+	quint32 image_height;
+	quint32 samples_per_shard;
+	quint32 num_samples;
+	quint64 first_index;
+	quint64 index_offset;
+};
+
+struct ShardIndexEntry {
+	quint64 offset;
+	quint32 num_params;
+	quint32 image_size;
+};
+
+/**
+ * Writer of the sharded dataset.
+ * The samples are appended to shard_0000.bin, shard_0001.bin, ..., and a new shard is started every samples_per_shard samples.
+ */
+class ShardedDatasetWriter : public DatasetWriter {
+public:
+	enum { IMAGE_RAW = 0, IMAGE_PNG };
+
+	static const char* MAGIC;
+	static const int VERSION = 2;
+	static const int SHARD_ALIGNMENT = 16;
+
+private:
+	int image_format;
+	int samples_per_shard;
+
+	QString output_dir;
+	int image_width;
+	int image_height;
+	QFile file;
+	int shard_id;
+	qint64 offset;
+	std::vector<ShardIndexEntry> index;
+
+public:
+	ShardedDatasetWriter(int image_format = IMAGE_RAW, int samples_per_shard = 10000);
+	~ShardedDatasetWriter();
+
+	bool open(const QString& output_dir, int image_width, int image_height);
+	void encode(ImageSample* sample) const;
+	void write(ImageSample* sample);
+	void close();
+
+	static QString shardFileName(const QString& dir, int shard_id);
+	static QVector<QRgb> grayColorTable();
+
+private:
+	bool openShard();
+	void closeShard();
+};
+
+/**
+ * Reader of the sharded dataset.
+ * All the shards are memory-mapped, so the parameter values and the image of any sample are accessed in O(1) without copying.
+ */
+class ShardedDatasetReader {
+private:
+	std::vector<QFile*> files;
+	std::vector<const uchar*> shards;
+	int samples_per_shard;
+	int num_samples;
+
+public:
+	ShardedDatasetReader();
+	~ShardedDatasetReader();
+
+	bool open(const QString& dir);
+	void close();
+	int size() const;
+	int numParams(int index) const;
+	const float* params(int index) const;
+	const float* camera(int index) const;
+	const uchar* imageData(int index, int& image_size) const;
+	QImage image(int index) const;
+
+private:
+	bool isValidShard(const ShardHeader* header, qint64 file_size, int shard_id) const;
+	const ShardHeader* header(int index) const;
+	const ShardIndexEntry* entry(int index) const;
+};
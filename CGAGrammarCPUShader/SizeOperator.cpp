@@ -1,6 +1,7 @@
 #include "SizeOperator.h"
 #include "CGA.h"
 #include "Shape.h"
+#include "BatchDerivation.h"
 
 namespace cga {
 
@@ -38,4 +39,38 @@ boost::shared_ptr<Shape> SizeOperator::apply(boost::shared_ptr<Shape>& shape, co
 	return shape;
 }
 
+/**
+ * Resize the shapes of multiple samples.
+ * The sizes are evaluated for all the samples at once, and then each shape is resized in the same way as apply().
+ */
+void SizeOperator::applyBatch(std::vector<boost::shared_ptr<Shape> >& shapes, const std::vector<int>& samples, BatchEvaluator& evaluator, std::vector<std::list<boost::shared_ptr<Shape> > >& stacks, std::vector<std::exception_ptr>& errors) {
+	std::vector<float> xSizes;
+	std::vector<float> ySizes;
+	std::vector<float> zSizes;
+	try {
+		evaluator.evalFloat(xSize.value, samples, shapes, xSizes);
+		evaluator.evalFloat(ySize.value, samples, shapes, ySizes);
+		evaluator.evalFloat(zSize.value, samples, shapes, zSizes);
+	} catch (...) {
+		// the shapes are resized one by one so that only the samples with the error fail
+		Operator::applyBatch(shapes, samples, evaluator, stacks, errors);
+		return;
+	}
+
+	for (int k = 0; k < shapes.size(); ++k) {
+		float actual_xSize = xSize.type == Value::TYPE_RELATIVE ? shapes[k]->_scope.x * xSizes[k] : xSizes[k];
+		float actual_ySize = ySize.type == Value::TYPE_RELATIVE ? shapes[k]->_scope.y * ySizes[k] : ySizes[k];
+		float actual_zSize = zSize.type == Value::TYPE_RELATIVE ? shapes[k]->_scope.z * zSizes[k] : zSizes[k];
+
+		shapes[k]->size(actual_xSize, actual_ySize, actual_zSize);
+	}
+}
+
+void SizeOperator::toNode(GrammarNode& node) const {
+	node.tagName = "size";
+	node.addParam("xSize", xSize.value).setAttribute("type", xSize.typeName());
+	node.addParam("ySize", ySize.value).setAttribute("type", ySize.typeName());
+	node.addParam("zSize", zSize.value).setAttribute("type", zSize.typeName());
+}
+
 }
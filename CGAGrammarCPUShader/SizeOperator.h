@@ -15,6 +15,8 @@ public:
 	SizeOperator(const Value& xSize, const Value& ySize, const Value& zSize);
 
 	boost::shared_ptr<Shape> apply(boost::shared_ptr<Shape>& shape, const Grammar& grammar, std::list<boost::shared_ptr<Shape> >& stack);
+	void applyBatch(std::vector<boost::shared_ptr<Shape> >& shapes, const std::vector<int>& samples, BatchEvaluator& evaluator, std::vector<std::list<boost::shared_ptr<Shape> > >& stacks, std::vector<std::exception_ptr>& errors);
+	void toNode(GrammarNode& node) const;
 };
 
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "SplitOperator.h"
 #include "CGA.h"
 #include "Shape.h"
+#include "BatchDerivation.h"
 
 namespace cga {
 
@@ -32,4 +33,71 @@ boost::shared_ptr<Shape> SplitOperator::apply(boost::shared_ptr<Shape>& shape, c
 	return boost::shared_ptr<Shape>();
 }
 
+/**
+ * Split the shapes of multiple samples.
+ * The sizes are evaluated for all the samples at once, and then each shape is split in the same way as apply().
+ * The pieces are checked against the budget for each sample before they are allocated, as apply() does.
+ */
+void SplitOperator::applyBatch(std::vector<boost::shared_ptr<Shape> >& shapes, const std::vector<int>& samples, BatchEvaluator& evaluator, std::vector<std::list<boost::shared_ptr<Shape> > >& stacks, std::vector<std::exception_ptr>& errors) {
+	bool decode = splitAxis == DIRECTION_X || splitAxis == DIRECTION_Y || splitAxis == DIRECTION_Z;
+
+	// values[i][k] is the i-th size for the k-th shape
+	std::vector<std::vector<float> > values(sizes.size());
+	if (decode) {
+		try {
+			for (int i = 0; i < sizes.size(); ++i) {
+				evaluator.evalFloat(sizes[i].value, samples, shapes, values[i]);
+			}
+		} catch (...) {
+			// the shapes are split one by one so that only the samples with the error fail
+			Operator::applyBatch(shapes, samples, evaluator, stacks, errors);
+			return;
+		}
+	}
+
+	std::vector<float> shape_values(sizes.size());
+	for (int k = 0; k < shapes.size(); ++k) {
+		std::vector<boost::shared_ptr<Shape> > floors;
+
+		std::vector<float> decoded_sizes;
+		std::vector<std::string> decoded_output_names;
+		if (decode) {
+			for (int i = 0; i < sizes.size(); ++i) {
+				shape_values[i] = values[i][k];
+			}
+			try {
+				Rule::decodeSplitSizes(shapes[k]->_scope[splitAxis], sizes, shape_values, output_names, decoded_sizes, decoded_output_names);
+			} catch (...) {
+				// such as too many pieces for the budget, which stops only this sample
+				shapes[k] = boost::shared_ptr<Shape>();
+				errors[k] = std::current_exception();
+				continue;
+			}
+		}
+
+		shapes[k]->split(splitAxis, decoded_sizes, decoded_output_names, floors);
+		stacks[k].insert(stacks[k].end(), floors.begin(), floors.end());
+		shapes[k] = boost::shared_ptr<Shape>();
+	}
+}
+
+void SplitOperator::toNode(GrammarNode& node) const {
+	node.tagName = "split";
+	if (splitAxis == DIRECTION_X) {
+		node.setAttribute("splitAxis", "x");
+	} else if (splitAxis == DIRECTION_Y) {
+		node.setAttribute("splitAxis", "y");
+	} else {
+		node.setAttribute("splitAxis", "z");
+	}
+
+	for (int i = 0; i < sizes.size(); ++i) {
+		GrammarNode& param = node.addParam(output_names[i], sizes[i].value);
+		param.setAttribute("type", sizes[i].typeName());
+		if (sizes[i].repeat) {
+			param.setAttribute("repeat", "true");
+		}
+	}
+}
+
 }
@@ -17,4 +17,10 @@ boost::shared_ptr<Shape> TaperOperator::apply(boost::shared_ptr<Shape>& shape, c
 	return shape->taper(shape->_name, actual_height, actual_top_ratio);
 }
 
+void TaperOperator::toNode(GrammarNode& node) const {
+	node.tagName = "taper";
+	node.setAttribute("height", height);
+	node.setAttribute("top_ratio", top_ratio);
+}
+
 }
@@ -0,0 +1,56 @@
+#include "TerminalShapeConsumer.h"
+#include "CGA.h"
+
+namespace cga {
+
+ShapeCollector::ShapeCollector(std::vector<boost::shared_ptr<Shape> >& shapes) : shapes(shapes) {
+}
+
+void ShapeCollector::consume(const boost::shared_ptr<Shape>& shape) {
+	shapes.push_back(shape);
+}
+
+GeometryGenerator::GeometryGenerator(std::vector<std::vector<Vertex> >& vertices, const AffineTransform& pivot, int max_polygons) : vertices(vertices) {
+	this->pivot = pivot;
+	this->max_polygons = max_polygons;
+	this->num_shapes = 0;
+	this->num_polygons = 0;
+}
+
+void GeometryGenerator::consume(const boost::shared_ptr<Shape>& shape) {
+	int offset = vertices.size();
+	shape->generateGeometry(pivot, 1.0f, vertices);
+	num_shapes++;
+
+	num_polygons += (int)vertices.size() - offset;
+	if (max_polygons > 0 && num_polygons > max_polygons) {
+		throw BudgetExceededError(BudgetExceededError::BUDGET_TERMINAL_POLYGONS, max_polygons, shape->_name, num_shapes, 0);
+	}
+}
+
+InstancedGeometryGenerator::InstancedGeometryGenerator(InstancedGeometry& geometry, const AffineTransform& pivot, int max_polygons) : geometry(geometry) {
+	this->pivot = pivot;
+	this->max_polygons = max_polygons;
+	this->num_shapes = 0;
+	this->num_polygons = 0;
+}
+
+void InstancedGeometryGenerator::consume(const boost::shared_ptr<Shape>& shape) {
+	// the shape may be shared by others, so the geometry in the local coordinates is generated from its copy
+	boost::shared_ptr<Shape> local = shape->clone(shape->_name);
+	local->_modelMat = AffineTransform();
+
+	mesh.clear();
+	local->generateGeometry(AffineTransform(), 1.0f, mesh);
+	num_shapes++;
+	if (mesh.empty()) return;
+
+	geometry.addInstance(geometry.addMesh(mesh), pivot * shape->_modelMat);
+
+	num_polygons += mesh.size();
+	if (max_polygons > 0 && num_polygons > max_polygons) {
+		throw BudgetExceededError(BudgetExceededError::BUDGET_TERMINAL_POLYGONS, max_polygons, shape->_name, num_shapes, 0);
+	}
+}
+
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include "Shape.h"
+#include "Vertex.h"
+#include "InstancedGeometry.h"
+
+namespace cga {
+
+/**
+ * Receiver of the terminal shapes of CGA::derive().
+ * Each terminal shape is passed as soon as it is derived, in the same order as CGA::shapes, so the shape can be
+ * turned into the geometry and released during the derivation instead of keeping all the terminal shapes until the end.
+ */
+class TerminalShapeConsumer {
+public:
+	virtual ~TerminalShapeConsumer() {}
+
+	virtual void consume(const boost::shared_ptr<Shape>& shape) = 0;
+};
+
+/**
+ * Consumer that keeps the terminal shapes.
+ */
+class ShapeCollector : public TerminalShapeConsumer {
+private:
+	std::vector<boost::shared_ptr<Shape> >& shapes;
+
+public:
+	ShapeCollector(std::vector<boost::shared_ptr<Shape> >& shapes);
+
+	void consume(const boost::shared_ptr<Shape>& shape);
+};
+
+/**
+ * Consumer that generates the polygons of the terminal shapes, which are transformed by the pivot of the derivation.
+ * BudgetExceededError is thrown if the number of the polygons exceeds max_polygons (0 means no limit).
+ */
+class GeometryGenerator : public TerminalShapeConsumer {
+private:
+	std::vector<std::vector<Vertex> >& vertices;
+	AffineTransform pivot;
+	int max_polygons;
+	int num_shapes;
+	int num_polygons;
+
+public:
+	GeometryGenerator(std::vector<std::vector<Vertex> >& vertices, const AffineTransform& pivot, int max_polygons = 0);
+
+	void consume(const boost::shared_ptr<Shape>& shape);
+};
+
+/**
+ * Consumer that generates the instanced geometry of the terminal shapes.
+ * The geometry of each shape is generated in its local coordinates and placed by the pivot of the derivation and its model matrix.
+ * BudgetExceededError is thrown if the number of the polygons exceeds max_polygons (0 means no limit).
+ */
+class InstancedGeometryGenerator : public TerminalShapeConsumer {
+private:
+	InstancedGeometry& geometry;
+	AffineTransform pivot;
+	int max_polygons;
+	int num_shapes;
+	int num_polygons;
+	std::vector<std::vector<Vertex> > mesh;
+
+public:
+	InstancedGeometryGenerator(InstancedGeometry& geometry, const AffineTransform& pivot, int max_polygons = 0);
+
+	void consume(const boost::shared_ptr<Shape>& shape);
+};
+
+}
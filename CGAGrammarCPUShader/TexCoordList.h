@@ -0,0 +1,83 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <algorithm>
+
+namespace cga {
+
+/**
+ * Texture coordinates of a shape.
+ *
+ * Most of the shapes are rectangles, which have 4 texture coordinates, so up to 4 coordinates are stored in the shape
+ * itself without allocating memory, and only the polygons with more vertices use the heap.
+ * The inline coordinates and the pointer to the heap share the memory, so it is 40 bytes on 64-bit, while
+ * std::vector is 24 bytes plus the allocated coordinates.
+ * It has the same interface as std::vector for the operations that the shapes use.
+ */
+class TexCoordList {
+private:
+	static const int INLINE_SIZE = 4;
+
+	int count;
+	union {
+		/** the coordinates if there are up to INLINE_SIZE of them */
+		float inline_coords[INLINE_SIZE * 2];
+		/** the coordinates if there are more */
+		std::vector<glm::vec2>* heap_coords;
+	};
+
+public:
+	TexCoordList() : count(0) {}
+	TexCoordList(const TexCoordList& other) : count(0) { *this = other; }
+	~TexCoordList() { clear(); }
+
+	TexCoordList& operator=(const TexCoordList& other) {
+		if (this == &other) return *this;
+		resize(other.count);
+		for (int i = 0; i < count; ++i) (*this)[i] = other[i];
+		return *this;
+	}
+
+	int size() const { return count; }
+	bool empty() const { return count == 0; }
+
+	void resize(int n) {
+		if (n > INLINE_SIZE) {
+			if (count > INLINE_SIZE) {
+				heap_coords->resize(n);
+			} else {
+				std::vector<glm::vec2>* coords = new std::vector<glm::vec2>(inlineCoords(), inlineCoords() + count);
+				coords->resize(n);
+				heap_coords = coords;
+			}
+		} else {
+			if (count > INLINE_SIZE) {
+				// the pointer is overwritten by the coordinates
+				std::vector<glm::vec2>* coords = heap_coords;
+				std::copy(coords->begin(), coords->begin() + n, inlineCoords());
+				delete coords;
+			} else {
+				std::fill(inlineCoords() + count, inlineCoords() + (std::max)(count, n), glm::vec2());
+			}
+		}
+		count = n;
+	}
+
+	void clear() { resize(0); }
+
+	void push_back(const glm::vec2& texCoord) {
+		glm::vec2 value = texCoord;
+		resize(count + 1);
+		(*this)[count - 1] = value;
+	}
+
+	glm::vec2& operator[](int i) { return count > INLINE_SIZE ? (*heap_coords)[i] : inlineCoords()[i]; }
+	const glm::vec2& operator[](int i) const { return count > INLINE_SIZE ? (*heap_coords)[i] : inlineCoords()[i]; }
+
+private:
+	glm::vec2* inlineCoords() { return reinterpret_cast<glm::vec2*>(inline_coords); }
+	const glm::vec2* inlineCoords() const { return reinterpret_cast<const glm::vec2*>(inline_coords); }
+};
+
+}
@@ -0,0 +1,695 @@
+#include "TextGrammarParser.h"
+#include "GrammarParser.h"
+#include <QFile>
+#include <QFileInfo>
+#include <cctype>
+#include <cstdlib>
+#include <sstream>
+
+namespace cga {
+
+namespace {
+
+/** the operations that only affect the attributes, the UV coordinates, or the normals, which have no effect on this engine */
+const char* IGNORED_OPERATIONS[] = { "set", "projectUV", "tileUV", "translateUV", "scaleUV", "rotateUV", "normalizeUV", "deleteUV", "reverseNormals", "setNormals", "print", "report", "alignScopeToAxes", "alignScopeToGeometry", "cleanupGeometry", NULL };
+
+/** the selectors of the component split that the CompOperator supports */
+const char* COMP_SELECTORS[] = { "front", "back", "left", "right", "side", "top", "bottom", "inside", "border", "vertical", NULL };
+
+/** the operators of two characters in the expressions */
+const char* TWO_CHAR_SYMBOLS[] = { "||", "&&", "==", "!=", "<=", ">=", NULL };
+
+bool contains(const char** list, const std::string& str) {
+	for (int i = 0; list[i] != NULL; ++i) {
+		if (str == list[i]) return true;
+	}
+	return false;
+}
+
+bool isNumber(const std::string& str) {
+	if (str.empty()) return false;
+
+	char* end;
+	strtod(str.c_str(), &end);
+	return *end == '\0';
+}
+
+}
+
+/**
+ * Parse the CGA text file.
+ */
+void TextGrammarParser::parse(const char* filename, Grammar& grammar) {
+	this->filename = filename;
+
+	QFile file(QString::fromUtf8(filename));
+	if (!file.open(QIODevice::ReadOnly)) {
+		throw std::string("Cannot open grammar file: ") + filename;
+	}
+	QByteArray data = file.readAll();
+	file.close();
+
+	parse(data.constData(), data.size(), grammar);
+}
+
+/**
+ * Parse the CGA text in memory.
+ */
+void TextGrammarParser::parse(const char* data, int size, Grammar& grammar) {
+	tokenize(data, size);
+	pos = 0;
+	has_range = false;
+	is_start_rule = false;
+	start_rule.clear();
+
+	while (peek().type != TOKEN_END) {
+		if (isSymbol("@")) {
+			parseAnnotation();
+		} else if (isIdent("version")) {
+			next();
+			if (peek().type == TOKEN_STRING) next();
+		} else if (isIdent("attr") || isIdent("const")) {
+			parseAttr(grammar);
+		} else if (isIdent("import")) {
+			error("import is not supported.");
+		} else if (peek().type == TOKEN_IDENT) {
+			parseRule(grammar);
+		} else {
+			error("unexpected '" + peek().text + "'.");
+		}
+	}
+
+	// the derivation always starts with the rule "Start", so it is connected to the start rule of the file
+	if (!start_rule.empty() && !grammar.contain("Start")) {
+		GrammarNode node("copy");
+		node.setAttribute("name", start_rule);
+		grammar.addRule("Start");
+		grammar.addOperator("Start", parseOperator(node));
+	}
+}
+
+/**
+ * Split the text into the tokens.
+ * The comments (#, //, and the block comments) are skipped, and the line number is kept in each token for the error messages.
+ */
+void TextGrammarParser::tokenize(const char* data, int size) {
+	tokens.clear();
+
+	int line = 1;
+	int i = 0;
+	while (i < size) {
+		char c = data[i];
+		if (c == '\n') {
+			line++;
+			i++;
+			continue;
+		}
+		if (isspace((unsigned char)c)) {
+			i++;
+			continue;
+		}
+		if (c == '#' || (c == '/' && i + 1 < size && data[i + 1] == '/')) {
+			while (i < size && data[i] != '\n') i++;
+			continue;
+		}
+		if (c == '/' && i + 1 < size && data[i + 1] == '*') {
+			i += 2;
+			while (i + 1 < size && !(data[i] == '*' && data[i + 1] == '/')) {
+				if (data[i] == '\n') line++;
+				i++;
+			}
+			i += 2;
+			continue;
+		}
+
+		Token token;
+		token.line = line;
+		if (isalpha((unsigned char)c) || c == '_') {
+			// the identifier may contain '.', such as scope.sx or Roof.
+			int begin = i;
+			while (i < size && (isalnum((unsigned char)data[i]) || data[i] == '_' || data[i] == '.')) i++;
+			token.type = TOKEN_IDENT;
+			token.text.assign(data + begin, i - begin);
+		} else if (isdigit((unsigned char)c) || (c == '.' && i + 1 < size && isdigit((unsigned char)data[i + 1]))) {
+			int begin = i;
+			while (i < size && (isdigit((unsigned char)data[i]) || data[i] == '.')) i++;
+			if (i < size && (data[i] == 'e' || data[i] == 'E')) {
+				i++;
+				if (i < size && (data[i] == '+' || data[i] == '-')) i++;
+				while (i < size && isdigit((unsigned char)data[i])) i++;
+			}
+			token.type = TOKEN_NUMBER;
+			token.text.assign(data + begin, i - begin);
+		} else if (c == '"') {
+			i++;
+			while (i < size && data[i] != '"') {
+				if (data[i] == '\\' && i + 1 < size) i++;
+				if (data[i] == '\n') line++;
+				token.text += data[i];
+				i++;
+			}
+			if (i >= size) {
+				error(token, "the string is not terminated.");
+			}
+			i++;
+			token.type = TOKEN_STRING;
+		} else if (c == '-' && i + 2 < size && data[i + 1] == '-' && data[i + 2] == '>') {
+			token.type = TOKEN_ARROW;
+			token.text = "-->";
+			i += 3;
+		} else {
+			token.type = TOKEN_SYMBOL;
+			token.text = c;
+			if (i + 1 < size && contains(TWO_CHAR_SYMBOLS, std::string(data + i, 2))) {
+				token.text += data[i + 1];
+			}
+			i += token.text.size();
+		}
+
+		tokens.push_back(token);
+	}
+
+	Token token;
+	token.type = TOKEN_END;
+	token.line = line;
+	tokens.push_back(token);
+}
+
+/**
+ * Parse the annotation.
+ * @Range(min, max) gives the range to the next attribute, and @StartRule marks the next rule as the start rule.
+ * The other annotations are only for the user interface of CityEngine, so they are skipped.
+ */
+void TextGrammarParser::parseAnnotation() {
+	expect("@");
+	std::string name = expectIdent();
+
+	std::vector<Argument> arguments;
+	if (isSymbol("(")) {
+		parseArguments(arguments);
+	}
+
+	if (name == "Range" && arguments.size() >= 2 && isNumber(arguments[0].value) && isNumber(arguments[1].value)) {
+		has_range = true;
+		range_start = (float)atof(arguments[0].value.c_str());
+		range_end = (float)atof(arguments[1].value.c_str());
+	} else if (name == "StartRule") {
+		is_start_rule = true;
+	}
+}
+
+/**
+ * Parse the attribute, such as "attr height = 20" or "const wallTexture = "brick.jpg"".
+ * The value ends at the end of the line. The attributes are used by Grammar::evalFloat() and Grammar::evalString()
+ * without being evaluated, so the value has to be a number or a string.
+ */
+void TextGrammarParser::parseAttr(Grammar& grammar) {
+	next();
+	const Token& name_token = peek();
+	std::string name = expectIdent();
+	expect("=");
+	Argument value = parseArgument(true);
+	if (value.prefix != 0 || (!value.isString && !isNumber(value.value))) {
+		error(name_token, "the value of " + name + " has to be a number or a string.");
+	}
+
+	if (has_range) {
+		grammar.addAttr(name, Attribute(name, value.value, range_start, range_end));
+	} else {
+		grammar.addAttr(name, Attribute(name, value.value));
+	}
+	has_range = false;
+	is_start_rule = false;
+}
+
+/**
+ * Parse the rule, such as "Lot --> extrude(height) Mass".
+ * The operations are added to the rule in order, and each successor becomes a copy operator,
+ * so that the successor is derived from the shape at that point.
+ */
+void TextGrammarParser::parseRule(Grammar& grammar) {
+	const Token& name_token = peek();
+	std::string name = expectIdent();
+	if (isSymbol("(")) {
+		error(name_token, "the parameters of rule " + name + " are not supported.");
+	}
+	if (peek().type != TOKEN_ARROW) {
+		error("--> is expected after " + name + ".");
+	}
+	next();
+
+	if (grammar.contain(name)) {
+		error(name_token, "rule " + name + " is defined twice.");
+	}
+	grammar.addRule(name);
+
+	if (is_start_rule) {
+		start_rule = name;
+	}
+	has_range = false;
+	is_start_rule = false;
+
+	int num_items = 0;
+	bool nil = false;
+	while (peek().type != TOKEN_END && !isSymbol("@") && !isIdent("attr") && !isIdent("const") && !isIdent("version") && !isIdent("import") && !isRuleStart()) {
+		const Token& token = next();
+		num_items++;
+
+		if (token.type == TOKEN_IDENT) {
+			if (token.text == "case" || token.text == "else") {
+				error(token, "the conditional rule is not supported.");
+			}
+
+			if (isSymbol("(")) {
+				GrammarNode node;
+				if (parseOperation(token.text, node)) {
+					grammar.addOperator(name, parseOperator(node));
+				}
+			} else if (token.text == "NIL") {
+				nil = true;
+			} else {
+				GrammarNode node("copy");
+				node.setAttribute("name", token.text);
+				grammar.addOperator(name, parseOperator(node));
+			}
+		} else if (token.text == "[" || token.text == "]") {
+			error(token, "[ and ] are not supported.");
+		} else {
+			error(token, "unexpected '" + token.text + "' in rule " + name + ".");
+		}
+	}
+
+	// the shape is removed only if the rule has no operator
+	if (nil && num_items > 1) {
+		error(name_token, "NIL has to be the only successor of rule " + name + ".");
+	}
+}
+
+/**
+ * Parse the operation whose name has been read, and make the element of the operator.
+ *
+ * @return	false if the operation is skipped
+ */
+bool TextGrammarParser::parseOperation(const std::string& name, GrammarNode& node) {
+	std::vector<Argument> arguments;
+	parseArguments(arguments);
+
+	if (name == "comp") {
+		checkArguments(name, arguments, 1, 1);
+		if (arguments[0].value != "f") {
+			error("only comp(f) is supported.");
+		}
+		node.tagName = "comp";
+		parseCompParams(node);
+	} else if (name == "split") {
+		checkArguments(name, arguments, 1, 2);
+		if (arguments[0].value != "x" && arguments[0].value != "y" && arguments[0].value != "z") {
+			error("the axis of split has to be x, y, or z.");
+		}
+		node.tagName = "split";
+		node.setAttribute("splitAxis", arguments[0].value);
+		parseSplitParams(node, false);
+
+		// the operator repeats each part, so the whole split can be repeated only if it has one part
+		if (isSymbol("*")) {
+			if (node.children.size() != 1) {
+				error("repeating the split of two or more parts is not supported.");
+			}
+			next();
+			node.children[0].setAttribute("repeat", "true");
+		}
+	} else if (name == "extrude") {
+		checkArguments(name, arguments, 1, 2);
+		node.tagName = "extrude";
+		node.setAttribute("height", arguments.back().value);
+	} else if (name == "taper") {
+		checkArguments(name, arguments, 1, 2);
+		node.tagName = "taper";
+		node.setAttribute("height", arguments[0].value);
+		if (arguments.size() == 2) {
+			node.setAttribute("top_ratio", arguments[1].value);
+		}
+	} else if (name == "roofHip" || name == "roofGable") {
+		checkArguments(name, arguments, 1, 3);
+		node.tagName = name;
+		node.setAttribute("angle", arguments[0].value);
+	} else if (name == "offset") {
+		checkArguments(name, arguments, 1, 2);
+		node.tagName = "offset";
+		node.setAttribute("offsetDistance", arguments[0].value);
+		if (arguments.size() == 2) {
+			node.setAttribute("offsetSelector", arguments[1].value);
+		}
+	} else if (name == "i" || name == "insert") {
+		checkArguments(name, arguments, 1, 1);
+		node.tagName = "insert";
+		node.setAttribute("geometryPath", arguments[0].value);
+	} else if (name == "color") {
+		checkArguments(name, arguments, 1, 4);
+		node.tagName = "color";
+		if (arguments.size() == 1) {
+			node.setAttribute("s", arguments[0].value);
+		} else if (arguments.size() >= 3) {
+			node.setAttribute("r", arguments[0].value);
+			node.setAttribute("g", arguments[1].value);
+			node.setAttribute("b", arguments[2].value);
+		} else {
+			error("color has to have one or three arguments.");
+		}
+	} else if (name == "texture") {
+		checkArguments(name, arguments, 1, 1);
+		node.tagName = "texture";
+		node.setAttribute("texturePath", arguments[0].value);
+	} else if (name == "t" || name == "translate") {
+		// t(x, y, z) is translate(rel, object, x, y, z)
+		int first = 0;
+		node.tagName = "translate";
+		if (name == "t") {
+			checkArguments(name, arguments, 3, 3);
+			node.setAttribute("mode", "rel");
+			node.setAttribute("coordSystem", "object");
+		} else {
+			checkArguments(name, arguments, 5, 5);
+			node.setAttribute("mode", arguments[0].value);
+			node.setAttribute("coordSystem", arguments[1].value);
+			first = 2;
+		}
+		const char* names[3] = { "x", "y", "z" };
+		for (int i = 0; i < 3; ++i) {
+			GrammarNode& param = node.addParam(names[i], arguments[first + i].value);
+			param.setAttribute("type", arguments[first + i].prefix == '\'' ? "relative" : "absolute");
+		}
+	} else if (name == "s") {
+		checkArguments(name, arguments, 3, 3);
+		node.tagName = "size";
+		const char* names[3] = { "xSize", "ySize", "zSize" };
+		for (int i = 0; i < 3; ++i) {
+			GrammarNode& param = node.addParam(names[i], arguments[i].value);
+			param.setAttribute("type", arguments[i].prefix == '\'' ? "relative" : "absolute");
+		}
+	} else if (name == "r" || name == "rotate") {
+		// the mode and the coordinate system of rotate(mode, coordSystem, x, y, z) are not supported by the operator
+		if (name == "r") {
+			checkArguments(name, arguments, 3, 3);
+		} else {
+			checkArguments(name, arguments, 5, 5);
+		}
+		int first = arguments.size() - 3;
+		node.tagName = "rotate";
+		const char* names[3] = { "xAngle", "yAngle", "zAngle" };
+		for (int i = 0; i < 3; ++i) {
+			if (!isNumber(arguments[first + i].value)) {
+				error("the angles of " + name + " have to be numbers.");
+			}
+			node.addParam(names[i], arguments[first + i].value);
+		}
+	} else if (name == "center") {
+		checkArguments(name, arguments, 1, 1);
+		node.tagName = "center";
+		node.setAttribute("axesSelector", arguments[0].value);
+	} else if (name == "setupProjection") {
+		checkArguments(name, arguments, 4, 6);
+		if (arguments[1].value != "scope.xy" && arguments[1].value != "scope.xz") {
+			error("the axes of setupProjection have to be scope.xy or scope.xz.");
+		}
+		node.tagName = "setupProjection";
+		node.setAttribute("axesSelector", arguments[1].value);
+		GrammarNode& texWidth = node.addParam("texWidth", arguments[2].value);
+		texWidth.setAttribute("type", arguments[2].prefix == '\'' ? "relative" : "absolute");
+		GrammarNode& texHeight = node.addParam("texHeight", arguments[3].value);
+		texHeight.setAttribute("type", arguments[3].prefix == '\'' ? "relative" : "absolute");
+	} else if (name == "shapeL") {
+		checkArguments(name, arguments, 2, 2);
+		if (!isNumber(arguments[0].value) || !isNumber(arguments[1].value)) {
+			error("the widths of shapeL have to be numbers.");
+		}
+		node.tagName = "shapeL";
+		node.addParam("frontWidth", arguments[0].value);
+		node.addParam("leftWidth", arguments[1].value);
+	} else if (name == "cornerCut") {
+		checkArguments(name, arguments, 2, 2);
+		node.tagName = "cornerCut";
+		node.setAttribute("type", arguments[0].value);
+		node.setAttribute("length", arguments[1].value);
+	} else if (name == "innerSemiCircle") {
+		checkArguments(name, arguments, 0, 0);
+		node.tagName = "innerSemiCircle";
+	} else if (contains(IGNORED_OPERATIONS, name)) {
+		return false;
+	} else {
+		error(name + "() is not supported.");
+	}
+
+	return true;
+}
+
+/**
+ * Parse the cases of the component split, such as "{ front : Facade | side : Wall }".
+ */
+void TextGrammarParser::parseCompParams(GrammarNode& node) {
+	expect("{");
+	while (true) {
+		const Token& token = peek();
+		std::string selector = expectIdent();
+		if (!contains(COMP_SELECTORS, selector)) {
+			error(token, "the selector " + selector + " is not supported.");
+		}
+		if (isSymbol("=")) {
+			next();
+		} else {
+			expect(":");
+		}
+		node.addParam(selector, parseSuccessor());
+
+		if (!isSymbol("|")) break;
+		next();
+	}
+	expect("}");
+}
+
+/**
+ * Parse the parts of the split, such as "{ 2 : Ground | { ~3 : Floor }* | ' 0.1 : Top }".
+ * The size is absolute, relative (with '), or floating (with ~).
+ *
+ * @param repeat	true if the parts are in a repeated group
+ */
+void TextGrammarParser::parseSplitParams(GrammarNode& node, bool repeat) {
+	expect("{");
+	while (true) {
+		if (isSymbol("{")) {
+			const Token& token = peek();
+			if (repeat) {
+				error(token, "the nested repeat of split is not supported.");
+			}
+
+			// the operator repeats each part, so the group can be repeated only if it has one part
+			int first = node.children.size();
+			parseSplitParams(node, true);
+			expect("*");
+			if (node.children.size() - first != 1) {
+				error(token, "repeating two or more parts of split is not supported.");
+			}
+		} else {
+			Argument size = parseArgument(false);
+			expect(":");
+			GrammarNode& param = node.addParam(parseSuccessor(), size.value);
+			if (size.prefix == '~') {
+				param.setAttribute("type", "floating");
+			} else if (size.prefix == '\'') {
+				param.setAttribute("type", "relative");
+			} else {
+				param.setAttribute("type", "absolute");
+			}
+			if (repeat) {
+				param.setAttribute("repeat", "true");
+			}
+		}
+
+		if (!isSymbol("|")) break;
+		next();
+	}
+	expect("}");
+}
+
+/**
+ * Parse the successor of a split or a component split, which has to be a rule name or NIL.
+ */
+std::string TextGrammarParser::parseSuccessor() {
+	const Token& token = peek();
+	std::string name = expectIdent();
+	if (!isSymbol("|") && !isSymbol("}")) {
+		error(token, "the operations in split are not supported. Write them in rule " + name + ".");
+	}
+	return name;
+}
+
+/**
+ * Parse the arguments in the parentheses.
+ */
+void TextGrammarParser::parseArguments(std::vector<Argument>& arguments) {
+	expect("(");
+	if (isSymbol(")")) {
+		next();
+		return;
+	}
+
+	while (true) {
+		arguments.push_back(parseArgument(false));
+		if (!isSymbol(",")) break;
+		next();
+	}
+	expect(")");
+}
+
+void TextGrammarParser::checkArguments(const std::string& name, const std::vector<Argument>& arguments, int min_num, int max_num) const {
+	if (arguments.size() < min_num || arguments.size() > max_num) {
+		std::stringstream ss;
+		ss << name << " cannot have " << arguments.size() << " arguments.";
+		error(ss.str());
+	}
+}
+
+/**
+ * Parse the argument, which is a string, or an expression with the optional prefix (' or ~).
+ */
+TextGrammarParser::Argument TextGrammarParser::parseArgument(bool stop_at_newline) {
+	Argument argument;
+	argument.prefix = 0;
+	argument.isString = false;
+
+	if (isSymbol("'") || isSymbol("~")) {
+		argument.prefix = next().text[0];
+	}
+
+	if (peek().type == TOKEN_STRING && !(peek(1).type == TOKEN_SYMBOL && peek(1).text == "+")) {
+		argument.value = next().text;
+		argument.isString = true;
+	} else {
+		argument.value = parseExpression(stop_at_newline);
+	}
+
+	return argument;
+}
+
+/**
+ * Read the expression as text until ',', ':', '|', or the closing parenthesis at the top level.
+ *
+ * @param stop_at_newline	true if the expression ends at the end of the line
+ */
+std::string TextGrammarParser::parseExpression(bool stop_at_newline) {
+	std::string expression;
+	int line = peek().line;
+	int depth = 0;
+
+	while (peek().type != TOKEN_END) {
+		const Token& token = peek();
+		if (stop_at_newline && depth == 0 && token.line != line) break;
+
+		if (token.type == TOKEN_SYMBOL) {
+			if (token.text == "(" || token.text == "[" || token.text == "{") {
+				depth++;
+			} else if (token.text == ")" || token.text == "]" || token.text == "}") {
+				if (depth == 0) break;
+				depth--;
+			} else if (depth == 0 && (token.text == "," || token.text == ":" || token.text == "|")) {
+				break;
+			}
+		} else if (token.type == TOKEN_ARROW) {
+			error(token, "--> is not expected in the expression.");
+		} else if (token.type == TOKEN_IDENT && (token.text == "case" || token.text == "else")) {
+			error(token, "the conditional expression is not supported.");
+		}
+
+		if (token.type == TOKEN_STRING) {
+			expression += "\"" + token.text + "\"";
+		} else {
+			expression += token.text;
+		}
+		next();
+	}
+
+	if (expression.empty()) {
+		error("an expression is expected.");
+	}
+
+	return expression;
+}
+
+/**
+ * Check if the current token starts a rule, which is "Name -->" or "Name(params) -->".
+ */
+bool TextGrammarParser::isRuleStart() const {
+	if (peek().type != TOKEN_IDENT) return false;
+	if (peek(1).type == TOKEN_ARROW) return true;
+	if (peek(1).type != TOKEN_SYMBOL || peek(1).text != "(") return false;
+
+	int depth = 0;
+	for (int i = pos + 1; i < tokens.size(); ++i) {
+		if (tokens[i].type == TOKEN_END) break;
+		if (tokens[i].type != TOKEN_SYMBOL) continue;
+
+		if (tokens[i].text == "(") {
+			depth++;
+		} else if (tokens[i].text == ")") {
+			if (--depth == 0) {
+				return tokens[i + 1].type == TOKEN_ARROW;
+			}
+		}
+	}
+
+	return false;
+}
+
+bool TextGrammarParser::isSymbol(const std::string& symbol) const {
+	return peek().type == TOKEN_SYMBOL && peek().text == symbol;
+}
+
+bool TextGrammarParser::isIdent(const std::string& ident) const {
+	return peek().type == TOKEN_IDENT && peek().text == ident;
+}
+
+const TextGrammarParser::Token& TextGrammarParser::peek(int offset) const {
+	if (pos + offset >= tokens.size()) return tokens.back();
+	return tokens[pos + offset];
+}
+
+const TextGrammarParser::Token& TextGrammarParser::next() {
+	const Token& token = tokens[pos];
+	if (pos + 1 < tokens.size()) pos++;
+	return token;
+}
+
+void TextGrammarParser::expect(const std::string& symbol) {
+	if (!isSymbol(symbol)) {
+		error("'" + symbol + "' is expected.");
+	}
+	next();
+}
+
+std::string TextGrammarParser::expectIdent() {
+	if (peek().type != TOKEN_IDENT) {
+		error("a name is expected.");
+	}
+	return next().text;
+}
+
+void TextGrammarParser::error(const std::string& message) const {
+	error(peek(), message);
+}
+
+void TextGrammarParser::error(const Token& token, const std::string& message) const {
+	std::stringstream ss;
+	ss << filename << "(" << token.line << "): " << message;
+	throw ss.str();
+}
+
+void parseTextGrammar(const char* filename, Grammar& grammar) {
+	TextGrammarParser parser;
+	parser.parse(filename, grammar);
+}
+
+bool isTextGrammarFile(const char* filename) {
+	return QFileInfo(QString::fromUtf8(filename)).suffix().toLower() == "cga";
+}
+
+}
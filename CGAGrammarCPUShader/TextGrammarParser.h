@@ -0,0 +1,92 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "Grammar.h"
+#include "GrammarNode.h"
+
+namespace cga {
+
+/**
+ * Parser of the CGA text rule file (.cga), such as
+ *
+ *   @Range(10, 30)
+ *   attr height = 20
+ *   Lot --> extrude(height) Mass
+ *   Mass --> comp(f) { front : Facade | side : Wall. | top : Roof }
+ *   Facade --> split(y) { 2 : GroundFloor | { ~3 : Floor }* }
+ *
+ * The file is tokenized once, and the rules are read in one pass by recursive descent.
+ * Each operation is turned into the same GrammarNode as the element of the XML file, so that
+ * the operators are created by parseOperator() and the grammar can be cached in the binary grammar file.
+ * The expressions are kept as text and evaluated at the derivation like the ones in the XML file.
+ *
+ * This engine has no counterpart of the conditional rules (case, else), the rule parameters,
+ * the stack operations ([ and ]), the operations nested in a split or a component split, the repeat of two or more
+ * parts of a split, and the attributes defined by an expression, so they are reported as errors.
+ * cga/tutorial/simpleBuilding.cga shows the supported subset. The operations that only affect the attributes or the UV coordinates
+ * (set, projectUV, tileUV, etc.) are skipped.
+ */
+class TextGrammarParser {
+private:
+	enum { TOKEN_END = 0, TOKEN_IDENT, TOKEN_NUMBER, TOKEN_STRING, TOKEN_ARROW, TOKEN_SYMBOL };
+
+	struct Token {
+		int type;
+		std::string text;
+		int line;
+	};
+
+	/** argument of an operation, such as 'scope.sx, ~2, or "texture.png" */
+	struct Argument {
+		char prefix;
+		std::string value;
+		bool isString;
+	};
+
+	std::string filename;
+	std::vector<Token> tokens;
+	int pos;
+
+	bool has_range;
+	float range_start;
+	float range_end;
+	bool is_start_rule;
+	std::string start_rule;
+
+public:
+	TextGrammarParser() {}
+
+	void parse(const char* filename, Grammar& grammar);
+	void parse(const char* data, int size, Grammar& grammar);
+
+private:
+	void tokenize(const char* data, int size);
+
+	void parseAnnotation();
+	void parseAttr(Grammar& grammar);
+	void parseRule(Grammar& grammar);
+	bool parseOperation(const std::string& name, GrammarNode& node);
+	void parseCompParams(GrammarNode& node);
+	void parseSplitParams(GrammarNode& node, bool repeat);
+	std::string parseSuccessor();
+	void parseArguments(std::vector<Argument>& arguments);
+	void checkArguments(const std::string& name, const std::vector<Argument>& arguments, int min_num, int max_num) const;
+	Argument parseArgument(bool stop_at_newline);
+	std::string parseExpression(bool stop_at_newline);
+
+	bool isRuleStart() const;
+	bool isSymbol(const std::string& symbol) const;
+	bool isIdent(const std::string& ident) const;
+	const Token& peek(int offset = 0) const;
+	const Token& next();
+	void expect(const std::string& symbol);
+	std::string expectIdent();
+	void error(const std::string& message) const;
+	void error(const Token& token, const std::string& message) const;
+};
+
+void parseTextGrammar(const char* filename, Grammar& grammar);
+bool isTextGrammarFile(const char* filename);
+
+}
@@ -14,4 +14,9 @@ boost::shared_ptr<Shape> TextureOperator::apply(boost::shared_ptr<Shape>& shape,
 	return shape;
 }
 
+void TextureOperator::toNode(GrammarNode& node) const {
+	node.tagName = "texture";
+	node.setAttribute("texturePath", texture);
+}
+
 }
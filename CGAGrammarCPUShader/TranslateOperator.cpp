@@ -1,6 +1,7 @@
 #include "TranslateOperator.h"
 #include "CGA.h"
 #include "Shape.h"
+#include "BatchDerivation.h"
 
 namespace cga {
 
@@ -40,4 +41,40 @@ boost::shared_ptr<Shape> TranslateOperator::apply(boost::shared_ptr<Shape>& shap
 	return shape;
 }
 
+/**
+ * Translate the shapes of multiple samples.
+ * The offsets are evaluated for all the samples at once, and then each shape is translated in the same way as apply().
+ */
+void TranslateOperator::applyBatch(std::vector<boost::shared_ptr<Shape> >& shapes, const std::vector<int>& samples, BatchEvaluator& evaluator, std::vector<std::list<boost::shared_ptr<Shape> > >& stacks, std::vector<std::exception_ptr>& errors) {
+	std::vector<float> xs;
+	std::vector<float> ys;
+	std::vector<float> zs;
+	try {
+		evaluator.evalFloat(x.value, samples, shapes, xs);
+		evaluator.evalFloat(y.value, samples, shapes, ys);
+		evaluator.evalFloat(z.value, samples, shapes, zs);
+	} catch (...) {
+		// the shapes are translated one by one so that only the samples with the error fail
+		Operator::applyBatch(shapes, samples, evaluator, stacks, errors);
+		return;
+	}
+
+	for (int k = 0; k < shapes.size(); ++k) {
+		float actual_x = x.type == Value::TYPE_RELATIVE ? shapes[k]->_scope.x * xs[k] : xs[k];
+		float actual_y = y.type == Value::TYPE_RELATIVE ? shapes[k]->_scope.y * ys[k] : ys[k];
+		float actual_z = z.type == Value::TYPE_RELATIVE ? shapes[k]->_scope.z * zs[k] : zs[k];
+
+		shapes[k]->translate(mode, coordSystem, actual_x, actual_y, actual_z);
+	}
+}
+
+void TranslateOperator::toNode(GrammarNode& node) const {
+	node.tagName = "translate";
+	node.setAttribute("mode", mode == MODE_ABSOLUTE ? "abs" : "rel");
+	node.setAttribute("coordSystem", coordSystem == COORD_SYSTEM_WORLD ? "world" : "object");
+	node.addParam("x", x.value).setAttribute("type", x.typeName());
+	node.addParam("y", y.value).setAttribute("type", y.typeName());
+	node.addParam("z", z.value).setAttribute("type", z.typeName());
+}
+
 }
\ No newline at end of file
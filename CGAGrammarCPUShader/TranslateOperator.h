@@ -16,6 +16,8 @@ private:
 public:
 	TranslateOperator(int mode, int coordSystem, const Value& x, const Value& y, const Value& z);
 	boost::shared_ptr<Shape> apply(boost::shared_ptr<Shape>& shape, const Grammar& grammar, std::list<boost::shared_ptr<Shape> >& stack);
+	void applyBatch(std::vector<boost::shared_ptr<Shape> >& shapes, const std::vector<int>& samples, BatchEvaluator& evaluator, std::vector<std::list<boost::shared_ptr<Shape> > >& stacks, std::vector<std::exception_ptr>& errors);
+	void toNode(GrammarNode& node) const;
 };
 
 }
@@ -2,6 +2,7 @@
 #include <CGAL/Exact_predicates_exact_constructions_kernel.h>
 #include <CGAL/Boolean_set_operations_2.h>
 #include <list>
+#include <algorithm>
 
 namespace utils {
 
@@ -11,6 +12,188 @@ typedef CGAL::Polygon_2<Kernel>                           Polygon_2;
 typedef CGAL::Polygon_with_holes_2<Kernel>                Polygon_with_holes_2;
 typedef std::list<Polygon_with_holes_2>                   Pwh_list_2;
 
+namespace {
+
+/**
+ * Check if all the edges of the polygon are parallel to the x or y axis.
+ */
+bool is_rectilinear(const std::vector<glm::ivec2>& polygon) {
+	for (int i = 0; i < polygon.size(); ++i) {
+		const glm::ivec2& p0 = polygon[i];
+		const glm::ivec2& p1 = polygon[(i + 1) % polygon.size()];
+		if (p0.x != p1.x && p0.y != p1.y) return false;
+	}
+	return true;
+}
+
+/**
+ * Mark the cells of the compressed grid that are inside the rectilinear polygon.
+ * Each row of the cells is filled between the pairs of the vertical edges that cross the row (even-odd rule).
+ */
+void fill_rectilinear_polygon(const std::vector<glm::ivec2>& polygon, const std::vector<int>& xs, const std::vector<int>& ys, std::vector<unsigned char>& cells) {
+	int nx = xs.size() - 1;
+
+	std::vector<int> crossings;
+	for (int j = 0; j < ys.size() - 1; ++j) {
+		// use the doubled coordinates so that the center of the row is an integer
+		int yc = ys[j] + ys[j + 1];
+
+		crossings.clear();
+		for (int i = 0; i < polygon.size(); ++i) {
+			const glm::ivec2& p0 = polygon[i];
+			const glm::ivec2& p1 = polygon[(i + 1) % polygon.size()];
+			if (p0.x != p1.x) continue;
+
+			if (std::min(p0.y, p1.y) * 2 < yc && yc < std::max(p0.y, p1.y) * 2) {
+				crossings.push_back(p0.x);
+			}
+		}
+		std::sort(crossings.begin(), crossings.end());
+
+		for (int k = 0; k + 1 < crossings.size(); k += 2) {
+			int i0 = std::lower_bound(xs.begin(), xs.end(), crossings[k]) - xs.begin();
+			int i1 = std::lower_bound(xs.begin(), xs.end(), crossings[k + 1]) - xs.begin();
+			for (int i = i0; i < i1; ++i) {
+				cells[j * nx + i] = 1;
+			}
+		}
+	}
+}
+
+/**
+ * Compute the union of two rectilinear polygons with integer coordinates.
+ * The plane is divided into the cells by all the x and y coordinates of the vertices, the cells inside either polygon are marked,
+ * and the outer boundary of the marked cells is traced.
+ *
+ * @param polygon1		the first polygon
+ * @param polygon2		the second polygon
+ * @param union_polygon	[OUT] the outer boundary of the union in counter-clockwise order
+ * @return				false if the polygons do not share an area or an edge
+ */
+bool union_rectilinear_polygons(const std::vector<glm::ivec2>& polygon1, const std::vector<glm::ivec2>& polygon2, std::vector<glm::ivec2>& union_polygon) {
+	std::vector<int> xs;
+	std::vector<int> ys;
+	for (int i = 0; i < polygon1.size(); ++i) {
+		xs.push_back(polygon1[i].x);
+		ys.push_back(polygon1[i].y);
+	}
+	for (int i = 0; i < polygon2.size(); ++i) {
+		xs.push_back(polygon2[i].x);
+		ys.push_back(polygon2[i].y);
+	}
+	std::sort(xs.begin(), xs.end());
+	xs.erase(std::unique(xs.begin(), xs.end()), xs.end());
+	std::sort(ys.begin(), ys.end());
+	ys.erase(std::unique(ys.begin(), ys.end()), ys.end());
+
+	int nx = xs.size() - 1;
+	int ny = ys.size() - 1;
+	if (nx <= 0 || ny <= 0) return false;
+
+	std::vector<unsigned char> cells(nx * ny, 0);
+	fill_rectilinear_polygon(polygon1, xs, ys, cells);
+	fill_rectilinear_polygon(polygon2, xs, ys, cells);
+
+	// the union has to be one region where the cells are connected by their edges
+	int first_cell = std::find(cells.begin(), cells.end(), 1) - cells.begin();
+	if (first_cell == cells.size()) return false;
+
+	std::vector<unsigned char> visited(nx * ny, 0);
+	std::vector<int> stack(1, first_cell);
+	visited[first_cell] = 1;
+	int num_visited = 0;
+	while (!stack.empty()) {
+		int c = stack.back();
+		stack.pop_back();
+		num_visited++;
+
+		int i = c % nx;
+		int j = c / nx;
+		int neighbors[4] = { i > 0 ? c - 1 : -1, i < nx - 1 ? c + 1 : -1, j > 0 ? c - nx : -1, j < ny - 1 ? c + nx : -1 };
+		for (int k = 0; k < 4; ++k) {
+			if (neighbors[k] < 0 || !cells[neighbors[k]] || visited[neighbors[k]]) continue;
+			visited[neighbors[k]] = 1;
+			stack.push_back(neighbors[k]);
+		}
+	}
+	if (num_visited != std::count(cells.begin(), cells.end(), 1)) return false;
+
+	// collect the boundary edges of the marked cells with the inside on the left (0: +x, 1: +y, 2: -x, 3: -y)
+	const int dx[4] = { 1, 0, -1, 0 };
+	const int dy[4] = { 0, 1, 0, -1 };
+	std::vector<int> edge_from;
+	std::vector<int> edge_dir;
+	std::vector<int> outgoing((nx + 1) * (ny + 1) * 4, -1);
+	for (int j = 0; j < ny; ++j) {
+		for (int i = 0; i < nx; ++i) {
+			if (!cells[j * nx + i]) continue;
+
+			int corners[4] = { j * (nx + 1) + i, j * (nx + 1) + i + 1, (j + 1) * (nx + 1) + i + 1, (j + 1) * (nx + 1) + i };
+			bool outside[4] = { j == 0 || !cells[(j - 1) * nx + i], i == nx - 1 || !cells[j * nx + i + 1], j == ny - 1 || !cells[(j + 1) * nx + i], i == 0 || !cells[j * nx + i - 1] };
+			for (int d = 0; d < 4; ++d) {
+				if (!outside[d]) continue;
+
+				outgoing[corners[d] * 4 + d] = edge_from.size();
+				edge_from.push_back(corners[d]);
+				edge_dir.push_back(d);
+			}
+		}
+	}
+
+	// trace the loops of the edges by turning left first, which splits the loops that touch at a vertex.
+	// the outer boundary is the loop of the largest signed area.
+	std::vector<unsigned char> used(edge_from.size(), 0);
+	long long max_area = 0;
+	for (int e0 = 0; e0 < edge_from.size(); ++e0) {
+		if (used[e0]) continue;
+
+		std::vector<glm::ivec2> loop;
+		long long area = 0;
+		int e = e0;
+		do {
+			used[e] = 1;
+			int v = edge_from[e];
+			int d = edge_dir[e];
+			int to = v + dx[d] + dy[d] * (nx + 1);
+
+			glm::ivec2 p0(xs[v % (nx + 1)], ys[v / (nx + 1)]);
+			glm::ivec2 p1(xs[to % (nx + 1)], ys[to / (nx + 1)]);
+			area += (long long)p0.x * p1.y - (long long)p1.x * p0.y;
+
+			int next = -1;
+			int turns[3] = { (d + 1) % 4, d, (d + 3) % 4 };
+			for (int k = 0; k < 3 && next < 0; ++k) {
+				next = outgoing[to * 4 + turns[k]];
+			}
+
+			// keep only the corners
+			if (next >= 0 && edge_dir[next] != d) {
+				loop.push_back(p1);
+			}
+			e = next;
+		} while (e >= 0 && e != e0);
+
+		if (area > max_area) {
+			max_area = area;
+			union_polygon = loop;
+		}
+	}
+
+	return union_polygon.size() >= 3;
+}
+
+}
+
+/**
+ * Compute the union of two coplanar polygons.
+ * The coordinates on the plane are snapped to the 0.1 grid. When both polygons are rectilinear on the plane, which is the usual case
+ * for the facades, the union is computed on the integer grid. Otherwise, CGAL is used.
+ *
+ * @param polygon1		the first polygon
+ * @param polygon2		the second polygon
+ * @param union_polygon	[OUT] the outer boundary of the union
+ * @return				false if the polygons do not intersect
+ */
 bool union_polygons(const std::vector<glm::vec3>& polygon1, const std::vector<glm::vec3>& polygon2, std::vector<glm::vec3>& union_polygon) {
 	union_polygon.clear();
 
@@ -30,58 +213,87 @@ bool union_polygons(const std::vector<glm::vec3>& polygon1, const std::vector<gl
 
 	glm::mat4 inv = glm::inverse(mat);
 
-	Polygon_2 pol1;
+	// coordinates on the plane in the unit of 0.1
+	std::vector<glm::ivec2> grid1(polygon1.size());
 	float z;
 	for (int i = 0; i < polygon1.size(); ++i) {
 		glm::vec3 p = glm::vec3(inv * glm::vec4(polygon1[i], 1));
 		z = p.z;
-		pol1.push_back(Point_2(round1(p.x), round1(p.y)));
+		grid1[i] = glm::ivec2(round_to_grid(p.x), round_to_grid(p.y));
 	}
-	if (pol1.is_clockwise_oriented()) {
-		pol1.reverse_orientation();
-	}
-
-	Polygon_2 pol2;
+	std::vector<glm::ivec2> grid2(polygon2.size());
 	for (int i = 0; i < polygon2.size(); ++i) {
 		glm::vec3 p = glm::vec3(inv * glm::vec4(polygon2[i], 1));
-		pol2.push_back(Point_2(round1(p.x), round1(p.y)));
-	}
-	if (pol2.is_clockwise_oriented()) {
-		pol2.reverse_orientation();
+		grid2[i] = glm::ivec2(round_to_grid(p.x), round_to_grid(p.y));
 	}
 
-	Polygon_with_holes_2 unionPol;
-	if (CGAL::join (pol1, pol2, unionPol)) {
+	std::vector<glm::vec2> boundary;
+	if (is_rectilinear(grid1) && is_rectilinear(grid2)) {
+		std::vector<glm::ivec2> grid_union;
+		if (!union_rectilinear_polygons(grid1, grid2, grid_union)) return false;
+
+		for (int k = 0; k < grid_union.size(); ++k) {
+			boundary.push_back(glm::vec2(grid_union[k].x * 0.1f, grid_union[k].y * 0.1f));
+		}
+	} else {
+		Polygon_2 pol1;
+		for (int i = 0; i < grid1.size(); ++i) {
+			pol1.push_back(Point_2(grid1[i].x * 0.1f, grid1[i].y * 0.1f));
+		}
+		if (pol1.is_clockwise_oriented()) {
+			pol1.reverse_orientation();
+		}
+
+		Polygon_2 pol2;
+		for (int i = 0; i < grid2.size(); ++i) {
+			pol2.push_back(Point_2(grid2[i].x * 0.1f, grid2[i].y * 0.1f));
+		}
+		if (pol2.is_clockwise_oriented()) {
+			pol2.reverse_orientation();
+		}
+
+		Polygon_with_holes_2 unionPol;
+		if (!CGAL::join (pol1, pol2, unionPol)) return false;
+
 		for (int k = 0; k < unionPol.outer_boundary().size(); ++k) {
-			glm::vec3 p(CGAL::to_double(unionPol.outer_boundary()[k].x()), CGAL::to_double(unionPol.outer_boundary()[k].y()), z);
-			glm::vec3 p2 = glm::vec3(mat * glm::vec4(p, 1));
-			if (k > 0 && glm::length(union_polygon.back() - p2) < 0.1) continue;
-
-			if (k > 1 && glm::dot(glm::normalize(union_polygon.back() - union_polygon[union_polygon.size() - 2]), glm::normalize(p2 - union_polygon.back())) > 0.99) {
-				union_polygon[union_polygon.size() - 1] = p2;
-			} else {
-				union_polygon.push_back(p2);
-			}
+			boundary.push_back(glm::vec2(CGAL::to_double(unionPol.outer_boundary()[k].x()), CGAL::to_double(unionPol.outer_boundary()[k].y())));
 		}
+	}
 
-		if (union_polygon.size() > 3 && glm::dot(glm::normalize(union_polygon.back() - union_polygon[union_polygon.size() - 2]), glm::normalize(union_polygon[0] - union_polygon.back())) > 0.99) {
-			union_polygon.erase(union_polygon.begin() + union_polygon.size() - 1);
+	for (int k = 0; k < boundary.size(); ++k) {
+		glm::vec3 p(boundary[k], z);
+		glm::vec3 p2 = glm::vec3(mat * glm::vec4(p, 1));
+		if (k > 0 && glm::length(union_polygon.back() - p2) < 0.1) continue;
+
+		if (k > 1 && glm::dot(glm::normalize(union_polygon.back() - union_polygon[union_polygon.size() - 2]), glm::normalize(p2 - union_polygon.back())) > 0.99) {
+			union_polygon[union_polygon.size() - 1] = p2;
+		} else {
+			union_polygon.push_back(p2);
 		}
+	}
 
-		return true;
-	} else {
-		return false;
+	if (union_polygon.size() > 3 && glm::dot(glm::normalize(union_polygon.back() - union_polygon[union_polygon.size() - 2]), glm::normalize(union_polygon[0] - union_polygon.back())) > 0.99) {
+		union_polygon.erase(union_polygon.begin() + union_polygon.size() - 1);
 	}
+
+	return true;
 }
 
-float round1(float val) {
+/**
+ * Round the value to the 0.1 grid, and return it in the unit of 0.1.
+ */
+int round_to_grid(float val) {
 	if (val >= 0.0f) {
-		return (float)((int)(val * 10 + 0.5)) * 0.1f;
+		return (int)(val * 10 + 0.5);
 	} else {
-		return (float)((int)(val * 10 - 0.5)) * 0.1f;
+		return (int)(val * 10 - 0.5);
 	}
 }
 
+float round1(float val) {
+	return (float)round_to_grid(val) * 0.1f;
+}
+
 float round2(float val) {
 	if (val >= 0.0f) {
 		return (float)((int)(val * 100 + 0.5)) * 0.01f;
@@ -8,6 +8,7 @@
 namespace utils {
 
 bool union_polygons(const std::vector<glm::vec3>& polygon1, const std::vector<glm::vec3>& polygon2, std::vector<glm::vec3>& union_polygon);
+int round_to_grid(float val);
 float round1(float val);
 float round2(float val);
 glm::vec3 round1(const glm::vec3& v);